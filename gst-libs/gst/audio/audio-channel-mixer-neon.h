@@ -0,0 +1,128 @@
+/* GStreamer
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/* Only included when the compiler targets NEON, so unlike the x86 versions
+ * these don't need a runtime check. Results are the same as the C kernels,
+ * except that the compiler may contract the float tail loop into fused
+ * multiply-adds. */
+
+#include <arm_neon.h>
+
+static void
+mix_taps_gint16_neon (gint16 * d, const gint16 * s[],
+    const gint32 * coeffs, guint n_taps, guint samples)
+{
+  guint n = 0, t;
+
+  for (; n + 8 <= samples; n += 8) {
+    int32x4_t acc0 = vdupq_n_s32 (0);
+    int32x4_t acc1 = vdupq_n_s32 (0);
+
+    for (t = 0; t < n_taps; t++) {
+      int16x8_t x = vld1q_s16 (s[t] + n);
+      int32x4_t c = vdupq_n_s32 (coeffs[t]);
+
+      acc0 = vmlaq_s32 (acc0, vmovl_s16 (vget_low_s16 (x)), c);
+      acc1 = vmlaq_s32 (acc1, vmovl_s16 (vget_high_s16 (x)), c);
+    }
+    /* rounding shift and saturating narrow, like the C code */
+    acc0 = vaddq_s32 (acc0, vdupq_n_s32 (1 << (PRECISION_INT - 1)));
+    acc1 = vaddq_s32 (acc1, vdupq_n_s32 (1 << (PRECISION_INT - 1)));
+    vst1q_s16 (d + n,
+        vcombine_s16 (vqmovn_s32 (vshrq_n_s32 (acc0, PRECISION_INT)),
+            vqmovn_s32 (vshrq_n_s32 (acc1, PRECISION_INT))));
+  }
+  for (; n < samples; n++) {
+    gint32 res = 0;
+
+    for (t = 0; t < n_taps; t++)
+      res += s[t][n] * coeffs[t];
+    res = (res + (1 << (PRECISION_INT - 1))) >> PRECISION_INT;
+    d[n] = CLAMP (res, G_MININT16, G_MAXINT16);
+  }
+}
+
+static void
+mix_taps_gint32_neon (gint32 * d, const gint32 * s[],
+    const gint32 * coeffs, guint n_taps, guint samples)
+{
+  guint n = 0, t;
+
+  for (; n + 4 <= samples; n += 4) {
+    int64x2_t acc0 = vdupq_n_s64 (0);
+    int64x2_t acc1 = vdupq_n_s64 (0);
+
+    for (t = 0; t < n_taps; t++) {
+      int32x4_t x = vld1q_s32 (s[t] + n);
+      int32x2_t c = vdup_n_s32 (coeffs[t]);
+
+      acc0 = vmlal_s32 (acc0, vget_low_s32 (x), c);
+      acc1 = vmlal_s32 (acc1, vget_high_s32 (x), c);
+    }
+    acc0 = vaddq_s64 (acc0, vdupq_n_s64 (1 << (PRECISION_INT - 1)));
+    acc1 = vaddq_s64 (acc1, vdupq_n_s64 (1 << (PRECISION_INT - 1)));
+    vst1q_s32 (d + n,
+        vcombine_s32 (vqmovn_s64 (vshrq_n_s64 (acc0, PRECISION_INT)),
+            vqmovn_s64 (vshrq_n_s64 (acc1, PRECISION_INT))));
+  }
+  for (; n < samples; n++) {
+    gint64 res = 0;
+
+    for (t = 0; t < n_taps; t++)
+      res += s[t][n] * (gint64) coeffs[t];
+    res = (res + (1 << (PRECISION_INT - 1))) >> PRECISION_INT;
+    d[n] = CLAMP (res, G_MININT32, G_MAXINT32);
+  }
+}
+
+static void
+mix_taps_gfloat_neon (gfloat * d, const gfloat * s[],
+    const gfloat * coeffs, guint n_taps, guint samples)
+{
+  guint n = 0, t;
+
+  for (; n + 8 <= samples; n += 8) {
+    float32x4_t acc0 = vdupq_n_f32 (0.0f);
+    float32x4_t acc1 = vdupq_n_f32 (0.0f);
+
+    for (t = 0; t < n_taps; t++) {
+      float32x4_t c = vdupq_n_f32 (coeffs[t]);
+
+      acc0 = vaddq_f32 (acc0, vmulq_f32 (vld1q_f32 (s[t] + n), c));
+      acc1 = vaddq_f32 (acc1, vmulq_f32 (vld1q_f32 (s[t] + n + 4), c));
+    }
+    vst1q_f32 (d + n, acc0);
+    vst1q_f32 (d + n + 4, acc1);
+  }
+  for (; n < samples; n++) {
+    gfloat res = 0.0;
+
+    for (t = 0; t < n_taps; t++)
+      res += s[t][n] * coeffs[t];
+    d[n] = res;
+  }
+}
+
+static void
+audio_channel_mixer_check_neon (void)
+{
+  GST_DEBUG ("enable NEON optimisations");
+  mix_taps_gint16 = mix_taps_gint16_neon;
+  mix_taps_gint32 = mix_taps_gint32_neon;
+  mix_taps_gfloat = mix_taps_gfloat_neon;
+}
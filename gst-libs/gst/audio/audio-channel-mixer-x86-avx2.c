@@ -0,0 +1,150 @@
+/* GStreamer
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#endif
+
+#include "audio-channel-mixer-x86-avx2.h"
+
+#if defined (HAVE_IMMINTRIN_H) && defined (__AVX2__)
+
+#include <immintrin.h>
+
+/* Same precision as in audio-channel-mixer.c */
+#define PRECISION_INT 10
+/* Same as MAX_SIMD_TAPS in audio-channel-mixer.c, callers never pass more
+ * taps than this */
+#define MAX_TAPS 64
+
+/* These kernels produce the same results as the C versions: the taps are
+ * accumulated in the same order, 16 bit samples in wrapping 32 bit integers
+ * and 32 bit samples in 64 bit integers. No FMA is used for floats so that
+ * every product is rounded like in the C code. */
+
+void
+audio_channel_mixer_mix_taps_gint16_avx2 (gint16 * d, const gint16 * s[],
+    const gint32 * coeffs, guint n_taps, guint samples)
+{
+  __m256i c[MAX_TAPS];
+  const __m256i round = _mm256_set1_epi32 (1 << (PRECISION_INT - 1));
+  guint n = 0, t;
+
+  for (t = 0; t < n_taps; t++)
+    c[t] = _mm256_set1_epi32 (coeffs[t]);
+
+  for (; n + 8 <= samples; n += 8) {
+    __m256i acc = _mm256_setzero_si256 ();
+
+    for (t = 0; t < n_taps; t++) {
+      __m256i x = _mm256_cvtepi16_epi32 (_mm_loadu_si128 ((__m128i *)
+              (s[t] + n)));
+      acc = _mm256_add_epi32 (acc, _mm256_mullo_epi32 (x, c[t]));
+    }
+    acc = _mm256_srai_epi32 (_mm256_add_epi32 (acc, round), PRECISION_INT);
+    /* packs saturates like the CLAMP, but works per 128 bit lane */
+    acc = _mm256_permute4x64_epi64 (_mm256_packs_epi32 (acc, acc), 0xd8);
+    _mm_storeu_si128 ((__m128i *) (d + n), _mm256_castsi256_si128 (acc));
+  }
+  for (; n < samples; n++) {
+    gint32 res = 0;
+
+    for (t = 0; t < n_taps; t++)
+      res += s[t][n] * coeffs[t];
+    res = (res + (1 << (PRECISION_INT - 1))) >> PRECISION_INT;
+    d[n] = CLAMP (res, G_MININT16, G_MAXINT16);
+  }
+}
+
+void
+audio_channel_mixer_mix_taps_gint32_avx2 (gint32 * d, const gint32 * s[],
+    const gint32 * coeffs, guint n_taps, guint samples)
+{
+  __m256i c[MAX_TAPS];
+  const __m256i round = _mm256_set1_epi64x (1 << (PRECISION_INT - 1));
+  /* clamping before the shift gives the same result as clamping after it */
+  const __m256i lo = _mm256_set1_epi64x ((gint64) G_MININT32 << PRECISION_INT);
+  const __m256i hi = _mm256_set1_epi64x (((gint64) G_MAXINT32 <<
+          PRECISION_INT) + (1 << PRECISION_INT) - 1);
+  /* there is no 64 bit arithmetic shift, make the values positive and
+   * use a logical shift, the offset disappears in the low 32 bits */
+  const __m256i bias = _mm256_set1_epi64x (G_GINT64_CONSTANT (1) << 42);
+  const __m256i even = _mm256_setr_epi32 (0, 2, 4, 6, 0, 2, 4, 6);
+  guint n = 0, t;
+
+  for (t = 0; t < n_taps; t++)
+    c[t] = _mm256_set1_epi64x (coeffs[t]);
+
+  for (; n + 4 <= samples; n += 4) {
+    __m256i acc = _mm256_setzero_si256 ();
+
+    for (t = 0; t < n_taps; t++) {
+      __m256i x = _mm256_cvtepi32_epi64 (_mm_loadu_si128 ((__m128i *)
+              (s[t] + n)));
+      acc = _mm256_add_epi64 (acc, _mm256_mul_epi32 (x, c[t]));
+    }
+    acc = _mm256_add_epi64 (acc, round);
+    acc = _mm256_blendv_epi8 (acc, hi, _mm256_cmpgt_epi64 (acc, hi));
+    acc = _mm256_blendv_epi8 (acc, lo, _mm256_cmpgt_epi64 (lo, acc));
+    acc = _mm256_srli_epi64 (_mm256_add_epi64 (acc, bias), PRECISION_INT);
+    acc = _mm256_permutevar8x32_epi32 (acc, even);
+    _mm_storeu_si128 ((__m128i *) (d + n), _mm256_castsi256_si128 (acc));
+  }
+  for (; n < samples; n++) {
+    gint64 res = 0;
+
+    for (t = 0; t < n_taps; t++)
+      res += s[t][n] * (gint64) coeffs[t];
+    res = (res + (1 << (PRECISION_INT - 1))) >> PRECISION_INT;
+    d[n] = CLAMP (res, G_MININT32, G_MAXINT32);
+  }
+}
+
+void
+audio_channel_mixer_mix_taps_gfloat_avx2 (gfloat * d, const gfloat * s[],
+    const gfloat * coeffs, guint n_taps, guint samples)
+{
+  __m256 c[MAX_TAPS];
+  guint n = 0, t;
+
+  for (t = 0; t < n_taps; t++)
+    c[t] = _mm256_set1_ps (coeffs[t]);
+
+  for (; n + 16 <= samples; n += 16) {
+    __m256 acc0 = _mm256_setzero_ps ();
+    __m256 acc1 = _mm256_setzero_ps ();
+
+    for (t = 0; t < n_taps; t++) {
+      acc0 = _mm256_add_ps (acc0,
+          _mm256_mul_ps (_mm256_loadu_ps (s[t] + n), c[t]));
+      acc1 = _mm256_add_ps (acc1,
+          _mm256_mul_ps (_mm256_loadu_ps (s[t] + n + 8), c[t]));
+    }
+    _mm256_storeu_ps (d + n, acc0);
+    _mm256_storeu_ps (d + n + 8, acc1);
+  }
+  for (; n < samples; n++) {
+    gfloat res = 0.0;
+
+    for (t = 0; t < n_taps; t++)
+      res += s[t][n] * coeffs[t];
+    d[n] = res;
+  }
+}
+
+#endif
@@ -0,0 +1,36 @@
+/* GStreamer
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef AUDIO_CHANNEL_MIXER_X86_AVX2_H
+#define AUDIO_CHANNEL_MIXER_X86_AVX2_H
+
+#include <glib.h>
+
+G_GNUC_INTERNAL
+void audio_channel_mixer_mix_taps_gint16_avx2 (gint16 * d,
+    const gint16 * s[], const gint32 * coeffs, guint n_taps, guint samples);
+
+G_GNUC_INTERNAL
+void audio_channel_mixer_mix_taps_gint32_avx2 (gint32 * d,
+    const gint32 * s[], const gint32 * coeffs, guint n_taps, guint samples);
+
+G_GNUC_INTERNAL
+void audio_channel_mixer_mix_taps_gfloat_avx2 (gfloat * d,
+    const gfloat * s[], const gfloat * coeffs, guint n_taps, guint samples);
+
+#endif /* AUDIO_CHANNEL_MIXER_X86_AVX2_H */
@@ -54,6 +54,10 @@ ensure_debug_category (void)
 
 #define PRECISION_INT 10
 
+/* The SIMD tap kernels keep the broadcast coefficients in fixed-size stack
+ * arrays; output channels with more taps use the C kernels */
+#define MAX_SIMD_TAPS 64
+
 typedef void (*MixerFunc) (GstAudioChannelMixer * mix, const gpointer src[],
     gpointer dst[], gint samples);
 
@@ -70,6 +74,15 @@ struct _GstAudioChannelMixer
    * this is matrix * (2^10) as integers */
   gint **matrix_int;
 
+  /* sparse form of the matrix, compiled at setup time. For each output
+   * channel o, n_taps[o] input channels contribute, their indices are in
+   * tap_in[o * in_channels] and their coefficients in the coeffs or
+   * coeffs_int array at the same offset. Zero coefficients are left out. */
+  gint *n_taps;
+  gint *tap_in;
+  gfloat *coeffs;
+  gint32 *coeffs_int;
+
   MixerFunc func;
 };
 
@@ -95,6 +108,11 @@ gst_audio_channel_mixer_free (GstAudioChannelMixer * mix)
   g_free (mix->matrix_int);
   mix->matrix_int = NULL;
 
+  g_free (mix->n_taps);
+  g_free (mix->tap_in);
+  g_free (mix->coeffs);
+  g_free (mix->coeffs_int);
+
   g_slice_free (GstAudioChannelMixer, mix);
 }
 
@@ -673,6 +691,43 @@ gst_audio_channel_mixer_setup_matrix_int (GstAudioChannelMixer * mix)
   }
 }
 
+/* Compile the matrix into per output channel lists of the input channels
+ * that contribute to it. Integer formats use the coefficients of matrix_int,
+ * which can be zero where the float matrix is not. */
+static void
+gst_audio_channel_mixer_setup_taps (GstAudioChannelMixer * mix,
+    GstAudioFormat format)
+{
+  gint i, j, n, total = 0;
+  gboolean is_int = format == GST_AUDIO_FORMAT_S16
+      || format == GST_AUDIO_FORMAT_S32;
+
+  mix->n_taps = g_new0 (gint, mix->out_channels);
+  mix->tap_in = g_new0 (gint, mix->out_channels * mix->in_channels);
+  mix->coeffs = g_new0 (gfloat, mix->out_channels * mix->in_channels);
+  mix->coeffs_int = g_new0 (gint32, mix->out_channels * mix->in_channels);
+
+  for (j = 0; j < mix->out_channels; j++) {
+    gint offset = j * mix->in_channels;
+
+    n = 0;
+    for (i = 0; i < mix->in_channels; i++) {
+      if (is_int ? mix->matrix_int[i][j] == 0 : mix->matrix[i][j] == 0.0f)
+        continue;
+
+      mix->tap_in[offset + n] = i;
+      mix->coeffs[offset + n] = mix->matrix[i][j];
+      mix->coeffs_int[offset + n] = mix->matrix_int[i][j];
+      n++;
+    }
+    mix->n_taps[j] = n;
+    total += n;
+  }
+
+  GST_DEBUG ("%d of %d coefficients are non-zero", total,
+      mix->in_channels * mix->out_channels);
+}
+
 static gfloat **
 gst_audio_channel_mixer_setup_matrix (GstAudioChannelMixerFlags flags,
     gint in_channels, GstAudioChannelPosition * in_position,
@@ -731,7 +786,7 @@ gst_audio_channel_mixer_mix_int##bits##_##inlayout##_##outlayout ( \
     GstAudioChannelMixer * mix, const gint##bits * in_data[], \
     gint##bits * out_data[], gint samples) \
 { \
-  gint in, out, n; \
+  gint t, out, n; \
   gint##resbits res; \
   gint inchannels, outchannels; \
   \
@@ -740,12 +795,15 @@ gst_audio_channel_mixer_mix_int##bits##_##inlayout##_##outlayout ( \
   \
   for (n = 0; n < samples; n++) { \
     for (out = 0; out < outchannels; out++) { \
-      /* convert */ \
+      const gint *tap_in = &mix->tap_in[out * inchannels]; \
+      const gint32 *coeffs = &mix->coeffs_int[out * inchannels]; \
+      \
+      /* convert, only non-zero coefficients contribute */ \
       res = 0; \
-      for (in = 0; in < inchannels; in++) \
+      for (t = 0; t < mix->n_taps[out]; t++) \
         res += \
-          _get_in_data_##inlayout##_gint##bits (in_data, n, in, inchannels) * \
-          (gint##resbits) mix->matrix_int[in][out]; \
+          _get_in_data_##inlayout##_gint##bits (in_data, n, tap_in[t], inchannels) * \
+          (gint##resbits) coeffs[t]; \
       \
       /* remove factor from int matrix */ \
       res = (res + (1 << (PRECISION_INT - 1))) >> PRECISION_INT; \
@@ -761,7 +819,7 @@ gst_audio_channel_mixer_mix_##type##_##inlayout##_##outlayout ( \
     GstAudioChannelMixer * mix, const g##type * in_data[], \
     g##type * out_data[], gint samples) \
 { \
-  gint in, out, n; \
+  gint t, out, n; \
   g##type res; \
   gint inchannels, outchannels; \
   \
@@ -770,41 +828,155 @@ gst_audio_channel_mixer_mix_##type##_##inlayout##_##outlayout ( \
   \
   for (n = 0; n < samples; n++) { \
     for (out = 0; out < outchannels; out++) { \
-      /* convert */ \
+      const gint *tap_in = &mix->tap_in[out * inchannels]; \
+      const gfloat *coeffs = &mix->coeffs[out * inchannels]; \
+      \
+      /* convert, only non-zero coefficients contribute */ \
       res = 0.0; \
-      for (in = 0; in < inchannels; in++) \
+      for (t = 0; t < mix->n_taps[out]; t++) \
         res += \
-          _get_in_data_##inlayout##_g##type (in_data, n, in, inchannels) * \
-          mix->matrix[in][out]; \
+          _get_in_data_##inlayout##_g##type (in_data, n, tap_in[t], inchannels) * \
+          coeffs[t]; \
       \
       *_get_out_data_##outlayout##_g##type (out_data, n, out, outchannels) = res; \
     } \
   } \
 }
 
+/* Kernels for one planar output channel, d[n] = sum (s[t][n] * coeffs[t]).
+ * They process the samples of a channel in one go, which is what the SIMD
+ * versions vectorize over. */
+#define DEFINE_INTEGER_TAPS_FUNC(bits, resbits) \
+static void \
+mix_taps_gint##bits##_c (gint##bits * d, const gint##bits * s[], \
+    const gint32 * coeffs, guint n_taps, guint samples) \
+{ \
+  guint t, n; \
+  gint##resbits res; \
+  \
+  for (n = 0; n < samples; n++) { \
+    res = 0; \
+    for (t = 0; t < n_taps; t++) \
+      res += s[t][n] * (gint##resbits) coeffs[t]; \
+    \
+    res = (res + (1 << (PRECISION_INT - 1))) >> PRECISION_INT; \
+    d[n] = CLAMP (res, G_MININT##bits, G_MAXINT##bits); \
+  } \
+}
+
+#define DEFINE_FLOAT_TAPS_FUNC(type) \
+static void \
+mix_taps_g##type##_c (g##type * d, const g##type * s[], \
+    const gfloat * coeffs, guint n_taps, guint samples) \
+{ \
+  guint t, n; \
+  g##type res; \
+  \
+  for (n = 0; n < samples; n++) { \
+    res = 0.0; \
+    for (t = 0; t < n_taps; t++) \
+      res += s[t][n] * coeffs[t]; \
+    d[n] = res; \
+  } \
+}
+
+DEFINE_INTEGER_TAPS_FUNC (16, 32);
+DEFINE_INTEGER_TAPS_FUNC (32, 64);
+DEFINE_FLOAT_TAPS_FUNC (float);
+DEFINE_FLOAT_TAPS_FUNC (double);
+
+static void (*mix_taps_gint16) (gint16 * d, const gint16 * s[],
+    const gint32 * coeffs, guint n_taps, guint samples) = mix_taps_gint16_c;
+static void (*mix_taps_gint32) (gint32 * d, const gint32 * s[],
+    const gint32 * coeffs, guint n_taps, guint samples) = mix_taps_gint32_c;
+static void (*mix_taps_gfloat) (gfloat * d, const gfloat * s[],
+    const gfloat * coeffs, guint n_taps, guint samples) = mix_taps_gfloat_c;
+static void (*mix_taps_gdouble) (gdouble * d, const gdouble * s[],
+    const gfloat * coeffs, guint n_taps, guint samples) = mix_taps_gdouble_c;
+
+#if defined (__i386__) || defined (__x86_64__)
+#  define CHECK_X86
+#  include "audio-channel-mixer-x86.h"
+#endif
+#if defined (__ARM_NEON) || defined (__ARM_NEON__)
+#  define CHECK_NEON
+#  include "audio-channel-mixer-neon.h"
+#endif
+
+static void
+audio_channel_mixer_init (void)
+{
+  static gsize init_gonce = 0;
+
+  if (g_once_init_enter (&init_gonce)) {
+#ifdef CHECK_X86
+    audio_channel_mixer_check_x86 ();
+#endif
+#ifdef CHECK_NEON
+    audio_channel_mixer_check_neon ();
+#endif
+    g_once_init_leave (&init_gonce, 1);
+  }
+}
+
+/* An output channel that is a copy of a single input channel or silent
+ * doesn't need any arithmetic */
+#define DEFINE_PLANAR_MIX_FUNC(name, type, coeffs_field, unit) \
+static void \
+gst_audio_channel_mixer_mix_##name##_planar_planar ( \
+    GstAudioChannelMixer * mix, const type * in_data[], \
+    type * out_data[], gint samples) \
+{ \
+  const type **s; \
+  gint t, out; \
+  \
+  s = g_newa (const type *, mix->in_channels); \
+  \
+  for (out = 0; out < mix->out_channels; out++) { \
+    const gint *tap_in = &mix->tap_in[out * mix->in_channels]; \
+    gint n_taps = mix->n_taps[out]; \
+    \
+    if (n_taps == 0) { \
+      memset (out_data[out], 0, samples * sizeof (type)); \
+    } else if (n_taps == 1 && \
+        mix->coeffs_field[out * mix->in_channels] == unit) { \
+      memcpy (out_data[out], in_data[tap_in[0]], samples * sizeof (type)); \
+    } else { \
+      for (t = 0; t < n_taps; t++) \
+        s[t] = in_data[tap_in[t]]; \
+      if (n_taps > MAX_SIMD_TAPS) \
+        mix_taps_##type##_c (out_data[out], s, \
+            &mix->coeffs_field[out * mix->in_channels], n_taps, samples); \
+      else \
+        mix_taps_##type (out_data[out], s, \
+            &mix->coeffs_field[out * mix->in_channels], n_taps, samples); \
+    } \
+  } \
+}
+
 DEFINE_GET_DATA_FUNCS (gint16);
 DEFINE_INTEGER_MIX_FUNC (16, 32, interleaved, interleaved);
 DEFINE_INTEGER_MIX_FUNC (16, 32, interleaved, planar);
 DEFINE_INTEGER_MIX_FUNC (16, 32, planar, interleaved);
-DEFINE_INTEGER_MIX_FUNC (16, 32, planar, planar);
+DEFINE_PLANAR_MIX_FUNC (int16, gint16, coeffs_int, 1 << PRECISION_INT);
 
 DEFINE_GET_DATA_FUNCS (gint32);
 DEFINE_INTEGER_MIX_FUNC (32, 64, interleaved, interleaved);
 DEFINE_INTEGER_MIX_FUNC (32, 64, interleaved, planar);
 DEFINE_INTEGER_MIX_FUNC (32, 64, planar, interleaved);
-DEFINE_INTEGER_MIX_FUNC (32, 64, planar, planar);
+DEFINE_PLANAR_MIX_FUNC (int32, gint32, coeffs_int, 1 << PRECISION_INT);
 
 DEFINE_GET_DATA_FUNCS (gfloat);
 DEFINE_FLOAT_MIX_FUNC (float, interleaved, interleaved);
 DEFINE_FLOAT_MIX_FUNC (float, interleaved, planar);
 DEFINE_FLOAT_MIX_FUNC (float, planar, interleaved);
-DEFINE_FLOAT_MIX_FUNC (float, planar, planar);
+DEFINE_PLANAR_MIX_FUNC (float, gfloat, coeffs, 1.0f);
 
 DEFINE_GET_DATA_FUNCS (gdouble);
 DEFINE_FLOAT_MIX_FUNC (double, interleaved, interleaved);
 DEFINE_FLOAT_MIX_FUNC (double, interleaved, planar);
 DEFINE_FLOAT_MIX_FUNC (double, planar, interleaved);
-DEFINE_FLOAT_MIX_FUNC (double, planar, planar);
+DEFINE_PLANAR_MIX_FUNC (double, gdouble, coeffs, 1.0f);
 
 /**
  * gst_audio_channel_mixer_new_with_matrix: (skip):
@@ -857,7 +1029,10 @@ gst_audio_channel_mixer_new_with_matrix (GstAudioChannelMixerFlags flags,
     mix->matrix = matrix;
   }
 
+  audio_channel_mixer_init ();
+
   gst_audio_channel_mixer_setup_matrix_int (mix);
+  gst_audio_channel_mixer_setup_taps (mix, format);
 
 #ifndef GST_DISABLE_GST_DEBUG
   /* debug */
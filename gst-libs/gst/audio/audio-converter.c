@@ -116,6 +116,10 @@ struct _GstAudioConverter
   /* unpack */
   gboolean in_default;
   gboolean unpack_ip;
+  /* unpack deinterleaves into planar samples */
+  gboolean unpack_deinterleave;
+  gpointer unpack_tmp;
+  gsize unpack_tmp_size;
 
   /* convert in */
   AudioConvertFunc convert_in;
@@ -440,6 +444,143 @@ get_temp_samples (AudioChain * chain, gsize num_samples, gpointer user_data)
   return chain->tmp;
 }
 
+#define MAKE_INTERLEAVE_FUNC(type) \
+static inline void \
+interleave_##type (const type * in[], type * out[], \
+    gsize num_samples, gint channels) \
+{ \
+  gsize s; \
+  gint c; \
+  for (s = 0; s < num_samples; s++) { \
+    for (c = 0; c < channels; c++) { \
+      out[0][s * channels + c] = in[c][s]; \
+    } \
+  } \
+}
+
+#define MAKE_DEINTERLEAVE_FUNC(type) \
+static inline void \
+deinterleave_##type (const type * in[], type * out[], \
+    gsize num_samples, gint channels) \
+{ \
+  gsize s; \
+  gint c; \
+  for (s = 0; s < num_samples; s++) { \
+    for (c = 0; c < channels; c++) { \
+      out[c][s] = in[0][s * channels + c]; \
+    } \
+  } \
+}
+
+MAKE_INTERLEAVE_FUNC (gint16);
+MAKE_INTERLEAVE_FUNC (gint32);
+MAKE_INTERLEAVE_FUNC (gfloat);
+MAKE_INTERLEAVE_FUNC (gdouble);
+MAKE_DEINTERLEAVE_FUNC (gint16);
+MAKE_DEINTERLEAVE_FUNC (gint32);
+MAKE_DEINTERLEAVE_FUNC (gfloat);
+MAKE_DEINTERLEAVE_FUNC (gdouble);
+
+static void
+interleave_samples (GstAudioFormat format, gpointer in[], gpointer out[],
+    gsize num_samples, gint channels)
+{
+  switch (format) {
+    case GST_AUDIO_FORMAT_S16:
+      interleave_gint16 ((const gint16 **) in, (gint16 **) out,
+          num_samples, channels);
+      break;
+    case GST_AUDIO_FORMAT_S32:
+      interleave_gint32 ((const gint32 **) in, (gint32 **) out,
+          num_samples, channels);
+      break;
+    case GST_AUDIO_FORMAT_F32:
+      interleave_gfloat ((const gfloat **) in, (gfloat **) out,
+          num_samples, channels);
+      break;
+    case GST_AUDIO_FORMAT_F64:
+      interleave_gdouble ((const gdouble **) in, (gdouble **) out,
+          num_samples, channels);
+      break;
+    default:
+      g_assert_not_reached ();
+      break;
+  }
+}
+
+static void
+deinterleave_samples (GstAudioFormat format, gpointer in[], gpointer out[],
+    gsize num_samples, gint channels)
+{
+  switch (format) {
+    case GST_AUDIO_FORMAT_S16:
+      deinterleave_gint16 ((const gint16 **) in, (gint16 **) out,
+          num_samples, channels);
+      break;
+    case GST_AUDIO_FORMAT_S32:
+      deinterleave_gint32 ((const gint32 **) in, (gint32 **) out,
+          num_samples, channels);
+      break;
+    case GST_AUDIO_FORMAT_F32:
+      deinterleave_gfloat ((const gfloat **) in, (gfloat **) out,
+          num_samples, channels);
+      break;
+    case GST_AUDIO_FORMAT_F64:
+      deinterleave_gdouble ((const gdouble **) in, (gdouble **) out,
+          num_samples, channels);
+      break;
+    default:
+      g_assert_not_reached ();
+      break;
+  }
+}
+
+/* unpack interleaved input into planar samples, the only place where the
+ * input is deinterleaved when the converter works on planar samples */
+static gboolean
+do_unpack_deinterleave (AudioChain * chain, gpointer user_data)
+{
+  GstAudioConverter *convert = user_data;
+  gsize num_samples;
+  gpointer *tmp;
+  gint i;
+
+  num_samples = convert->in_frames;
+  tmp = audio_chain_alloc_samples (chain, num_samples);
+
+  if (convert->in_data) {
+    gpointer in[1];
+
+    if (convert->in_default) {
+      in[0] = convert->in_data[0];
+    } else {
+      gsize size = num_samples * chain->blocks * chain->stride;
+
+      if (size > convert->unpack_tmp_size) {
+        convert->unpack_tmp = g_realloc (convert->unpack_tmp, size);
+        convert->unpack_tmp_size = size;
+      }
+      in[0] = convert->unpack_tmp;
+
+      GST_LOG ("unpack %p, %p, %" G_GSIZE_FORMAT, in[0],
+          convert->in_data[0], num_samples);
+      convert->in.finfo->unpack_func (convert->in.finfo,
+          GST_AUDIO_PACK_FLAG_TRUNCATE_RANGE, in[0], convert->in_data[0],
+          num_samples * chain->blocks);
+    }
+    GST_LOG ("deinterleave %p, %p, %" G_GSIZE_FORMAT, in[0], tmp,
+        num_samples);
+    deinterleave_samples (chain->finfo->format, in, tmp, num_samples,
+        chain->blocks);
+  } else {
+    for (i = 0; i < chain->blocks; i++)
+      gst_audio_format_info_fill_silence (chain->finfo, tmp[i], num_samples);
+  }
+  audio_chain_set_samples (chain, tmp, num_samples);
+
+  return TRUE;
+}
+
 static gboolean
 do_unpack (AudioChain * chain, gpointer user_data)
 {
@@ -589,43 +730,6 @@ do_quantize (AudioChain * chain, gpointer user_data)
   return TRUE;
 }
 
-#define MAKE_INTERLEAVE_FUNC(type) \
-static inline void \
-interleave_##type (const type * in[], type * out[], \
-    gsize num_samples, gint channels) \
-{ \
-  gsize s; \
-  gint c; \
-  for (s = 0; s < num_samples; s++) { \
-    for (c = 0; c < channels; c++) { \
-      out[0][s * channels + c] = in[c][s]; \
-    } \
-  } \
-}
-
-#define MAKE_DEINTERLEAVE_FUNC(type) \
-static inline void \
-deinterleave_##type (const type * in[], type * out[], \
-    gsize num_samples, gint channels) \
-{ \
-  gsize s; \
-  gint c; \
-  for (s = 0; s < num_samples; s++) { \
-    for (c = 0; c < channels; c++) { \
-      out[c][s] = in[0][s * channels + c]; \
-    } \
-  } \
-}
-
-MAKE_INTERLEAVE_FUNC (gint16);
-MAKE_INTERLEAVE_FUNC (gint32);
-MAKE_INTERLEAVE_FUNC (gfloat);
-MAKE_INTERLEAVE_FUNC (gdouble);
-MAKE_DEINTERLEAVE_FUNC (gint16);
-MAKE_DEINTERLEAVE_FUNC (gint32);
-MAKE_DEINTERLEAVE_FUNC (gfloat);
-MAKE_DEINTERLEAVE_FUNC (gdouble);
-
 static gboolean
 do_change_layout (AudioChain * chain, gpointer user_data)
 {
@@ -640,53 +744,11 @@ do_change_layout (AudioChain * chain, gpointer user_data)
   out = (chain->allow_ip ? in : audio_chain_alloc_samples (chain, num_samples));
 
   if (out_layout == GST_AUDIO_LAYOUT_INTERLEAVED) {
-    /* interleave */
     GST_LOG ("interleaving %p, %p %" G_GSIZE_FORMAT, in, out, num_samples);
-    switch (format) {
-      case GST_AUDIO_FORMAT_S16:
-        interleave_gint16 ((const gint16 **) in, (gint16 **) out,
-            num_samples, channels);
-        break;
-      case GST_AUDIO_FORMAT_S32:
-        interleave_gint32 ((const gint32 **) in, (gint32 **) out,
-            num_samples, channels);
-        break;
-      case GST_AUDIO_FORMAT_F32:
-        interleave_gfloat ((const gfloat **) in, (gfloat **) out,
-            num_samples, channels);
-        break;
-      case GST_AUDIO_FORMAT_F64:
-        interleave_gdouble ((const gdouble **) in, (gdouble **) out,
-            num_samples, channels);
-        break;
-      default:
-        g_assert_not_reached ();
-        break;
-    }
+    interleave_samples (format, in, out, num_samples, channels);
   } else {
-    /* deinterleave */
     GST_LOG ("deinterleaving %p, %p %" G_GSIZE_FORMAT, in, out, num_samples);
-    switch (format) {
-      case GST_AUDIO_FORMAT_S16:
-        deinterleave_gint16 ((const gint16 **) in, (gint16 **) out,
-            num_samples, channels);
-        break;
-      case GST_AUDIO_FORMAT_S32:
-        deinterleave_gint32 ((const gint32 **) in, (gint32 **) out,
-            num_samples, channels);
-        break;
-      case GST_AUDIO_FORMAT_F32:
-        deinterleave_gfloat ((const gfloat **) in, (gfloat **) out,
-            num_samples, channels);
-        break;
-      case GST_AUDIO_FORMAT_F64:
-        deinterleave_gdouble ((const gdouble **) in, (gdouble **) out,
-            num_samples, channels);
-        break;
-      default:
-        g_assert_not_reached ();
-        break;
-    }
+    deinterleave_samples (format, in, out, num_samples, channels);
   }
 
   audio_chain_set_samples (chain, out, num_samples);
@@ -701,6 +763,21 @@ is_intermediate_format (GstAudioFormat format)
       format == GST_AUDIO_FORMAT_F32 || format == GST_AUDIO_FORMAT_F64);
 }
 
+/* whether the channel mixer will have work to do, it is only created after
+ * the unpack step */
+static gboolean
+need_mix (GstAudioConverter * convert)
+{
+  GstAudioInfo *in = &convert->in;
+  GstAudioInfo *out = &convert->out;
+
+  if (GET_OPT_MIX_MATRIX (convert) || in->channels != out->channels)
+    return TRUE;
+
+  return memcmp (in->position, out->position,
+      in->channels * sizeof (in->position[0])) != 0;
+}
+
 static AudioChain *
 chain_unpack (GstAudioConverter * convert)
 {
@@ -727,10 +804,30 @@ chain_unpack (GstAudioConverter * convert)
       gst_audio_format_to_string (in->finfo->format),
       gst_audio_format_to_string (convert->current_format));
 
+  /* Multichannel samples that are mixed are processed planar when they have
+   * to be deinterleaved anyway, either for planar output or by the
+   * resampler, which keeps planar history. Deinterleave once while
+   * unpacking so that mixing and resampling work on contiguous channels,
+   * the resampler or the final layout change interleave again if needed. */
+  if (in->layout == GST_AUDIO_LAYOUT_INTERLEAVED && in->channels > 1 &&
+      need_mix (convert) &&
+      (out->layout == GST_AUDIO_LAYOUT_NON_INTERLEAVED ||
+          in->rate != out->rate ||
+          (convert->flags & GST_AUDIO_CONVERTER_FLAG_VARIABLE_RATE))) {
+    GST_INFO ("deinterleave while unpacking");
+    convert->unpack_deinterleave = TRUE;
+    convert->current_layout = GST_AUDIO_LAYOUT_NON_INTERLEAVED;
+  }
+
   prev = audio_chain_new (NULL, convert);
-  prev->allow_ip = prev->finfo->width <= in->finfo->width;
   prev->pass_alloc = FALSE;
-  audio_chain_set_make_func (prev, do_unpack, convert, NULL);
+  if (convert->unpack_deinterleave) {
+    prev->allow_ip = FALSE;
+    audio_chain_set_make_func (prev, do_unpack_deinterleave, convert, NULL);
+  } else {
+    prev->allow_ip = prev->finfo->width <= in->finfo->width;
+    audio_chain_set_make_func (prev, do_unpack, convert, NULL);
+  }
 
   return prev;
 }
@@ -985,7 +1082,9 @@ chain_quantize (GstAudioConverter * convert, AudioChain * prev)
       && convert->current_format == GST_AUDIO_FORMAT_S32) {
     GST_INFO ("quantize to %d bits, dither %d, ns %d", out_depth, dither, ns);
     convert->quant =
-        gst_audio_quantize_new (dither, ns, 0, convert->current_format,
+        gst_audio_quantize_new (dither, ns,
+        convert->current_layout == GST_AUDIO_LAYOUT_NON_INTERLEAVED ?
+        GST_AUDIO_QUANTIZE_FLAG_NON_INTERLEAVED : 0, convert->current_format,
         out->channels, 1U << (32 - out_depth));
 
     prev = audio_chain_new (prev, convert);
@@ -1389,7 +1488,10 @@ gst_audio_converter_new (GstAudioConverterFlags flags, GstAudioInfo * in_info,
           convert->passthrough = TRUE;
         }
       } else {
-        if (is_intermediate_format (in_info->finfo->format)) {
+        /* the resampler expects planar input when unpacking deinterleaves,
+         * this can only happen with an identity mix matrix */
+        if (is_intermediate_format (in_info->finfo->format) &&
+            !convert->unpack_deinterleave) {
           GST_INFO ("same formats, and passthrough mixing -> only resampling");
           convert->convert = converter_resample;
         }
@@ -1470,6 +1572,7 @@ gst_audio_converter_free (GstAudioConverter * convert)
     gst_audio_channel_mixer_free (convert->mix);
   if (convert->resampler)
     gst_audio_resampler_free (convert->resampler);
+  g_free (convert->unpack_tmp);
   gst_audio_info_init (&convert->in);
   gst_audio_info_init (&convert->out);
 
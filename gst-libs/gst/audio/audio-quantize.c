@@ -64,6 +64,12 @@ struct _GstAudioQuantize
   gpointer coeffs;
   gint n_coeffs;
 
+  /* for non-interleaved samples, the error and random history of each
+   * channel, swapped in and out of error_buf and last_random */
+  guint n_history;
+  gint32 *block_errors;
+  gint32 *block_random;
+
   QuantizeFunc quantize;
 };
 
@@ -399,6 +405,26 @@ gst_audio_quantize_setup_quantize_func (GstAudioQuantize * quant)
   quant->quantize = quantize_funcs[index];
 }
 
+static void
+gst_audio_quantize_setup_history (GstAudioQuantize * quant)
+{
+  if (quant->blocks == 1 || quant->shift == 0)
+    return;
+
+  /* the quantize functions keep the history of the last samples at the
+   * start of error_buf, it is shared by all blocks so keep a copy for
+   * each channel */
+  if (quant->ns == GST_AUDIO_NOISE_SHAPING_ERROR_FEEDBACK)
+    quant->n_history = 1;
+  else if (quant->ns > GST_AUDIO_NOISE_SHAPING_ERROR_FEEDBACK)
+    quant->n_history = quant->n_coeffs;
+
+  if (quant->n_history)
+    quant->block_errors = g_new0 (gint32, quant->n_history * quant->blocks);
+  if (quant->last_random)
+    quant->block_random = g_new0 (gint32, quant->blocks);
+}
+
 static gint
 count_power (guint v)
 {
@@ -463,6 +489,7 @@ gst_audio_quantize_new (GstAudioDitherMethod dither,
   gst_audio_quantize_setup_dither (quant);
   gst_audio_quantize_setup_noise_shaping (quant);
   gst_audio_quantize_setup_quantize_func (quant);
+  gst_audio_quantize_setup_history (quant);
 
   return quant;
 }
@@ -482,6 +509,8 @@ gst_audio_quantize_free (GstAudioQuantize * quant)
   g_free (quant->coeffs);
   g_free (quant->last_random);
   g_free (quant->dither_buf);
+  g_free (quant->block_errors);
+  g_free (quant->block_random);
 
   g_slice_free (GstAudioQuantize, quant);
 }
@@ -499,6 +528,12 @@ gst_audio_quantize_reset (GstAudioQuantize * quant)
   g_free (quant->error_buf);
   quant->error_buf = NULL;
   quant->error_size = 0;
+
+  if (quant->block_errors)
+    memset (quant->block_errors, 0,
+        quant->n_history * quant->blocks * sizeof (gint32));
+  if (quant->block_random)
+    memset (quant->block_random, 0, quant->blocks * sizeof (gint32));
 }
 
 /**
@@ -529,6 +564,25 @@ gst_audio_quantize_samples (GstAudioQuantize * quant,
   g_return_if_fail (out != NULL || samples == 0);
   g_return_if_fail (in != NULL || samples == 0);
 
-  for (i = 0; i < quant->blocks; i++)
+  if (quant->blocks == 1) {
+    quant->quantize (quant, in[0], out[0], samples);
+    return;
+  }
+
+  for (i = 0; i < quant->blocks; i++) {
+    gint32 *errors = quant->block_errors + i * quant->n_history;
+
+    /* restore the history of this channel */
+    if (quant->block_errors && quant->error_size)
+      memcpy (quant->error_buf, errors, quant->n_history * sizeof (gint32));
+    if (quant->block_random)
+      *(gint32 *) quant->last_random = quant->block_random[i];
+
     quant->quantize (quant, in[i], out[i], samples);
+
+    if (quant->block_errors)
+      memcpy (errors, quant->error_buf, quant->n_history * sizeof (gint32));
+    if (quant->block_random)
+      quant->block_random[i] = *(gint32 *) quant->last_random;
+  }
 }
@@ -75,15 +75,13 @@ struct _GstAudioResampler
   /* temp taps */
   gpointer tmp_taps;
 
-  /* oversampled main filter table */
+  /* oversampled main filter table, shared with other resamplers */
   gint oversample;
   gint n_taps;
   gpointer taps;
-  gpointer taps_mem;
   gsize taps_stride;
+  struct _TapsTable *taps_table;
   gint n_phases;
-  gint alloc_taps;
-  gint alloc_phases;
 
   /* cached taps */
   gpointer *cached_phases;
@@ -108,6 +106,12 @@ struct _GstAudioResampler
   gsize samples_len;
   gsize samples_avail;
   gpointer *sbuf;
+
+  /* channel groups resampled in parallel */
+  guint n_threads;
+  struct _GstParallelizedTaskRunner *runner;
+  struct _ResampleTask *tasks;
+  gpointer *task_data;
 };
 
 #endif /* __GST_AUDIO_RESAMPLER_PRIVATE_H__ */
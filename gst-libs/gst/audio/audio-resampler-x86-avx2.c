@@ -0,0 +1,498 @@
+/* GStreamer
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#endif
+
+#include "audio-resampler-x86-avx2.h"
+
+#if defined (HAVE_IMMINTRIN_H) && defined (__AVX2__) && defined (__FMA__)
+
+#include <immintrin.h>
+
+/* The loops never read further past @len than the SSE versions do, the
+ * filter memory is padded for that. The integer versions keep the partial
+ * sums in the same lanes as the SSE2 and SSE4.1 versions and finish them
+ * the same way, so they give the same results. */
+
+static inline gfloat
+hsum_ps (__m256 v)
+{
+  __m128 s = _mm_add_ps (_mm256_castps256_ps128 (v),
+      _mm256_extractf128_ps (v, 1));
+
+  s = _mm_add_ps (s, _mm_movehl_ps (s, s));
+  s = _mm_add_ss (s, _mm_shuffle_ps (s, s, 0x55));
+  return _mm_cvtss_f32 (s);
+}
+
+static inline gdouble
+hsum_pd (__m256d v)
+{
+  __m128d s = _mm_add_pd (_mm256_castpd256_pd128 (v),
+      _mm256_extractf128_pd (v, 1));
+
+  s = _mm_add_sd (s, _mm_unpackhi_pd (s, s));
+  return _mm_cvtsd_f64 (s);
+}
+
+/* fold the 8 lanes onto the 4 lanes the SSE2 version uses */
+static inline __m128i
+fold_epi32 (__m256i v)
+{
+  return _mm_add_epi32 (_mm256_castsi256_si128 (v),
+      _mm256_extracti128_si256 (v, 1));
+}
+
+static inline void
+inner_product_gfloat_full_1_avx2 (gfloat * o, const gfloat * a,
+    const gfloat * b, gint len, const gfloat * icoeff, gint bstride)
+{
+  gint i = 0;
+  __m256 sum[2];
+
+  sum[0] = sum[1] = _mm256_setzero_ps ();
+
+  for (; i + 16 <= len; i += 16) {
+    sum[0] = _mm256_fmadd_ps (_mm256_loadu_ps (a + i + 0),
+        _mm256_loadu_ps (b + i + 0), sum[0]);
+    sum[1] = _mm256_fmadd_ps (_mm256_loadu_ps (a + i + 8),
+        _mm256_loadu_ps (b + i + 8), sum[1]);
+  }
+  for (; i < len; i += 8)
+    sum[0] = _mm256_fmadd_ps (_mm256_loadu_ps (a + i),
+        _mm256_loadu_ps (b + i), sum[0]);
+
+  *o = hsum_ps (_mm256_add_ps (sum[0], sum[1]));
+}
+
+static inline void
+inner_product_gfloat_linear_1_avx2 (gfloat * o, const gfloat * a,
+    const gfloat * b, gint len, const gfloat * icoeff, gint bstride)
+{
+  gint i = 0;
+  __m256 sum[2], t;
+  const gfloat *c[2] = { (gfloat *) ((gint8 *) b + 0 * bstride),
+    (gfloat *) ((gint8 *) b + 1 * bstride)
+  };
+
+  sum[0] = sum[1] = _mm256_setzero_ps ();
+
+  for (; i < len; i += 8) {
+    t = _mm256_loadu_ps (a + i);
+    sum[0] = _mm256_fmadd_ps (t, _mm256_loadu_ps (c[0] + i), sum[0]);
+    sum[1] = _mm256_fmadd_ps (t, _mm256_loadu_ps (c[1] + i), sum[1]);
+  }
+  sum[0] = _mm256_fmadd_ps (_mm256_sub_ps (sum[0], sum[1]),
+      _mm256_broadcast_ss (icoeff), sum[1]);
+
+  *o = hsum_ps (sum[0]);
+}
+
+static inline void
+inner_product_gfloat_cubic_1_avx2 (gfloat * o, const gfloat * a,
+    const gfloat * b, gint len, const gfloat * icoeff, gint bstride)
+{
+  gint i = 0;
+  __m256 sum[4], t;
+  const gfloat *c[4] = { (gfloat *) ((gint8 *) b + 0 * bstride),
+    (gfloat *) ((gint8 *) b + 1 * bstride),
+    (gfloat *) ((gint8 *) b + 2 * bstride),
+    (gfloat *) ((gint8 *) b + 3 * bstride)
+  };
+
+  sum[0] = sum[1] = sum[2] = sum[3] = _mm256_setzero_ps ();
+
+  for (; i < len; i += 8) {
+    t = _mm256_loadu_ps (a + i);
+    sum[0] = _mm256_fmadd_ps (t, _mm256_loadu_ps (c[0] + i), sum[0]);
+    sum[1] = _mm256_fmadd_ps (t, _mm256_loadu_ps (c[1] + i), sum[1]);
+    sum[2] = _mm256_fmadd_ps (t, _mm256_loadu_ps (c[2] + i), sum[2]);
+    sum[3] = _mm256_fmadd_ps (t, _mm256_loadu_ps (c[3] + i), sum[3]);
+  }
+  sum[0] = _mm256_mul_ps (sum[0], _mm256_broadcast_ss (icoeff + 0));
+  sum[0] = _mm256_fmadd_ps (sum[1], _mm256_broadcast_ss (icoeff + 1), sum[0]);
+  sum[0] = _mm256_fmadd_ps (sum[2], _mm256_broadcast_ss (icoeff + 2), sum[0]);
+  sum[0] = _mm256_fmadd_ps (sum[3], _mm256_broadcast_ss (icoeff + 3), sum[0]);
+
+  *o = hsum_ps (sum[0]);
+}
+
+static inline void
+inner_product_gdouble_full_1_avx2 (gdouble * o, const gdouble * a,
+    const gdouble * b, gint len, const gdouble * icoeff, gint bstride)
+{
+  gint i = 0;
+  __m256d sum[2];
+
+  sum[0] = sum[1] = _mm256_setzero_pd ();
+
+  for (; i < len; i += 8) {
+    sum[0] = _mm256_fmadd_pd (_mm256_loadu_pd (a + i + 0),
+        _mm256_loadu_pd (b + i + 0), sum[0]);
+    sum[1] = _mm256_fmadd_pd (_mm256_loadu_pd (a + i + 4),
+        _mm256_loadu_pd (b + i + 4), sum[1]);
+  }
+
+  *o = hsum_pd (_mm256_add_pd (sum[0], sum[1]));
+}
+
+static inline void
+inner_product_gdouble_linear_1_avx2 (gdouble * o, const gdouble * a,
+    const gdouble * b, gint len, const gdouble * icoeff, gint bstride)
+{
+  gint i = 0;
+  __m256d sum[2], t;
+  const gdouble *c[2] = { (gdouble *) ((gint8 *) b + 0 * bstride),
+    (gdouble *) ((gint8 *) b + 1 * bstride)
+  };
+
+  sum[0] = sum[1] = _mm256_setzero_pd ();
+
+  for (; i < len; i += 4) {
+    t = _mm256_loadu_pd (a + i);
+    sum[0] = _mm256_fmadd_pd (t, _mm256_loadu_pd (c[0] + i), sum[0]);
+    sum[1] = _mm256_fmadd_pd (t, _mm256_loadu_pd (c[1] + i), sum[1]);
+  }
+  sum[0] = _mm256_fmadd_pd (_mm256_sub_pd (sum[0], sum[1]),
+      _mm256_broadcast_sd (icoeff), sum[1]);
+
+  *o = hsum_pd (sum[0]);
+}
+
+static inline void
+inner_product_gdouble_cubic_1_avx2 (gdouble * o, const gdouble * a,
+    const gdouble * b, gint len, const gdouble * icoeff, gint bstride)
+{
+  gint i = 0;
+  __m256d sum[4], t;
+  const gdouble *c[4] = { (gdouble *) ((gint8 *) b + 0 * bstride),
+    (gdouble *) ((gint8 *) b + 1 * bstride),
+    (gdouble *) ((gint8 *) b + 2 * bstride),
+    (gdouble *) ((gint8 *) b + 3 * bstride)
+  };
+
+  sum[0] = sum[1] = sum[2] = sum[3] = _mm256_setzero_pd ();
+
+  for (; i < len; i += 4) {
+    t = _mm256_loadu_pd (a + i);
+    sum[0] = _mm256_fmadd_pd (t, _mm256_loadu_pd (c[0] + i), sum[0]);
+    sum[1] = _mm256_fmadd_pd (t, _mm256_loadu_pd (c[1] + i), sum[1]);
+    sum[2] = _mm256_fmadd_pd (t, _mm256_loadu_pd (c[2] + i), sum[2]);
+    sum[3] = _mm256_fmadd_pd (t, _mm256_loadu_pd (c[3] + i), sum[3]);
+  }
+  sum[0] = _mm256_mul_pd (sum[0], _mm256_broadcast_sd (icoeff + 0));
+  sum[0] = _mm256_fmadd_pd (sum[1], _mm256_broadcast_sd (icoeff + 1), sum[0]);
+  sum[0] = _mm256_fmadd_pd (sum[2], _mm256_broadcast_sd (icoeff + 2), sum[0]);
+  sum[0] = _mm256_fmadd_pd (sum[3], _mm256_broadcast_sd (icoeff + 3), sum[0]);
+
+  *o = hsum_pd (sum[0]);
+}
+
+static inline void
+inner_product_gint16_full_1_avx2 (gint16 * o, const gint16 * a,
+    const gint16 * b, gint len, const gint16 * icoeff, gint bstride)
+{
+  gint i;
+  __m256i sum8;
+  __m128i sum;
+
+  sum8 = _mm256_setzero_si256 ();
+
+  for (i = 0; i < len; i += 16)
+    sum8 = _mm256_add_epi32 (sum8,
+        _mm256_madd_epi16 (_mm256_loadu_si256 ((__m256i *) (a + i)),
+            _mm256_loadu_si256 ((__m256i *) (b + i))));
+
+  sum = fold_epi32 (sum8);
+  sum = _mm_add_epi32 (sum, _mm_shuffle_epi32 (sum, _MM_SHUFFLE (2, 3, 2, 3)));
+  sum = _mm_add_epi32 (sum, _mm_shuffle_epi32 (sum, _MM_SHUFFLE (1, 1, 1, 1)));
+
+  sum = _mm_add_epi32 (sum, _mm_set1_epi32 (1 << (PRECISION_S16 - 1)));
+  sum = _mm_srai_epi32 (sum, PRECISION_S16);
+  sum = _mm_packs_epi32 (sum, sum);
+  *o = _mm_extract_epi16 (sum, 0);
+}
+
+static inline void
+inner_product_gint16_linear_1_avx2 (gint16 * o, const gint16 * a,
+    const gint16 * b, gint len, const gint16 * icoeff, gint bstride)
+{
+  gint i = 0;
+  __m256i sum8[2], t8;
+  __m128i sum[2], t;
+  __m128i f = _mm_set_epi64x (0, *((gint64 *) icoeff));
+  const gint16 *c[2] = { (gint16 *) ((gint8 *) b + 0 * bstride),
+    (gint16 *) ((gint8 *) b + 1 * bstride)
+  };
+
+  sum8[0] = sum8[1] = _mm256_setzero_si256 ();
+  sum[0] = sum[1] = _mm_setzero_si128 ();
+  f = _mm_unpacklo_epi16 (f, sum[0]);
+
+  for (; i + 16 <= len; i += 16) {
+    t8 = _mm256_loadu_si256 ((__m256i *) (a + i));
+    sum8[0] = _mm256_add_epi32 (sum8[0], _mm256_madd_epi16 (t8,
+            _mm256_loadu_si256 ((__m256i *) (c[0] + i))));
+    sum8[1] = _mm256_add_epi32 (sum8[1], _mm256_madd_epi16 (t8,
+            _mm256_loadu_si256 ((__m256i *) (c[1] + i))));
+  }
+  for (; i < len; i += 8) {
+    t = _mm_loadu_si128 ((__m128i *) (a + i));
+    sum[0] = _mm_add_epi32 (sum[0], _mm_madd_epi16 (t,
+            _mm_loadu_si128 ((__m128i *) (c[0] + i))));
+    sum[1] = _mm_add_epi32 (sum[1], _mm_madd_epi16 (t,
+            _mm_loadu_si128 ((__m128i *) (c[1] + i))));
+  }
+  sum[0] = _mm_add_epi32 (sum[0], fold_epi32 (sum8[0]));
+  sum[1] = _mm_add_epi32 (sum[1], fold_epi32 (sum8[1]));
+
+  sum[0] = _mm_srai_epi32 (sum[0], PRECISION_S16);
+  sum[1] = _mm_srai_epi32 (sum[1], PRECISION_S16);
+
+  sum[0] =
+      _mm_madd_epi16 (sum[0], _mm_shuffle_epi32 (f, _MM_SHUFFLE (0, 0, 0, 0)));
+  sum[1] =
+      _mm_madd_epi16 (sum[1], _mm_shuffle_epi32 (f, _MM_SHUFFLE (1, 1, 1, 1)));
+  sum[0] = _mm_add_epi32 (sum[0], sum[1]);
+
+  sum[0] =
+      _mm_add_epi32 (sum[0], _mm_shuffle_epi32 (sum[0], _MM_SHUFFLE (2, 3, 2,
+              3)));
+  sum[0] =
+      _mm_add_epi32 (sum[0], _mm_shuffle_epi32 (sum[0], _MM_SHUFFLE (1, 1, 1,
+              1)));
+
+  sum[0] = _mm_add_epi32 (sum[0], _mm_set1_epi32 (1 << (PRECISION_S16 - 1)));
+  sum[0] = _mm_srai_epi32 (sum[0], PRECISION_S16);
+  sum[0] = _mm_packs_epi32 (sum[0], sum[0]);
+  *o = _mm_extract_epi16 (sum[0], 0);
+}
+
+static inline void
+inner_product_gint16_cubic_1_avx2 (gint16 * o, const gint16 * a,
+    const gint16 * b, gint len, const gint16 * icoeff, gint bstride)
+{
+  gint i = 0, j;
+  __m256i sum8[4], t8;
+  __m128i sum[4], t[4];
+  __m128i f = _mm_set_epi64x (0, *((long long *) icoeff));
+  const gint16 *c[4] = { (gint16 *) ((gint8 *) b + 0 * bstride),
+    (gint16 *) ((gint8 *) b + 1 * bstride),
+    (gint16 *) ((gint8 *) b + 2 * bstride),
+    (gint16 *) ((gint8 *) b + 3 * bstride)
+  };
+
+  sum8[0] = sum8[1] = sum8[2] = sum8[3] = _mm256_setzero_si256 ();
+  sum[0] = sum[1] = sum[2] = sum[3] = _mm_setzero_si128 ();
+  f = _mm_unpacklo_epi16 (f, sum[0]);
+
+  for (; i + 16 <= len; i += 16) {
+    t8 = _mm256_loadu_si256 ((__m256i *) (a + i));
+    for (j = 0; j < 4; j++)
+      sum8[j] = _mm256_add_epi32 (sum8[j], _mm256_madd_epi16 (t8,
+              _mm256_loadu_si256 ((__m256i *) (c[j] + i))));
+  }
+  for (; i < len; i += 8) {
+    t[0] = _mm_loadu_si128 ((__m128i *) (a + i));
+    for (j = 0; j < 4; j++)
+      sum[j] = _mm_add_epi32 (sum[j], _mm_madd_epi16 (t[0],
+              _mm_loadu_si128 ((__m128i *) (c[j] + i))));
+  }
+  for (j = 0; j < 4; j++)
+    sum[j] = _mm_add_epi32 (sum[j], fold_epi32 (sum8[j]));
+
+  t[0] = _mm_unpacklo_epi32 (sum[0], sum[1]);
+  t[1] = _mm_unpacklo_epi32 (sum[2], sum[3]);
+  t[2] = _mm_unpackhi_epi32 (sum[0], sum[1]);
+  t[3] = _mm_unpackhi_epi32 (sum[2], sum[3]);
+
+  sum[0] =
+      _mm_add_epi32 (_mm_unpacklo_epi64 (t[0], t[1]), _mm_unpackhi_epi64 (t[0],
+          t[1]));
+  sum[2] =
+      _mm_add_epi32 (_mm_unpacklo_epi64 (t[2], t[3]), _mm_unpackhi_epi64 (t[2],
+          t[3]));
+  sum[0] = _mm_add_epi32 (sum[0], sum[2]);
+
+  sum[0] = _mm_srai_epi32 (sum[0], PRECISION_S16);
+  sum[0] = _mm_madd_epi16 (sum[0], f);
+
+  sum[0] =
+      _mm_add_epi32 (sum[0], _mm_shuffle_epi32 (sum[0], _MM_SHUFFLE (2, 3, 2,
+              3)));
+  sum[0] =
+      _mm_add_epi32 (sum[0], _mm_shuffle_epi32 (sum[0], _MM_SHUFFLE (1, 1, 1,
+              1)));
+
+  sum[0] = _mm_add_epi32 (sum[0], _mm_set1_epi32 (1 << (PRECISION_S16 - 1)));
+  sum[0] = _mm_srai_epi32 (sum[0], PRECISION_S16);
+  sum[0] = _mm_packs_epi32 (sum[0], sum[0]);
+  *o = _mm_extract_epi16 (sum[0], 0);
+}
+
+MAKE_RESAMPLE_FUNC (gfloat, full, 1, avx2);
+MAKE_RESAMPLE_FUNC (gfloat, linear, 1, avx2);
+MAKE_RESAMPLE_FUNC (gfloat, cubic, 1, avx2);
+
+MAKE_RESAMPLE_FUNC (gdouble, full, 1, avx2);
+MAKE_RESAMPLE_FUNC (gdouble, linear, 1, avx2);
+MAKE_RESAMPLE_FUNC (gdouble, cubic, 1, avx2);
+
+MAKE_RESAMPLE_FUNC (gint16, full, 1, avx2);
+MAKE_RESAMPLE_FUNC (gint16, linear, 1, avx2);
+MAKE_RESAMPLE_FUNC (gint16, cubic, 1, avx2);
+
+#if defined (__x86_64__)
+
+static inline gint64
+hsum_epi64 (__m256i v)
+{
+  __m128i s = _mm_add_epi64 (_mm256_castsi256_si128 (v),
+      _mm256_extracti128_si256 (v, 1));
+
+  s = _mm_add_epi64 (s, _mm_unpackhi_epi64 (s, s));
+  return _mm_cvtsi128_si64 (s);
+}
+
+/* accumulate the products of the even samples in @even and those of the
+ * odd samples in @odd, like the two lanes of the SSE4.1 version */
+#define MUL_ACC_EVEN_ODD(even,odd,ta,tb)                                \
+G_STMT_START {                                                          \
+  even = _mm256_add_epi64 (even, _mm256_mul_epi32 (ta, tb));            \
+  odd = _mm256_add_epi64 (odd, _mm256_mul_epi32 (_mm256_srli_epi64 (ta, \
+          32), _mm256_srli_epi64 (tb, 32)));                            \
+} G_STMT_END
+
+static inline void
+inner_product_gint32_full_1_avx2 (gint32 * o, const gint32 * a,
+    const gint32 * b, gint len, const gint32 * icoeff, gint bstride)
+{
+  gint i = 0;
+  __m256i sum[2], ta, tb;
+  gint64 res;
+
+  sum[0] = sum[1] = _mm256_setzero_si256 ();
+
+  for (; i < len; i += 8) {
+    ta = _mm256_loadu_si256 ((__m256i *) (a + i));
+    tb = _mm256_loadu_si256 ((__m256i *) (b + i));
+    MUL_ACC_EVEN_ODD (sum[0], sum[1], ta, tb);
+  }
+  res = hsum_epi64 (_mm256_add_epi64 (sum[0], sum[1]));
+
+  res = (res + (1 << (PRECISION_S32 - 1))) >> PRECISION_S32;
+  *o = CLAMP (res, G_MININT32, G_MAXINT32);
+}
+
+static inline void
+inner_product_gint32_linear_1_avx2 (gint32 * o, const gint32 * a,
+    const gint32 * b, gint len, const gint32 * icoeff, gint bstride)
+{
+  gint i = 0, j;
+  gint64 res;
+  __m256i even[2], odd[2], ta;
+  __m128i sum[2];
+  __m128i f = _mm_loadu_si128 ((__m128i *) icoeff);
+  const gint32 *c[2] = { (gint32 *) ((gint8 *) b + 0 * bstride),
+    (gint32 *) ((gint8 *) b + 1 * bstride)
+  };
+
+  for (j = 0; j < 2; j++)
+    even[j] = odd[j] = _mm256_setzero_si256 ();
+
+  for (; i < len; i += 8) {
+    ta = _mm256_loadu_si256 ((__m256i *) (a + i));
+    for (j = 0; j < 2; j++)
+      MUL_ACC_EVEN_ODD (even[j], odd[j], ta,
+          _mm256_loadu_si256 ((__m256i *) (c[j] + i)));
+  }
+  for (j = 0; j < 2; j++)
+    sum[j] = _mm_set_epi64x (hsum_epi64 (odd[j]), hsum_epi64 (even[j]));
+
+  sum[0] = _mm_srli_epi64 (sum[0], PRECISION_S32);
+  sum[1] = _mm_srli_epi64 (sum[1], PRECISION_S32);
+  sum[0] =
+      _mm_mul_epi32 (sum[0], _mm_shuffle_epi32 (f, _MM_SHUFFLE (0, 0, 0, 0)));
+  sum[1] =
+      _mm_mul_epi32 (sum[1], _mm_shuffle_epi32 (f, _MM_SHUFFLE (1, 1, 1, 1)));
+  sum[0] = _mm_add_epi64 (sum[0], sum[1]);
+  sum[0] = _mm_add_epi64 (sum[0], _mm_unpackhi_epi64 (sum[0], sum[0]));
+  res = _mm_cvtsi128_si64 (sum[0]);
+
+  res = (res + (1 << (PRECISION_S32 - 1))) >> PRECISION_S32;
+  *o = CLAMP (res, G_MININT32, G_MAXINT32);
+}
+
+static inline void
+inner_product_gint32_cubic_1_avx2 (gint32 * o, const gint32 * a,
+    const gint32 * b, gint len, const gint32 * icoeff, gint bstride)
+{
+  gint i = 0, j;
+  gint64 res;
+  __m256i even[4], odd[4], ta;
+  __m128i sum[4];
+  __m128i f = _mm_loadu_si128 ((__m128i *) icoeff);
+  const gint32 *c[4] = { (gint32 *) ((gint8 *) b + 0 * bstride),
+    (gint32 *) ((gint8 *) b + 1 * bstride),
+    (gint32 *) ((gint8 *) b + 2 * bstride),
+    (gint32 *) ((gint8 *) b + 3 * bstride)
+  };
+
+  for (j = 0; j < 4; j++)
+    even[j] = odd[j] = _mm256_setzero_si256 ();
+
+  for (; i < len; i += 8) {
+    ta = _mm256_loadu_si256 ((__m256i *) (a + i));
+    for (j = 0; j < 4; j++)
+      MUL_ACC_EVEN_ODD (even[j], odd[j], ta,
+          _mm256_loadu_si256 ((__m256i *) (c[j] + i)));
+  }
+  for (j = 0; j < 4; j++)
+    sum[j] = _mm_set_epi64x (hsum_epi64 (odd[j]), hsum_epi64 (even[j]));
+
+  sum[0] = _mm_srli_epi64 (sum[0], PRECISION_S32);
+  sum[1] = _mm_srli_epi64 (sum[1], PRECISION_S32);
+  sum[2] = _mm_srli_epi64 (sum[2], PRECISION_S32);
+  sum[3] = _mm_srli_epi64 (sum[3], PRECISION_S32);
+  sum[0] =
+      _mm_mul_epi32 (sum[0], _mm_shuffle_epi32 (f, _MM_SHUFFLE (0, 0, 0, 0)));
+  sum[1] =
+      _mm_mul_epi32 (sum[1], _mm_shuffle_epi32 (f, _MM_SHUFFLE (1, 1, 1, 1)));
+  sum[2] =
+      _mm_mul_epi32 (sum[2], _mm_shuffle_epi32 (f, _MM_SHUFFLE (2, 2, 2, 2)));
+  sum[3] =
+      _mm_mul_epi32 (sum[3], _mm_shuffle_epi32 (f, _MM_SHUFFLE (3, 3, 3, 3)));
+  sum[0] = _mm_add_epi64 (sum[0], sum[1]);
+  sum[2] = _mm_add_epi64 (sum[2], sum[3]);
+  sum[0] = _mm_add_epi64 (sum[0], sum[2]);
+  sum[0] = _mm_add_epi64 (sum[0], _mm_unpackhi_epi64 (sum[0], sum[0]));
+  res = _mm_cvtsi128_si64 (sum[0]);
+
+  res = (res + (1 << (PRECISION_S32 - 1))) >> PRECISION_S32;
+  *o = CLAMP (res, G_MININT32, G_MAXINT32);
+}
+
+MAKE_RESAMPLE_FUNC (gint32, full, 1, avx2);
+MAKE_RESAMPLE_FUNC (gint32, linear, 1, avx2);
+MAKE_RESAMPLE_FUNC (gint32, cubic, 1, avx2);
+
+#endif /* __x86_64__ */
+
+#endif
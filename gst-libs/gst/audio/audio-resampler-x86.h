@@ -21,7 +21,9 @@
 #include "audio-resampler-x86-sse.h"
 #include "audio-resampler-x86-sse2.h"
 #include "audio-resampler-x86-sse41.h"
+#include "audio-resampler-x86-avx2.h"
 
+#if defined HAVE_ORC && !defined DISABLE_ORC
 static void
 audio_resampler_check_x86 (const gchar *option)
 {
@@ -69,3 +71,36 @@ audio_resampler_check_x86 (const gchar *option)
 #endif
   }
 }
+#endif
+
+/* AVX2 and FMA are not among the flags that orc reports, ask the CPU */
+static void
+audio_resampler_check_x86_avx2 (void)
+{
+#if defined (HAVE_IMMINTRIN_H) && defined (HAVE_AVX2_FMA) && defined (__GNUC__)
+  __builtin_cpu_init ();
+  if (__builtin_cpu_supports ("avx2") && __builtin_cpu_supports ("fma")) {
+    GST_DEBUG ("enable AVX2 optimisations");
+    resample_gfloat_full_1 = resample_gfloat_full_1_avx2;
+    resample_gfloat_linear_1 = resample_gfloat_linear_1_avx2;
+    resample_gfloat_cubic_1 = resample_gfloat_cubic_1_avx2;
+
+    resample_gdouble_full_1 = resample_gdouble_full_1_avx2;
+    resample_gdouble_linear_1 = resample_gdouble_linear_1_avx2;
+    resample_gdouble_cubic_1 = resample_gdouble_cubic_1_avx2;
+
+    resample_gint16_full_1 = resample_gint16_full_1_avx2;
+    resample_gint16_linear_1 = resample_gint16_linear_1_avx2;
+    resample_gint16_cubic_1 = resample_gint16_cubic_1_avx2;
+#if defined (__x86_64__)
+    resample_gint32_full_1 = resample_gint32_full_1_avx2;
+    resample_gint32_linear_1 = resample_gint32_linear_1_avx2;
+    resample_gint32_cubic_1 = resample_gint32_cubic_1_avx2;
+#endif
+  } else {
+    GST_DEBUG ("CPU does not support AVX2 and FMA");
+  }
+#else
+  GST_DEBUG ("AVX2 optimisations not enabled");
+#endif
+}
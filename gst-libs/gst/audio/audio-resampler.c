@@ -25,6 +25,8 @@
 #include <stdio.h>
 #include <math.h>
 
+#include <gst/base/base.h>
+
 #ifdef HAVE_ORC
 #include <orc/orc.h>
 #endif
@@ -32,6 +34,7 @@
 #include "audio-resampler.h"
 #include "audio-resampler-private.h"
 #include "audio-resampler-macros.h"
+#include "../parallelized-task-runner-private.h"
 
 #define MEM_ALIGN(m,a) ((gint8 *)((guintptr)((gint8 *)(m) + ((a)-1)) & ~((a)-1)))
 #define ALIGN 16
@@ -105,6 +108,7 @@ static const BlackmanQualityMap blackman_qualities[] = {
 #define DEFAULT_OPT_FILTER_INTERPOLATION GST_AUDIO_RESAMPLER_FILTER_INTERPOLATION_CUBIC
 #define DEFAULT_OPT_FILTER_OVERSAMPLE 8
 #define DEFAULT_OPT_MAX_PHASE_ERROR 0.1
+#define DEFAULT_OPT_THREADS 1
 
 static gdouble
 get_opt_double (GstStructure * options, const gchar * name, gdouble def)
@@ -124,6 +128,15 @@ get_opt_int (GstStructure * options, const gchar * name, gint def)
   return res;
 }
 
+static guint
+get_opt_uint (GstStructure * options, const gchar * name, guint def)
+{
+  guint res;
+  if (!options || !gst_structure_get_uint (options, name, &res))
+    res = def;
+  return res;
+}
+
 static gint
 get_opt_enum (GstStructure * options, const gchar * name, GType type, gint def)
 {
@@ -160,6 +173,8 @@ get_opt_enum (GstStructure * options, const gchar * name, GType type, gint def)
     GST_AUDIO_RESAMPLER_OPT_FILTER_OVERSAMPLE, DEFAULT_OPT_FILTER_OVERSAMPLE)
 #define GET_OPT_MAX_PHASE_ERROR(options) get_opt_double(options, \
     GST_AUDIO_RESAMPLER_OPT_MAX_PHASE_ERROR, DEFAULT_OPT_MAX_PHASE_ERROR)
+#define GET_OPT_THREADS(options) get_opt_uint(options, \
+    GST_AUDIO_RESAMPLER_OPT_THREADS, DEFAULT_OPT_THREADS)
 
 #include "dbesi0.c"
 #define bessel dbesi0
@@ -827,10 +842,10 @@ static ResampleFunc resample_funcs[] = {
 #  define CHECK_NEON
 #  include "audio-resampler-neon.h"
 # endif
-# if defined (__i386__) || defined (__x86_64__)
-#  define CHECK_X86
-#  include "audio-resampler-x86.h"
-# endif
+#endif
+#if defined (__i386__) || defined (__x86_64__)
+# define CHECK_X86
+# include "audio-resampler-x86.h"
 #endif
 
 static void
@@ -874,6 +889,9 @@ audio_resampler_init (void)
         }
       }
     }
+#endif
+#ifdef CHECK_X86
+    audio_resampler_check_x86_avx2 ();
 #endif
     g_once_init_leave (&init_gonce, 1);
   }
@@ -967,26 +985,305 @@ calculate_kaiser_params (GstAudioResampler * resampler)
       resampler->n_taps, resampler->cutoff);
 }
 
+/* The oversampled filter tables only depend on the filter parameters and
+ * the sample format. They are shared between all resamplers in the process
+ * so that new resamplers and renegotiations with the same parameters don't
+ * need to calculate them again. A few unused tables are kept around for
+ * pipelines that are restarted. */
+#define MAX_UNUSED_TAPS_TABLES 8
+
+typedef struct _TapsTable
+{
+  gint ref_count;
+
+  /* key */
+  GstAudioResamplerMethod method;
+  gint format_index;
+  gint n_taps;
+  gint n_phases;
+  gint oversample;
+  gdouble cutoff;
+  gdouble kaiser_beta;
+  gdouble b, c;
+
+  gpointer mem;
+  gpointer taps;
+  gsize stride;
+} TapsTable;
+
+static GMutex taps_cache_lock;
+static GHashTable *taps_cache;
+static GQueue taps_cache_unused = G_QUEUE_INIT;
+
+static guint
+taps_table_hash (gconstpointer key)
+{
+  const TapsTable *t = key;
+  guint hash;
+
+  hash = t->method;
+  hash = hash * 31 + t->format_index;
+  hash = hash * 31 + t->n_taps;
+  hash = hash * 31 + t->n_phases;
+  hash = hash * 31 + t->oversample;
+  hash = hash * 31 + g_double_hash (&t->cutoff);
+  hash = hash * 31 + g_double_hash (&t->kaiser_beta);
+
+  return hash;
+}
+
+static gboolean
+taps_table_equal (gconstpointer a, gconstpointer b)
+{
+  const TapsTable *ta = a, *tb = b;
+
+  return ta->method == tb->method && ta->format_index == tb->format_index &&
+      ta->n_taps == tb->n_taps && ta->n_phases == tb->n_phases &&
+      ta->oversample == tb->oversample && ta->cutoff == tb->cutoff &&
+      ta->kaiser_beta == tb->kaiser_beta && ta->b == tb->b && ta->c == tb->c;
+}
+
 static void
-alloc_taps_mem (GstAudioResampler * resampler, gint bps, gint n_taps,
+taps_table_free (TapsTable * table)
+{
+  g_free (table->mem);
+  g_free (table);
+}
+
+static TapsTable *
+taps_table_acquire (GstAudioResampler * resampler, gint bps, gint n_taps,
     gint n_phases)
 {
-  if (resampler->alloc_taps >= n_taps && resampler->alloc_phases >= n_phases)
-    return;
+  TapsTable key = { 0, }, *table, *cached;
+  gint i;
+
+  key.method = resampler->method;
+  key.format_index = resampler->format_index;
+  key.n_taps = n_taps;
+  key.n_phases = n_phases;
+  key.oversample = resampler->oversample;
+  /* only the parameters that the method uses are part of the key */
+  switch (resampler->method) {
+    case GST_AUDIO_RESAMPLER_METHOD_CUBIC:
+      key.b = resampler->b;
+      key.c = resampler->c;
+      break;
+    case GST_AUDIO_RESAMPLER_METHOD_KAISER:
+      key.kaiser_beta = resampler->kaiser_beta;
+      /* fallthrough */
+    case GST_AUDIO_RESAMPLER_METHOD_BLACKMAN_NUTTALL:
+      key.cutoff = resampler->cutoff;
+      break;
+    default:
+      break;
+  }
+
+  g_mutex_lock (&taps_cache_lock);
+  if (taps_cache == NULL)
+    taps_cache = g_hash_table_new (taps_table_hash, taps_table_equal);
 
-  GST_DEBUG ("allocate bps %d n_taps %d n_phases %d", bps, n_taps, n_phases);
+  table = g_hash_table_lookup (taps_cache, &key);
+  if (table) {
+    if (table->ref_count++ == 0)
+      g_queue_remove (&taps_cache_unused, table);
+    g_mutex_unlock (&taps_cache_lock);
+
+    GST_DEBUG ("reusing filter table %p", table);
+    return table;
+  }
+  g_mutex_unlock (&taps_cache_lock);
+
+  GST_DEBUG ("calculate bps %d n_taps %d n_phases %d", bps, n_taps, n_phases);
+
+  table = g_new (TapsTable, 1);
+  *table = key;
+  table->ref_count = 1;
+  table->stride = GST_ROUND_UP_32 (bps * (n_taps + TAPS_OVERREAD));
+  table->mem = g_malloc0 (n_phases * table->stride + ALIGN - 1);
+  table->taps = MEM_ALIGN ((gint8 *) table->mem, ALIGN);
 
   resampler->tmp_taps =
       g_realloc_n (resampler->tmp_taps, n_taps, sizeof (gdouble));
 
-  resampler->taps_stride = GST_ROUND_UP_32 (bps * (n_taps + TAPS_OVERREAD));
+  for (i = 0; i < n_phases; i++) {
+    gdouble x = -(n_taps / 2) + i / (gdouble) resampler->oversample;
+    gpointer taps = (gint8 *) table->taps + i * table->stride;
 
-  g_free (resampler->taps_mem);
-  resampler->taps_mem =
-      g_malloc0 (n_phases * resampler->taps_stride + ALIGN - 1);
-  resampler->taps = MEM_ALIGN ((gint8 *) resampler->taps_mem, ALIGN);
-  resampler->alloc_taps = n_taps;
-  resampler->alloc_phases = n_phases;
+    make_taps (resampler, taps, x, n_taps);
+  }
+
+  /* another resampler might have made the same table in the meantime */
+  g_mutex_lock (&taps_cache_lock);
+  cached = g_hash_table_lookup (taps_cache, &key);
+  if (cached) {
+    if (cached->ref_count++ == 0)
+      g_queue_remove (&taps_cache_unused, cached);
+  } else {
+    g_hash_table_add (taps_cache, table);
+  }
+  g_mutex_unlock (&taps_cache_lock);
+
+  if (cached) {
+    taps_table_free (table);
+    table = cached;
+  }
+  return table;
+}
+
+static void
+taps_table_release (TapsTable * table)
+{
+  g_mutex_lock (&taps_cache_lock);
+  if (--table->ref_count == 0) {
+    g_queue_push_head (&taps_cache_unused, table);
+
+    if (taps_cache_unused.length > MAX_UNUSED_TAPS_TABLES) {
+      TapsTable *old = g_queue_pop_tail (&taps_cache_unused);
+
+      g_hash_table_remove (taps_cache, old);
+      taps_table_free (old);
+    }
+  }
+  g_mutex_unlock (&taps_cache_lock);
+}
+
+/* a group of channels, resampled with a private copy of the resampler
+ * state that only sees the channels of the group */
+typedef struct _ResampleTask
+{
+  GstAudioResampler resampler;
+  gpointer *in;
+  gsize in_len;
+  gpointer *out;
+  gpointer out_interleaved[1];
+  gsize out_len;
+  gsize consumed;
+} ResampleTask;
+
+static void
+resampler_free_threads (GstAudioResampler * resampler)
+{
+  if (resampler->runner)
+    gst_parallelized_task_runner_free (resampler->runner);
+  resampler->runner = NULL;
+  g_free (resampler->tasks);
+  resampler->tasks = NULL;
+  g_free (resampler->task_data);
+  resampler->task_data = NULL;
+  resampler->n_threads = 1;
+}
+
+static void
+resampler_setup_threads (GstAudioResampler * resampler, guint n_threads)
+{
+  if (n_threads == 0)
+    n_threads = g_get_num_processors ();
+  /* each thread handles at least one channel */
+  n_threads = CLAMP (n_threads, 1, resampler->channels);
+
+  if (n_threads == resampler->n_threads)
+    return;
+
+  resampler_free_threads (resampler);
+
+  if (n_threads > 1) {
+    GstTaskPool *pool = gst_parallelized_task_runner_get_shared_pool ();
+
+    resampler->runner = gst_parallelized_task_runner_new (n_threads, pool);
+    gst_object_unref (pool);
+    n_threads = resampler->runner->n_threads;
+    resampler->tasks = g_new0 (ResampleTask, n_threads);
+    resampler->task_data = g_new0 (gpointer, n_threads);
+  }
+  resampler->n_threads = n_threads;
+
+  GST_DEBUG ("resampling with %u threads", n_threads);
+}
+
+/* Make sure all filter phases that the next @out_len samples use are in the
+ * cache so that the channel groups only read from it. */
+static void
+resampler_fill_phases (GstAudioResampler * resampler, gsize out_len)
+{
+  gint samp_index = 0, samp_phase = resampler->samp_phase;
+  gint64 icoeff[4];
+  gsize i;
+
+  out_len = MIN (out_len, resampler->out_rate);
+
+  for (i = 0; i < out_len; i++) {
+    switch (resampler->format_index) {
+      case 0:
+        get_taps_gint16_full (resampler, &samp_index, &samp_phase,
+            (gint16 *) icoeff);
+        break;
+      case 1:
+        get_taps_gint32_full (resampler, &samp_index, &samp_phase,
+            (gint32 *) icoeff);
+        break;
+      case 2:
+        get_taps_gfloat_full (resampler, &samp_index, &samp_phase,
+            (gfloat *) icoeff);
+        break;
+      case 3:
+        get_taps_gdouble_full (resampler, &samp_index, &samp_phase,
+            (gdouble *) icoeff);
+        break;
+      default:
+        g_assert_not_reached ();
+        break;
+    }
+  }
+}
+
+static void
+resample_task (gpointer data)
+{
+  ResampleTask *task = data;
+
+  task->resampler.resample (&task->resampler, task->in, task->in_len,
+      task->out, task->out_len, &task->consumed);
+}
+
+static void
+resample_threaded (GstAudioResampler * resampler, gpointer in[],
+    gsize in_len, gpointer out[], gsize out_len, gsize * consumed)
+{
+  guint i, n_threads = resampler->n_threads;
+  gint blocks = resampler->blocks;
+  ResampleTask *tasks = resampler->tasks;
+
+  if (resampler->in_rate != resampler->out_rate &&
+      resampler->method != GST_AUDIO_RESAMPLER_METHOD_NEAREST &&
+      resampler->filter_mode == GST_AUDIO_RESAMPLER_FILTER_MODE_FULL)
+    resampler_fill_phases (resampler, out_len);
+
+  for (i = 0; i < n_threads; i++) {
+    ResampleTask *task = &tasks[i];
+    gint c0 = i * blocks / n_threads;
+    gint c1 = (i + 1) * blocks / n_threads;
+
+    task->resampler = *resampler;
+    task->resampler.blocks = c1 - c0;
+    task->in = in + c0;
+    task->in_len = in_len;
+    if (resampler->ostride == 1) {
+      task->out = out + c0;
+    } else {
+      task->out_interleaved[0] = (gint8 *) out[0] + c0 * resampler->bps;
+      task->out = task->out_interleaved;
+    }
+    task->out_len = out_len;
+    resampler->task_data[i] = task;
+  }
+
+  gst_parallelized_task_runner_run (resampler->runner, resample_task,
+      resampler->task_data);
+
+  /* all groups advanced the same way */
+  resampler->samp_index = tasks[0].resampler.samp_index;
+  resampler->samp_phase = tasks[0].resampler.samp_phase;
+  *consumed = tasks[0].consumed;
 }
 
 static void
@@ -1070,6 +1367,7 @@ resampler_calculate_taps (GstAudioResampler * resampler)
   gint in_rate, out_rate;
   gboolean scale = TRUE, sinc_table = FALSE;
   GstAudioResamplerFilterInterpolation filter_interpolation;
+  TapsTable *table = NULL;
 
   switch (resampler->method) {
     case GST_AUDIO_RESAMPLER_METHOD_NEAREST:
@@ -1184,9 +1482,7 @@ resampler_calculate_taps (GstAudioResampler * resampler)
 
   if (resampler->filter_interpolation !=
       GST_AUDIO_RESAMPLER_FILTER_INTERPOLATION_NONE) {
-    gint i, isize;
-    gdouble x;
-    gpointer taps;
+    gint isize;
 
     switch (resampler->filter_interpolation) {
       default:
@@ -1200,13 +1496,19 @@ resampler_calculate_taps (GstAudioResampler * resampler)
         break;
     }
 
-    alloc_taps_mem (resampler, bps, n_taps, oversample + isize);
+    table = taps_table_acquire (resampler, bps, n_taps, oversample + isize);
+  }
 
-    for (i = 0; i < oversample + isize; i++) {
-      x = -(n_taps / 2) + i / (gdouble) oversample;
-      taps = (gint8 *) resampler->taps + i * resampler->taps_stride;
-      make_taps (resampler, taps, x, n_taps);
-    }
+  if (resampler->taps_table)
+    taps_table_release (resampler->taps_table);
+  resampler->taps_table = table;
+
+  if (table) {
+    resampler->taps = table->taps;
+    resampler->taps_stride = table->stride;
+  } else {
+    resampler->taps = NULL;
+    resampler->taps_stride = 0;
   }
 }
 
@@ -1372,6 +1674,7 @@ gst_audio_resampler_new (GstAudioResamplerMethod method,
   resampler->flags = flags;
   resampler->format = format;
   resampler->channels = channels;
+  resampler->n_threads = 1;
 
   switch (format) {
     case GST_AUDIO_FORMAT_S16:
@@ -1572,6 +1875,7 @@ gst_audio_resampler_update (GstAudioResampler * resampler,
 
     old_n_taps = resampler->n_taps;
 
+    resampler_setup_threads (resampler, GET_OPT_THREADS (resampler->options));
     resampler_calculate_taps (resampler);
     resampler_dump (resampler);
 
@@ -1629,10 +1933,12 @@ gst_audio_resampler_free (GstAudioResampler * resampler)
   g_return_if_fail (resampler != NULL);
 
   g_free (resampler->cached_taps_mem);
-  g_free (resampler->taps_mem);
+  if (resampler->taps_table)
+    taps_table_release (resampler->taps_table);
   g_free (resampler->tmp_taps);
   g_free (resampler->samples);
   g_free (resampler->sbuf);
+  resampler_free_threads (resampler);
   if (resampler->options)
     gst_structure_free (resampler->options);
   g_slice_free (GstAudioResampler, resampler);
@@ -1781,8 +2087,12 @@ gst_audio_resampler_resample (GstAudioResampler * resampler,
   }
 
   /* resample all channels */
-  resampler->resample (resampler, sbuf, samples_avail, out, out_frames,
-      &consumed);
+  if (resampler->n_threads > 1)
+    resample_threaded (resampler, sbuf, samples_avail, out, out_frames,
+        &consumed);
+  else
+    resampler->resample (resampler, sbuf, samples_avail, out, out_frames,
+        &consumed);
 
   GST_LOG ("in %" G_GSIZE_FORMAT ", avail %" G_GSIZE_FORMAT ", consumed %"
       G_GSIZE_FORMAT, in_frames, samples_avail, consumed);
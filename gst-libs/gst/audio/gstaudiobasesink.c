@@ -38,6 +38,7 @@
 
 #include <gst/audio/audio.h>
 #include "gstaudiobasesink.h"
+#include "gstaudioutilsprivate.h"
 
 GST_DEBUG_CATEGORY_STATIC (gst_audio_base_sink_debug);
 #define GST_CAT_DEFAULT gst_audio_base_sink_debug
@@ -75,6 +76,14 @@ struct _GstAudioBaseSinkPrivate
   GstAudioBaseSinkCustomSlavingCallback custom_slaving_callback;
   gpointer custom_slaving_cb_data;
   GDestroyNotify custom_slaving_cb_notify;
+
+  /* append samples behind the device read pointer instead of placing them
+   * according to their timestamps */
+  gboolean low_latency;
+
+  /* protected by the object lock */
+  GstAudioStats stats;
+  GstClockTime stats_interval;
 };
 
 /* BaseAudioSink signals and args */
@@ -105,6 +114,12 @@ enum
  * fix itself, or is a permanent offset */
 #define DEFAULT_DISCONT_WAIT        (1 * GST_SECOND)
 
+#define DEFAULT_LOW_LATENCY         FALSE
+#define DEFAULT_AUDIO_STATS_INTERVAL 0
+
+/* smallest segment size we configure in low-latency mode */
+#define LOW_LATENCY_MIN_SEGMENT_FRAMES 32
+
 enum
 {
   PROP_0,
@@ -117,6 +132,9 @@ enum
   PROP_ALIGNMENT_THRESHOLD,
   PROP_DRIFT_TOLERANCE,
   PROP_DISCONT_WAIT,
+  PROP_LOW_LATENCY,
+  PROP_AUDIO_STATS,
+  PROP_AUDIO_STATS_INTERVAL,
 
   PROP_LAST
 };
@@ -165,6 +183,8 @@ static GstCaps *gst_audio_base_sink_fixate (GstBaseSink * bsink,
 
 static gboolean gst_audio_base_sink_query_pad (GstBaseSink * bsink,
     GstQuery * query);
+static guint64 gst_audio_base_sink_get_queued_samples (GstAudioBaseSink *
+    sink);
 
 
 /* static guint gst_audio_base_sink_signals[LAST_SIGNAL] = { 0 }; */
@@ -247,6 +267,78 @@ gst_audio_base_sink_class_init (GstAudioBaseSinkClass * klass)
           G_MAXUINT64 - 1, DEFAULT_DISCONT_WAIT,
           G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
+  /**
+   * GstAudioBaseSink:low-latency:
+   *
+   * Render samples as close to the device read pointer as possible, for
+   * live monitoring.
+   *
+   * Incoming samples are appended right behind the segment the device is
+   * currently playing instead of being placed according to their timestamps
+   * and playback starts as soon as the first samples are written instead of
+   * after the ringbuffer was filled. When more than
+   * #GstAudioBaseSink:buffer-time of samples would be queued, the queued
+   * samples are dropped. #GstAudioBaseSink:latency-time is rounded to whole
+   * frames and can go down to 32 frames per segment.
+   *
+   * The latency query reports the latency that is actually achieved, which
+   * is the amount of queued samples plus the device delay.
+   *
+   * Since: 1.20
+   */
+  g_object_class_install_property (gobject_class, PROP_LOW_LATENCY,
+      g_param_spec_boolean ("low-latency", "Low Latency",
+          "Write samples right behind the device read pointer instead of "
+          "syncing them to the clock", DEFAULT_LOW_LATENCY,
+          G_PARAM_READWRITE | GST_PARAM_MUTABLE_READY |
+          G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstAudioBaseSink:audio-stats:
+   *
+   * Glitch and processing time counters since the sink went to PAUSED, in
+   * a structure named "application/x-gst-audio-base-sink-stats" with the
+   * following #G_TYPE_UINT64 fields:
+   *
+   * - "underruns": number of times samples arrived after the device played
+   *   their position
+   * - "overruns": number of times queued samples were dropped because the
+   *   ringbuffer was full, only in #GstAudioBaseSink:low-latency mode
+   * - "dropped-samples": samples that were not played because they were late,
+   *   overlapped previous samples or were dropped on overrun
+   * - "inserted-samples": samples of silence inserted when resyncing to the
+   *   timestamps or the clock
+   * - "processed": number of buffers written to the ringbuffer
+   * - "process-time", "average-process-time", "max-process-time": total,
+   *   average and maximum time in nanoseconds spent writing a buffer into the
+   *   ringbuffer, including waiting for free space
+   *
+   * "process-time-histogram" is a #GST_TYPE_ARRAY of 8 #G_TYPE_UINT64 counts
+   * of buffers that took less than 100µs, 250µs, 500µs, 1ms, 2.5ms, 5ms,
+   * 10ms and more than that to write.
+   *
+   * Since: 1.20
+   */
+  g_object_class_install_property (gobject_class, PROP_AUDIO_STATS,
+      g_param_spec_boxed ("audio-stats", "Audio Statistics",
+          "Underrun, dropped sample and processing time counters",
+          GST_TYPE_STRUCTURE, G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstAudioBaseSink:audio-stats-interval:
+   *
+   * Interval in nanoseconds at which the #GstAudioBaseSink:audio-stats are
+   * posted as an element message while rendering, 0 disables the messages.
+   *
+   * Since: 1.20
+   */
+  g_object_class_install_property (gobject_class, PROP_AUDIO_STATS_INTERVAL,
+      g_param_spec_uint64 ("audio-stats-interval", "Audio Statistics Interval",
+          "Interval in nanoseconds for posting the audio-stats as element "
+          "message (0 = disabled)", 0, G_MAXUINT64,
+          DEFAULT_AUDIO_STATS_INTERVAL,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
   gstelement_class->change_state =
       GST_DEBUG_FUNCPTR (gst_audio_base_sink_change_state);
   gstelement_class->provide_clock =
@@ -287,6 +379,9 @@ gst_audio_base_sink_init (GstAudioBaseSink * audiobasesink)
   audiobasesink->priv->drift_tolerance = DEFAULT_DRIFT_TOLERANCE;
   audiobasesink->priv->alignment_threshold = DEFAULT_ALIGNMENT_THRESHOLD;
   audiobasesink->priv->discont_wait = DEFAULT_DISCONT_WAIT;
+  audiobasesink->priv->low_latency = DEFAULT_LOW_LATENCY;
+  audiobasesink->priv->stats_interval = DEFAULT_AUDIO_STATS_INTERVAL;
+  __gst_audio_stats_reset (&audiobasesink->priv->stats);
   audiobasesink->priv->custom_slaving_callback = NULL;
   audiobasesink->priv->custom_slaving_cb_data = NULL;
   audiobasesink->priv->custom_slaving_cb_notify = NULL;
@@ -423,6 +518,9 @@ gst_audio_base_sink_query (GstElement * element, GstQuery * query)
     {
       gboolean live, us_live;
       GstClockTime min_l, max_l;
+      GstAudioRingBuffer *ringbuf = NULL;
+      guint64 queued = -1;
+      gint rate = 0;
 
       GST_DEBUG_OBJECT (basesink, "latency query");
 
@@ -449,11 +547,29 @@ gst_audio_base_sink_query (GstElement * element, GstQuery * query)
 
           basesink->priv->us_latency = min_l;
 
-          base_latency =
-              gst_util_uint64_scale_int (spec->seglatency * spec->segsize,
-              GST_SECOND, spec->info.rate * spec->info.bpf);
+          if (basesink->priv->low_latency) {
+            /* report what we achieve, we can't go lower than one segment */
+            queued = gst_audio_base_sink_get_queued_samples (basesink);
+            if (queued != -1)
+              ringbuf = gst_object_ref (basesink->ringbuffer);
+            rate = spec->info.rate;
+            base_latency = gst_util_uint64_scale_int (spec->segsize,
+                GST_SECOND, spec->info.rate * spec->info.bpf);
+          } else {
+            base_latency =
+                gst_util_uint64_scale_int (spec->seglatency * spec->segsize,
+                GST_SECOND, spec->info.rate * spec->info.bpf);
+          }
           GST_OBJECT_UNLOCK (basesink);
 
+          /* add the device delay without our lock, the subclass can take
+           * device or mainloop locks for it */
+          if (ringbuf) {
+            queued += gst_audio_ring_buffer_delay (ringbuf);
+            base_latency = gst_util_uint64_scale_int (queued, GST_SECOND, rate);
+            gst_object_unref (ringbuf);
+          }
+
           /* we cannot go lower than the buffer size and the min peer latency */
           min_latency = base_latency + min_l;
           /* the max latency is the max of the peer, we can delay an infinite
@@ -854,6 +970,16 @@ gst_audio_base_sink_set_property (GObject * object, guint prop_id,
     case PROP_DISCONT_WAIT:
       gst_audio_base_sink_set_discont_wait (sink, g_value_get_uint64 (value));
       break;
+    case PROP_LOW_LATENCY:
+      GST_OBJECT_LOCK (sink);
+      sink->priv->low_latency = g_value_get_boolean (value);
+      GST_OBJECT_UNLOCK (sink);
+      break;
+    case PROP_AUDIO_STATS_INTERVAL:
+      GST_OBJECT_LOCK (sink);
+      sink->priv->stats_interval = g_value_get_uint64 (value);
+      GST_OBJECT_UNLOCK (sink);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -894,6 +1020,23 @@ gst_audio_base_sink_get_property (GObject * object, guint prop_id,
     case PROP_DISCONT_WAIT:
       g_value_set_uint64 (value, gst_audio_base_sink_get_discont_wait (sink));
       break;
+    case PROP_LOW_LATENCY:
+      GST_OBJECT_LOCK (sink);
+      g_value_set_boolean (value, sink->priv->low_latency);
+      GST_OBJECT_UNLOCK (sink);
+      break;
+    case PROP_AUDIO_STATS:
+      GST_OBJECT_LOCK (sink);
+      g_value_take_boxed (value,
+          __gst_audio_stats_to_structure (&sink->priv->stats,
+              "application/x-gst-audio-base-sink-stats"));
+      GST_OBJECT_UNLOCK (sink);
+      break;
+    case PROP_AUDIO_STATS_INTERVAL:
+      GST_OBJECT_LOCK (sink);
+      g_value_set_uint64 (value, sink->priv->stats_interval);
+      GST_OBJECT_UNLOCK (sink);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -944,6 +1087,22 @@ gst_audio_base_sink_setcaps (GstBaseSink * bsink, GstCaps * caps)
   if (!gst_audio_ring_buffer_parse_caps (spec, caps))
     goto parse_error;
 
+  /* in low-latency mode, round the segment size to whole frames instead of
+   * truncating it so that small periods end up where they were asked for */
+  if (sink->priv->low_latency
+      && spec->type == GST_AUDIO_RING_BUFFER_FORMAT_TYPE_RAW) {
+    gint bpf = GST_AUDIO_INFO_BPF (&spec->info);
+    guint64 frames;
+
+    frames = gst_util_uint64_scale_round (spec->latency_time,
+        GST_AUDIO_INFO_RATE (&spec->info), GST_SECOND / GST_USECOND);
+    frames = MAX (frames, LOW_LATENCY_MIN_SEGMENT_FRAMES);
+    spec->segsize = frames * bpf;
+    spec->segtotal = MAX (gst_util_uint64_scale (spec->buffer_time,
+            GST_AUDIO_INFO_RATE (&spec->info),
+            frames * (GST_SECOND / GST_USECOND)), 2);
+  }
+
   gst_audio_ring_buffer_debug_spec_buff (spec);
 
   GST_DEBUG_OBJECT (sink, "acquire ringbuffer");
@@ -1226,6 +1385,80 @@ gst_audio_base_sink_get_offset (GstAudioBaseSink * sink)
   return sample;
 }
 
+/* Returns the sample right behind the samples that are already queued, or
+ * right behind the segment the device is playing when we underran or when
+ * more than the ringbuffer can hold would be queued. In the latter case the
+ * queued samples are dropped. */
+static guint64
+gst_audio_base_sink_get_low_latency_offset (GstAudioBaseSink * sink,
+    guint samples)
+{
+  GstAudioRingBuffer *ringbuf = sink->ringbuffer;
+  guint64 sample, sps, playable;
+  gint segdone, segtotal, i;
+
+  sps = ringbuf->samples_per_seg;
+  segtotal = ringbuf->spec.segtotal;
+  segdone = g_atomic_int_get (&ringbuf->segdone) - ringbuf->segbase;
+  if (segdone < 0)
+    segdone = 0;
+
+  /* the segment after the one the device is processing, or the first one
+   * when the device did not start yet */
+  if (g_atomic_int_get (&ringbuf->state) == GST_AUDIO_RING_BUFFER_STATE_STARTED)
+    playable = (segdone + 1) * sps;
+  else
+    playable = segdone * sps;
+  sample = sink->next_sample;
+
+  if (sample == -1 || sample < playable) {
+    GST_DEBUG_OBJECT (sink, "underrun, writing at %" G_GUINT64_FORMAT,
+        playable);
+    if (sample != -1) {
+      GST_OBJECT_LOCK (sink);
+      sink->priv->stats.underruns++;
+      GST_OBJECT_UNLOCK (sink);
+    }
+    sample = playable;
+  } else if (sample + samples > (segdone + segtotal) * sps) {
+    GST_DEBUG_OBJECT (sink, "%" G_GUINT64_FORMAT " samples queued, dropping "
+        "them and writing at %" G_GUINT64_FORMAT, sample - playable, playable);
+    GST_OBJECT_LOCK (sink);
+    sink->priv->stats.overruns++;
+    sink->priv->stats.dropped_samples += sample - playable;
+    GST_OBJECT_UNLOCK (sink);
+    /* silence what we queued so the device doesn't play it when we don't
+     * overwrite it in time */
+    for (i = 1; i < segtotal; i++)
+      gst_audio_ring_buffer_clear (ringbuf, segdone + i);
+    sample = playable;
+  }
+
+  return sample;
+}
+
+/* Returns the samples that are written to the ringbuffer but not yet
+ * processed by the device, or -1 when the ringbuffer is not running. A sample
+ * written now is played after these and the device delay. Called with the
+ * object lock. */
+static guint64
+gst_audio_base_sink_get_queued_samples (GstAudioBaseSink * sink)
+{
+  GstAudioRingBuffer *ringbuf = sink->ringbuffer;
+  guint64 next_sample, samples_done;
+  gint segdone;
+
+  next_sample = sink->next_sample;
+  if (GST_AUDIO_INFO_RATE (&ringbuf->spec.info) == 0 || next_sample == -1 ||
+      g_atomic_int_get (&ringbuf->state) != GST_AUDIO_RING_BUFFER_STATE_STARTED)
+    return -1;
+
+  segdone = g_atomic_int_get (&ringbuf->segdone) - ringbuf->segbase;
+  samples_done = MAX (segdone, 0) * (guint64) ringbuf->samples_per_seg;
+
+  return next_sample > samples_done ? next_sample - samples_done : 0;
+}
+
 static GstClockTime
 clock_convert_external (GstClockTime external, GstClockTime cinternal,
     GstClockTime cexternal, GstClockTime crate_num, GstClockTime crate_denom)
@@ -1787,6 +2020,13 @@ gst_audio_base_sink_get_alignment (GstAudioBaseSink * sink,
         sample_offset > sink->next_sample ? "+" : "-", GST_TIME_ARGS (diff_s));
     align = 0;
 
+    GST_OBJECT_LOCK (sink);
+    if (sample_offset > sink->next_sample)
+      sink->priv->stats.inserted_samples += sample_diff;
+    else
+      sink->priv->stats.dropped_samples += sample_diff;
+    GST_OBJECT_UNLOCK (sink);
+
     gst_audio_base_sink_custom_cb_report_discont (sink,
         GST_AUDIO_BASE_SINK_DISCONT_REASON_ALIGNMENT);
   }
@@ -1813,11 +2053,13 @@ gst_audio_base_sink_render (GstBaseSink * bsink, GstBuffer * buf)
   gint out_samples;
   GstClockTime base_time, render_delay, latency;
   GstClock *clock;
-  gboolean sync, slaved, align_next;
+  gboolean sync, slaved, align_next, low_latency;
   GstFlowReturn ret;
   GstSegment clip_seg;
   gint64 time_offset;
   GstBuffer *out = NULL;
+  GstClockTime process_start, process_time;
+  GstStructure *stats = NULL;
 
   sink = GST_AUDIO_BASE_SINK (bsink);
   bclass = GST_AUDIO_BASE_SINK_GET_CLASS (sink);
@@ -1833,8 +2075,15 @@ gst_audio_base_sink_render (GstBaseSink * bsink, GstBuffer * buf)
    * latency. */
   GST_OBJECT_LOCK (sink);
   base_time = GST_ELEMENT_CAST (sink)->base_time;
+  low_latency = sink->priv->low_latency;
   if (G_UNLIKELY (sink->priv->sync_latency)) {
-    ret = gst_audio_base_sink_sync_latency (bsink, GST_MINI_OBJECT_CAST (buf));
+    /* in low-latency mode samples are not placed according to the clock, so
+     * there is nothing to align to */
+    if (low_latency)
+      ret = GST_FLOW_OK;
+    else
+      ret = gst_audio_base_sink_sync_latency (bsink,
+          GST_MINI_OBJECT_CAST (buf));
     GST_OBJECT_UNLOCK (sink);
     if (G_UNLIKELY (ret != GST_FLOW_OK))
       goto sync_latency_failed;
@@ -1899,7 +2148,10 @@ gst_audio_base_sink_render (GstBaseSink * bsink, GstBuffer * buf)
   /* if not valid timestamp or we can't clip or sync, try to play
    * sample ASAP */
   if (!GST_CLOCK_TIME_IS_VALID (time)) {
-    render_start = gst_audio_base_sink_get_offset (sink);
+    if (G_UNLIKELY (low_latency))
+      render_start = gst_audio_base_sink_get_low_latency_offset (sink, samples);
+    else
+      render_start = gst_audio_base_sink_get_offset (sink);
     render_stop = render_start + samples;
     GST_DEBUG_OBJECT (sink, "Buffer of size %" G_GSIZE_FORMAT " has no time."
         " Using render_start=%" G_GUINT64_FORMAT, size, render_start);
@@ -1968,6 +2220,30 @@ gst_audio_base_sink_render (GstBaseSink * bsink, GstBuffer * buf)
     stop = cstop;
   }
 
+  if (G_UNLIKELY (low_latency)) {
+    GstClockTime rstart, rstop;
+
+    /* we don't sync against the timestamps here, but draining still waits
+     * for the running time of the last sample */
+    rstart =
+        gst_segment_to_running_time (&bsink->segment, GST_FORMAT_TIME, time);
+    rstop =
+        gst_segment_to_running_time (&bsink->segment, GST_FORMAT_TIME, stop);
+    if (G_LIKELY (bsink->segment.rate >= 0.0)) {
+      if (rstop != GST_CLOCK_TIME_NONE)
+        sink->priv->eos_time = rstop;
+    } else {
+      if (rstart != GST_CLOCK_TIME_NONE)
+        sink->priv->eos_time = rstart;
+    }
+
+    render_start = gst_audio_base_sink_get_low_latency_offset (sink, samples);
+    render_stop = render_start + samples;
+    GST_DEBUG_OBJECT (sink,
+        "low-latency. Using render_start=%" G_GUINT64_FORMAT, render_start);
+    goto no_align;
+  }
+
   /* figure out how to sync */
   if (G_LIKELY ((clock = GST_ELEMENT_CLOCK (bsink))))
     sync = bsink->sync;
@@ -2136,14 +2412,33 @@ no_align:
   GST_DEBUG_OBJECT (sink, "rendering at %" G_GUINT64_FORMAT " %d/%d",
       sample_offset, samples, out_samples);
 
+  /* samples before the segment the device is processing are dropped by the
+   * ringbuffer, the device played whatever was there instead */
+  if (g_atomic_int_get (&ringbuf->state) == GST_AUDIO_RING_BUFFER_STATE_STARTED
+      && bsink->segment.rate >= 0.0) {
+    guint64 processing = (guint64) MAX (g_atomic_int_get (&ringbuf->segdone)
+        - ringbuf->segbase, 0) * ringbuf->samples_per_seg;
+
+    if (sample_offset < processing) {
+      GST_OBJECT_LOCK (sink);
+      sink->priv->stats.underruns++;
+      sink->priv->stats.dropped_samples +=
+          MIN (processing - sample_offset, samples);
+      GST_OBJECT_UNLOCK (sink);
+    }
+  }
+
   /* we need to accumulate over different runs for when we get interrupted */
   accum = 0;
   align_next = TRUE;
+  process_time = 0;
   gst_buffer_map (buf, &info, GST_MAP_READ);
   do {
+    process_start = gst_util_get_timestamp ();
     written =
         gst_audio_ring_buffer_commit (ringbuf, &sample_offset,
         info.data + offset, samples, out_samples, &accum);
+    process_time += gst_util_get_timestamp () - process_start;
 
     GST_DEBUG_OBJECT (sink, "wrote %u of %u", written, samples);
     /* if we wrote all, we're done */
@@ -2179,6 +2474,24 @@ no_align:
   GST_DEBUG_OBJECT (sink, "next sample expected at %" G_GUINT64_FORMAT,
       sink->next_sample);
 
+  GST_OBJECT_LOCK (sink);
+  __gst_audio_stats_add_process_time (&sink->priv->stats, process_time);
+  if (__gst_audio_stats_need_post (&sink->priv->stats,
+          sink->priv->stats_interval))
+    stats = __gst_audio_stats_to_structure (&sink->priv->stats,
+        "application/x-gst-audio-base-sink-stats");
+  GST_OBJECT_UNLOCK (sink);
+
+  if (stats)
+    gst_element_post_message (GST_ELEMENT_CAST (sink),
+        gst_message_new_element (GST_OBJECT_CAST (sink), stats));
+
+  /* don't wait for the ringbuffer to fill up, gst_audio_ring_buffer_start()
+   * does nothing until we are allowed to start */
+  if (G_UNLIKELY (low_latency) && g_atomic_int_get (&ringbuf->state) !=
+      GST_AUDIO_RING_BUFFER_STATE_STARTED)
+    gst_audio_ring_buffer_start (ringbuf);
+
   if (G_UNLIKELY (GST_CLOCK_TIME_IS_VALID (stop)
           && stop >= bsink->segment.stop)) {
     GST_DEBUG_OBJECT (sink,
@@ -2420,6 +2733,9 @@ gst_audio_base_sink_change_state (GstElement * element,
     }
     case GST_STATE_CHANGE_READY_TO_PAUSED:
       gst_audio_base_sink_reset_sync (sink);
+      GST_OBJECT_LOCK (sink);
+      __gst_audio_stats_reset (&sink->priv->stats);
+      GST_OBJECT_UNLOCK (sink);
       gst_audio_ring_buffer_set_flushing (sink->ringbuffer, FALSE);
       gst_audio_ring_buffer_may_start (sink->ringbuffer, FALSE);
 
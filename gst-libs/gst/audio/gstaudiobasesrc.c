@@ -39,6 +39,7 @@
 
 #include <gst/audio/audio.h>
 #include "gstaudiobasesrc.h"
+#include "gstaudioutilsprivate.h"
 
 #include "gst/gst-i18n-plugin.h"
 
@@ -49,6 +50,10 @@ struct _GstAudioBaseSrcPrivate
 {
   /* the clock slaving algorithm in use */
   GstAudioBaseSrcSlaveMethod slave_method;
+
+  /* protected by the object lock */
+  GstAudioStats stats;
+  GstClockTime stats_interval;
 };
 
 /* BaseAudioSrc signals and args */
@@ -65,6 +70,7 @@ enum
 #define DEFAULT_ACTUAL_LATENCY_TIME    -1
 #define DEFAULT_PROVIDE_CLOCK   TRUE
 #define DEFAULT_SLAVE_METHOD    GST_AUDIO_BASE_SRC_SLAVE_SKEW
+#define DEFAULT_AUDIO_STATS_INTERVAL 0
 
 enum
 {
@@ -75,6 +81,8 @@ enum
   PROP_ACTUAL_LATENCY_TIME,
   PROP_PROVIDE_CLOCK,
   PROP_SLAVE_METHOD,
+  PROP_AUDIO_STATS,
+  PROP_AUDIO_STATS_INTERVAL,
   PROP_LAST
 };
 
@@ -189,6 +197,40 @@ gst_audio_base_src_class_init (GstAudioBaseSrcClass * klass)
           GST_TYPE_AUDIO_BASE_SRC_SLAVE_METHOD, DEFAULT_SLAVE_METHOD,
           G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
+  /**
+   * GstAudioBaseSrc:audio-stats:
+   *
+   * Glitch and processing time counters since the source went to PAUSED, in
+   * a structure named "application/x-gst-audio-base-src-stats" with the
+   * same fields as #GstAudioBaseSink:audio-stats. Here "overruns" counts
+   * the number of times the device overwrote samples before they were read,
+   * "dropped-samples" the samples lost that way or skipped when resyncing
+   * to the clock, and the process times are the time spent reading a buffer
+   * from the ringbuffer, including waiting for the device. "underruns" and
+   * "inserted-samples" are not counted by sources.
+   *
+   * Since: 1.20
+   */
+  g_object_class_install_property (gobject_class, PROP_AUDIO_STATS,
+      g_param_spec_boxed ("audio-stats", "Audio Statistics",
+          "Overrun, dropped sample and processing time counters",
+          GST_TYPE_STRUCTURE, G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstAudioBaseSrc:audio-stats-interval:
+   *
+   * Interval in nanoseconds at which the #GstAudioBaseSrc:audio-stats are
+   * posted as an element message while capturing, 0 disables the messages.
+   *
+   * Since: 1.20
+   */
+  g_object_class_install_property (gobject_class, PROP_AUDIO_STATS_INTERVAL,
+      g_param_spec_uint64 ("audio-stats-interval", "Audio Statistics Interval",
+          "Interval in nanoseconds for posting the audio-stats as element "
+          "message (0 = disabled)", 0, G_MAXUINT64,
+          DEFAULT_AUDIO_STATS_INTERVAL,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
   gstelement_class->change_state =
       GST_DEBUG_FUNCPTR (gst_audio_base_src_change_state);
   gstelement_class->provide_clock =
@@ -222,6 +264,8 @@ gst_audio_base_src_init (GstAudioBaseSrc * audiobasesrc)
   else
     GST_OBJECT_FLAG_UNSET (audiobasesrc, GST_ELEMENT_FLAG_PROVIDE_CLOCK);
   audiobasesrc->priv->slave_method = DEFAULT_SLAVE_METHOD;
+  audiobasesrc->priv->stats_interval = DEFAULT_AUDIO_STATS_INTERVAL;
+  __gst_audio_stats_reset (&audiobasesrc->priv->stats);
   /* reset blocksize we use latency time to calculate a more useful
    * value based on negotiated format. */
   GST_BASE_SRC (audiobasesrc)->blocksize = 0;
@@ -435,6 +479,11 @@ gst_audio_base_src_set_property (GObject * object, guint prop_id,
     case PROP_SLAVE_METHOD:
       gst_audio_base_src_set_slave_method (src, g_value_get_enum (value));
       break;
+    case PROP_AUDIO_STATS_INTERVAL:
+      GST_OBJECT_LOCK (src);
+      src->priv->stats_interval = g_value_get_uint64 (value);
+      GST_OBJECT_UNLOCK (src);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -478,6 +527,18 @@ gst_audio_base_src_get_property (GObject * object, guint prop_id,
     case PROP_SLAVE_METHOD:
       g_value_set_enum (value, gst_audio_base_src_get_slave_method (src));
       break;
+    case PROP_AUDIO_STATS:
+      GST_OBJECT_LOCK (src);
+      g_value_take_boxed (value,
+          __gst_audio_stats_to_structure (&src->priv->stats,
+              "application/x-gst-audio-base-src-stats"));
+      GST_OBJECT_UNLOCK (src);
+      break;
+    case PROP_AUDIO_STATS_INTERVAL:
+      GST_OBJECT_LOCK (src);
+      g_value_set_uint64 (value, src->priv->stats_interval);
+      GST_OBJECT_UNLOCK (src);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -758,6 +819,8 @@ gst_audio_base_src_create (GstBaseSrc * bsrc, guint64 offset, guint length,
   GstClock *clock;
   gboolean first;
   gboolean first_sample = src->next_sample == -1;
+  GstClockTime process_start, process_time;
+  GstStructure *stats = NULL;
 
   ringbuffer = src->ringbuffer;
   spec = &ringbuffer->spec;
@@ -802,11 +865,14 @@ gst_audio_base_src_create (GstBaseSrc * bsrc, guint64 offset, guint length,
   gst_buffer_map (buf, &info, GST_MAP_WRITE);
   ptr = info.data;
   first = TRUE;
+  process_time = 0;
   do {
     GstClockTime tmp_ts = GST_CLOCK_TIME_NONE;
 
+    process_start = gst_util_get_timestamp ();
     read =
         gst_audio_ring_buffer_read (ringbuffer, sample, ptr, samples, &tmp_ts);
+    process_time += gst_util_get_timestamp () - process_start;
     if (first && GST_CLOCK_TIME_IS_VALID (tmp_ts)) {
       first = FALSE;
       rb_timestamp = tmp_ts;
@@ -845,6 +911,11 @@ gst_audio_base_src_create (GstBaseSrc * bsrc, guint64 offset, guint length,
             "downstream can't keep up and is consuming samples too slowly.",
             sample - src->next_sample));
     GST_BUFFER_FLAG_SET (buf, GST_BUFFER_FLAG_DISCONT);
+
+    GST_OBJECT_LOCK (src);
+    src->priv->stats.overruns++;
+    src->priv->stats.dropped_samples += sample - src->next_sample;
+    GST_OBJECT_UNLOCK (src);
   }
 
   src->next_sample = sample + samples;
@@ -948,6 +1019,10 @@ gst_audio_base_src_create (GstBaseSrc * bsrc, guint64 offset, guint length,
           /* advance the ringbuffer */
           gst_audio_ring_buffer_advance (ringbuffer, segment_diff);
 
+          /* on the first buffer there was nothing to skip yet */
+          if (!first_sample && segment_diff > 0)
+            src->priv->stats.dropped_samples += ((guint64) segment_diff) * sps;
+
           /* we move the  new read segment to the last known written segment */
           new_read_segment =
               g_atomic_int_get (&ringbuffer->segdone) - ringbuffer->segbase;
@@ -1025,8 +1100,17 @@ gst_audio_base_src_create (GstBaseSrc * bsrc, guint64 offset, guint length,
   }
 
 no_sync:
+  __gst_audio_stats_add_process_time (&src->priv->stats, process_time);
+  if (__gst_audio_stats_need_post (&src->priv->stats,
+          src->priv->stats_interval))
+    stats = __gst_audio_stats_to_structure (&src->priv->stats,
+        "application/x-gst-audio-base-src-stats");
   GST_OBJECT_UNLOCK (src);
 
+  if (stats)
+    gst_element_post_message (GST_ELEMENT_CAST (src),
+        gst_message_new_element (GST_OBJECT_CAST (src), stats));
+
   GST_BUFFER_PTS (buf) = timestamp;
   GST_BUFFER_DURATION (buf) = duration;
   GST_BUFFER_OFFSET (buf) = sample;
@@ -1132,6 +1216,9 @@ gst_audio_base_src_change_state (GstElement * element,
     case GST_STATE_CHANGE_READY_TO_PAUSED:
       GST_DEBUG_OBJECT (src, "READY->PAUSED");
       src->next_sample = -1;
+      GST_OBJECT_LOCK (src);
+      __gst_audio_stats_reset (&src->priv->stats);
+      GST_OBJECT_UNLOCK (src);
       gst_audio_ring_buffer_set_flushing (src->ringbuffer, FALSE);
       gst_audio_ring_buffer_may_start (src->ringbuffer, FALSE);
       /* Only post clock-provide messages if this is the clock that
@@ -1335,12 +1335,20 @@ gst_audio_ring_buffer_clear_all (GstAudioRingBuffer * buf)
 }
 
 
+/* Wait until the device advanced past @segdone, the segment counter value
+ * the caller based its decision to wait on.
+ *
+ * The segment handoff between the streaming thread and the device thread is
+ * lock-free: the device only increments segdone atomically and the
+ * streaming thread only ends up here when the ringbuffer is full (commit)
+ * or empty (read). Like with a futex, the counter is compared again after
+ * announcing ourselves in the waiting flag, so that an advance that happens
+ * right before we would go to sleep is never missed. Otherwise we would
+ * oversleep by a whole segment, which at small periods means a missed
+ * deadline. */
 static gboolean
-wait_segment (GstAudioRingBuffer * buf)
+wait_segment (GstAudioRingBuffer * buf, gint segdone)
 {
-  gint segments;
-  gboolean wait = TRUE;
-
   /* buffer must be started now or we deadlock since nobody is reading */
   if (G_UNLIKELY (g_atomic_int_get (&buf->state) !=
           GST_AUDIO_RING_BUFFER_STATE_STARTED)) {
@@ -1349,15 +1357,16 @@ wait_segment (GstAudioRingBuffer * buf)
       goto no_start;
 
     GST_DEBUG_OBJECT (buf, "start!");
-    segments = g_atomic_int_get (&buf->segdone);
     gst_audio_ring_buffer_start (buf);
-
-    /* After starting, the writer may have wrote segments already and then we
-     * don't need to wait anymore */
-    if (G_LIKELY (g_atomic_int_get (&buf->segdone) != segments))
-      wait = FALSE;
   }
 
+  /* The device may have processed segments already, e.g. right after
+   * starting, and then we don't need to wait anymore. Flushing pauses the
+   * ringbuffer, so checking the state is enough to not miss that. */
+  if (g_atomic_int_get (&buf->segdone) != segdone &&
+      g_atomic_int_get (&buf->state) == GST_AUDIO_RING_BUFFER_STATE_STARTED)
+    return TRUE;
+
   /* take lock first, then update our waiting flag */
   GST_OBJECT_LOCK (buf);
   if (G_UNLIKELY (buf->flushing))
@@ -1367,18 +1376,24 @@ wait_segment (GstAudioRingBuffer * buf)
           GST_AUDIO_RING_BUFFER_STATE_STARTED))
     goto not_started;
 
-  if (G_LIKELY (wait)) {
-    if (g_atomic_int_compare_and_exchange (&buf->waiting, 0, 1)) {
-      GST_DEBUG_OBJECT (buf, "waiting..");
-      GST_AUDIO_RING_BUFFER_WAIT (buf);
+  if (g_atomic_int_compare_and_exchange (&buf->waiting, 0, 1)) {
+    /* the device may have advanced between our check and setting the
+     * waiting flag, in which case it did not see the flag */
+    if (g_atomic_int_get (&buf->segdone) != segdone) {
+      g_atomic_int_compare_and_exchange (&buf->waiting, 1, 0);
+      GST_OBJECT_UNLOCK (buf);
+      return TRUE;
+    }
 
-      if (G_UNLIKELY (buf->flushing))
-        goto flushing;
+    GST_DEBUG_OBJECT (buf, "waiting..");
+    GST_AUDIO_RING_BUFFER_WAIT (buf);
 
-      if (G_UNLIKELY (g_atomic_int_get (&buf->state) !=
-              GST_AUDIO_RING_BUFFER_STATE_STARTED))
-        goto not_started;
-    }
+    if (G_UNLIKELY (buf->flushing))
+      goto flushing;
+
+    if (G_UNLIKELY (g_atomic_int_get (&buf->state) !=
+            GST_AUDIO_RING_BUFFER_STATE_STARTED))
+      goto not_started;
   }
   GST_OBJECT_UNLOCK (buf);
 
@@ -1597,7 +1612,7 @@ default_commit (GstAudioRingBuffer * buf, guint64 * sample,
       }
 
       /* else we need to wait for the segment to become writable. */
-      if (!wait_segment (buf))
+      if (!wait_segment (buf, segdone + buf->segbase))
         goto not_started;
     }
 
@@ -1813,7 +1828,7 @@ gst_audio_ring_buffer_read (GstAudioRingBuffer * buf, guint64 sample,
         break;
 
       /* else we need to wait for the segment to become readable. */
-      if (!wait_segment (buf))
+      if (!wait_segment (buf, segdone + buf->segbase))
         goto not_started;
     }
 
@@ -1933,12 +1948,15 @@ gst_audio_ring_buffer_advance (GstAudioRingBuffer * buf, guint advance)
 {
   g_return_if_fail (GST_IS_AUDIO_RING_BUFFER (buf));
 
-  /* update counter */
+  /* update counter, this hands the segments over to the streaming thread
+   * without taking any lock */
   g_atomic_int_add (&buf->segdone, advance);
 
-  /* the lock is already taken when the waiting flag is set,
-   * we grab the lock as well to make sure the waiter is actually
-   * waiting for the signal */
+  /* Only when the streaming thread is blocked on a full or empty ringbuffer
+   * we need to wake it up. The lock is already taken when the waiting flag
+   * is set, we grab the lock as well to make sure the waiter is actually
+   * waiting for the signal. The waiter checks segdone again after setting
+   * the flag, so no wakeup is lost. */
   if (g_atomic_int_compare_and_exchange (&buf->waiting, 1, 0)) {
     GST_OBJECT_LOCK (buf);
     GST_DEBUG_OBJECT (buf, "signal waiter");
@@ -2093,6 +2111,8 @@ gst_audio_ring_buffer_set_timestamp (GstAudioRingBuffer * buf, gint readseg,
   GST_DEBUG_OBJECT (buf, "Storing timestamp %" GST_TIME_FORMAT
       " @ %d", GST_TIME_ARGS (timestamp), readseg);
 
+  /* The device thread of a source is only joined after release freed the
+   * timestamps, so check under the lock that we are still acquired */
   GST_OBJECT_LOCK (buf);
   if (G_UNLIKELY (!buf->acquired))
     goto not_acquired;
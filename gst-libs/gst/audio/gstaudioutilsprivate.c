@@ -23,6 +23,8 @@
 #include "config.h"
 #endif
 
+#include <string.h>
+
 #include <gst/audio/audio.h>
 #ifdef G_OS_WIN32
 #include <windows.h>
@@ -333,3 +335,90 @@ __gst_audio_restore_thread_priority (gpointer handle)
   return TRUE;
 #endif
 }
+
+/* upper bounds of the processing time histogram buckets, the last bucket
+ * counts everything above the last bound */
+static const GstClockTime stats_bucket_bounds[GST_AUDIO_STATS_N_BUCKETS - 1] = {
+  100 * GST_USECOND, 250 * GST_USECOND, 500 * GST_USECOND, 1 * GST_MSECOND,
+  2500 * GST_USECOND, 5 * GST_MSECOND, 10 * GST_MSECOND
+};
+
+void
+__gst_audio_stats_reset (GstAudioStats * stats)
+{
+  memset (stats, 0, sizeof (GstAudioStats));
+  stats->last_post = g_get_monotonic_time ();
+}
+
+void
+__gst_audio_stats_add_process_time (GstAudioStats * stats, GstClockTime time)
+{
+  gint i;
+
+  stats->processed++;
+  stats->process_time += time;
+  stats->max_process_time = MAX (stats->max_process_time, time);
+
+  for (i = 0; i < GST_AUDIO_STATS_N_BUCKETS - 1; i++) {
+    if (time < stats_bucket_bounds[i])
+      break;
+  }
+  stats->histogram[i]++;
+}
+
+/*
+ * Creates a structure called @name with the counters of @stats.
+ */
+GstStructure *
+__gst_audio_stats_to_structure (const GstAudioStats * stats,
+    const gchar * name)
+{
+  GstStructure *s;
+  GValue histogram = G_VALUE_INIT;
+  GValue val = G_VALUE_INIT;
+  GstClockTime average;
+  gint i;
+
+  average = stats->processed ? stats->process_time / stats->processed : 0;
+
+  s = gst_structure_new (name,
+      "underruns", G_TYPE_UINT64, stats->underruns,
+      "overruns", G_TYPE_UINT64, stats->overruns,
+      "dropped-samples", G_TYPE_UINT64, stats->dropped_samples,
+      "inserted-samples", G_TYPE_UINT64, stats->inserted_samples,
+      "processed", G_TYPE_UINT64, stats->processed,
+      "process-time", G_TYPE_UINT64, stats->process_time,
+      "average-process-time", G_TYPE_UINT64, average,
+      "max-process-time", G_TYPE_UINT64, stats->max_process_time, NULL);
+
+  g_value_init (&histogram, GST_TYPE_ARRAY);
+  g_value_init (&val, G_TYPE_UINT64);
+  for (i = 0; i < GST_AUDIO_STATS_N_BUCKETS; i++) {
+    g_value_set_uint64 (&val, stats->histogram[i]);
+    gst_value_array_append_value (&histogram, &val);
+  }
+  g_value_unset (&val);
+  gst_structure_take_value (s, "process-time-histogram", &histogram);
+
+  return s;
+}
+
+/*
+ * Returns %TRUE when @interval passed since the last time this function
+ * returned %TRUE.
+ */
+gboolean
+__gst_audio_stats_need_post (GstAudioStats * stats, GstClockTime interval)
+{
+  gint64 now;
+
+  if (interval == 0)
+    return FALSE;
+
+  now = g_get_monotonic_time ();
+  if ((GstClockTime) (now - stats->last_post) * GST_USECOND < interval)
+    return FALSE;
+
+  stats->last_post = now;
+  return TRUE;
+}
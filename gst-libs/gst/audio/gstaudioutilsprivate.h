@@ -48,6 +48,41 @@ gboolean __gst_audio_set_thread_priority   (gpointer * handle);
 G_GNUC_INTERNAL
 gboolean __gst_audio_restore_thread_priority (gpointer handle);
 
+/* Glitch and processing time counters of the audio base sink and source */
+#define GST_AUDIO_STATS_N_BUCKETS 8
+
+typedef struct
+{
+  guint64 underruns;
+  guint64 overruns;
+  guint64 dropped_samples;
+  guint64 inserted_samples;
+
+  /* time spent writing buffers to / reading buffers from the ringbuffer */
+  guint64 processed;
+  GstClockTime process_time;
+  GstClockTime max_process_time;
+  guint64 histogram[GST_AUDIO_STATS_N_BUCKETS];
+
+  /* monotonic time the last stats message was posted */
+  gint64 last_post;
+} GstAudioStats;
+
+G_GNUC_INTERNAL
+void __gst_audio_stats_reset (GstAudioStats * stats);
+
+G_GNUC_INTERNAL
+void __gst_audio_stats_add_process_time (GstAudioStats * stats,
+                                         GstClockTime time);
+
+G_GNUC_INTERNAL
+GstStructure *__gst_audio_stats_to_structure (const GstAudioStats * stats,
+                                              const gchar * name);
+
+G_GNUC_INTERNAL
+gboolean __gst_audio_stats_need_post (GstAudioStats * stats,
+                                      GstClockTime interval);
+
 G_END_DECLS
 
 #endif
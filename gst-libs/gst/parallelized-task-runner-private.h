@@ -0,0 +1,67 @@
+/* GStreamer
+ * Copyright (C) 2010 David Schleef <ds@schleef.org>
+ * Copyright (C) 2010 Sebastian Dröge <sebastian.droege@collabora.co.uk>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __GST_PARALLELIZED_TASK_RUNNER_PRIVATE_H__
+#define __GST_PARALLELIZED_TASK_RUNNER_PRIVATE_H__
+
+#include <gst/gst.h>
+#include <gst/base/base.h>
+
+G_BEGIN_DECLS
+
+/* Splits a job into n_threads tasks that run on a GstTaskPool, the calling
+ * thread runs the last one. Compiled into each library that uses it. */
+
+typedef void (*GstParallelizedTaskFunc) (gpointer user_data);
+
+typedef struct _GstParallelizedTaskRunner GstParallelizedTaskRunner;
+
+struct _GstParallelizedTaskRunner
+{
+  GstTaskPool *pool;
+  gboolean own_pool;
+  guint n_threads;
+
+  GstQueueArray *tasks;
+
+  GstParallelizedTaskFunc func;
+  gpointer *task_data;
+
+  GMutex lock;
+  gint n_todo;
+};
+
+G_GNUC_INTERNAL
+GstParallelizedTaskRunner * gst_parallelized_task_runner_new (guint n_threads,
+    GstTaskPool * pool);
+
+G_GNUC_INTERNAL
+void gst_parallelized_task_runner_free (GstParallelizedTaskRunner * self);
+
+G_GNUC_INTERNAL
+void gst_parallelized_task_runner_run (GstParallelizedTaskRunner * self,
+    GstParallelizedTaskFunc func, gpointer * task_data);
+
+G_GNUC_INTERNAL
+GstTaskPool * gst_parallelized_task_runner_get_shared_pool (void);
+
+G_END_DECLS
+
+#endif /* __GST_PARALLELIZED_TASK_RUNNER_PRIVATE_H__ */
@@ -0,0 +1,181 @@
+/* GStreamer
+ * Copyright (C) 2010 David Schleef <ds@schleef.org>
+ * Copyright (C) 2010 Sebastian Dröge <sebastian.droege@collabora.co.uk>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "parallelized-task-runner-private.h"
+
+static void
+gst_parallelized_task_thread_func (gpointer data)
+{
+  GstParallelizedTaskRunner *runner = data;
+  gint idx;
+
+  g_mutex_lock (&runner->lock);
+  idx = runner->n_todo--;
+  g_assert (runner->n_todo >= -1);
+  g_mutex_unlock (&runner->lock);
+
+  g_assert (runner->func != NULL);
+
+  runner->func (runner->task_data[idx]);
+}
+
+static void
+gst_parallelized_task_runner_join (GstParallelizedTaskRunner * self)
+{
+  gboolean joined = FALSE;
+
+  while (!joined) {
+    g_mutex_lock (&self->lock);
+    if (!(joined = gst_queue_array_is_empty (self->tasks))) {
+      gpointer task = gst_queue_array_pop_head (self->tasks);
+      g_mutex_unlock (&self->lock);
+      gst_task_pool_join (self->pool, task);
+    } else {
+      g_mutex_unlock (&self->lock);
+    }
+  }
+}
+
+void
+gst_parallelized_task_runner_free (GstParallelizedTaskRunner * self)
+{
+  gst_parallelized_task_runner_join (self);
+
+  gst_queue_array_free (self->tasks);
+  if (self->own_pool)
+    gst_task_pool_cleanup (self->pool);
+  gst_object_unref (self->pool);
+  g_mutex_clear (&self->lock);
+  g_free (self);
+}
+
+GstParallelizedTaskRunner *
+gst_parallelized_task_runner_new (guint n_threads, GstTaskPool * pool)
+{
+  GstParallelizedTaskRunner *self;
+
+  if (n_threads == 0)
+    n_threads = g_get_num_processors ();
+
+  self = g_new0 (GstParallelizedTaskRunner, 1);
+
+  if (pool) {
+    self->pool = g_object_ref (pool);
+    self->own_pool = FALSE;
+
+    /* No reason to split up the work between more threads than the
+     * pool can spawn */
+    if (GST_IS_SHARED_TASK_POOL (pool))
+      n_threads =
+          MIN (n_threads,
+          gst_shared_task_pool_get_max_threads (GST_SHARED_TASK_POOL (pool)));
+  } else {
+    self->pool = gst_shared_task_pool_new ();
+    self->own_pool = TRUE;
+    gst_shared_task_pool_set_max_threads (GST_SHARED_TASK_POOL (self->pool),
+        n_threads);
+    gst_task_pool_prepare (self->pool, NULL);
+  }
+
+  self->tasks = gst_queue_array_new (n_threads);
+
+  self->n_threads = n_threads;
+
+  self->n_todo = -1;
+  g_mutex_init (&self->lock);
+
+  /* Set when scheduling a job */
+  self->func = NULL;
+  self->task_data = NULL;
+
+  return self;
+}
+
+void
+gst_parallelized_task_runner_run (GstParallelizedTaskRunner * self,
+    GstParallelizedTaskFunc func, gpointer * task_data)
+{
+  guint n_threads = self->n_threads;
+
+  self->func = func;
+  self->task_data = task_data;
+
+  if (n_threads > 1) {
+    guint i = 0;
+    g_mutex_lock (&self->lock);
+    self->n_todo = self->n_threads - 2;
+    for (i = 1; i < n_threads; i++) {
+      gpointer task =
+          gst_task_pool_push (self->pool, gst_parallelized_task_thread_func,
+          self, NULL);
+
+      /* The return value of push() is unfortunately nullable, and we can't deal with that */
+      g_assert (task != NULL);
+      gst_queue_array_push_tail (self->tasks, task);
+    }
+    g_mutex_unlock (&self->lock);
+  }
+
+  self->func (self->task_data[self->n_threads - 1]);
+
+  gst_parallelized_task_runner_join (self);
+
+  self->func = NULL;
+  self->task_data = NULL;
+}
+
+/* Each library that compiles this file has one pool that all of its runners
+ * share. It is limited to the number of processors and only lives while
+ * somebody holds a reference, so that its threads are shut down once the
+ * last converter or resampler is gone instead of leaking past gst_deinit().
+ * The weak reference can't hand out a pool that is already being disposed. */
+static GMutex shared_pool_lock;
+static GWeakRef shared_pool;
+
+static void
+shared_pool_disposed (gpointer data, GObject * pool)
+{
+  gst_task_pool_cleanup (GST_TASK_POOL (pool));
+}
+
+GstTaskPool *
+gst_parallelized_task_runner_get_shared_pool (void)
+{
+  GstTaskPool *pool;
+
+  g_mutex_lock (&shared_pool_lock);
+  pool = g_weak_ref_get (&shared_pool);
+  if (pool == NULL) {
+    pool = gst_shared_task_pool_new ();
+    gst_shared_task_pool_set_max_threads (GST_SHARED_TASK_POOL (pool),
+        g_get_num_processors ());
+    gst_task_pool_prepare (pool, NULL);
+
+    g_object_weak_ref (G_OBJECT (pool), shared_pool_disposed, NULL);
+    g_weak_ref_set (&shared_pool, pool);
+  }
+  g_mutex_unlock (&shared_pool_lock);
+
+  return pool;
+}
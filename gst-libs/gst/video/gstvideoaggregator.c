@@ -397,6 +397,7 @@ enum
 {
   PROP_CONVERT_PAD_0,
   PROP_CONVERT_PAD_CONVERTER_CONFIG,
+  PROP_CONVERT_PAD_STATS,
 };
 
 struct _GstVideoAggregatorConvertPadPrivate
@@ -410,11 +411,23 @@ struct _GstVideoAggregatorConvertPadPrivate
   /* caps used for conversion if needed */
   GstVideoInfo conversion_info;
   GstBuffer *converted_buffer;
+  /* input buffer @converted_buffer was converted from, so that repeated
+   * input buffers are not converted again. Not a reference, it is only
+   * valid while it is the current buffer of the pad */
+  gconstpointer converted_input;
+  /* Pool the converted buffers are recycled in, and the size of its
+   * buffers */
+  GstBufferPool *converted_pool;
+  guint converted_pool_size;
 
   /* The following fields are accessed from the property setters / getters,
    * and as such are protected with the object lock */
   GstStructure *converter_config;
   gboolean converter_config_changed;
+  /* Number of conversions, and of repeated input buffers for which the
+   * previous conversion was reused */
+  guint64 n_converted;
+  guint64 n_reused;
 
   GstTaskPool *task_pool;
 };
@@ -422,6 +435,88 @@ struct _GstVideoAggregatorConvertPadPrivate
 G_DEFINE_TYPE_WITH_PRIVATE (GstVideoAggregatorConvertPad,
     gst_video_aggregator_convert_pad, GST_TYPE_VIDEO_AGGREGATOR_PAD);
 
+static void
+gst_video_aggregator_convert_pad_free_pool (GstVideoAggregatorConvertPad * pad)
+{
+  if (!pad->priv->converted_pool)
+    return;
+
+  GST_DEBUG_OBJECT (pad, "Freeing pool of %u byte buffers",
+      pad->priv->converted_pool_size);
+
+  gst_buffer_pool_set_active (pad->priv->converted_pool, FALSE);
+  gst_object_unref (pad->priv->converted_pool);
+  pad->priv->converted_pool = NULL;
+  pad->priv->converted_pool_size = 0;
+}
+
+/* Converted buffers are allocated from a pool so that they are recycled
+ * instead of being allocated again for every output frame */
+static GstBuffer *
+gst_video_aggregator_convert_pad_acquire_buffer (GstVideoAggregatorConvertPad *
+    pad, guint size)
+{
+  static GstAllocationParams params = { 0, 15, 0, 0, };
+  GstBuffer *buffer = NULL;
+
+  if (pad->priv->converted_pool && pad->priv->converted_pool_size != size)
+    gst_video_aggregator_convert_pad_free_pool (pad);
+
+  if (!pad->priv->converted_pool) {
+    GstBufferPool *pool;
+    GstStructure *config;
+    GstCaps *caps;
+
+    pool = gst_video_buffer_pool_new ();
+    config = gst_buffer_pool_get_config (pool);
+    caps = gst_video_info_to_caps (&pad->priv->conversion_info);
+    gst_buffer_pool_config_set_params (config, caps, size, 0, 0);
+    gst_buffer_pool_config_set_allocator (config, NULL, &params);
+    gst_caps_unref (caps);
+
+    if (!gst_buffer_pool_set_config (pool, config)
+        || !gst_buffer_pool_set_active (pool, TRUE)) {
+      GST_WARNING_OBJECT (pad, "Could not configure buffer pool");
+      gst_object_unref (pool);
+      return NULL;
+    }
+
+    GST_DEBUG_OBJECT (pad, "Created pool of %u byte buffers", size);
+    pad->priv->converted_pool = pool;
+    pad->priv->converted_pool_size = size;
+  }
+
+  if (gst_buffer_pool_acquire_buffer (pad->priv->converted_pool, &buffer,
+          NULL) != GST_FLOW_OK)
+    return NULL;
+
+  return buffer;
+}
+
+/* Drops the last conversion, so that a buffer seen before a flush or a
+ * restart is converted again */
+static void
+gst_video_aggregator_convert_pad_clear_converted (GstVideoAggregatorConvertPad
+    * pad)
+{
+  gst_buffer_replace (&pad->priv->converted_buffer, NULL);
+  pad->priv->converted_input = NULL;
+}
+
+static GstFlowReturn
+gst_video_aggregator_convert_pad_flush (GstAggregatorPad * aggpad,
+    GstAggregator * aggregator)
+{
+  GstVideoAggregatorConvertPad *pad = GST_VIDEO_AGGREGATOR_CONVERT_PAD (aggpad);
+
+  gst_video_aggregator_convert_pad_clear_converted (pad);
+
+  return
+      GST_AGGREGATOR_PAD_CLASS
+      (gst_video_aggregator_convert_pad_parent_class)->flush (aggpad,
+      aggregator);
+}
+
 static void
 gst_video_aggregator_convert_pad_finalize (GObject * o)
 {
@@ -435,8 +530,8 @@ gst_video_aggregator_convert_pad_finalize (GObject * o)
     gst_structure_free (vaggpad->priv->converter_config);
   vaggpad->priv->converter_config = NULL;
 
-  if (vaggpad->priv->task_pool)
-    gst_task_pool_cleanup (vaggpad->priv->task_pool);
+  gst_buffer_replace (&vaggpad->priv->converted_buffer, NULL);
+  gst_video_aggregator_convert_pad_free_pool (vaggpad);
 
   gst_object_replace ((GstObject **) & vaggpad->priv->task_pool, NULL);
 
@@ -454,15 +549,6 @@ static void
   GST_OBJECT_UNLOCK (pad);
 }
 
-static guint
-get_opt_uint (const GstStructure * config, const gchar * opt, guint def)
-{
-  guint res;
-  if (!gst_structure_get_uint (config, opt, &res))
-    res = def;
-  return res;
-}
-
 static gboolean
 gst_video_aggregator_convert_pad_prepare_frame (GstVideoAggregatorPad * vpad,
     GstVideoAggregator * vagg, GstBuffer * buffer,
@@ -490,18 +576,11 @@ gst_video_aggregator_convert_pad_prepare_frame (GstVideoAggregatorPad * vpad,
       gst_video_converter_free (pad->priv->convert);
     pad->priv->convert = NULL;
 
-    if (!gst_video_info_is_equal (&vpad->info, &pad->priv->conversion_info)) {
-      if (pad->priv->converter_config) {
-        guint n_threads = get_opt_uint (pad->priv->converter_config,
-            GST_VIDEO_CONVERTER_OPT_THREADS, 1);
-
-        if (n_threads == 0 || n_threads > g_get_num_processors ())
-          n_threads = g_get_num_processors ();
-
-        gst_shared_task_pool_set_max_threads (GST_SHARED_TASK_POOL (pad->priv->
-                task_pool), n_threads);
-      }
+    gst_buffer_replace (&pad->priv->converted_buffer, NULL);
+    pad->priv->converted_input = NULL;
+    gst_video_aggregator_convert_pad_free_pool (pad);
 
+    if (!gst_video_info_is_equal (&vpad->info, &pad->priv->conversion_info)) {
       pad->priv->convert =
           gst_video_converter_new_with_pool (&vpad->info,
           &pad->priv->conversion_info,
@@ -522,6 +601,23 @@ gst_video_aggregator_convert_pad_prepare_frame (GstVideoAggregatorPad * vpad,
   }
   GST_OBJECT_UNLOCK (pad);
 
+  /* Repeated input buffer, the result of the last conversion is still valid */
+  if (pad->priv->convert && pad->priv->converted_buffer
+      && pad->priv->converted_input == buffer) {
+    GST_LOG_OBJECT (pad, "reusing converted frame");
+    GST_OBJECT_LOCK (pad);
+    pad->priv->n_reused++;
+    GST_OBJECT_UNLOCK (pad);
+
+    if (!gst_video_frame_map (prepared_frame, &pad->priv->conversion_info,
+            pad->priv->converted_buffer, GST_MAP_READ)) {
+      GST_WARNING_OBJECT (vagg, "Could not map converted frame");
+      return FALSE;
+    }
+
+    return TRUE;
+  }
+
   if (!gst_video_frame_map (&frame, &vpad->info, buffer, GST_MAP_READ)) {
     GST_WARNING_OBJECT (vagg, "Could not map input buffer");
     return FALSE;
@@ -530,7 +626,6 @@ gst_video_aggregator_convert_pad_prepare_frame (GstVideoAggregatorPad * vpad,
   if (pad->priv->convert) {
     GstVideoFrame converted_frame;
     GstBuffer *converted_buf = NULL;
-    static GstAllocationParams params = { 0, 15, 0, 0, };
     gint converted_size;
     guint outsize;
 
@@ -538,7 +633,14 @@ gst_video_aggregator_convert_pad_prepare_frame (GstVideoAggregatorPad * vpad,
     converted_size = pad->priv->conversion_info.size;
     outsize = GST_VIDEO_INFO_SIZE (&vagg->info);
     converted_size = converted_size > outsize ? converted_size : outsize;
-    converted_buf = gst_buffer_new_allocate (NULL, converted_size, &params);
+    converted_buf =
+        gst_video_aggregator_convert_pad_acquire_buffer (pad, converted_size);
+    if (!converted_buf) {
+      GST_WARNING_OBJECT (vagg, "Could not allocate converted frame");
+
+      gst_video_frame_unmap (&frame);
+      return FALSE;
+    }
 
     if (!gst_video_frame_map (&converted_frame, &(pad->priv->conversion_info),
             converted_buf, GST_MAP_READWRITE)) {
@@ -549,7 +651,12 @@ gst_video_aggregator_convert_pad_prepare_frame (GstVideoAggregatorPad * vpad,
     }
 
     gst_video_converter_frame (pad->priv->convert, &frame, &converted_frame);
+    GST_OBJECT_LOCK (pad);
+    pad->priv->n_converted++;
+    GST_OBJECT_UNLOCK (pad);
+    gst_buffer_replace (&pad->priv->converted_buffer, NULL);
     pad->priv->converted_buffer = converted_buf;
+    pad->priv->converted_input = buffer;
     gst_video_frame_unmap (&frame);
     *prepared_frame = converted_frame;
   } else {
@@ -563,17 +670,12 @@ static void
 gst_video_aggregator_convert_pad_clean_frame (GstVideoAggregatorPad * vpad,
     GstVideoAggregator * vagg, GstVideoFrame * prepared_frame)
 {
-  GstVideoAggregatorConvertPad *pad = GST_VIDEO_AGGREGATOR_CONVERT_PAD (vpad);
-
   if (prepared_frame->buffer) {
     gst_video_frame_unmap (prepared_frame);
     memset (prepared_frame, 0, sizeof (GstVideoFrame));
   }
 
-  if (pad->priv->converted_buffer) {
-    gst_buffer_unref (pad->priv->converted_buffer);
-    pad->priv->converted_buffer = NULL;
-  }
+  /* The converted buffer is kept around in case the input is repeated */
 }
 
 static void
@@ -649,6 +751,14 @@ gst_video_aggregator_convert_pad_get_property (GObject * object, guint prop_id,
         g_value_set_boxed (value, pad->priv->converter_config);
       GST_OBJECT_UNLOCK (pad);
       break;
+    case PROP_CONVERT_PAD_STATS:
+      GST_OBJECT_LOCK (pad);
+      g_value_take_boxed (value,
+          gst_structure_new ("application/x-videoaggregator-convert-pad-stats",
+              "converted", G_TYPE_UINT64, pad->priv->n_converted,
+              "reused", G_TYPE_UINT64, pad->priv->n_reused, NULL));
+      GST_OBJECT_UNLOCK (pad);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -681,6 +791,7 @@ gst_video_aggregator_convert_pad_class_init (GstVideoAggregatorConvertPadClass *
     klass)
 {
   GObjectClass *gobject_class = (GObjectClass *) klass;
+  GstAggregatorPadClass *aggpadclass = (GstAggregatorPadClass *) klass;
   GstVideoAggregatorPadClass *vaggpadclass =
       (GstVideoAggregatorPadClass *) klass;
 
@@ -697,6 +808,25 @@ gst_video_aggregator_convert_pad_class_init (GstVideoAggregatorConvertPadClass *
           "when scaling and converting this pad's video frames",
           GST_TYPE_STRUCTURE, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
+  /**
+   * GstVideoAggregatorConvertPad:stats:
+   *
+   * Conversion statistics of the pad, with the following fields:
+   *
+   *   * `converted`: #G_TYPE_UINT64, the number of frames that were converted
+   *   * `reused`: #G_TYPE_UINT64, the number of repeated input frames for
+   *      which the previous conversion was reused
+   *
+   * Since: 1.20
+   */
+  g_object_class_install_property (gobject_class,
+      PROP_CONVERT_PAD_STATS, g_param_spec_boxed ("stats", "Statistics",
+          "Conversion statistics of this pad", GST_TYPE_STRUCTURE,
+          G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+
+  aggpadclass->flush =
+      GST_DEBUG_FUNCPTR (gst_video_aggregator_convert_pad_flush);
+
   vaggpadclass->update_conversion_info =
       GST_DEBUG_FUNCPTR
       (gst_video_aggregator_convert_pad_update_conversion_info_internal);
@@ -719,9 +849,8 @@ gst_video_aggregator_convert_pad_init (GstVideoAggregatorConvertPad * vaggpad)
   vaggpad->priv->convert = NULL;
   vaggpad->priv->converter_config = NULL;
   vaggpad->priv->converter_config_changed = FALSE;
-  vaggpad->priv->task_pool = gst_shared_task_pool_new ();
-
-  gst_task_pool_prepare (vaggpad->priv->task_pool, NULL);
+  /* Conversion slices of all pads run on the process-wide pool */
+  vaggpad->priv->task_pool = gst_video_converter_get_shared_task_pool ();
 }
 
 /**
@@ -787,8 +916,23 @@ struct _GstVideoAggregatorPrivate
   /* The (ordered) list of #GstVideoFormatInfo supported by the aggregation
      method (from the srcpad template caps). */
   GPtrArray *supported_formats;
+
+  /* Protected by the object lock */
+  guint prepare_threads;
+
+  /* Only used from the aggregate thread. Separate from the pool the
+   * converters run their slices on, as the prepare tasks wait for those */
+  GstTaskPool *prepare_pool;
+};
+
+enum
+{
+  PROP_0,
+  PROP_PREPARE_THREADS,
 };
 
+#define DEFAULT_PREPARE_THREADS 1
+
 /* Can't use the G_DEFINE_TYPE macros because we need the
  * videoaggregator class in the _init to be able to set
  * the sink pad non-alpha caps. Using the G_DEFINE_TYPE there
@@ -1549,10 +1693,29 @@ gst_video_aggregator_reset (GstVideoAggregator * vagg)
     p->priv->end_time = -1;
 
     gst_video_info_init (&p->info);
+
+    if (GST_IS_VIDEO_AGGREGATOR_CONVERT_PAD (p))
+      gst_video_aggregator_convert_pad_clear_converted
+          (GST_VIDEO_AGGREGATOR_CONVERT_PAD (p));
   }
   GST_OBJECT_UNLOCK (vagg);
 }
 
+/* Replaces the current buffer of @pad. A convert pad only remembers the
+ * address of the buffer it converted last, so forget the converted frame
+ * when the current buffer changes: the old buffer may be recycled by
+ * upstream and come back at the same address */
+static void
+gst_video_aggregator_pad_replace_buffer (GstVideoAggregatorPad * pad,
+    GstBuffer * buffer)
+{
+  if (pad->priv->buffer != buffer && GST_IS_VIDEO_AGGREGATOR_CONVERT_PAD (pad))
+    gst_video_aggregator_convert_pad_clear_converted
+        (GST_VIDEO_AGGREGATOR_CONVERT_PAD (pad));
+
+  gst_buffer_replace (&pad->priv->buffer, buffer);
+}
+
 static GstFlowReturn
 gst_video_aggregator_fill_queues (GstVideoAggregator * vagg,
     GstClockTime output_start_running_time,
@@ -1622,7 +1785,7 @@ gst_video_aggregator_fill_queues (GstVideoAggregator * vagg,
         } else if (start_time < output_start_running_time) {
           GST_DEBUG_OBJECT (pad, "buffer duration is -1, start_time < "
               "output_start_running_time.  Discarding old buffer");
-          gst_buffer_replace (&pad->priv->buffer, buf);
+          gst_video_aggregator_pad_replace_buffer (pad, buf);
           if (pad->priv->pending_vinfo.finfo) {
             gst_caps_replace (&pad->priv->caps, pad->priv->pending_caps);
             gst_caps_replace (&pad->priv->pending_caps, NULL);
@@ -1645,7 +1808,7 @@ gst_video_aggregator_fill_queues (GstVideoAggregator * vagg,
         }
         gst_buffer_unref (buf);
         buf = gst_aggregator_pad_pop_buffer (bpad);
-        gst_buffer_replace (&pad->priv->buffer, buf);
+        gst_video_aggregator_pad_replace_buffer (pad, buf);
         if (pad->priv->pending_vinfo.finfo) {
           gst_caps_replace (&pad->priv->caps, pad->priv->pending_caps);
           gst_caps_replace (&pad->priv->pending_caps, NULL);
@@ -1707,7 +1870,7 @@ gst_video_aggregator_fill_queues (GstVideoAggregator * vagg,
         GST_DEBUG_OBJECT (pad,
             "Taking new buffer with start time %" GST_TIME_FORMAT,
             GST_TIME_ARGS (start_time));
-        gst_buffer_replace (&pad->priv->buffer, buf);
+        gst_video_aggregator_pad_replace_buffer (pad, buf);
         if (pad->priv->pending_vinfo.finfo) {
           gst_caps_replace (&pad->priv->caps, pad->priv->pending_caps);
           gst_caps_replace (&pad->priv->pending_caps, NULL);
@@ -1727,7 +1890,7 @@ gst_video_aggregator_fill_queues (GstVideoAggregator * vagg,
         gst_buffer_unref (buf);
         eos = FALSE;
       } else {
-        gst_buffer_replace (&pad->priv->buffer, buf);
+        gst_video_aggregator_pad_replace_buffer (pad, buf);
         if (pad->priv->pending_vinfo.finfo) {
           gst_caps_replace (&pad->priv->caps, pad->priv->pending_caps);
           gst_caps_replace (&pad->priv->pending_caps, NULL);
@@ -1762,7 +1925,7 @@ gst_video_aggregator_fill_queues (GstVideoAggregator * vagg,
               if (output_start_running_time - pad->priv->end_time >
                   pad->priv->max_last_buffer_repeat) {
                 pad->priv->start_time = pad->priv->end_time = -1;
-                gst_buffer_replace (&pad->priv->buffer, NULL);
+                gst_video_aggregator_pad_replace_buffer (pad, NULL);
                 gst_caps_replace (&pad->priv->caps, NULL);
               }
             } else {
@@ -1770,7 +1933,7 @@ gst_video_aggregator_fill_queues (GstVideoAggregator * vagg,
             }
             need_more_data = TRUE;
           } else {
-            gst_buffer_replace (&pad->priv->buffer, NULL);
+            gst_video_aggregator_pad_replace_buffer (pad, NULL);
             gst_caps_replace (&pad->priv->caps, NULL);
             pad->priv->start_time = pad->priv->end_time = -1;
           }
@@ -1778,7 +1941,7 @@ gst_video_aggregator_fill_queues (GstVideoAggregator * vagg,
           eos = FALSE;
         }
       } else if (is_eos) {
-        gst_buffer_replace (&pad->priv->buffer, NULL);
+        gst_video_aggregator_pad_replace_buffer (pad, NULL);
         gst_caps_replace (&pad->priv->caps, NULL);
       } else if (pad->priv->start_time != -1) {
         /* When the current buffer didn't have a duration, but
@@ -1790,7 +1953,7 @@ gst_video_aggregator_fill_queues (GstVideoAggregator * vagg,
             if (output_start_running_time - pad->priv->start_time >
                 pad->priv->max_last_buffer_repeat) {
               pad->priv->start_time = pad->priv->end_time = -1;
-              gst_buffer_replace (&pad->priv->buffer, NULL);
+              gst_video_aggregator_pad_replace_buffer (pad, NULL);
               gst_caps_replace (&pad->priv->caps, NULL);
             }
           }
@@ -1848,6 +2011,94 @@ prepare_frames (GstElement * agg, GstPad * pad, gpointer user_data)
       vpad->priv->buffer, &vpad->priv->prepared_frame);
 }
 
+typedef struct
+{
+  GstVideoAggregator *vagg;
+  GPtrArray *pads;
+  gint next;
+} PrepareFramesData;
+
+static void
+prepare_frames_func (PrepareFramesData * data)
+{
+  guint idx;
+
+  /* Each worker picks the next pad that nobody took yet, so one pad with an
+   * expensive conversion doesn't hold back the others */
+  while ((idx = g_atomic_int_add (&data->next, 1)) < data->pads->len)
+    prepare_frames (GST_ELEMENT_CAST (data->vagg),
+        g_ptr_array_index (data->pads, idx), NULL);
+}
+
+static gboolean
+collect_pads (GstElement * agg, GstPad * pad, gpointer user_data)
+{
+  GPtrArray *pads = user_data;
+
+  g_ptr_array_add (pads, gst_object_ref (pad));
+
+  return TRUE;
+}
+
+static void
+gst_video_aggregator_prepare_frames (GstVideoAggregator * vagg)
+{
+  GstVideoAggregatorPrivate *priv = vagg->priv;
+  PrepareFramesData data;
+  gpointer *tasks = NULL;
+  guint n_threads, i;
+
+  GST_OBJECT_LOCK (vagg);
+  n_threads = priv->prepare_threads;
+  GST_OBJECT_UNLOCK (vagg);
+
+  if (n_threads == 0)
+    n_threads = g_get_num_processors ();
+
+  if (n_threads == 1) {
+    gst_element_foreach_sink_pad (GST_ELEMENT_CAST (vagg), prepare_frames,
+        NULL);
+    return;
+  }
+
+  data.vagg = vagg;
+  data.pads = g_ptr_array_new_with_free_func (gst_object_unref);
+  data.next = 0;
+  gst_element_foreach_sink_pad (GST_ELEMENT_CAST (vagg), collect_pads,
+      data.pads);
+
+  n_threads = MIN (n_threads, data.pads->len);
+
+  if (n_threads > 1) {
+    if (!priv->prepare_pool) {
+      priv->prepare_pool = gst_shared_task_pool_new ();
+      gst_task_pool_prepare (priv->prepare_pool, NULL);
+    }
+    /* The aggregate thread takes part in the work too */
+    gst_shared_task_pool_set_max_threads (GST_SHARED_TASK_POOL
+        (priv->prepare_pool), n_threads - 1);
+
+    GST_LOG_OBJECT (vagg, "preparing %u pads on %u threads", data.pads->len,
+        n_threads);
+
+    tasks = g_newa (gpointer, n_threads - 1);
+    for (i = 0; i < n_threads - 1; i++)
+      tasks[i] = gst_task_pool_push (priv->prepare_pool,
+          (GstTaskPoolFunction) prepare_frames_func, &data, NULL);
+  }
+
+  prepare_frames_func (&data);
+
+  /* A task that failed to be pushed doesn't matter, its pads were picked up
+   * by the other workers */
+  for (i = 0; n_threads > 1 && i < n_threads - 1; i++) {
+    if (tasks[i])
+      gst_task_pool_join (priv->prepare_pool, tasks[i]);
+  }
+
+  g_ptr_array_unref (data.pads);
+}
+
 static gboolean
 clean_pad (GstElement * agg, GstPad * pad, gpointer user_data)
 {
@@ -1906,7 +2157,7 @@ gst_video_aggregator_do_aggregate (GstVideoAggregator * vagg,
       GST_BUFFER_DTS (*outbuf), GST_BUFFER_DURATION (*outbuf), NULL);
 
   /* Convert all the frames the subclass has before aggregating */
-  gst_element_foreach_sink_pad (GST_ELEMENT_CAST (vagg), prepare_frames, NULL);
+  gst_video_aggregator_prepare_frames (vagg);
 
   ret = vagg_klass->aggregate_frames (vagg, *outbuf);
 
@@ -2702,6 +2953,11 @@ gst_video_aggregator_finalize (GObject * o)
   g_mutex_clear (&vagg->priv->lock);
   g_ptr_array_unref (vagg->priv->supported_formats);
 
+  if (vagg->priv->prepare_pool) {
+    gst_task_pool_cleanup (vagg->priv->prepare_pool);
+    gst_object_unref (vagg->priv->prepare_pool);
+  }
+
   G_OBJECT_CLASS (gst_video_aggregator_parent_class)->finalize (o);
 }
 
@@ -2719,7 +2975,14 @@ static void
 gst_video_aggregator_get_property (GObject * object,
     guint prop_id, GValue * value, GParamSpec * pspec)
 {
+  GstVideoAggregator *vagg = GST_VIDEO_AGGREGATOR (object);
+
   switch (prop_id) {
+    case PROP_PREPARE_THREADS:
+      GST_OBJECT_LOCK (vagg);
+      g_value_set_uint (value, vagg->priv->prepare_threads);
+      GST_OBJECT_UNLOCK (vagg);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -2730,7 +2993,14 @@ static void
 gst_video_aggregator_set_property (GObject * object,
     guint prop_id, const GValue * value, GParamSpec * pspec)
 {
+  GstVideoAggregator *vagg = GST_VIDEO_AGGREGATOR (object);
+
   switch (prop_id) {
+    case PROP_PREPARE_THREADS:
+      GST_OBJECT_LOCK (vagg);
+      vagg->priv->prepare_threads = g_value_get_uint (value);
+      GST_OBJECT_UNLOCK (vagg);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -2760,6 +3030,26 @@ gst_video_aggregator_class_init (GstVideoAggregatorClass * klass)
   gobject_class->get_property = gst_video_aggregator_get_property;
   gobject_class->set_property = gst_video_aggregator_set_property;
 
+  /**
+   * GstVideoAggregator:prepare-threads:
+   *
+   * Maximum number of threads used to prepare (e.g. convert) the frames of
+   * the sink pads for one output frame. The frames of different pads are
+   * then prepared concurrently before #GstVideoAggregatorClass.aggregate_frames
+   * is called. 0 means the number of processors.
+   *
+   * Only enable this if the #GstVideoAggregatorPadClass.prepare_frame
+   * implementation of the pads can be called from any thread.
+   *
+   * Since: 1.20
+   */
+  g_object_class_install_property (gobject_class, PROP_PREPARE_THREADS,
+      g_param_spec_uint ("prepare-threads", "Prepare Threads",
+          "Maximum number of threads used to prepare the sink pad frames "
+          "concurrently (0 = number of processors)", 0, G_MAXUINT,
+          DEFAULT_PREPARE_THREADS,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
   gstelement_class->request_new_pad =
       GST_DEBUG_FUNCPTR (gst_video_aggregator_request_new_pad);
   gstelement_class->release_pad =
@@ -2800,6 +3090,7 @@ gst_video_aggregator_init (GstVideoAggregator * vagg,
 
   vagg->priv = gst_video_aggregator_get_instance_private (vagg);
   vagg->priv->current_caps = NULL;
+  vagg->priv->prepare_threads = DEFAULT_PREPARE_THREADS;
 
   g_mutex_init (&vagg->priv->lock);
 
@@ -37,6 +37,7 @@
 #include <gst/base/base.h>
 
 #include "video-orc.h"
+#include "../parallelized-task-runner-private.h"
 
 /**
  * SECTION:videoconverter
@@ -116,147 +117,6 @@ ensure_debug_category (void)
 #define ensure_debug_category() /* NOOP */
 #endif /* GST_DISABLE_GST_DEBUG */
 
-typedef void (*GstParallelizedTaskFunc) (gpointer user_data);
-
-typedef struct _GstParallelizedTaskRunner GstParallelizedTaskRunner;
-typedef struct _GstParallelizedTaskThread GstParallelizedTaskThread;
-
-struct _GstParallelizedTaskRunner
-{
-  GstTaskPool *pool;
-  gboolean own_pool;
-  guint n_threads;
-
-  GstQueueArray *tasks;
-
-  GstParallelizedTaskFunc func;
-  gpointer *task_data;
-
-  GMutex lock;
-  gint n_todo;
-};
-
-static void
-gst_parallelized_task_thread_func (gpointer data)
-{
-  GstParallelizedTaskRunner *runner = data;
-  gint idx;
-
-  g_mutex_lock (&runner->lock);
-  idx = runner->n_todo--;
-  g_assert (runner->n_todo >= -1);
-  g_mutex_unlock (&runner->lock);
-
-  g_assert (runner->func != NULL);
-
-  runner->func (runner->task_data[idx]);
-}
-
-static void
-gst_parallelized_task_runner_join (GstParallelizedTaskRunner * self)
-{
-  gboolean joined = FALSE;
-
-  while (!joined) {
-    g_mutex_lock (&self->lock);
-    if (!(joined = gst_queue_array_is_empty (self->tasks))) {
-      gpointer task = gst_queue_array_pop_head (self->tasks);
-      g_mutex_unlock (&self->lock);
-      gst_task_pool_join (self->pool, task);
-    } else {
-      g_mutex_unlock (&self->lock);
-    }
-  }
-}
-
-static void
-gst_parallelized_task_runner_free (GstParallelizedTaskRunner * self)
-{
-  gst_parallelized_task_runner_join (self);
-
-  gst_queue_array_free (self->tasks);
-  if (self->own_pool)
-    gst_task_pool_cleanup (self->pool);
-  gst_object_unref (self->pool);
-  g_mutex_clear (&self->lock);
-  g_free (self);
-}
-
-static GstParallelizedTaskRunner *
-gst_parallelized_task_runner_new (guint n_threads, GstTaskPool * pool)
-{
-  GstParallelizedTaskRunner *self;
-
-  if (n_threads == 0)
-    n_threads = g_get_num_processors ();
-
-  self = g_new0 (GstParallelizedTaskRunner, 1);
-
-  if (pool) {
-    self->pool = g_object_ref (pool);
-    self->own_pool = FALSE;
-
-    /* No reason to split up the work between more threads than the
-     * pool can spawn */
-    if (GST_IS_SHARED_TASK_POOL (pool))
-      n_threads =
-          MIN (n_threads,
-          gst_shared_task_pool_get_max_threads (GST_SHARED_TASK_POOL (pool)));
-  } else {
-    self->pool = gst_shared_task_pool_new ();
-    self->own_pool = TRUE;
-    gst_shared_task_pool_set_max_threads (GST_SHARED_TASK_POOL (self->pool),
-        n_threads);
-    gst_task_pool_prepare (self->pool, NULL);
-  }
-
-  self->tasks = gst_queue_array_new (n_threads);
-
-  self->n_threads = n_threads;
-
-  self->n_todo = -1;
-  g_mutex_init (&self->lock);
-
-  /* Set when scheduling a job */
-  self->func = NULL;
-  self->task_data = NULL;
-
-  return self;
-}
-
-static void
-gst_parallelized_task_runner_run (GstParallelizedTaskRunner * self,
-    GstParallelizedTaskFunc func, gpointer * task_data)
-{
-  guint n_threads = self->n_threads;
-
-  self->func = func;
-  self->task_data = task_data;
-
-  if (n_threads > 1) {
-    guint i = 0;
-    g_mutex_lock (&self->lock);
-    self->n_todo = self->n_threads - 2;
-    for (i = 1; i < n_threads; i++) {
-      gpointer task =
-          gst_task_pool_push (self->pool, gst_parallelized_task_thread_func,
-          self, NULL);
-
-      /* The return value of push() is unfortunately nullable, and we can't deal with that */
-      g_assert (task != NULL);
-      gst_queue_array_push_tail (self->tasks, task);
-    }
-    g_mutex_unlock (&self->lock);
-  }
-
-  self->func (self->task_data[self->n_threads - 1]);
-
-  gst_parallelized_task_runner_join (self);
-
-  self->func = NULL;
-  self->task_data = NULL;
-}
-
 typedef struct _GstLineCache GstLineCache;
 
 #define SCALE    (8)
@@ -310,6 +170,21 @@ typedef struct
 typedef void (*FastConvertFunc) (GstVideoConverter * convert,
     const GstVideoFrame * src, GstVideoFrame * dest, gint plane);
 
+/* Window of horizontally scaled input lines for the fused scale + convert
+ * fastpaths. It only holds the lines needed by the vertical filter for the
+ * current output line, so the working set stays in cache. */
+typedef struct
+{
+  guint8 *lines;
+  gint *line_idx;
+  guint n_lines;
+  guint stride;
+  gpointer *taps;
+  guint8 *out;
+  gpointer cur;
+  gint cur_idx;
+} FusedScaleWindow;
+
 struct _GstVideoConverter
 {
   gint flags;
@@ -447,6 +322,7 @@ struct _GstVideoConverter
     GstVideoScaler **scaler;
   } fv_scaler[4];
   FastConvertFunc fconvert[4];
+  FusedScaleWindow *fwindow[4];
 };
 
 typedef gpointer (*GstLineCacheAllocLineFunc) (GstLineCache * cache, gint idx,
@@ -604,6 +480,10 @@ static gboolean video_converter_lookup_fastpath (GstVideoConverter * convert);
 static void video_converter_compute_matrix (GstVideoConverter * convert);
 static void video_converter_compute_resample (GstVideoConverter * convert,
     gint idx);
+static GstVideoFormat get_scale_format (GstVideoFormat format, gint plane);
+static void convert_plane_hv (GstVideoConverter * convert,
+    const GstVideoFrame * src, GstVideoFrame * dest, gint plane);
+static void fused_scale_window_reset (FusedScaleWindow * win);
 
 static gpointer get_dest_line (GstLineCache * cache, gint idx,
     gpointer user_data);
@@ -2498,6 +2378,31 @@ gst_video_converter_new (const GstVideoInfo * in_info,
   return gst_video_converter_new_with_pool (in_info, out_info, config, NULL);
 }
 
+/**
+ * gst_video_converter_get_shared_task_pool: (skip)
+ *
+ * Get the process-wide #GstTaskPool that can be passed to
+ * gst_video_converter_new_with_pool() so that all converters, scalers and
+ * mixers in the process submit their line slices to one set of threads
+ * instead of each spawning their own.
+ *
+ * The pool is a #GstSharedTaskPool that is limited to the number of
+ * processors by default. It is shut down when the last reference to it is
+ * dropped, and a new one is created on the next call. Applications can change its size with
+ * gst_shared_task_pool_set_max_threads(). The number of threads requested
+ * with #GST_VIDEO_CONVERTER_OPT_THREADS still decides how many slices a
+ * single conversion is split into.
+ *
+ * Returns: (transfer full): the shared #GstTaskPool
+ *
+ * Since: 1.20
+ */
+GstTaskPool *
+gst_video_converter_get_shared_task_pool (void)
+{
+  return gst_parallelized_task_runner_get_shared_pool ();
+}
+
 static void
 clear_matrix_data (MatrixData * data)
 {
@@ -2602,6 +2507,16 @@ gst_video_converter_free (GstVideoConverter * convert)
     }
     g_free (convert->fv_scaler[i].scaler);
     g_free (convert->fh_scaler[i].scaler);
+
+    if (convert->fwindow[i]) {
+      for (j = 0; j < convert->conversion_runner->n_threads; j++) {
+        g_free (convert->fwindow[i][j].lines);
+        g_free (convert->fwindow[i][j].line_idx);
+        g_free (convert->fwindow[i][j].taps);
+        g_free (convert->fwindow[i][j].out);
+      }
+      g_free (convert->fwindow[i]);
+    }
   }
 
   if (convert->conversion_runner)
@@ -3261,6 +3176,104 @@ video_converter_generic (GstVideoConverter * convert, const GstVideoFrame * src,
 static void convert_fill_border (GstVideoConverter * convert,
     GstVideoFrame * dest);
 
+/* Set up the scalers and line windows for the fused scale + convert
+ * fastpaths. Scalers are indexed by input component, which for the
+ * semi-planar formats means the interleaved chroma plane is scaled as one
+ * NV12 component. */
+static gboolean
+setup_fused_scale (GstVideoConverter * convert)
+{
+  GstVideoInfo *in_info = &convert->in_info;
+  GstVideoInfo *out_info = &convert->out_info;
+  const GstVideoFormatInfo *in_finfo = in_info->finfo;
+  const GstVideoFormatInfo *out_finfo = out_info->finfo;
+  GstVideoFormat in_format = GST_VIDEO_INFO_FORMAT (in_info);
+  gint method, cr_method, i, n_comp;
+  guint taps, j, n_threads = convert->conversion_runner->n_threads;
+
+  method = GET_OPT_RESAMPLER_METHOD (convert);
+  if (method == GST_VIDEO_RESAMPLER_METHOD_NEAREST)
+    cr_method = method;
+  else
+    cr_method = GET_OPT_CHROMA_RESAMPLER_METHOD (convert);
+  taps = GET_OPT_RESAMPLER_TAPS (convert);
+
+  if (convert->in_width == 0 || convert->in_height == 0 ||
+      convert->out_width == 0 || convert->out_height == 0)
+    return FALSE;
+
+  /* semi-planar input has all chroma in the second component */
+  n_comp = GST_VIDEO_INFO_N_PLANES (in_info) == 2 ? 2 : 3;
+
+  for (i = 0; i < n_comp; i++) {
+    gint iw, ih, ow, oh, pstride, resample_method;
+
+    iw = GST_VIDEO_FORMAT_INFO_SCALE_WIDTH (in_finfo, i, convert->in_width);
+    ih = GST_VIDEO_FORMAT_INFO_SCALE_HEIGHT (in_finfo, i, convert->in_height);
+    ow = GST_VIDEO_FORMAT_INFO_SCALE_WIDTH (in_finfo, i, convert->out_width);
+    oh = GST_VIDEO_FORMAT_INFO_SCALE_HEIGHT (in_finfo, i, convert->out_height);
+    pstride = GST_VIDEO_FORMAT_INFO_PSTRIDE (in_finfo, i);
+
+    GST_DEBUG ("fused component %d: %dx%d -> %dx%d", i, iw, ih, ow, oh);
+
+    convert->fsplane[i] = GST_VIDEO_FORMAT_INFO_PLANE (in_finfo, i);
+    convert->fformat[i] = get_scale_format (in_format, convert->fsplane[i]);
+    convert->fin_x[i] =
+        GST_VIDEO_FORMAT_INFO_SCALE_WIDTH (in_finfo, i, convert->in_x) * pstride;
+    convert->fin_y[i] =
+        GST_VIDEO_FORMAT_INFO_SCALE_HEIGHT (in_finfo, i, convert->in_y);
+    convert->fout_x[i] =
+        GST_VIDEO_FORMAT_INFO_SCALE_WIDTH (out_finfo, i, convert->out_x);
+    convert->fout_y[i] =
+        GST_VIDEO_FORMAT_INFO_SCALE_HEIGHT (out_finfo, i, convert->out_y);
+    convert->fout_width[i] = ow;
+    convert->fout_height[i] = oh;
+
+    resample_method = (i == 0 ? method : cr_method);
+
+    if (iw != ow) {
+      convert->fh_scaler[i].scaler = g_new (GstVideoScaler *, n_threads);
+      for (j = 0; j < n_threads; j++) {
+        convert->fh_scaler[i].scaler[j] =
+            gst_video_scaler_new (resample_method, GST_VIDEO_SCALER_FLAG_NONE,
+            taps, iw, ow, convert->config);
+      }
+    }
+    if (ih != oh) {
+      convert->fv_scaler[i].scaler = g_new (GstVideoScaler *, n_threads);
+      for (j = 0; j < n_threads; j++) {
+        convert->fv_scaler[i].scaler[j] =
+            gst_video_scaler_new (resample_method, GST_VIDEO_SCALER_FLAG_NONE,
+            taps, ih, oh, convert->config);
+      }
+    }
+
+    /* the luma plane of semi-planar input is scaled straight into the
+     * destination and needs no line window */
+    if (n_comp == 2 && i == 0)
+      continue;
+
+    convert->fwindow[i] = g_new0 (FusedScaleWindow, n_threads);
+    for (j = 0; j < n_threads; j++) {
+      FusedScaleWindow *win = &convert->fwindow[i][j];
+
+      win->n_lines = convert->fv_scaler[i].scaler ?
+          gst_video_scaler_get_max_taps (convert->fv_scaler[i].scaler[j]) : 1;
+      win->stride = GST_ROUND_UP_16 (ow * pstride);
+      win->lines = g_malloc (win->n_lines * win->stride);
+      win->line_idx = g_new (gint, win->n_lines);
+      win->taps = g_new (gpointer, win->n_lines);
+      win->out = g_malloc (win->stride);
+      fused_scale_window_reset (win);
+    }
+  }
+
+  if (n_comp == 2)
+    convert->fconvert[0] = convert_plane_hv;
+
+  return TRUE;
+}
+
 /* Fast paths */
 
 #define GET_LINE_OFFSETS(interlaced,line,l1,l2) \
@@ -6379,6 +6392,236 @@ convert_scale_planes (GstVideoConverter * convert,
   convert_fill_border (convert, dest);
 }
 
+typedef struct
+{
+  GstVideoConverter *convert;
+  const GstVideoFrame *src;
+  GstVideoFrame *dest;
+  gint height_0, height_1;
+  gint idx;
+} FFusedScaleTask;
+
+static void
+fused_scale_window_reset (FusedScaleWindow * win)
+{
+  guint i;
+
+  for (i = 0; i < win->n_lines; i++)
+    win->line_idx[i] = -1;
+  win->cur = NULL;
+  win->cur_idx = -1;
+}
+
+/* Get @out_line of component @comp scaled to the output size. Input lines
+ * are horizontally scaled once into the window and reused for all output
+ * lines whose vertical filter needs them. */
+static gpointer
+fused_scale_get_line (GstVideoConverter * convert, const GstVideoFrame * src,
+    gint comp, gint idx, gint out_line)
+{
+  FusedScaleWindow *win = &convert->fwindow[comp][idx];
+  GstVideoScaler *h_scaler, *v_scaler;
+  guint8 *s;
+  gint sstride;
+  guint in_line, n_taps, j;
+
+  if (win->cur_idx == out_line)
+    return win->cur;
+
+  h_scaler =
+      convert->fh_scaler[comp].scaler ? convert->
+      fh_scaler[comp].scaler[idx] : NULL;
+  v_scaler =
+      convert->fv_scaler[comp].scaler ? convert->
+      fv_scaler[comp].scaler[idx] : NULL;
+
+  sstride = FRAME_GET_PLANE_STRIDE (src, convert->fsplane[comp]);
+  s = FRAME_GET_PLANE_LINE (src, convert->fsplane[comp], convert->fin_y[comp]);
+  s += convert->fin_x[comp];
+
+  if (v_scaler) {
+    gst_video_scaler_get_coeff (v_scaler, out_line, &in_line, &n_taps);
+  } else {
+    in_line = out_line;
+    n_taps = 1;
+  }
+
+  for (j = 0; j < n_taps; j++) {
+    guint l = in_line + j;
+    guint8 *sl = s + l * sstride;
+
+    if (h_scaler) {
+      guint slot = l % win->n_lines;
+      guint8 *tmp = win->lines + slot * win->stride;
+
+      if (win->line_idx[slot] != l) {
+        gst_video_scaler_horizontal (h_scaler, convert->fformat[comp], sl,
+            tmp, 0, convert->fout_width[comp]);
+        win->line_idx[slot] = l;
+      }
+      win->taps[j] = tmp;
+    } else {
+      win->taps[j] = sl;
+    }
+  }
+
+  if (v_scaler) {
+    gst_video_scaler_vertical (v_scaler, convert->fformat[comp], win->taps,
+        win->out, out_line, convert->fout_width[comp]);
+    win->cur = win->out;
+  } else {
+    win->cur = win->taps[0];
+  }
+  win->cur_idx = out_line;
+
+  return win->cur;
+}
+
+static void
+convert_I420_BGRA_scale_task (FFusedScaleTask * task)
+{
+  GstVideoConverter *convert = task->convert;
+  MatrixData *data = &convert->convert_matrix;
+  gint i;
+
+  for (i = 0; i < 3; i++)
+    fused_scale_window_reset (&convert->fwindow[i][task->idx]);
+
+  for (i = task->height_0; i < task->height_1; i++) {
+    guint8 *sy, *su, *sv, *d;
+
+    d = FRAME_GET_LINE (task->dest, i + convert->out_y);
+    d += (convert->out_x * 4);
+    sy = fused_scale_get_line (convert, task->src, 0, task->idx, i);
+    su = fused_scale_get_line (convert, task->src, 1, task->idx, i >> 1);
+    sv = fused_scale_get_line (convert, task->src, 2, task->idx, i >> 1);
+
+#if G_BYTE_ORDER == G_LITTLE_ENDIAN
+    video_orc_convert_I420_BGRA (d, sy, su, sv,
+        data->im[0][0], data->im[0][2],
+        data->im[2][1], data->im[1][1], data->im[1][2], convert->out_width);
+#else
+    video_orc_convert_I420_ARGB (d, sy, su, sv,
+        data->im[0][0], data->im[0][2],
+        data->im[2][1], data->im[1][1], data->im[1][2], convert->out_width);
+#endif
+  }
+}
+
+/* Scale the Y, U and V planes and convert to BGRA in one pass over the
+ * output lines instead of going through the generic AYUV intermediate */
+static void
+convert_I420_BGRA_scale (GstVideoConverter * convert,
+    const GstVideoFrame * src, GstVideoFrame * dest)
+{
+  gint i, n_threads, lines_per_thread;
+  gint height = convert->out_height;
+  FFusedScaleTask *tasks;
+  FFusedScaleTask **tasks_p;
+
+  n_threads = convert->conversion_runner->n_threads;
+  tasks = g_newa (FFusedScaleTask, n_threads);
+  tasks_p = g_newa (FFusedScaleTask *, n_threads);
+
+  /* keep line pairs sharing a chroma line in the same task */
+  lines_per_thread = GST_ROUND_UP_2 ((height + n_threads - 1) / n_threads);
+
+  for (i = 0; i < n_threads; i++) {
+    tasks[i].convert = convert;
+    tasks[i].src = src;
+    tasks[i].dest = dest;
+    tasks[i].idx = i;
+
+    tasks[i].height_0 = MIN (i * lines_per_thread, height);
+    tasks[i].height_1 = tasks[i].height_0 + lines_per_thread;
+    tasks[i].height_1 = MIN (height, tasks[i].height_1);
+
+    tasks_p[i] = &tasks[i];
+  }
+
+  gst_parallelized_task_runner_run (convert->conversion_runner,
+      (GstParallelizedTaskFunc) convert_I420_BGRA_scale_task,
+      (gpointer) tasks_p);
+
+  convert_fill_border (convert, dest);
+}
+
+static void
+convert_NV12_I420_scale_task (FFusedScaleTask * task)
+{
+  GstVideoConverter *convert = task->convert;
+  gint i, j, width, out_x, out_y;
+  gint u_off, v_off;
+
+  if (GST_VIDEO_INFO_FORMAT (&convert->in_info) == GST_VIDEO_FORMAT_NV21) {
+    u_off = 1;
+    v_off = 0;
+  } else {
+    u_off = 0;
+    v_off = 1;
+  }
+
+  fused_scale_window_reset (&convert->fwindow[1][task->idx]);
+
+  width = convert->fout_width[1];
+  out_x = convert->fout_x[1];
+  out_y = convert->fout_y[1];
+
+  for (i = task->height_0; i < task->height_1; i++) {
+    guint8 *uv, *du, *dv;
+
+    uv = fused_scale_get_line (convert, task->src, 1, task->idx, i);
+    du = FRAME_GET_U_LINE (task->dest, i + out_y);
+    du += out_x;
+    dv = FRAME_GET_V_LINE (task->dest, i + out_y);
+    dv += out_x;
+
+    for (j = 0; j < width; j++) {
+      du[j] = uv[2 * j + u_off];
+      dv[j] = uv[2 * j + v_off];
+    }
+  }
+}
+
+/* Scale the luma plane directly and the interleaved chroma plane through the
+ * scale window, splitting it into the U and V planes as it is produced */
+static void
+convert_NV12_I420_scale (GstVideoConverter * convert,
+    const GstVideoFrame * src, GstVideoFrame * dest)
+{
+  gint i, n_threads, lines_per_thread;
+  gint height = convert->fout_height[1];
+  FFusedScaleTask *tasks;
+  FFusedScaleTask **tasks_p;
+
+  convert_plane_hv (convert, src, dest, 0);
+
+  n_threads = convert->conversion_runner->n_threads;
+  tasks = g_newa (FFusedScaleTask, n_threads);
+  tasks_p = g_newa (FFusedScaleTask *, n_threads);
+
+  lines_per_thread = (height + n_threads - 1) / n_threads;
+
+  for (i = 0; i < n_threads; i++) {
+    tasks[i].convert = convert;
+    tasks[i].src = src;
+    tasks[i].dest = dest;
+    tasks[i].idx = i;
+
+    tasks[i].height_0 = MIN (i * lines_per_thread, height);
+    tasks[i].height_1 = tasks[i].height_0 + lines_per_thread;
+    tasks[i].height_1 = MIN (height, tasks[i].height_1);
+
+    tasks_p[i] = &tasks[i];
+  }
+
+  gst_parallelized_task_runner_run (convert->conversion_runner,
+      (GstParallelizedTaskFunc) convert_NV12_I420_scale_task,
+      (gpointer) tasks_p);
+
+  convert_fill_border (convert, dest);
+}
+
 static GstVideoFormat
 get_scale_format (GstVideoFormat format, gint plane)
 {
@@ -7091,6 +7334,16 @@ static const VideoTransform transforms[] = {
   {GST_VIDEO_FORMAT_YVU9, GST_VIDEO_FORMAT_YVU9, TRUE, FALSE, FALSE, TRUE,
       TRUE, FALSE, FALSE, FALSE, 0, 0, convert_scale_planes},
 
+  /* semiplanar -> planar */
+  {GST_VIDEO_FORMAT_NV12, GST_VIDEO_FORMAT_I420, FALSE, FALSE, FALSE, TRUE,
+      TRUE, FALSE, FALSE, FALSE, 0, 0, convert_NV12_I420_scale},
+  {GST_VIDEO_FORMAT_NV12, GST_VIDEO_FORMAT_YV12, FALSE, FALSE, FALSE, TRUE,
+      TRUE, FALSE, FALSE, FALSE, 0, 0, convert_NV12_I420_scale},
+  {GST_VIDEO_FORMAT_NV21, GST_VIDEO_FORMAT_I420, FALSE, FALSE, FALSE, TRUE,
+      TRUE, FALSE, FALSE, FALSE, 0, 0, convert_NV12_I420_scale},
+  {GST_VIDEO_FORMAT_NV21, GST_VIDEO_FORMAT_YV12, FALSE, FALSE, FALSE, TRUE,
+      TRUE, FALSE, FALSE, FALSE, 0, 0, convert_NV12_I420_scale},
+
   /* sempiplanar -> semiplanar */
   {GST_VIDEO_FORMAT_NV12, GST_VIDEO_FORMAT_NV12, TRUE, FALSE, FALSE, TRUE,
       TRUE, FALSE, FALSE, FALSE, 0, 0, convert_scale_planes},
@@ -7147,6 +7400,16 @@ static const VideoTransform transforms[] = {
   {GST_VIDEO_FORMAT_YV12, GST_VIDEO_FORMAT_BGRx, FALSE, TRUE, TRUE, TRUE,
       TRUE, FALSE, FALSE, FALSE, 0, 0, convert_I420_BGRA},
 
+  /* fused scale + convert */
+  {GST_VIDEO_FORMAT_I420, GST_VIDEO_FORMAT_BGRA, FALSE, TRUE, FALSE, TRUE,
+      TRUE, FALSE, FALSE, FALSE, 0, 0, convert_I420_BGRA_scale},
+  {GST_VIDEO_FORMAT_I420, GST_VIDEO_FORMAT_BGRx, FALSE, TRUE, FALSE, TRUE,
+      TRUE, FALSE, FALSE, FALSE, 0, 0, convert_I420_BGRA_scale},
+  {GST_VIDEO_FORMAT_YV12, GST_VIDEO_FORMAT_BGRA, FALSE, TRUE, FALSE, TRUE,
+      TRUE, FALSE, FALSE, FALSE, 0, 0, convert_I420_BGRA_scale},
+  {GST_VIDEO_FORMAT_YV12, GST_VIDEO_FORMAT_BGRx, FALSE, TRUE, FALSE, TRUE,
+      TRUE, FALSE, FALSE, FALSE, 0, 0, convert_I420_BGRA_scale},
+
   {GST_VIDEO_FORMAT_I420, GST_VIDEO_FORMAT_ARGB, FALSE, TRUE, TRUE, TRUE,
       TRUE, FALSE, FALSE, FALSE, 0, 0, convert_I420_ARGB},
   {GST_VIDEO_FORMAT_I420, GST_VIDEO_FORMAT_xRGB, FALSE, TRUE, TRUE, TRUE,
@@ -7348,9 +7611,14 @@ video_converter_lookup_fastpath (GstVideoConverter * convert)
       for (j = 0; j < convert->conversion_runner->n_threads; j++)
         convert->tmpline[j] = g_malloc0 (sizeof (guint16) * (width + 8) * 4);
 
-      if (!transforms[i].keeps_size)
+      if (transforms[i].convert == convert_I420_BGRA_scale ||
+          transforms[i].convert == convert_NV12_I420_scale) {
+        if (!setup_fused_scale (convert))
+          return FALSE;
+      } else if (!transforms[i].keeps_size) {
         if (!setup_scale (convert))
           return FALSE;
+      }
       if (border)
         setup_borderline (convert);
       return TRUE;
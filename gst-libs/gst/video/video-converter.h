@@ -286,6 +286,9 @@ GstVideoConverter * gst_video_converter_new_with_pool   (const GstVideoInfo * in
                                                          GstStructure * config,
                                                          GstTaskPool  * pool);
 
+GST_VIDEO_API
+GstTaskPool *        gst_video_converter_get_shared_task_pool (void);
+
 GST_VIDEO_API
 void                 gst_video_converter_free           (GstVideoConverter * convert);
 
@@ -0,0 +1,107 @@
+/* GStreamer
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __GST_VIDEO_FRAME_CROP_PRIVATE_H__
+#define __GST_VIDEO_FRAME_CROP_PRIVATE_H__
+
+#include <gst/video/video.h>
+
+/* Not installed, only shared by the elements of this module that apply
+ * GstVideoCropMeta on their input themselves */
+
+G_BEGIN_DECLS
+
+/* The crop is applied by moving the plane pointers of the frame, which only
+ * works when every component starts on a byte boundary */
+static inline gboolean
+__gst_video_frame_can_apply_crop_meta (const GstVideoInfo * info)
+{
+  const GstVideoFormatInfo *finfo = info->finfo;
+  gint i;
+
+  if (finfo == NULL || GST_VIDEO_FORMAT_INFO_IS_COMPLEX (finfo)
+      || GST_VIDEO_FORMAT_INFO_IS_TILED (finfo))
+    return FALSE;
+
+  for (i = 0; i < GST_VIDEO_FORMAT_INFO_N_COMPONENTS (finfo); i++) {
+    if (GST_VIDEO_FORMAT_INFO_PSTRIDE (finfo, i) == 0)
+      return FALSE;
+  }
+
+  return TRUE;
+}
+
+/* Points the planes of @frame to the top-left corner of the region described
+ * by the GstVideoCropMeta of its buffer, so that @frame can be processed as
+ * a @width x @height frame. The offset is rounded down so that the chroma
+ * siting and the field order are kept.
+ *
+ * Returns FALSE if the crop meta can't be applied, TRUE otherwise, including
+ * when there's nothing to crop. */
+static inline gboolean
+__gst_video_frame_apply_crop_meta (GstVideoFrame * frame, guint width,
+    guint height)
+{
+  const GstVideoFormatInfo *finfo;
+  gboolean done[GST_VIDEO_MAX_PLANES] = { FALSE, };
+  GstVideoCropMeta *crop;
+  guint x, y, w_sub = 0, h_sub = 0;
+  gint i;
+
+  crop = gst_buffer_get_video_crop_meta (frame->buffer);
+  if (crop == NULL || (crop->x == 0 && crop->y == 0))
+    return TRUE;
+
+  if (!__gst_video_frame_can_apply_crop_meta (&frame->info)
+      || crop->x + width > GST_VIDEO_FRAME_WIDTH (frame)
+      || crop->y + height > GST_VIDEO_FRAME_HEIGHT (frame))
+    return FALSE;
+
+  finfo = frame->info.finfo;
+  for (i = 0; i < GST_VIDEO_FORMAT_INFO_N_COMPONENTS (finfo); i++) {
+    w_sub = MAX (w_sub, GST_VIDEO_FORMAT_INFO_W_SUB (finfo, i));
+    h_sub = MAX (h_sub, GST_VIDEO_FORMAT_INFO_H_SUB (finfo, i));
+  }
+  if (GST_VIDEO_INFO_IS_INTERLACED (&frame->info) &&
+      GST_VIDEO_INFO_INTERLACE_MODE (&frame->info) !=
+      GST_VIDEO_INTERLACE_MODE_ALTERNATE)
+    h_sub++;
+
+  x = (crop->x >> w_sub) << w_sub;
+  y = (crop->y >> h_sub) << h_sub;
+
+  for (i = 0; i < GST_VIDEO_FORMAT_INFO_N_COMPONENTS (finfo); i++) {
+    guint plane = GST_VIDEO_FORMAT_INFO_PLANE (finfo, i);
+
+    if (done[plane])
+      continue;
+
+    frame->data[plane] = (guint8 *) frame->data[plane] +
+        GST_VIDEO_FORMAT_INFO_SCALE_HEIGHT (finfo, i, y) *
+        GST_VIDEO_FRAME_PLANE_STRIDE (frame, plane) +
+        GST_VIDEO_FORMAT_INFO_SCALE_WIDTH (finfo, i, x) *
+        GST_VIDEO_FORMAT_INFO_PSTRIDE (finfo, i);
+    done[plane] = TRUE;
+  }
+
+  return TRUE;
+}
+
+G_END_DECLS
+
+#endif /* __GST_VIDEO_FRAME_CROP_PRIVATE_H__ */
@@ -0,0 +1,207 @@
+/* GStreamer
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#endif
+
+#include "video-scaler-x86-avx2.h"
+
+#if defined (HAVE_IMMINTRIN_H) && defined (__AVX2__)
+
+#include <immintrin.h>
+
+/* These kernels produce the same results as the ORC multaps / muladdtaps /
+ * scaletaps sequences they replace: 8 bit pixels are accumulated in wrapping
+ * 16 bit integers with 6 bits of precision, 16 bit pixels in 32 bit integers
+ * with 12 bits of precision. */
+
+static inline guint8
+scale_u8_lq (gint16 acc)
+{
+  gint16 v = (gint16) (acc + 32) >> 6;
+
+  return CLAMP (v, 0, 255);
+}
+
+static inline guint16
+scale_u16 (gint32 acc)
+{
+  gint32 v = (acc + 4095) >> 12;
+
+  return CLAMP (v, 0, 65535);
+}
+
+static inline __m256i
+pack_u8_lq (__m256i lo, __m256i hi)
+{
+  const __m256i round = _mm256_set1_epi16 (32);
+
+  lo = _mm256_srai_epi16 (_mm256_add_epi16 (lo, round), 6);
+  hi = _mm256_srai_epi16 (_mm256_add_epi16 (hi, round), 6);
+
+  /* packus works per 128 bit lane, put the quadwords back in order */
+  return _mm256_permute4x64_epi64 (_mm256_packus_epi16 (lo, hi), 0xd8);
+}
+
+static inline __m256i
+pack_u16 (__m256i lo, __m256i hi)
+{
+  const __m256i round = _mm256_set1_epi32 (4095);
+
+  lo = _mm256_srai_epi32 (_mm256_add_epi32 (lo, round), 12);
+  hi = _mm256_srai_epi32 (_mm256_add_epi32 (hi, round), 12);
+
+  return _mm256_permute4x64_epi64 (_mm256_packus_epi32 (lo, hi), 0xd8);
+}
+
+void
+video_scaler_h_taps_u8_lq_avx2 (guint8 * d, const guint8 * pixels,
+    const gint16 * taps, guint n_taps, guint count)
+{
+  guint i = 0, j;
+
+  for (; i + 32 <= count; i += 32) {
+    __m256i lo = _mm256_setzero_si256 ();
+    __m256i hi = _mm256_setzero_si256 ();
+
+    for (j = 0; j < n_taps; j++) {
+      const guint8 *p = pixels + j * count + i;
+      const gint16 *t = taps + j * count + i;
+      __m256i pl, ph;
+
+      pl = _mm256_cvtepu8_epi16 (_mm_loadu_si128 ((const __m128i *) p));
+      ph = _mm256_cvtepu8_epi16 (_mm_loadu_si128 ((const __m128i *) (p +
+                  16)));
+
+      lo = _mm256_add_epi16 (lo, _mm256_mullo_epi16 (pl,
+              _mm256_loadu_si256 ((const __m256i *) t)));
+      hi = _mm256_add_epi16 (hi, _mm256_mullo_epi16 (ph,
+              _mm256_loadu_si256 ((const __m256i *) (t + 16))));
+    }
+    _mm256_storeu_si256 ((__m256i *) (d + i), pack_u8_lq (lo, hi));
+  }
+  for (; i < count; i++) {
+    gint16 acc = 0;
+
+    for (j = 0; j < n_taps; j++)
+      acc += pixels[j * count + i] * taps[j * count + i];
+    d[i] = scale_u8_lq (acc);
+  }
+}
+
+void
+video_scaler_v_taps_u8_lq_avx2 (guint8 * d, gpointer srcs[],
+    guint src_inc, const gint16 * taps, guint n_taps, guint count)
+{
+  guint i = 0, j;
+
+  for (; i + 32 <= count; i += 32) {
+    __m256i lo = _mm256_setzero_si256 ();
+    __m256i hi = _mm256_setzero_si256 ();
+
+    for (j = 0; j < n_taps; j++) {
+      const guint8 *p = (const guint8 *) srcs[j * src_inc] + i;
+      __m256i t = _mm256_set1_epi16 (taps[j]);
+      __m256i pl, ph;
+
+      pl = _mm256_cvtepu8_epi16 (_mm_loadu_si128 ((const __m128i *) p));
+      ph = _mm256_cvtepu8_epi16 (_mm_loadu_si128 ((const __m128i *) (p +
+                  16)));
+
+      lo = _mm256_add_epi16 (lo, _mm256_mullo_epi16 (pl, t));
+      hi = _mm256_add_epi16 (hi, _mm256_mullo_epi16 (ph, t));
+    }
+    _mm256_storeu_si256 ((__m256i *) (d + i), pack_u8_lq (lo, hi));
+  }
+  for (; i < count; i++) {
+    gint16 acc = 0;
+
+    for (j = 0; j < n_taps; j++)
+      acc += ((const guint8 *) srcs[j * src_inc])[i] * taps[j];
+    d[i] = scale_u8_lq (acc);
+  }
+}
+
+void
+video_scaler_h_taps_u16_avx2 (guint16 * d, const guint16 * pixels,
+    const gint16 * taps, guint n_taps, guint count)
+{
+  guint i = 0, j;
+
+  for (; i + 16 <= count; i += 16) {
+    __m256i lo = _mm256_setzero_si256 ();
+    __m256i hi = _mm256_setzero_si256 ();
+
+    for (j = 0; j < n_taps; j++) {
+      const guint16 *p = pixels + j * count + i;
+      const gint16 *t = taps + j * count + i;
+      __m256i pl, ph, tl, th;
+
+      pl = _mm256_cvtepu16_epi32 (_mm_loadu_si128 ((const __m128i *) p));
+      ph = _mm256_cvtepu16_epi32 (_mm_loadu_si128 ((const __m128i *) (p + 8)));
+      tl = _mm256_cvtepi16_epi32 (_mm_loadu_si128 ((const __m128i *) t));
+      th = _mm256_cvtepi16_epi32 (_mm_loadu_si128 ((const __m128i *) (t + 8)));
+
+      lo = _mm256_add_epi32 (lo, _mm256_mullo_epi32 (pl, tl));
+      hi = _mm256_add_epi32 (hi, _mm256_mullo_epi32 (ph, th));
+    }
+    _mm256_storeu_si256 ((__m256i *) (d + i), pack_u16 (lo, hi));
+  }
+  for (; i < count; i++) {
+    gint32 acc = 0;
+
+    for (j = 0; j < n_taps; j++)
+      acc += pixels[j * count + i] * taps[j * count + i];
+    d[i] = scale_u16 (acc);
+  }
+}
+
+void
+video_scaler_v_taps_u16_avx2 (guint16 * d, gpointer srcs[],
+    guint src_inc, const gint16 * taps, guint n_taps, guint count)
+{
+  guint i = 0, j;
+
+  for (; i + 16 <= count; i += 16) {
+    __m256i lo = _mm256_setzero_si256 ();
+    __m256i hi = _mm256_setzero_si256 ();
+
+    for (j = 0; j < n_taps; j++) {
+      const guint16 *p = (const guint16 *) srcs[j * src_inc] + i;
+      __m256i t = _mm256_set1_epi32 (taps[j]);
+      __m256i pl, ph;
+
+      pl = _mm256_cvtepu16_epi32 (_mm_loadu_si128 ((const __m128i *) p));
+      ph = _mm256_cvtepu16_epi32 (_mm_loadu_si128 ((const __m128i *) (p + 8)));
+
+      lo = _mm256_add_epi32 (lo, _mm256_mullo_epi32 (pl, t));
+      hi = _mm256_add_epi32 (hi, _mm256_mullo_epi32 (ph, t));
+    }
+    _mm256_storeu_si256 ((__m256i *) (d + i), pack_u16 (lo, hi));
+  }
+  for (; i < count; i++) {
+    gint32 acc = 0;
+
+    for (j = 0; j < n_taps; j++)
+      acc += ((const guint16 *) srcs[j * src_inc])[i] * taps[j];
+    d[i] = scale_u16 (acc);
+  }
+}
+
+#endif
@@ -82,6 +82,35 @@ typedef void (*GstVideoScalerVFunc) (GstVideoScaler * scale,
     gpointer srcs[], gpointer dest, guint dest_offset, guint width,
     guint n_elems);
 
+/* Optional SIMD replacements for the multi-tap ORC sequences, selected once
+ * at runtime depending on the CPU */
+static void (*resample_h_taps_u8_lq) (guint8 * d, const guint8 * pixels,
+    const gint16 * taps, guint n_taps, guint count) = NULL;
+static void (*resample_v_taps_u8_lq) (guint8 * d, gpointer srcs[],
+    guint src_inc, const gint16 * taps, guint n_taps, guint count) = NULL;
+static void (*resample_h_taps_u16) (guint16 * d, const guint16 * pixels,
+    const gint16 * taps, guint n_taps, guint count) = NULL;
+static void (*resample_v_taps_u16) (guint16 * d, gpointer srcs[],
+    guint src_inc, const gint16 * taps, guint n_taps, guint count) = NULL;
+
+#if defined (__i386__) || defined (__x86_64__)
+#  define CHECK_X86
+#  include "video-scaler-x86.h"
+#endif
+
+static void
+video_scaler_init (void)
+{
+  static gsize init_gonce = 0;
+
+  if (g_once_init_enter (&init_gonce)) {
+#ifdef CHECK_X86
+    video_scaler_check_x86 ();
+#endif
+    g_once_init_leave (&init_gonce, 1);
+  }
+}
+
 struct _GstVideoScaler
 {
   GstVideoResamplerMethod method;
@@ -219,6 +248,8 @@ gst_video_scaler_new (GstVideoResamplerMethod method, GstVideoScalerFlags flags,
   g_return_val_if_fail (in_size != 0, NULL);
   g_return_val_if_fail (out_size != 0, NULL);
 
+  video_scaler_init ();
+
   scale = g_slice_new0 (GstVideoScaler);
 
   GST_DEBUG ("%d %u  %u->%u", method, n_taps, in_size, out_size);
@@ -701,6 +732,8 @@ video_scale_h_ntap_u8 (GstVideoScaler * scale,
   if (max_taps == 2) {
     video_orc_resample_h_2tap_u8_lq (d, pixels, pixels + count, taps,
         taps + count, count);
+  } else if (resample_h_taps_u8_lq) {
+    resample_h_taps_u8_lq (d, pixels, taps, max_taps, count);
   } else {
     /* first pixels with first tap to temp */
     if (max_taps >= 3) {
@@ -814,6 +847,8 @@ video_scale_h_ntap_u16 (GstVideoScaler * scale,
   if (max_taps == 2) {
     video_orc_resample_h_2tap_u16 (d, pixels, pixels + count, taps,
         taps + count, count);
+  } else if (resample_h_taps_u16) {
+    resample_h_taps_u16 (d, pixels, taps, max_taps, count);
   } else {
     /* first pixels with first tap to t4 */
     video_orc_resample_h_multaps_u16 (temp, pixels, taps, count);
@@ -975,6 +1010,10 @@ video_scale_v_4tap_u8 (GstVideoScaler * scale,
   p4 = taps[3];
 
 #ifdef LQ
+  if (resample_v_taps_u8_lq) {
+    resample_v_taps_u8_lq (d, srcs, src_inc, taps, 4, width * n_elems);
+    return;
+  }
   video_orc_resample_v_4tap_u8_lq (d, s1, s2, s3, s4, p1, p2, p3, p4,
       width * n_elems);
 #else
@@ -1014,6 +1053,11 @@ video_scale_v_ntap_u8 (GstVideoScaler * scale,
   count = width * n_elems;
 
 #ifdef LQ
+  if (resample_v_taps_u8_lq) {
+    resample_v_taps_u8_lq (d, srcs, src_inc, taps, max_taps, count);
+    return;
+  }
+
   if (max_taps >= 4) {
     video_orc_resample_v_multaps4_u8_lq (temp, srcs[0], srcs[1 * src_inc],
         srcs[2 * src_inc], srcs[3 * src_inc], taps[0], taps[1], taps[2],
@@ -1097,6 +1141,11 @@ video_scale_v_ntap_u16 (GstVideoScaler * scale,
   temp = (gint32 *) scale->tmpline2;
   count = width * n_elems;
 
+  if (resample_v_taps_u16) {
+    resample_v_taps_u16 (d, srcs, src_inc, taps, max_taps, count);
+    return;
+  }
+
   video_orc_resample_v_multaps_u16 (temp, srcs[0], taps[0], count);
   for (i = 1; i < max_taps; i++) {
     video_orc_resample_v_muladdtaps_u16 (temp, srcs[i * src_inc], taps[i],
@@ -49,6 +49,14 @@
  * * "mute": Whether to mute the pad or not (#gboolean)
  * * "volume": The volume of the pad, between 0.0 and 10.0 (#gdouble)
  *
+ * By default every input is added to the output buffer on its own and the
+ * result is clamped after each addition. With the #GstAudioMixer:accumulate
+ * property enabled, all inputs that contribute to an output buffer are
+ * summed up together in a wider accumulator (32 or 64 bit integers for
+ * integer formats), block by block, and only the final sum is clamped. This
+ * avoids reloading and clamping the output once per input, which pays off
+ * when mixing many streams, and prevents intermediate clipping.
+ *
  * ## Example launch line
  * |[
  * gst-launch-1.0 audiotestsrc freq=100 ! audiomixer name=mix ! audioconvert ! alsasink audiotestsrc freq=500 ! mix.
@@ -86,6 +94,12 @@ GST_DEBUG_CATEGORY_STATIC (GST_CAT_DEFAULT);
 #define VOLUME_UNITY_INT32           134217728  /* internal int for unity 2^(32-5) */
 #define VOLUME_UNITY_INT32_BIT_SHIFT 27
 
+/* number of samples mixed at once in accumulate mode, small enough to keep
+ * the accumulator in the L1 cache while all inputs are added to it */
+#define MIX_BLOCK_SIZE 1024
+
+#define DEFAULT_ACCUMULATE FALSE
+
 enum
 {
   PROP_PAD_0,
@@ -168,9 +182,229 @@ gst_audiomixer_pad_init (GstAudioMixerPad * pad)
 
 enum
 {
-  PROP_0
+  PROP_0,
+  PROP_ACCUMULATE
 };
 
+/* Accumulate mode: the inputs of an output buffer are recorded as jobs and
+ * summed up once the output buffer is complete */
+
+typedef struct
+{
+  GstBuffer *buffer;
+  GstMapInfo map;
+  guint in_offset;
+  guint out_offset;
+  guint num_frames;
+  gdouble volume;
+  gint volume_i;
+} GstAudioMixerJob;
+
+typedef struct
+{
+  gint acc_size;
+  void (*accumulate) (gpointer acc, gconstpointer src, gdouble volume,
+      gint volume_i, gint n);
+  void (*store) (gpointer dst, gconstpointer acc, gint n);
+} GstAudioMixerFuncs;
+
+/* Integer samples are accumulated as signed values in a wider type with the
+ * same fixed point volume as the ORC functions, and clamped when stored */
+#define MAKE_MIX_INT_FUNCS(name,type,acctype,bias,shift,min,max)        \
+static void                                                             \
+accumulate_##name (gpointer acc, gconstpointer src, gdouble volume,     \
+    gint volume_i, gint n)                                              \
+{                                                                       \
+  acctype *a = acc;                                                     \
+  const type *s = src;                                                  \
+  gint i;                                                               \
+                                                                        \
+  if (volume == 1.0) {                                                  \
+    for (i = 0; i < n; i++)                                             \
+      a[i] += (acctype) s[i] - (bias);                                  \
+  } else {                                                              \
+    for (i = 0; i < n; i++)                                             \
+      a[i] += (((acctype) s[i] - (bias)) * volume_i) >> (shift);        \
+  }                                                                     \
+}                                                                       \
+                                                                        \
+static void                                                             \
+store_##name (gpointer dst, gconstpointer acc, gint n)                  \
+{                                                                       \
+  type *d = dst;                                                        \
+  const acctype *a = acc;                                               \
+  gint i;                                                               \
+                                                                        \
+  for (i = 0; i < n; i++)                                               \
+    d[i] = CLAMP (a[i], (min), (max)) + (bias);                         \
+}
+
+#define MAKE_MIX_FLOAT_FUNCS(name,type)                                 \
+static void                                                             \
+accumulate_##name (gpointer acc, gconstpointer src, gdouble volume,     \
+    gint volume_i, gint n)                                              \
+{                                                                       \
+  type *a = acc;                                                        \
+  const type *s = src;                                                  \
+  const type v = volume;                                                \
+  gint i;                                                               \
+                                                                        \
+  if (volume == 1.0) {                                                  \
+    for (i = 0; i < n; i++)                                             \
+      a[i] += s[i];                                                     \
+  } else {                                                              \
+    for (i = 0; i < n; i++)                                             \
+      a[i] += s[i] * v;                                                 \
+  }                                                                     \
+}                                                                       \
+                                                                        \
+static void                                                             \
+store_##name (gpointer dst, gconstpointer acc, gint n)                  \
+{                                                                       \
+  memcpy (dst, acc, n * sizeof (type));                                 \
+}
+
+MAKE_MIX_INT_FUNCS (u8, guint8, gint32, 0x80, VOLUME_UNITY_INT8_BIT_SHIFT,
+    G_MININT8, G_MAXINT8);
+MAKE_MIX_INT_FUNCS (s8, gint8, gint32, 0, VOLUME_UNITY_INT8_BIT_SHIFT,
+    G_MININT8, G_MAXINT8);
+MAKE_MIX_INT_FUNCS (u16, guint16, gint32, 0x8000,
+    VOLUME_UNITY_INT16_BIT_SHIFT, G_MININT16, G_MAXINT16);
+MAKE_MIX_INT_FUNCS (s16, gint16, gint32, 0, VOLUME_UNITY_INT16_BIT_SHIFT,
+    G_MININT16, G_MAXINT16);
+MAKE_MIX_INT_FUNCS (u32, guint32, gint64, G_GINT64_CONSTANT (0x80000000),
+    VOLUME_UNITY_INT32_BIT_SHIFT, G_MININT32, G_MAXINT32);
+MAKE_MIX_INT_FUNCS (s32, gint32, gint64, 0, VOLUME_UNITY_INT32_BIT_SHIFT,
+    G_MININT32, G_MAXINT32);
+MAKE_MIX_FLOAT_FUNCS (f32, gfloat);
+MAKE_MIX_FLOAT_FUNCS (f64, gdouble);
+
+static const GstAudioMixerFuncs *
+gst_audiomixer_get_funcs (GstAudioFormat format)
+{
+  static const GstAudioMixerFuncs funcs_u8 =
+      { sizeof (gint32), accumulate_u8, store_u8 };
+  static const GstAudioMixerFuncs funcs_s8 =
+      { sizeof (gint32), accumulate_s8, store_s8 };
+  static const GstAudioMixerFuncs funcs_u16 =
+      { sizeof (gint32), accumulate_u16, store_u16 };
+  static const GstAudioMixerFuncs funcs_s16 =
+      { sizeof (gint32), accumulate_s16, store_s16 };
+  static const GstAudioMixerFuncs funcs_u32 =
+      { sizeof (gint64), accumulate_u32, store_u32 };
+  static const GstAudioMixerFuncs funcs_s32 =
+      { sizeof (gint64), accumulate_s32, store_s32 };
+  static const GstAudioMixerFuncs funcs_f32 =
+      { sizeof (gfloat), accumulate_f32, store_f32 };
+  static const GstAudioMixerFuncs funcs_f64 =
+      { sizeof (gdouble), accumulate_f64, store_f64 };
+
+  switch (format) {
+    case GST_AUDIO_FORMAT_U8:
+      return &funcs_u8;
+    case GST_AUDIO_FORMAT_S8:
+      return &funcs_s8;
+    case GST_AUDIO_FORMAT_U16:
+      return &funcs_u16;
+    case GST_AUDIO_FORMAT_S16:
+      return &funcs_s16;
+    case GST_AUDIO_FORMAT_U32:
+      return &funcs_u32;
+    case GST_AUDIO_FORMAT_S32:
+      return &funcs_s32;
+    case GST_AUDIO_FORMAT_F32:
+      return &funcs_f32;
+    case GST_AUDIO_FORMAT_F64:
+      return &funcs_f64;
+    default:
+      g_assert_not_reached ();
+      return NULL;
+  }
+}
+
+static void
+gst_audiomixer_job_clear (GstAudioMixerJob * job)
+{
+  gst_buffer_unref (job->buffer);
+}
+
+static void
+gst_audiomixer_clear_jobs (GstAudioMixer * audiomixer)
+{
+  g_array_set_size (audiomixer->jobs, 0);
+  audiomixer->jobs_outbuf = NULL;
+}
+
+/* Sums up all recorded inputs into @outbuf. This walks the output in blocks
+ * of MIX_BLOCK_SIZE samples, adds every input overlapping the block to the
+ * accumulator and then clamps and stores the block once. */
+static void
+gst_audiomixer_mix_jobs (GstAudioMixer * audiomixer, GstBuffer * outbuf,
+    const GstAudioInfo * info)
+{
+  const GstAudioMixerFuncs *funcs;
+  GstMapInfo outmap;
+  gsize n_samples, start, len;
+  gint channels, bps;
+  guint i;
+
+  funcs = gst_audiomixer_get_funcs (GST_AUDIO_INFO_FORMAT (info));
+  channels = GST_AUDIO_INFO_CHANNELS (info);
+  bps = GST_AUDIO_INFO_BPS (info);
+
+  gst_buffer_map (outbuf, &outmap, GST_MAP_READWRITE);
+  for (i = 0; i < audiomixer->jobs->len; i++) {
+    GstAudioMixerJob *job =
+        &g_array_index (audiomixer->jobs, GstAudioMixerJob, i);
+
+    gst_buffer_map (job->buffer, &job->map, GST_MAP_READ);
+  }
+
+  GST_LOG_OBJECT (audiomixer, "mixing %u inputs into %" G_GSIZE_FORMAT
+      " bytes", audiomixer->jobs->len, outmap.size);
+
+  n_samples = outmap.size / bps;
+  for (start = 0; start < n_samples; start += len) {
+    guint8 *out = outmap.data + start * bps;
+
+    len = MIN (MIX_BLOCK_SIZE, n_samples - start);
+
+    memset (audiomixer->accum, 0, len * funcs->acc_size);
+    /* the output was already partially mixed before a format change */
+    if (audiomixer->outbuf_dirty)
+      funcs->accumulate (audiomixer->accum, out, 1.0, 0, len);
+
+    for (i = 0; i < audiomixer->jobs->len; i++) {
+      GstAudioMixerJob *job =
+          &g_array_index (audiomixer->jobs, GstAudioMixerJob, i);
+      gsize job_start = (gsize) job->out_offset * channels;
+      gsize job_end = job_start + (gsize) job->num_frames * channels;
+      gsize s = MAX (start, job_start);
+      gsize e = MIN (start + len, job_end);
+
+      if (s >= e)
+        continue;
+
+      funcs->accumulate ((guint8 *) audiomixer->accum +
+          (s - start) * funcs->acc_size,
+          job->map.data + ((gsize) job->in_offset * channels + s -
+              job_start) * bps, job->volume, job->volume_i, e - s);
+    }
+
+    funcs->store (out, audiomixer->accum, len);
+  }
+
+  for (i = 0; i < audiomixer->jobs->len; i++) {
+    GstAudioMixerJob *job =
+        &g_array_index (audiomixer->jobs, GstAudioMixerJob, i);
+
+    gst_buffer_unmap (job->buffer, &job->map);
+  }
+  gst_buffer_unmap (outbuf, &outmap);
+
+  gst_audiomixer_clear_jobs (audiomixer);
+}
+
 /* These are the formats we can mix natively */
 
 #if G_BYTE_ORDER == G_LITTLE_ENDIAN
@@ -216,14 +450,90 @@ static gboolean
 gst_audiomixer_aggregate_one_buffer (GstAudioAggregator * aagg,
     GstAudioAggregatorPad * aaggpad, GstBuffer * inbuf, guint in_offset,
     GstBuffer * outbuf, guint out_offset, guint num_samples);
+static GstBuffer *gst_audiomixer_create_output_buffer (GstAudioAggregator *
+    aagg, guint num_frames);
+static GstFlowReturn gst_audiomixer_finish_buffer (GstAggregator * agg,
+    GstBuffer * buffer);
+static gboolean gst_audiomixer_negotiated_src_caps (GstAggregator * agg,
+    GstCaps * caps);
+static GstFlowReturn gst_audiomixer_flush (GstAggregator * agg);
+static gboolean gst_audiomixer_stop (GstAggregator * agg);
+
+static void
+gst_audiomixer_set_property (GObject * object, guint prop_id,
+    const GValue * value, GParamSpec * pspec)
+{
+  GstAudioMixer *audiomixer = GST_AUDIO_MIXER (object);
+
+  switch (prop_id) {
+    case PROP_ACCUMULATE:
+      GST_OBJECT_LOCK (audiomixer);
+      audiomixer->accumulate = g_value_get_boolean (value);
+      GST_OBJECT_UNLOCK (audiomixer);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
+}
+
+static void
+gst_audiomixer_get_property (GObject * object, guint prop_id,
+    GValue * value, GParamSpec * pspec)
+{
+  GstAudioMixer *audiomixer = GST_AUDIO_MIXER (object);
+
+  switch (prop_id) {
+    case PROP_ACCUMULATE:
+      GST_OBJECT_LOCK (audiomixer);
+      g_value_set_boolean (value, audiomixer->accumulate);
+      GST_OBJECT_UNLOCK (audiomixer);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
+}
+
+static void
+gst_audiomixer_finalize (GObject * object)
+{
+  GstAudioMixer *audiomixer = GST_AUDIO_MIXER (object);
+
+  g_array_unref (audiomixer->jobs);
+  g_free (audiomixer->accum);
+
+  G_OBJECT_CLASS (parent_class)->finalize (object);
+}
 
 
 static void
 gst_audiomixer_class_init (GstAudioMixerClass * klass)
 {
+  GObjectClass *gobject_class = (GObjectClass *) klass;
   GstElementClass *gstelement_class = (GstElementClass *) klass;
+  GstAggregatorClass *agg_class = (GstAggregatorClass *) klass;
   GstAudioAggregatorClass *aagg_class = (GstAudioAggregatorClass *) klass;
 
+  gobject_class->set_property = gst_audiomixer_set_property;
+  gobject_class->get_property = gst_audiomixer_get_property;
+  gobject_class->finalize = gst_audiomixer_finalize;
+
+  /**
+   * GstAudioMixer:accumulate:
+   *
+   * Sum up all inputs of an output buffer in a wider accumulator and clamp
+   * the result only once, instead of adding and clamping every input on its
+   * own. This reduces memory traffic when mixing many streams and avoids
+   * clipping of intermediate sums.
+   *
+   * Since: 1.20
+   */
+  g_object_class_install_property (gobject_class, PROP_ACCUMULATE,
+      g_param_spec_boolean ("accumulate", "Accumulate",
+          "Sum up all inputs in a wide accumulator and clamp only once",
+          DEFAULT_ACCUMULATE, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
   gst_element_class_add_static_pad_template_with_gtype (gstelement_class,
       &gst_audiomixer_src_template, GST_TYPE_AUDIO_AGGREGATOR_CONVERT_PAD);
   gst_element_class_add_static_pad_template_with_gtype (gstelement_class,
@@ -237,7 +547,14 @@ gst_audiomixer_class_init (GstAudioMixerClass * klass)
   gstelement_class->release_pad =
       GST_DEBUG_FUNCPTR (gst_audiomixer_release_pad);
 
+  agg_class->finish_buffer = GST_DEBUG_FUNCPTR (gst_audiomixer_finish_buffer);
+  agg_class->negotiated_src_caps =
+      GST_DEBUG_FUNCPTR (gst_audiomixer_negotiated_src_caps);
+  agg_class->flush = GST_DEBUG_FUNCPTR (gst_audiomixer_flush);
+  agg_class->stop = GST_DEBUG_FUNCPTR (gst_audiomixer_stop);
+
   aagg_class->aggregate_one_buffer = gst_audiomixer_aggregate_one_buffer;
+  aagg_class->create_output_buffer = gst_audiomixer_create_output_buffer;
 
   gst_type_mark_as_plugin_api (GST_TYPE_AUDIO_MIXER_PAD, 0);
 }
@@ -245,6 +562,12 @@ gst_audiomixer_class_init (GstAudioMixerClass * klass)
 static void
 gst_audiomixer_init (GstAudioMixer * audiomixer)
 {
+  audiomixer->accumulate = DEFAULT_ACCUMULATE;
+
+  audiomixer->jobs = g_array_new (FALSE, FALSE, sizeof (GstAudioMixerJob));
+  g_array_set_clear_func (audiomixer->jobs,
+      (GDestroyNotify) gst_audiomixer_job_clear);
+  audiomixer->accum = g_malloc (MIX_BLOCK_SIZE * sizeof (gdouble));
 }
 
 static GstPad *
@@ -287,6 +610,78 @@ gst_audiomixer_release_pad (GstElement * element, GstPad * pad)
   GST_ELEMENT_CLASS (parent_class)->release_pad (element, pad);
 }
 
+static GstBuffer *
+gst_audiomixer_create_output_buffer (GstAudioAggregator * aagg,
+    guint num_frames)
+{
+  GstAudioMixer *audiomixer = GST_AUDIO_MIXER (aagg);
+
+  gst_audiomixer_clear_jobs (audiomixer);
+  audiomixer->outbuf_dirty = FALSE;
+
+  GST_OBJECT_LOCK (audiomixer);
+  audiomixer->accumulating = audiomixer->accumulate;
+  GST_OBJECT_UNLOCK (audiomixer);
+
+  return GST_AUDIO_AGGREGATOR_CLASS (parent_class)->create_output_buffer
+      (aagg, num_frames);
+}
+
+static GstFlowReturn
+gst_audiomixer_finish_buffer (GstAggregator * agg, GstBuffer * buffer)
+{
+  GstAudioMixer *audiomixer = GST_AUDIO_MIXER (agg);
+
+  if (audiomixer->jobs->len > 0) {
+    GstAudioInfo info;
+
+    GST_OBJECT_LOCK (agg);
+    info = GST_AUDIO_AGGREGATOR_PAD (agg->srcpad)->info;
+    GST_OBJECT_UNLOCK (agg);
+
+    gst_audiomixer_mix_jobs (audiomixer, buffer, &info);
+  }
+
+  return GST_AGGREGATOR_CLASS (parent_class)->finish_buffer (agg, buffer);
+}
+
+static gboolean
+gst_audiomixer_negotiated_src_caps (GstAggregator * agg, GstCaps * caps)
+{
+  GstAudioMixer *audiomixer = GST_AUDIO_MIXER (agg);
+
+  /* The base class converts a partially mixed output buffer to the new
+   * format, so mix in the pending inputs while they still match it */
+  if (audiomixer->jobs->len > 0) {
+    GstAudioInfo info;
+
+    GST_OBJECT_LOCK (agg);
+    info = GST_AUDIO_AGGREGATOR_PAD (agg->srcpad)->info;
+    GST_OBJECT_UNLOCK (agg);
+
+    gst_audiomixer_mix_jobs (audiomixer, audiomixer->jobs_outbuf, &info);
+    audiomixer->outbuf_dirty = TRUE;
+  }
+
+  return GST_AGGREGATOR_CLASS (parent_class)->negotiated_src_caps (agg, caps);
+}
+
+static GstFlowReturn
+gst_audiomixer_flush (GstAggregator * agg)
+{
+  gst_audiomixer_clear_jobs (GST_AUDIO_MIXER (agg));
+
+  return GST_AGGREGATOR_CLASS (parent_class)->flush (agg);
+}
+
+static gboolean
+gst_audiomixer_stop (GstAggregator * agg)
+{
+  gst_audiomixer_clear_jobs (GST_AUDIO_MIXER (agg));
+
+  return GST_AGGREGATOR_CLASS (parent_class)->stop (agg);
+}
+
 
 static gboolean
 gst_audiomixer_aggregate_one_buffer (GstAudioAggregator * aagg,
@@ -312,6 +707,38 @@ gst_audiomixer_aggregate_one_buffer (GstAudioAggregator * aagg,
 
   bpf = GST_AUDIO_INFO_BPF (&srcpad->info);
 
+  if (GST_AUDIO_MIXER (aagg)->accumulating) {
+    GstAudioMixer *audiomixer = GST_AUDIO_MIXER (aagg);
+    GstAudioMixerJob job;
+
+    GST_LOG_OBJECT (pad, "queueing %u bytes at offset %u from offset %u",
+        num_frames * bpf, out_offset * bpf, in_offset * bpf);
+
+    job.buffer = gst_buffer_ref (inbuf);
+    job.in_offset = in_offset;
+    job.out_offset = out_offset;
+    job.num_frames = num_frames;
+    job.volume = pad->volume;
+    switch (GST_AUDIO_INFO_WIDTH (&srcpad->info)) {
+      case 8:
+        job.volume_i = pad->volume_i8;
+        break;
+      case 16:
+        job.volume_i = pad->volume_i16;
+        break;
+      default:
+        job.volume_i = pad->volume_i32;
+        break;
+    }
+    g_array_append_val (audiomixer->jobs, job);
+    audiomixer->jobs_outbuf = outbuf;
+
+    GST_OBJECT_UNLOCK (aaggpad);
+    GST_OBJECT_UNLOCK (aagg);
+
+    return TRUE;
+  }
+
   gst_buffer_map (outbuf, &outmap, GST_MAP_READWRITE);
   gst_buffer_map (inbuf, &inmap, GST_MAP_READ);
   GST_LOG_OBJECT (pad, "mixing %u bytes at offset %u from offset %u",
@@ -41,6 +41,16 @@ G_DECLARE_FINAL_TYPE (GstAudioMixer, gst_audiomixer, GST, AUDIO_MIXER,
  */
 struct _GstAudioMixer {
   GstAudioAggregator element;
+
+  /*< private >*/
+  gboolean accumulate;
+
+  /* state for the output buffer that is currently being mixed */
+  gboolean accumulating;
+  GArray *jobs;
+  GstBuffer *jobs_outbuf;
+  gboolean outbuf_dirty;
+  gpointer accum;
 };
 
 #define GST_TYPE_AUDIO_MIXER_PAD (gst_audiomixer_pad_get_type())
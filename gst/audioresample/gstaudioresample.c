@@ -42,6 +42,20 @@
  * To create the Ogg/Vorbis file refer to the documentation of vorbisenc.
  * This assumes there is an audio sink that will accept/handle 8kHz audio.
  *
+ * ## Drift compensation
+ *
+ * When #GstAudioResample:drift-compensation is enabled, audioresample
+ * compares the timestamps of the incoming buffers with the amount of audio
+ * it received and continuously adjusts the resampling ratio so that the
+ * output follows the clock that timestamped the input. This compensates
+ * the drift between the clock of a network sender and the clock of the
+ * pipeline without dropping or inserting samples.
+ *
+ * |[
+ * gst-launch-1.0 udpsrc port=5004 caps="application/x-rtp,media=audio,clock-rate=48000,encoding-name=L24,channels=2" ! rtpjitterbuffer ! rtpL24depay ! audioconvert ! audioresample drift-compensation=true ! alsasink slave-method=none
+ * ]|
+ *  Play a network stream on the sound card, correcting the drift between the
+ *  sender and the sound card in audioresample instead of in the sink.
  */
 
 /* TODO:
@@ -70,6 +84,9 @@ GST_DEBUG_CATEGORY (audio_resample_debug);
 #define DEFAULT_SINC_FILTER_MODE GST_AUDIO_RESAMPLER_FILTER_MODE_AUTO
 #define DEFAULT_SINC_FILTER_AUTO_THRESHOLD (1*1048576)
 #define DEFAULT_SINC_FILTER_INTERPOLATION GST_AUDIO_RESAMPLER_FILTER_INTERPOLATION_CUBIC
+#define DEFAULT_N_THREADS 1
+#define DEFAULT_DRIFT_COMPENSATION FALSE
+#define DEFAULT_MAX_DRIFT 1000
 
 enum
 {
@@ -78,7 +95,11 @@ enum
   PROP_RESAMPLE_METHOD,
   PROP_SINC_FILTER_MODE,
   PROP_SINC_FILTER_AUTO_THRESHOLD,
-  PROP_SINC_FILTER_INTERPOLATION
+  PROP_SINC_FILTER_INTERPOLATION,
+  PROP_N_THREADS,
+  PROP_DRIFT_COMPENSATION,
+  PROP_MAX_DRIFT,
+  PROP_DRIFT
 };
 
 #define SUPPORTED_CAPS \
@@ -181,6 +202,65 @@ gst_audio_resample_class_init (GstAudioResampleClass * klass)
           DEFAULT_SINC_FILTER_INTERPOLATION,
           G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
+  /**
+   * GstAudioResample:n-threads:
+   *
+   * Maximum number of threads to use. The channels are split into groups
+   * that are resampled in parallel, 0 uses the number of processors.
+   *
+   * Since: 1.20
+   */
+  g_object_class_install_property (gobject_class, PROP_N_THREADS,
+      g_param_spec_uint ("n-threads", "Threads",
+          "Maximum number of threads to use (0 = number of processors)",
+          0, G_MAXUINT, DEFAULT_N_THREADS,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstAudioResample:drift-compensation:
+   *
+   * Continuously adjust the resampling ratio so that the output follows
+   * the timestamps of the input. The interpolated filter is always used in
+   * this mode and the element never operates in passthrough.
+   *
+   * Since: 1.20
+   */
+  g_object_class_install_property (gobject_class, PROP_DRIFT_COMPENSATION,
+      g_param_spec_boolean ("drift-compensation", "Drift compensation",
+          "Adjust the resampling ratio to follow the input timestamps",
+          DEFAULT_DRIFT_COMPENSATION,
+          G_PARAM_READWRITE | GST_PARAM_MUTABLE_READY |
+          G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstAudioResample:max-drift:
+   *
+   * The maximum correction of the resampling ratio that drift compensation
+   * applies, in parts per million.
+   *
+   * Since: 1.20
+   */
+  g_object_class_install_property (gobject_class, PROP_MAX_DRIFT,
+      g_param_spec_uint ("max-drift", "Maximum drift",
+          "Maximum correction of the resampling ratio in ppm",
+          1, 100000, DEFAULT_MAX_DRIFT,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstAudioResample:drift:
+   *
+   * The correction of the resampling ratio that drift compensation currently
+   * applies, in parts per million. Positive when the input clock runs slower
+   * than the clock of the input timestamps.
+   *
+   * Since: 1.20
+   */
+  g_object_class_install_property (gobject_class, PROP_DRIFT,
+      g_param_spec_double ("drift", "Drift",
+          "Current correction of the resampling ratio in ppm",
+          -100000.0, 100000.0, 0.0,
+          G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+
   gst_element_class_add_static_pad_template (gstelement_class,
       &gst_audio_resample_src_template);
   gst_element_class_add_static_pad_template (gstelement_class,
@@ -233,6 +313,9 @@ gst_audio_resample_init (GstAudioResample * resample)
   resample->sinc_filter_mode = DEFAULT_SINC_FILTER_MODE;
   resample->sinc_filter_auto_threshold = DEFAULT_SINC_FILTER_AUTO_THRESHOLD;
   resample->sinc_filter_interpolation = DEFAULT_SINC_FILTER_INTERPOLATION;
+  resample->n_threads = DEFAULT_N_THREADS;
+  resample->drift_compensation = DEFAULT_DRIFT_COMPENSATION;
+  resample->max_drift = DEFAULT_MAX_DRIFT;
 
   gst_base_transform_set_gap_aware (trans, TRUE);
   gst_pad_set_query_function (trans->srcpad, gst_audio_resample_query);
@@ -254,6 +337,12 @@ gst_audio_resample_start (GstBaseTransform * base)
   resample->samples_in = 0;
   resample->samples_out = 0;
 
+  resample->drift_in_time = 0.0;
+  resample->drift_error = 0.0;
+  resample->drift_integral = 0.0;
+  resample->drift = 0.0;
+  resample->drift_in_rate = 0;
+
   return TRUE;
 }
 
@@ -384,7 +473,15 @@ make_options (GstAudioResample * resample, GstAudioInfo * in,
       G_TYPE_UINT, resample->sinc_filter_auto_threshold,
       GST_AUDIO_RESAMPLER_OPT_FILTER_INTERPOLATION,
       GST_TYPE_AUDIO_RESAMPLER_FILTER_INTERPOLATION,
-      resample->sinc_filter_interpolation, NULL);
+      resample->sinc_filter_interpolation, GST_AUDIO_RESAMPLER_OPT_THREADS,
+      G_TYPE_UINT, resample->n_threads, NULL);
+
+  /* the ratio changes all the time, only the interpolated filter can follow
+   * that without recalculating the filter table */
+  if (resample->drift_compensation)
+    gst_structure_set (options, GST_AUDIO_RESAMPLER_OPT_FILTER_MODE,
+        GST_TYPE_AUDIO_RESAMPLER_FILTER_MODE,
+        GST_AUDIO_RESAMPLER_FILTER_MODE_INTERPOLATED, NULL);
 
   return options;
 }
@@ -537,6 +634,11 @@ gst_audio_resample_set_caps (GstBaseTransform * base, GstCaps * incaps,
   resample->in = in;
   resample->out = out;
 
+  /* the converter runs at the nominal rates again */
+  resample->drift_in_rate = 0;
+  if (resample->drift_compensation)
+    gst_base_transform_set_passthrough (base, FALSE);
+
   return TRUE;
 
   /* ERROR */
@@ -697,10 +799,72 @@ gst_audio_resample_sink_event (GstBaseTransform * base, GstEvent * event)
   return GST_BASE_TRANSFORM_CLASS (parent_class)->sink_event (base, event);
 }
 
+/* Drift compensation is a PI controller on the difference between the
+ * input timestamps and the time that the input samples were resampled to.
+ * The difference is smoothed first because network timestamps jitter. */
+#define DRIFT_ERROR_TIME_CONSTANT 1.0
+#define DRIFT_KP 0.1
+#define DRIFT_KI (DRIFT_KP * DRIFT_KP / 4.0)
+/* the rates given to the converter are scaled up so that the ratio can be
+ * set with a resolution of about one ppm */
+#define DRIFT_RATE_RESOLUTION 1000000
+
+static gdouble
+gst_audio_resample_drift_in_rate (GstAudioResample * resample)
+{
+  if (resample->drift_in_rate == 0)
+    return resample->in.rate;
+
+  return (gdouble) resample->drift_in_rate / resample->drift_scale;
+}
+
+static void
+gst_audio_resample_update_drift (GstAudioResample * resample, GstBuffer * buf,
+    gsize in_len)
+{
+  gdouble error, dt, max, corr;
+  gint in_rate;
+
+  if (!GST_BUFFER_PTS_IS_VALID (buf) ||
+      !GST_CLOCK_TIME_IS_VALID (resample->t0) || resample->converter == NULL)
+    return;
+
+  error = (gdouble) GST_CLOCK_DIFF (resample->t0, GST_BUFFER_PTS (buf)) /
+      GST_SECOND - resample->drift_in_time;
+  dt = (gdouble) in_len / resample->in.rate;
+
+  resample->drift_error += (error - resample->drift_error) *
+      MIN (1.0, dt / DRIFT_ERROR_TIME_CONSTANT);
+
+  max = resample->max_drift / 1e6;
+  resample->drift_integral =
+      CLAMP (resample->drift_integral + DRIFT_KI * resample->drift_error * dt,
+      -max, max);
+  corr = CLAMP (DRIFT_KP * resample->drift_error + resample->drift_integral,
+      -max, max);
+  resample->drift = corr * 1e6;
+
+  /* when the input timestamps advance faster than the input samples, the
+   * input clock is slow and every input sample needs to become more output */
+  resample->drift_scale = MAX (1, DRIFT_RATE_RESOLUTION /
+      MAX (resample->in.rate, resample->out.rate));
+  in_rate = (gint) floor (resample->in.rate * resample->drift_scale *
+      (1.0 - corr) + 0.5);
+
+  if (in_rate != resample->drift_in_rate) {
+    GST_LOG_OBJECT (resample, "error %f s, correction %f ppm", error,
+        resample->drift);
+
+    gst_audio_converter_update_config (resample->converter, in_rate,
+        resample->out.rate * resample->drift_scale, NULL);
+    resample->drift_in_rate = in_rate;
+  }
+}
+
 static gboolean
 gst_audio_resample_check_discont (GstAudioResample * resample, GstBuffer * buf)
 {
-  guint64 offset;
+  guint64 offset, expected;
   guint64 delta;
 
   /* is the incoming buffer a discontinuity? */
@@ -722,7 +886,14 @@ gst_audio_resample_check_discont (GstAudioResample * resample, GstBuffer * buf)
    * flush/restart (if triggered incorrectly, this will be audible) */
   /* allow even up to more samples, since sink is not so strict anyway,
    * so give that one a chance to handle this as configured */
-  delta = ABS ((gint64) (offset - resample->samples_in));
+  /* with drift compensation the input samples don't last for their nominal
+   * duration */
+  if (resample->drift_compensation)
+    expected = resample->drift_in_time * resample->in.rate;
+  else
+    expected = resample->samples_in;
+
+  delta = ABS ((gint64) (offset - expected));
   if (delta <= (resample->in.rate >> 5))
     return FALSE;
 
@@ -925,12 +1096,18 @@ gst_audio_resample_transform (GstBaseTransform * base, GstBuffer * inbuf,
       resample->in_offset0 = GST_BUFFER_OFFSET_NONE;
       resample->out_offset0 = GST_BUFFER_OFFSET_NONE;
     }
+    resample->drift_in_time = 0.0;
+    resample->drift_error = 0.0;
     /* set DISCONT flag on output buffer */
     GST_DEBUG_OBJECT (resample, "marking this buffer with the DISCONT flag");
     GST_BUFFER_FLAG_SET (outbuf, GST_BUFFER_FLAG_DISCONT);
     resample->need_discont = FALSE;
   }
 
+  if (resample->drift_compensation)
+    resample->drift_in_time += gst_buffer_get_size (inbuf) / resample->in.bpf /
+        gst_audio_resample_drift_in_rate (resample);
+
   ret = gst_audio_resample_process (resample, inbuf, outbuf);
   if (G_UNLIKELY (ret != GST_FLOW_OK))
     return ret;
@@ -979,6 +1156,14 @@ gst_audio_resample_submit_input_buffer (GstBaseTransform * base,
       return GST_FLOW_OK;
   }
 
+  /* adjust the ratio before the output buffer for this input is allocated,
+   * discontinuities restart the measurement in transform */
+  if (resample->drift_compensation && !resample->need_discont &&
+      !GST_BUFFER_IS_DISCONT (input) &&
+      !gst_audio_resample_check_discont (resample, input))
+    gst_audio_resample_update_drift (resample, input,
+        gst_buffer_get_size (input) / resample->in.bpf);
+
   return GST_BASE_TRANSFORM_CLASS (parent_class)->submit_input_buffer (base,
       is_discont, input);
 }
@@ -1082,6 +1267,17 @@ gst_audio_resample_set_property (GObject * object, guint prop_id,
       resample->sinc_filter_interpolation = g_value_get_enum (value);
       gst_audio_resample_update_state (resample, NULL, NULL);
       break;
+    case PROP_N_THREADS:
+      /* FIXME locking! */
+      resample->n_threads = g_value_get_uint (value);
+      gst_audio_resample_update_state (resample, NULL, NULL);
+      break;
+    case PROP_DRIFT_COMPENSATION:
+      resample->drift_compensation = g_value_get_boolean (value);
+      break;
+    case PROP_MAX_DRIFT:
+      resample->max_drift = g_value_get_uint (value);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -1112,6 +1308,18 @@ gst_audio_resample_get_property (GObject * object, guint prop_id,
     case PROP_SINC_FILTER_INTERPOLATION:
       g_value_set_enum (value, resample->sinc_filter_interpolation);
       break;
+    case PROP_N_THREADS:
+      g_value_set_uint (value, resample->n_threads);
+      break;
+    case PROP_DRIFT_COMPENSATION:
+      g_value_set_boolean (value, resample->drift_compensation);
+      break;
+    case PROP_MAX_DRIFT:
+      g_value_set_uint (value, resample->max_drift);
+      break;
+    case PROP_DRIFT:
+      g_value_set_double (value, resample->drift);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
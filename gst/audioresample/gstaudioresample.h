@@ -58,6 +58,17 @@ struct _GstAudioResample {
   GstAudioResamplerFilterMode sinc_filter_mode;
   guint32 sinc_filter_auto_threshold;
   GstAudioResamplerFilterInterpolation sinc_filter_interpolation;
+  guint n_threads;
+  gboolean drift_compensation;
+  guint max_drift;
+
+  /* drift compensation */
+  gdouble drift_in_time;
+  gdouble drift_error;
+  gdouble drift_integral;
+  gdouble drift;
+  gint drift_scale;
+  gint drift_in_rate;
 
   /* state */
   GstAudioInfo in;
@@ -350,15 +350,104 @@ clamp_rectangle (gint x, gint y, gint w, gint h, gint outer_width,
   return clamped;
 }
 
-/* Call this with the lock taken */
+/* Append the parts of @rect that are not covered by @sub to @out */
+static void
+_rectangle_subtract (const GstVideoRectangle * rect,
+    const GstVideoRectangle * sub, GArray * out)
+{
+  gint x1 = MAX (rect->x, sub->x);
+  gint y1 = MAX (rect->y, sub->y);
+  gint x2 = MIN (rect->x + rect->w, sub->x + sub->w);
+  gint y2 = MIN (rect->y + rect->h, sub->y + sub->h);
+  GstVideoRectangle r;
+
+  if (x1 >= x2 || y1 >= y2) {
+    g_array_append_vals (out, rect, 1);
+    return;
+  }
+
+  /* above and below the intersection, full width */
+  if (y1 > rect->y) {
+    r.x = rect->x;
+    r.y = rect->y;
+    r.w = rect->w;
+    r.h = y1 - rect->y;
+    g_array_append_val (out, r);
+  }
+  if (y2 < rect->y + rect->h) {
+    r.x = rect->x;
+    r.y = y2;
+    r.w = rect->w;
+    r.h = rect->y + rect->h - y2;
+    g_array_append_val (out, r);
+  }
+
+  /* left and right of the intersection */
+  if (x1 > rect->x) {
+    r.x = rect->x;
+    r.y = y1;
+    r.w = x1 - rect->x;
+    r.h = y2 - y1;
+    g_array_append_val (out, r);
+  }
+  if (x2 < rect->x + rect->w) {
+    r.x = x2;
+    r.y = y1;
+    r.w = rect->x + rect->w - x2;
+    r.h = y2 - y1;
+    g_array_append_val (out, r);
+  }
+}
+
+/* Test whether the union of @occluders contains @rect (geometrically) */
+static gboolean
+_rectangle_is_covered (const GstVideoRectangle rect,
+    const GstVideoRectangle * occluders, guint n_occluders)
+{
+  GArray *remaining, *next, *tmp;
+  gboolean covered;
+  guint i, j;
+
+  if (rect.w <= 0 || rect.h <= 0)
+    return TRUE;
+
+  /* Common case, a single occluder covers everything */
+  for (i = 0; i < n_occluders; i++) {
+    if (is_rectangle_contained (rect, occluders[i]))
+      return TRUE;
+  }
+
+  remaining = g_array_new (FALSE, FALSE, sizeof (GstVideoRectangle));
+  next = g_array_new (FALSE, FALSE, sizeof (GstVideoRectangle));
+  g_array_append_val (remaining, rect);
+
+  for (i = 0; i < n_occluders && remaining->len > 0; i++) {
+    g_array_set_size (next, 0);
+    for (j = 0; j < remaining->len; j++)
+      _rectangle_subtract (&g_array_index (remaining, GstVideoRectangle, j),
+          &occluders[i], next);
+    tmp = remaining;
+    remaining = next;
+    next = tmp;
+  }
+
+  covered = remaining->len == 0;
+
+  g_array_free (remaining, TRUE);
+  g_array_free (next, TRUE);
+
+  return covered;
+}
+
+/* Call this with the lock taken. Returns %TRUE if @pad is known to draw
+ * only opaque pixels, and sets @pad_rect to the area it covers */
 static gboolean
-_pad_obscures_rectangle (GstVideoAggregator * vagg, GstVideoAggregatorPad * pad,
-    const GstVideoRectangle rect)
+_pad_get_opaque_rectangle (GstVideoAggregator * vagg,
+    GstVideoAggregatorPad * pad, GstVideoRectangle * pad_rect)
 {
-  GstVideoRectangle pad_rect;
   GstCompositorPad *cpad = GST_COMPOSITOR_PAD (pad);
 
-  /* No buffer to obscure the rectangle with */
+  /* No buffer to obscure anything with */
   if (!gst_video_aggregator_pad_has_current_buffer (pad))
     return FALSE;
 
@@ -369,19 +458,239 @@ _pad_obscures_rectangle (GstVideoAggregator * vagg, GstVideoAggregatorPad * pad,
   if (cpad->alpha != 1.0 || GST_VIDEO_INFO_HAS_ALPHA (&pad->info))
     return FALSE;
 
-  pad_rect.x = cpad->xpos;
-  pad_rect.y = cpad->ypos;
+  pad_rect->x = cpad->xpos;
+  pad_rect->y = cpad->ypos;
   /* Handle pixel and display aspect ratios to find the actual size */
   _mixer_pad_get_output_size (GST_COMPOSITOR (vagg), cpad,
       GST_VIDEO_INFO_PAR_N (&vagg->info), GST_VIDEO_INFO_PAR_D (&vagg->info),
-      &(pad_rect.w), &(pad_rect.h));
+      &(pad_rect->w), &(pad_rect->h));
+
+  return pad_rect->w > 0 && pad_rect->h > 0;
+}
+
+/* Number of scaled lines that are blended at once */
+#define SCALE_LINES 16
+
+struct _GstCompositorScaler
+{
+  GstVideoScaler *h_scaler[GST_VIDEO_MAX_PLANES];
+  GstVideoScaler *v_scaler[GST_VIDEO_MAX_PLANES];
+  /* the scaled lines that are currently being blended */
+  GstBuffer *lines;
+};
 
-  if (!is_rectangle_contained (rect, pad_rect))
+/* Like get_scale_format() in video-converter.c, but only for the formats we
+ * can blend and that the video scaler can scale without unpacking */
+static GstVideoFormat
+_get_scale_format (GstVideoFormat format, gint plane)
+{
+  switch (format) {
+    case GST_VIDEO_FORMAT_I420:
+    case GST_VIDEO_FORMAT_YV12:
+    case GST_VIDEO_FORMAT_Y41B:
+    case GST_VIDEO_FORMAT_Y42B:
+    case GST_VIDEO_FORMAT_Y444:
+      return GST_VIDEO_FORMAT_GRAY8;
+    case GST_VIDEO_FORMAT_NV12:
+    case GST_VIDEO_FORMAT_NV21:
+      return plane == 0 ? GST_VIDEO_FORMAT_GRAY8 : GST_VIDEO_FORMAT_NV12;
+    case GST_VIDEO_FORMAT_AYUV:
+    case GST_VIDEO_FORMAT_ARGB:
+    case GST_VIDEO_FORMAT_BGRA:
+    case GST_VIDEO_FORMAT_ABGR:
+    case GST_VIDEO_FORMAT_RGBA:
+    case GST_VIDEO_FORMAT_xRGB:
+    case GST_VIDEO_FORMAT_xBGR:
+    case GST_VIDEO_FORMAT_RGBx:
+    case GST_VIDEO_FORMAT_BGRx:
+    case GST_VIDEO_FORMAT_RGB:
+    case GST_VIDEO_FORMAT_BGR:
+      return format;
+    default:
+      return GST_VIDEO_FORMAT_UNKNOWN;
+  }
+}
+
+static gboolean
+_is_scaler_option (GQuark field_id, const GValue * value, gpointer user_data)
+{
+  const gchar *name = g_quark_to_string (field_id);
+
+  return g_str_has_prefix (name, "GstVideoResampler.")
+      || !g_strcmp0 (name, GST_VIDEO_CONVERTER_OPT_RESAMPLER_METHOD)
+      || !g_strcmp0 (name, GST_VIDEO_CONVERTER_OPT_CHROMA_RESAMPLER_METHOD)
+      || !g_strcmp0 (name, GST_VIDEO_CONVERTER_OPT_RESAMPLER_TAPS)
+      || !g_strcmp0 (name, GST_VIDEO_CONVERTER_OPT_THREADS);
+}
+
+/* Returns %TRUE if the only conversion needed for @pad is scaling to
+ * @width x @height, which can then be done while blending */
+static gboolean
+_pad_can_scale_on_blend (GstVideoAggregatorPad * pad,
+    GstVideoAggregator * vagg, gint width, gint height,
+    const GstStructure * config)
+{
+  const GstVideoInfo *in_info = &pad->info;
+  const GstVideoInfo *out_info = &vagg->info;
+  guint i;
+
+  if (GST_VIDEO_INFO_FORMAT (in_info) != GST_VIDEO_INFO_FORMAT (out_info))
+    return FALSE;
+
+  if (!gst_video_colorimetry_is_equal (&in_info->colorimetry,
+          &out_info->colorimetry)
+      || in_info->chroma_site != out_info->chroma_site)
+    return FALSE;
+
+  if (GST_VIDEO_INFO_IS_INTERLACED (in_info))
     return FALSE;
 
-  GST_DEBUG_OBJECT (pad, "Pad %s %ix%i@(%i,%i) obscures rect %ix%i@(%i,%i)",
-      GST_PAD_NAME (pad), pad_rect.w, pad_rect.h, pad_rect.x, pad_rect.y,
-      rect.w, rect.h, rect.x, rect.y);
+  /* Nothing to scale */
+  if (width == GST_VIDEO_INFO_WIDTH (in_info)
+      && height == GST_VIDEO_INFO_HEIGHT (in_info))
+    return FALSE;
+
+  for (i = 0; i < GST_VIDEO_INFO_N_PLANES (in_info); i++) {
+    if (_get_scale_format (GST_VIDEO_INFO_FORMAT (in_info),
+            i) == GST_VIDEO_FORMAT_UNKNOWN)
+      return FALSE;
+  }
+
+  /* Leave anything but scaling options to the converter */
+  if (config && !gst_structure_foreach (config, _is_scaler_option, NULL))
+    return FALSE;
+
+  return TRUE;
+}
+
+static void
+_pad_free_scalers (GstCompositorPad * cpad)
+{
+  guint i, j;
+
+  for (i = 0; i < cpad->n_scalers; i++) {
+    GstCompositorScaler *scaler = &cpad->scalers[i];
+
+    for (j = 0; j < GST_VIDEO_MAX_PLANES; j++) {
+      if (scaler->h_scaler[j])
+        gst_video_scaler_free (scaler->h_scaler[j]);
+      if (scaler->v_scaler[j])
+        gst_video_scaler_free (scaler->v_scaler[j]);
+    }
+    gst_buffer_replace (&scaler->lines, NULL);
+  }
+
+  g_free (cpad->scalers);
+  cpad->scalers = NULL;
+  cpad->n_scalers = 0;
+}
+
+/* Creates one set of scalers for each of the @n_threads blend threads,
+ * configured like the video converter would for the same scaling */
+static void
+_pad_ensure_scalers (GstCompositorPad * cpad, guint n_threads)
+{
+  const GstVideoInfo *in_info = &cpad->scale_info;
+  const GstVideoFormatInfo *finfo = in_info->finfo;
+  gint method = GST_VIDEO_RESAMPLER_METHOD_CUBIC;
+  gint cr_method = GST_VIDEO_RESAMPLER_METHOD_LINEAR;
+  guint taps = 0;
+  GstVideoInfo lines_info;
+  guint i, plane;
+
+  if (cpad->n_scalers == n_threads)
+    return;
+
+  _pad_free_scalers (cpad);
+
+  if (cpad->scale_config) {
+    gst_structure_get_enum (cpad->scale_config,
+        GST_VIDEO_CONVERTER_OPT_RESAMPLER_METHOD,
+        GST_TYPE_VIDEO_RESAMPLER_METHOD, &method);
+    gst_structure_get_enum (cpad->scale_config,
+        GST_VIDEO_CONVERTER_OPT_CHROMA_RESAMPLER_METHOD,
+        GST_TYPE_VIDEO_RESAMPLER_METHOD, &cr_method);
+    gst_structure_get_uint (cpad->scale_config,
+        GST_VIDEO_CONVERTER_OPT_RESAMPLER_TAPS, &taps);
+  }
+  if (method == GST_VIDEO_RESAMPLER_METHOD_NEAREST)
+    cr_method = method;
+
+  gst_video_info_set_format (&lines_info, GST_VIDEO_INFO_FORMAT (in_info),
+      cpad->scale_width, SCALE_LINES);
+
+  cpad->scalers = g_new0 (GstCompositorScaler, n_threads);
+  cpad->n_scalers = n_threads;
+
+  for (i = 0; i < n_threads; i++) {
+    GstCompositorScaler *scaler = &cpad->scalers[i];
+
+    for (plane = 0; plane < GST_VIDEO_INFO_N_PLANES (in_info); plane++) {
+      gint iw, ih, ow, oh;
+      gint plane_method = plane == 0 ? method : cr_method;
+
+      iw = GST_VIDEO_FORMAT_INFO_SCALE_WIDTH (finfo, plane,
+          GST_VIDEO_INFO_WIDTH (in_info));
+      ih = GST_VIDEO_FORMAT_INFO_SCALE_HEIGHT (finfo, plane,
+          GST_VIDEO_INFO_HEIGHT (in_info));
+      ow = GST_VIDEO_FORMAT_INFO_SCALE_WIDTH (finfo, plane, cpad->scale_width);
+      oh = GST_VIDEO_FORMAT_INFO_SCALE_HEIGHT (finfo, plane,
+          cpad->scale_height);
+
+      if (iw != ow)
+        scaler->h_scaler[plane] = gst_video_scaler_new (plane_method,
+            GST_VIDEO_SCALER_FLAG_NONE, taps, iw, ow, cpad->scale_config);
+      if (ih != oh)
+        scaler->v_scaler[plane] = gst_video_scaler_new (plane_method,
+            GST_VIDEO_SCALER_FLAG_NONE, taps, ih, oh, cpad->scale_config);
+    }
+
+    scaler->lines = gst_buffer_new_allocate (NULL,
+        GST_VIDEO_INFO_SIZE (&lines_info), NULL);
+  }
+}
+
+static gboolean
+_structures_equal (const GstStructure * s1, const GstStructure * s2)
+{
+  if (s1 == NULL || s2 == NULL)
+    return s1 == s2;
+
+  return gst_structure_is_equal (s1, s2);
+}
+
+/* Takes ownership of @config */
+static gboolean
+_pad_prepare_scale_on_blend (GstVideoAggregatorPad * pad, GstBuffer * buffer,
+    gint width, gint height, GstStructure * config,
+    GstVideoFrame * prepared_frame)
+{
+  GstCompositorPad *cpad = GST_COMPOSITOR_PAD (pad);
+
+  if (!cpad->scale_on_blend || cpad->scale_width != width
+      || cpad->scale_height != height
+      || !gst_video_info_is_equal (&cpad->scale_info, &pad->info)
+      || !_structures_equal (cpad->scale_config, config)) {
+    GST_DEBUG_OBJECT (pad, "Scaling from %dx%d to %dx%d while blending",
+        GST_VIDEO_INFO_WIDTH (&pad->info), GST_VIDEO_INFO_HEIGHT (&pad->info),
+        width, height);
+
+    _pad_free_scalers (cpad);
+    cpad->scale_info = pad->info;
+    cpad->scale_width = width;
+    cpad->scale_height = height;
+    if (cpad->scale_config)
+      gst_structure_free (cpad->scale_config);
+    cpad->scale_config = config;
+  } else if (config) {
+    gst_structure_free (config);
+  }
+  cpad->scale_on_blend = TRUE;
+
+  if (!gst_video_frame_map (prepared_frame, &pad->info, buffer, GST_MAP_READ)) {
+    GST_WARNING_OBJECT (pad, "Could not map input buffer");
+    return FALSE;
+  }
 
   return TRUE;
 }
@@ -394,6 +703,9 @@ gst_compositor_pad_prepare_frame (GstVideoAggregatorPad * pad,
   GstCompositorPad *cpad = GST_COMPOSITOR_PAD (pad);
   gint width, height;
   gboolean frame_obscured = FALSE;
+  GstVideoRectangle *occluders;
+  guint n_occluders = 0;
+  GstStructure *config = NULL;
   GList *l;
   /* The rectangle representing this frame, clamped to the video's boundaries.
    * Due to the clamping, this is different from the frame width/height above. */
@@ -430,23 +742,39 @@ gst_compositor_pad_prepare_frame (GstVideoAggregatorPad * pad,
   }
 
   GST_OBJECT_LOCK (vagg);
-  /* Check if this frame is obscured by a higher-zorder frame
-   * TODO: Also skip a frame if it's obscured by a combination of
-   * higher-zorder frames */
+  /* Check if this frame is obscured by the higher-zorder frames */
+  occluders = g_newa (GstVideoRectangle, GST_ELEMENT (vagg)->numsinkpads);
   l = g_list_find (GST_ELEMENT (vagg)->sinkpads, pad);
   /* The pad might've just been removed */
   if (l)
     l = l->next;
   for (; l; l = l->next) {
-    if (_pad_obscures_rectangle (vagg, l->data, frame_rect)) {
-      frame_obscured = TRUE;
-      break;
-    }
+    if (_pad_get_opaque_rectangle (vagg, l->data, &occluders[n_occluders]))
+      n_occluders++;
   }
+  frame_obscured = _rectangle_is_covered (frame_rect, occluders, n_occluders);
   GST_OBJECT_UNLOCK (vagg);
 
-  if (frame_obscured)
+  if (frame_obscured) {
+    GST_DEBUG_OBJECT (pad, "Pad %s %ix%i@(%i,%i) is obscured by %u pads",
+        GST_PAD_NAME (pad), frame_rect.w, frame_rect.h, frame_rect.x,
+        frame_rect.y, n_occluders);
     goto done;
+  }
+
+  /* Skip the intermediate frame if we only have to scale, the lines are
+   * scaled right before they are blended */
+  g_object_get (pad, "converter-config", &config, NULL);
+  if (_pad_can_scale_on_blend (pad, vagg, width, height, config))
+    return _pad_prepare_scale_on_blend (pad, buffer, width, height, config,
+        prepared_frame);
+
+  if (config)
+    gst_structure_free (config);
+  if (cpad->scale_on_blend) {
+    cpad->scale_on_blend = FALSE;
+    _pad_free_scalers (cpad);
+  }
 
   return
       GST_VIDEO_AGGREGATOR_PAD_CLASS
@@ -501,6 +829,21 @@ gst_compositor_pad_create_conversion_info (GstVideoAggregatorConvertPad * pad,
   }
 }
 
+static void
+gst_compositor_pad_finalize (GObject * object)
+{
+  GstCompositorPad *pad = GST_COMPOSITOR_PAD (object);
+
+  gst_buffer_replace (&pad->damage_buffer, NULL);
+
+  _pad_free_scalers (pad);
+  if (pad->scale_config)
+    gst_structure_free (pad->scale_config);
+  pad->scale_config = NULL;
+
+  G_OBJECT_CLASS (gst_compositor_pad_parent_class)->finalize (object);
+}
+
 static void
 gst_compositor_pad_class_init (GstCompositorPadClass * klass)
 {
@@ -512,6 +855,7 @@ gst_compositor_pad_class_init (GstCompositorPadClass * klass)
 
   gobject_class->set_property = gst_compositor_pad_set_property;
   gobject_class->get_property = gst_compositor_pad_get_property;
+  gobject_class->finalize = gst_compositor_pad_finalize;
 
   g_object_class_install_property (gobject_class, PROP_PAD_XPOS,
       g_param_spec_int ("xpos", "X Position", "X Position of the picture",
@@ -555,17 +899,20 @@ gst_compositor_pad_init (GstCompositorPad * compo_pad)
   compo_pad->op = DEFAULT_PAD_OPERATOR;
   compo_pad->width = DEFAULT_PAD_WIDTH;
   compo_pad->height = DEFAULT_PAD_HEIGHT;
+  compo_pad->damage_index = -1;
 }
 
 
 /* GstCompositor */
 #define DEFAULT_BACKGROUND COMPOSITOR_BACKGROUND_CHECKER
 #define DEFAULT_ZERO_SIZE_IS_UNSCALED TRUE
+#define DEFAULT_DAMAGE_TRACKING FALSE
 enum
 {
   PROP_0,
   PROP_BACKGROUND,
   PROP_ZERO_SIZE_IS_UNSCALED,
+  PROP_DAMAGE_TRACKING,
 };
 
 static void
@@ -581,6 +928,11 @@ gst_compositor_get_property (GObject * object,
     case PROP_ZERO_SIZE_IS_UNSCALED:
       g_value_set_boolean (value, self->zero_size_is_unscaled);
       break;
+    case PROP_DAMAGE_TRACKING:
+      GST_OBJECT_LOCK (self);
+      g_value_set_boolean (value, self->damage_tracking);
+      GST_OBJECT_UNLOCK (self);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -595,11 +947,19 @@ gst_compositor_set_property (GObject * object,
 
   switch (prop_id) {
     case PROP_BACKGROUND:
+      GST_OBJECT_LOCK (self);
       self->background = g_value_get_enum (value);
+      self->full_damage = TRUE;
+      GST_OBJECT_UNLOCK (self);
       break;
     case PROP_ZERO_SIZE_IS_UNSCALED:
       self->zero_size_is_unscaled = g_value_get_boolean (value);
       break;
+    case PROP_DAMAGE_TRACKING:
+      GST_OBJECT_LOCK (self);
+      self->damage_tracking = g_value_get_boolean (value);
+      GST_OBJECT_UNLOCK (self);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -859,123 +1219,79 @@ _fixate_caps (GstAggregator * agg, GstCaps * caps)
   return ret;
 }
 
-static gpointer
+static void
 gst_parallelized_task_thread_func (gpointer data)
 {
-  GstParallelizedTaskThread *self = data;
-
-  g_mutex_lock (&self->runner->lock);
-  self->runner->n_done++;
-  if (self->runner->n_done == self->runner->n_threads - 1)
-    g_cond_signal (&self->runner->cond_done);
-
-  do {
-    gint idx;
-
-    while (self->runner->n_todo == -1 && !self->runner->quit)
-      g_cond_wait (&self->runner->cond_todo, &self->runner->lock);
-
-    if (self->runner->quit)
-      break;
+  GstParallelizedTaskRunner *runner = data;
+  gint idx;
 
-    idx = self->runner->n_todo--;
-    g_assert (self->runner->n_todo >= -1);
-    g_mutex_unlock (&self->runner->lock);
+  g_mutex_lock (&runner->lock);
+  idx = runner->n_todo--;
+  g_assert (runner->n_todo >= -1);
+  g_mutex_unlock (&runner->lock);
 
-    g_assert (self->runner->func != NULL);
+  g_assert (runner->func != NULL);
 
-    self->runner->func (self->runner->task_data[idx]);
-
-    g_mutex_lock (&self->runner->lock);
-    self->runner->n_done++;
-    if (self->runner->n_done == self->runner->n_threads - 1)
-      g_cond_signal (&self->runner->cond_done);
-  } while (TRUE);
+  runner->func (runner->task_data[idx]);
+}
 
-  g_mutex_unlock (&self->runner->lock);
+static void
+gst_parallelized_task_runner_join (GstParallelizedTaskRunner * self)
+{
+  gboolean joined = FALSE;
 
-  return NULL;
+  while (!joined) {
+    g_mutex_lock (&self->lock);
+    if (!(joined = gst_queue_array_is_empty (self->tasks))) {
+      gpointer task = gst_queue_array_pop_head (self->tasks);
+      g_mutex_unlock (&self->lock);
+      gst_task_pool_join (self->pool, task);
+    } else {
+      g_mutex_unlock (&self->lock);
+    }
+  }
 }
 
 static void
 gst_parallelized_task_runner_free (GstParallelizedTaskRunner * self)
 {
-  guint i;
-
-  g_mutex_lock (&self->lock);
-  self->quit = TRUE;
-  g_cond_broadcast (&self->cond_todo);
-  g_mutex_unlock (&self->lock);
-
-  for (i = 1; i < self->n_threads; i++) {
-    if (!self->threads[i].thread)
-      continue;
-
-    g_thread_join (self->threads[i].thread);
-  }
+  gst_parallelized_task_runner_join (self);
 
+  gst_queue_array_free (self->tasks);
+  gst_object_unref (self->pool);
   g_mutex_clear (&self->lock);
-  g_cond_clear (&self->cond_todo);
-  g_cond_clear (&self->cond_done);
-  g_free (self->threads);
   g_free (self);
 }
 
 static GstParallelizedTaskRunner *
-gst_parallelized_task_runner_new (guint n_threads)
+gst_parallelized_task_runner_new (guint n_threads, GstTaskPool * pool)
 {
   GstParallelizedTaskRunner *self;
-  guint i;
-  GError *err = NULL;
 
   if (n_threads == 0)
     n_threads = g_get_num_processors ();
 
+  /* No reason to split up the work between more threads than the
+   * pool can spawn */
+  if (GST_IS_SHARED_TASK_POOL (pool))
+    n_threads =
+        MIN (n_threads,
+        gst_shared_task_pool_get_max_threads (GST_SHARED_TASK_POOL (pool)));
+  n_threads = MAX (n_threads, 1);
+
   self = g_new0 (GstParallelizedTaskRunner, 1);
+  self->pool = gst_object_ref (pool);
+  self->tasks = gst_queue_array_new (n_threads);
   self->n_threads = n_threads;
-  self->threads = g_new0 (GstParallelizedTaskThread, n_threads);
 
-  self->quit = FALSE;
   self->n_todo = -1;
-  self->n_done = 0;
   g_mutex_init (&self->lock);
-  g_cond_init (&self->cond_todo);
-  g_cond_init (&self->cond_done);
 
   /* Set when scheduling a job */
   self->func = NULL;
   self->task_data = NULL;
 
-  for (i = 0; i < n_threads; i++) {
-    self->threads[i].runner = self;
-    self->threads[i].idx = i;
-
-    /* First thread is the one calling run() */
-    if (i > 0) {
-      self->threads[i].thread =
-          g_thread_try_new ("compositor-blend",
-          gst_parallelized_task_thread_func, &self->threads[i], &err);
-      if (!self->threads[i].thread)
-        goto error;
-    }
-  }
-
-  g_mutex_lock (&self->lock);
-  while (self->n_done < self->n_threads - 1)
-    g_cond_wait (&self->cond_done, &self->lock);
-  self->n_done = 0;
-  g_mutex_unlock (&self->lock);
-
   return self;
-
-error:
-  {
-    GST_ERROR ("Failed to start thread %u: %s", i, err->message);
-    g_clear_error (&err);
-
-    gst_parallelized_task_runner_free (self);
-    return NULL;
-  }
 }
 
 static void
@@ -988,22 +1304,24 @@ gst_parallelized_task_runner_run (GstParallelizedTaskRunner * self,
   self->task_data = task_data;
 
   if (n_threads > 1) {
+    guint i = 0;
     g_mutex_lock (&self->lock);
     self->n_todo = self->n_threads - 2;
-    self->n_done = 0;
-    g_cond_broadcast (&self->cond_todo);
+    for (i = 1; i < n_threads; i++) {
+      gpointer task =
+          gst_task_pool_push (self->pool, gst_parallelized_task_thread_func,
+          self, NULL);
+
+      /* The return value of push() is unfortunately nullable, and we can't deal with that */
+      g_assert (task != NULL);
+      gst_queue_array_push_tail (self->tasks, task);
+    }
     g_mutex_unlock (&self->lock);
   }
 
   self->func (self->task_data[self->n_threads - 1]);
 
-  if (n_threads > 1) {
-    g_mutex_lock (&self->lock);
-    while (self->n_done < self->n_threads - 1)
-      g_cond_wait (&self->cond_done, &self->lock);
-    self->n_done = 0;
-    g_mutex_unlock (&self->lock);
-  }
+  gst_parallelized_task_runner_join (self);
 
   self->func = NULL;
   self->task_data = NULL;
@@ -1039,34 +1357,22 @@ _negotiated_caps (GstAggregator * agg, GstCaps * caps)
     gst_parallelized_task_runner_free (compositor->blend_runner);
     compositor->blend_runner = NULL;
   }
-  if (!compositor->blend_runner)
-    compositor->blend_runner = gst_parallelized_task_runner_new (n_threads);
-
-  return GST_AGGREGATOR_CLASS (parent_class)->negotiated_src_caps (agg, caps);
-}
-
-static gboolean
-_should_draw_background (GstVideoAggregator * vagg)
-{
-  GstVideoRectangle bg_rect;
-  gboolean draw = TRUE;
-  GList *l;
+  /* The previous output frame has a different layout now */
+  GST_OBJECT_LOCK (compositor);
+  gst_buffer_replace (&compositor->damage_ref, NULL);
+  GST_OBJECT_UNLOCK (compositor);
 
-  bg_rect.x = bg_rect.y = 0;
+  if (!compositor->blend_runner) {
+    /* Blend stripes run on the same process-wide threads as all video
+     * converters */
+    GstTaskPool *pool = gst_video_converter_get_shared_task_pool ();
 
-  GST_OBJECT_LOCK (vagg);
-  bg_rect.w = GST_VIDEO_INFO_WIDTH (&vagg->info);
-  bg_rect.h = GST_VIDEO_INFO_HEIGHT (&vagg->info);
-  /* Check if the background is completely obscured by a pad
-   * TODO: Also skip if it's obscured by a combination of pads */
-  for (l = GST_ELEMENT (vagg)->sinkpads; l; l = l->next) {
-    if (_pad_obscures_rectangle (vagg, l->data, bg_rect)) {
-      draw = FALSE;
-      break;
-    }
+    compositor->blend_runner =
+        gst_parallelized_task_runner_new (n_threads, pool);
+    gst_object_unref (pool);
   }
-  GST_OBJECT_UNLOCK (vagg);
-  return draw;
+
+  return GST_AGGREGATOR_CLASS (parent_class)->negotiated_src_caps (agg, caps);
 }
 
 static gboolean
@@ -1088,17 +1394,65 @@ struct CompositePadInfo
   GstCompositorBlendMode blend_mode;
 };
 
+struct DamagedLines
+{
+  guint start;
+  guint end;
+};
+
 struct CompositeTask
 {
   GstCompositor *compositor;
+  /* index of the thread blending this band, selects the scalers used for
+   * scale-on-blend */
+  guint index;
   GstVideoFrame *out_frame;
   guint dst_line_start;
   guint dst_line_end;
   gboolean draw_background;
   guint n_pads;
   struct CompositePadInfo *pads_info;
+  /* With damage tracking, the previous output frame and the lines that
+   * changed since then, or %NULL if all of them did */
+  GstVideoFrame *ref_frame;
+  GArray *damage;
 };
 
+static void
+_copy_lines (GstVideoFrame * dest, const GstVideoFrame * src, guint y_start,
+    guint y_end)
+{
+  const GstVideoFormatInfo *info = dest->info.finfo;
+  guint plane;
+
+  for (plane = 0; plane < GST_VIDEO_FRAME_N_PLANES (dest); plane++) {
+    gint comp[GST_VIDEO_MAX_COMPONENTS];
+    const guint8 *s;
+    guint8 *d;
+    gint i, start, end, s_stride, d_stride;
+    gsize rowsize;
+
+    gst_video_format_info_component (info, plane, comp);
+
+    start = GST_VIDEO_FORMAT_INFO_SCALE_HEIGHT (info, comp[0], y_start);
+    end = GST_VIDEO_FORMAT_INFO_SCALE_HEIGHT (info, comp[0], y_end);
+    rowsize = GST_VIDEO_FRAME_COMP_WIDTH (dest, comp[0])
+        * GST_VIDEO_FRAME_COMP_PSTRIDE (dest, comp[0]);
+    s_stride = GST_VIDEO_FRAME_PLANE_STRIDE (src, plane);
+    d_stride = GST_VIDEO_FRAME_PLANE_STRIDE (dest, plane);
+
+    s = (const guint8 *) GST_VIDEO_FRAME_PLANE_DATA (src, plane) +
+        start * s_stride;
+    d = (guint8 *) GST_VIDEO_FRAME_PLANE_DATA (dest, plane) + start * d_stride;
+
+    for (i = start; i < end; i++) {
+      memcpy (d, s, rowsize);
+      s += s_stride;
+      d += d_stride;
+    }
+  }
+}
+
 static void
 _draw_background (GstCompositor * comp, GstVideoFrame * outframe,
     guint y_start, guint y_end, BlendFunction * composite)
@@ -1149,8 +1503,67 @@ _draw_background (GstCompositor * comp, GstVideoFrame * outframe,
   }
 }
 
+/* Scales the lines of @pad_info that end up between @y_start and @y_end in
+ * strips of SCALE_LINES and blends each strip while it is still in the
+ * cache */
 static void
-blend_pads (struct CompositeTask *comp)
+blend_scaled_pad (struct CompositeTask *comp,
+    struct CompositePadInfo *pad_info, BlendFunction composite,
+    guint y_start, guint y_end)
+{
+  GstCompositorPad *cpad = pad_info->pad;
+  GstVideoFrame *srcframe = pad_info->prepared_frame;
+  GstCompositorScaler *scaler = &cpad->scalers[comp->index];
+  GstVideoFormat format = GST_VIDEO_FRAME_FORMAT (srcframe);
+  const GstVideoFormatInfo *finfo = srcframe->info.finfo;
+  gint align = 1, start, end, y;
+  guint i, plane;
+
+  for (i = 0; i < GST_VIDEO_FRAME_N_COMPONENTS (srcframe); i++)
+    align = MAX (align, 1 << GST_VIDEO_FORMAT_INFO_H_SUB (finfo, i));
+
+  /* Start a bit earlier as the blend functions round the position to the
+   * chroma subsampling, and keep the strips aligned to it */
+  start = MAX ((gint) y_start - cpad->ypos - align, 0);
+  start = start / align * align;
+  end = MIN ((gint) y_end - cpad->ypos, cpad->scale_height);
+
+  for (y = start; y < end; y += SCALE_LINES) {
+    GstVideoInfo lines_info;
+    GstVideoFrame lines;
+
+    gst_video_info_set_format (&lines_info, format, cpad->scale_width,
+        MIN (SCALE_LINES, end - y));
+    if (!gst_video_frame_map (&lines, &lines_info, scaler->lines,
+            GST_MAP_READWRITE)) {
+      GST_WARNING_OBJECT (cpad, "Could not map scaled lines");
+      return;
+    }
+
+    for (plane = 0; plane < GST_VIDEO_FRAME_N_PLANES (srcframe); plane++) {
+      gint line = GST_VIDEO_FORMAT_INFO_SCALE_HEIGHT (finfo, plane, y);
+      gint stride = GST_VIDEO_FRAME_PLANE_STRIDE (&lines, plane);
+      guint8 *dest = GST_VIDEO_FRAME_PLANE_DATA (&lines, plane);
+
+      /* The scaler writes output line N at @dest + N * stride */
+      gst_video_scaler_2d (scaler->h_scaler[plane], scaler->v_scaler[plane],
+          _get_scale_format (format, plane),
+          GST_VIDEO_FRAME_PLANE_DATA (srcframe, plane),
+          GST_VIDEO_FRAME_PLANE_STRIDE (srcframe, plane),
+          dest - line * stride, stride, 0, line,
+          GST_VIDEO_FRAME_COMP_WIDTH (&lines, plane),
+          line + GST_VIDEO_FRAME_COMP_HEIGHT (&lines, plane));
+    }
+
+    composite (&lines, cpad->xpos, cpad->ypos + y, cpad->alpha,
+        comp->out_frame, y_start, y_end, pad_info->blend_mode);
+
+    gst_video_frame_unmap (&lines);
+  }
+}
+
+static void
+blend_lines (struct CompositeTask *comp, guint y_start, guint y_end)
 {
   BlendFunction composite;
   guint i;
@@ -1158,16 +1571,293 @@ blend_pads (struct CompositeTask *comp)
   composite = comp->compositor->blend;
 
   if (comp->draw_background) {
-    _draw_background (comp->compositor, comp->out_frame, comp->dst_line_start,
-        comp->dst_line_end, &composite);
+    _draw_background (comp->compositor, comp->out_frame, y_start, y_end,
+        &composite);
   }
 
   for (i = 0; i < comp->n_pads; i++) {
+    if (comp->pads_info[i].pad->scale_on_blend) {
+      blend_scaled_pad (comp, &comp->pads_info[i], composite, y_start, y_end);
+      continue;
+    }
+
     composite (comp->pads_info[i].prepared_frame,
         comp->pads_info[i].pad->xpos, comp->pads_info[i].pad->ypos,
-        comp->pads_info[i].pad->alpha, comp->out_frame, comp->dst_line_start,
-        comp->dst_line_end, comp->pads_info[i].blend_mode);
+        comp->pads_info[i].pad->alpha, comp->out_frame, y_start, y_end,
+        comp->pads_info[i].blend_mode);
+  }
+}
+
+static void
+blend_pads (struct CompositeTask *comp)
+{
+  guint i, y;
+
+  if (comp->ref_frame == NULL) {
+    blend_lines (comp, comp->dst_line_start, comp->dst_line_end);
+    return;
+  }
+
+  if (comp->damage == NULL) {
+    blend_lines (comp, comp->dst_line_start, comp->dst_line_end);
+    _copy_lines (comp->ref_frame, comp->out_frame, comp->dst_line_start,
+        comp->dst_line_end);
+    return;
+  }
+
+  /* Only blend the damaged lines again, all others are the same as in the
+   * previous output frame */
+  y = comp->dst_line_start;
+  for (i = 0; i < comp->damage->len; i++) {
+    const struct DamagedLines *lines =
+        &g_array_index (comp->damage, struct DamagedLines, i);
+    guint start = MAX (lines->start, y);
+    guint end = MIN (lines->end, comp->dst_line_end);
+
+    if (start >= end)
+      continue;
+
+    if (y < start)
+      _copy_lines (comp->out_frame, comp->ref_frame, y, start);
+    blend_lines (comp, start, end);
+    _copy_lines (comp->ref_frame, comp->out_frame, start, end);
+    y = end;
+  }
+
+  if (y < comp->dst_line_end)
+    _copy_lines (comp->out_frame, comp->ref_frame, y, comp->dst_line_end);
+}
+
+/* Number of bands each blend thread gets on average */
+#define BANDS_PER_THREAD 4
+
+struct CompositeWorker
+{
+  guint index;
+  struct CompositeTask *tasks;
+  guint n_tasks;
+  gint *next_task;
+};
+
+static void
+blend_worker (struct CompositeWorker *worker)
+{
+  gint i;
+
+  while ((i = g_atomic_int_add (worker->next_task, 1)) <
+      (gint) worker->n_tasks) {
+    worker->tasks[i].index = worker->index;
+    blend_pads (&worker->tasks[i]);
+  }
+}
+
+/* Rough estimate of what blending one pixel of @pad_info costs compared to
+ * filling one pixel of background */
+static guint
+_pad_blend_cost (struct CompositePadInfo *pad_info)
+{
+  if (pad_info->pad->scale_on_blend)
+    return 4;
+  if (pad_info->pad->alpha == 1.0
+      && !GST_VIDEO_INFO_HAS_ALPHA (&pad_info->prepared_frame->info))
+    return 1;
+  return 2;
+}
+
+/* Splits the lines of @outframe into at most @n_bands bands of multiples of
+ * @align lines that take about the same time to blend, based on the area the
+ * pads cover in each of them. Sets the lines of the bands in @tasks and
+ * returns the number of bands. */
+static guint
+_split_bands (GstVideoFrame * outframe, gboolean draw_background,
+    struct CompositePadInfo *pads_info, guint n_pads, guint align,
+    guint n_bands, struct CompositeTask *tasks)
+{
+  gint out_width = GST_VIDEO_FRAME_WIDTH (outframe);
+  gint out_height = GST_VIDEO_FRAME_HEIGHT (outframe);
+  guint n_units = (out_height + align - 1) / align;
+  gint64 *cost;
+  guint64 total = 0, acc = 0;
+  guint i, u, band, start;
+
+  n_bands = MAX (MIN (n_bands, n_units), 1);
+  if (n_bands == 1) {
+    tasks[0].dst_line_start = 0;
+    tasks[0].dst_line_end = out_height;
+    return 1;
+  }
+
+  /* Cost per @align lines, first as differences to the previous lines */
+  cost = g_new0 (gint64, n_units + 1);
+  cost[0] = draw_background ? out_width : 0;
+
+  for (i = 0; i < n_pads; i++) {
+    GstCompositorPad *cpad = pads_info[i].pad;
+    GstVideoFrame *frame = pads_info[i].prepared_frame;
+    GstVideoRectangle rect;
+    gint width = GST_VIDEO_FRAME_WIDTH (frame);
+    gint height = GST_VIDEO_FRAME_HEIGHT (frame);
+    gint64 pad_cost;
+
+    if (cpad->scale_on_blend) {
+      width = cpad->scale_width;
+      height = cpad->scale_height;
+    }
+
+    rect = clamp_rectangle (cpad->xpos, cpad->ypos, width, height,
+        out_width, out_height);
+    if (rect.w == 0 || rect.h == 0)
+      continue;
+
+    pad_cost = (gint64) rect.w * _pad_blend_cost (&pads_info[i]);
+    cost[rect.y / align] += pad_cost;
+    cost[(rect.y + rect.h + align - 1) / align] -= pad_cost;
   }
+
+  for (u = 0; u < n_units; u++) {
+    if (u > 0)
+      cost[u] += cost[u - 1];
+    total += cost[u];
+  }
+
+  /* Nothing to draw, split evenly */
+  if (total == 0) {
+    for (u = 0; u < n_units; u++)
+      cost[u] = 1;
+    total = n_units;
+  }
+
+  for (u = 0, band = 0, start = 0; u < n_units && band < n_bands - 1; u++) {
+    acc += cost[u];
+
+    /* Close the band once it has its share of the total cost, or if every
+     * following band only gets one unit of lines anyway */
+    if (acc * n_bands >= (band + 1) * total
+        || n_units - u - 1 == n_bands - band - 1) {
+      tasks[band].dst_line_start = start * align;
+      tasks[band].dst_line_end = MIN ((u + 1) * align, out_height);
+      start = u + 1;
+      band++;
+    }
+  }
+
+  tasks[band].dst_line_start = start * align;
+  tasks[band].dst_line_end = out_height;
+
+  g_free (cost);
+
+  return band + 1;
+}
+
+static gint
+_damaged_lines_compare (const struct DamagedLines *a,
+    const struct DamagedLines *b)
+{
+  return (gint) a->start - (gint) b->start;
+}
+
+/* Call this with the lock taken. Returns the sorted and merged ranges of
+ * output lines whose inputs changed since the previous output frame, or
+ * %NULL if the whole frame has to be drawn again. */
+static GArray *
+_compute_damage (GstCompositor * self, GstVideoFrame * outframe)
+{
+  GstVideoAggregator *vagg = GST_VIDEO_AGGREGATOR (self);
+  const GstVideoFormatInfo *info = outframe->info.finfo;
+  gint out_width = GST_VIDEO_FRAME_WIDTH (outframe);
+  gint out_height = GST_VIDEO_FRAME_HEIGHT (outframe);
+  GArray *rects, *damage;
+  guint i, j, v_sub = 0;
+  gint index = 0;
+  GList *l;
+
+  rects = g_array_new (FALSE, FALSE, sizeof (GstVideoRectangle));
+
+  for (l = GST_ELEMENT (vagg)->sinkpads; l; l = l->next, index++) {
+    GstVideoAggregatorPad *pad = l->data;
+    GstCompositorPad *cpad = GST_COMPOSITOR_PAD (pad);
+    GstVideoFrame *prepared_frame =
+        gst_video_aggregator_pad_get_prepared_frame (pad);
+    GstBuffer *buffer = NULL;
+    GstVideoRectangle rect = { 0, 0, 0, 0 };
+
+    if (prepared_frame) {
+      gint width = GST_VIDEO_FRAME_WIDTH (prepared_frame);
+      gint height = GST_VIDEO_FRAME_HEIGHT (prepared_frame);
+
+      if (cpad->scale_on_blend) {
+        width = cpad->scale_width;
+        height = cpad->scale_height;
+      }
+
+      buffer = gst_video_aggregator_pad_get_current_buffer (pad);
+      rect = clamp_rectangle (cpad->xpos, cpad->ypos, width, height,
+          out_width, out_height);
+    }
+
+    if (buffer == cpad->damage_buffer && cpad->alpha == cpad->damage_alpha
+        && cpad->op == cpad->damage_op && index == cpad->damage_index
+        && rect.x == cpad->damage_rect.x && rect.y == cpad->damage_rect.y
+        && rect.w == cpad->damage_rect.w && rect.h == cpad->damage_rect.h)
+      continue;
+
+    /* Both where the pad was drawn before and where it's drawn now */
+    g_array_append_val (rects, cpad->damage_rect);
+    g_array_append_val (rects, rect);
+
+    gst_buffer_replace (&cpad->damage_buffer, buffer);
+    cpad->damage_rect = rect;
+    cpad->damage_alpha = cpad->alpha;
+    cpad->damage_op = cpad->op;
+    cpad->damage_index = index;
+  }
+
+  if (self->full_damage) {
+    self->full_damage = FALSE;
+    g_array_free (rects, TRUE);
+    return NULL;
+  }
+
+  /* Don't split up lines sharing the same subsampled chroma */
+  for (i = 0; i < GST_VIDEO_FORMAT_INFO_N_COMPONENTS (info); i++)
+    v_sub = MAX (v_sub, GST_VIDEO_FORMAT_INFO_H_SUB (info, i));
+
+  damage = g_array_new (FALSE, FALSE, sizeof (struct DamagedLines));
+  for (i = 0; i < rects->len; i++) {
+    const GstVideoRectangle *rect = &g_array_index (rects, GstVideoRectangle,
+        i);
+    struct DamagedLines lines;
+
+    if (rect->w <= 0 || rect->h <= 0)
+      continue;
+
+    lines.start = (rect->y >> v_sub) << v_sub;
+    lines.end = MIN (GST_ROUND_UP_N (rect->y + rect->h, 1 << v_sub),
+        out_height);
+    g_array_append_val (damage, lines);
+  }
+  g_array_free (rects, TRUE);
+
+  g_array_sort (damage, (GCompareFunc) _damaged_lines_compare);
+
+  /* merge overlapping and adjacent ranges */
+  for (i = 1, j = 0; i < damage->len; i++) {
+    struct DamagedLines *prev = &g_array_index (damage, struct DamagedLines, j);
+    struct DamagedLines *cur = &g_array_index (damage, struct DamagedLines, i);
+
+    if (cur->start <= prev->end) {
+      prev->end = MAX (prev->end, cur->end);
+    } else {
+      j++;
+      g_array_index (damage, struct DamagedLines, j) = *cur;
+    }
+  }
+  if (damage->len > 0)
+    g_array_set_size (damage, j + 1);
+
+  GST_LOG_OBJECT (self, "%u damaged line ranges", damage->len);
+
+  return damage;
 }
 
 static GstFlowReturn
@@ -1176,10 +1866,13 @@ gst_compositor_aggregate_frames (GstVideoAggregator * vagg, GstBuffer * outbuf)
   GstCompositor *compositor = GST_COMPOSITOR (vagg);
   GList *l;
   GstVideoFrame out_frame, *outframe;
+  GstVideoFrame ref_frame, *refframe = NULL;
+  GArray *damage = NULL;
   gboolean draw_background;
   guint drawn_a_pad = FALSE;
   struct CompositePadInfo *pads_info;
-  guint i, n_pads = 0;
+  GstVideoRectangle *occluders, bg_rect;
+  guint i, n_pads = 0, n_occluders = 0;
 
   if (!gst_video_frame_map (&out_frame, &vagg->info, outbuf, GST_MAP_WRITE)) {
     GST_WARNING_OBJECT (vagg, "Could not map output buffer");
@@ -1188,20 +1881,48 @@ gst_compositor_aggregate_frames (GstVideoAggregator * vagg, GstBuffer * outbuf)
 
   outframe = &out_frame;
 
-  /* If one of the frames to be composited completely obscures the background,
-   * don't bother drawing the background at all. We can also always use the
-   * 'blend' BlendFunction in that case because it only changes if we have to
-   * overlay on top of a transparent background. */
-  draw_background = _should_draw_background (vagg);
-
   GST_OBJECT_LOCK (vagg);
+  occluders = g_newa (GstVideoRectangle, GST_ELEMENT (vagg)->numsinkpads);
   for (l = GST_ELEMENT (vagg)->sinkpads; l; l = l->next) {
     GstVideoAggregatorPad *pad = l->data;
     GstVideoFrame *prepared_frame =
         gst_video_aggregator_pad_get_prepared_frame (pad);
 
-    if (prepared_frame)
+    if (prepared_frame) {
       n_pads++;
+      if (_pad_get_opaque_rectangle (vagg, pad, &occluders[n_occluders]))
+        n_occluders++;
+    }
+  }
+
+  /* If the frames to be composited completely obscure the background, don't
+   * bother drawing the background at all. We can also always use the
+   * 'blend' BlendFunction in that case because it only changes if we have to
+   * overlay on top of a transparent background. */
+  bg_rect.x = bg_rect.y = 0;
+  bg_rect.w = GST_VIDEO_FRAME_WIDTH (outframe);
+  bg_rect.h = GST_VIDEO_FRAME_HEIGHT (outframe);
+  draw_background = !_rectangle_is_covered (bg_rect, occluders, n_occluders);
+
+  if (compositor->damage_tracking) {
+    if (!compositor->damage_ref) {
+      compositor->damage_ref = gst_buffer_new_allocate (NULL,
+          GST_VIDEO_INFO_SIZE (&vagg->info), NULL);
+      compositor->full_damage = TRUE;
+    }
+
+    if (gst_video_frame_map (&ref_frame, &vagg->info, compositor->damage_ref,
+            GST_MAP_READWRITE)) {
+      refframe = &ref_frame;
+      damage = _compute_damage (compositor, outframe);
+    } else {
+      GST_WARNING_OBJECT (vagg, "Could not map previous output frame");
+    }
+  } else {
+    /* Don't keep any input buffers alive while not tracking */
+    gst_buffer_replace (&compositor->damage_ref, NULL);
+    for (l = GST_ELEMENT (vagg)->sinkpads; l; l = l->next)
+      gst_buffer_replace (&GST_COMPOSITOR_PAD (l->data)->damage_buffer, NULL);
   }
 
   pads_info = g_newa (struct CompositePadInfo, n_pads);
@@ -1234,10 +1955,12 @@ gst_compositor_aggregate_frames (GstVideoAggregator * vagg, GstBuffer * outbuf)
        * background, and @prepared_frame has the same format, height, and width
        * as @outframe, then we can just copy it as-is. Subsequent pads (if any)
        * will be composited on top of it. */
-      if (!drawn_a_pad && !draw_background &&
+      if (!drawn_a_pad && !draw_background && !compo_pad->scale_on_blend &&
           frames_can_copy (prepared_frame, outframe)) {
         gst_video_frame_copy (outframe, prepared_frame);
       } else {
+        if (compo_pad->scale_on_blend)
+          _pad_ensure_scalers (compo_pad, compositor->blend_runner->n_threads);
         pads_info[n_pads].pad = compo_pad;
         pads_info[n_pads].prepared_frame = prepared_frame;
         pads_info[n_pads].blend_mode = blend_mode;
@@ -1248,41 +1971,76 @@ gst_compositor_aggregate_frames (GstVideoAggregator * vagg, GstBuffer * outbuf)
   }
 
   {
-    guint n_threads, lines_per_thread;
-    guint out_height;
+    guint n_threads, n_bands, v_sub = 0;
+    gint next_band = 0;
     struct CompositeTask *tasks;
-    struct CompositeTask **tasks_p;
+    struct CompositeWorker *workers;
+    struct CompositeWorker **workers_p;
 
     n_threads = compositor->blend_runner->n_threads;
 
-    tasks = g_newa (struct CompositeTask, n_threads);
-    tasks_p = g_newa (struct CompositeTask *, n_threads);
+    /* Keep lines sharing the same subsampled chroma in one band */
+    for (i = 0; i < GST_VIDEO_FRAME_N_COMPONENTS (outframe); i++)
+      v_sub = MAX (v_sub, GST_VIDEO_FORMAT_INFO_H_SUB (outframe->info.finfo,
+              i));
 
-    out_height = GST_VIDEO_FRAME_HEIGHT (outframe);
-    lines_per_thread = (out_height + n_threads - 1) / n_threads;
+    /* Split into more bands than threads, and let each thread pick the next
+     * band once it's done with the previous one, so that threads getting the
+     * cheaper bands don't have to wait for the others at the end */
+    n_bands = n_threads > 1 ? n_threads * BANDS_PER_THREAD : 1;
+    tasks = g_newa (struct CompositeTask, n_bands);
+    n_bands = _split_bands (outframe, draw_background, pads_info, n_pads,
+        1 << v_sub, n_bands, tasks);
 
-    for (i = 0; i < n_threads; i++) {
+    GST_LOG_OBJECT (vagg, "Blending %u bands with %u threads", n_bands,
+        n_threads);
+
+    for (i = 0; i < n_bands; i++) {
       tasks[i].compositor = compositor;
+      tasks[i].index = 0;
       tasks[i].n_pads = n_pads;
       tasks[i].pads_info = pads_info;
       tasks[i].out_frame = outframe;
+      tasks[i].ref_frame = refframe;
+      tasks[i].damage = damage;
+
+      /* Opaque pads might still cover all lines of this band */
       tasks[i].draw_background = draw_background;
-      /* This is a dumb split of the work by number of output lines.
-       * If there is a section of the output that reads from a lot of source
-       * pads, then that thread will consume more time. Maybe tracking and
-       * splitting on the source fill rate would produce better results. */
-      tasks[i].dst_line_start = i * lines_per_thread;
-      tasks[i].dst_line_end = MIN ((i + 1) * lines_per_thread, out_height);
-
-      tasks_p[i] = &tasks[i];
+      if (draw_background && n_occluders > 0) {
+        GstVideoRectangle band_rect;
+
+        band_rect.x = 0;
+        band_rect.y = tasks[i].dst_line_start;
+        band_rect.w = GST_VIDEO_FRAME_WIDTH (outframe);
+        band_rect.h = tasks[i].dst_line_end - tasks[i].dst_line_start;
+        tasks[i].draw_background =
+            !_rectangle_is_covered (band_rect, occluders, n_occluders);
+      }
+    }
+
+    workers = g_newa (struct CompositeWorker, n_threads);
+    workers_p = g_newa (struct CompositeWorker *, n_threads);
+
+    for (i = 0; i < n_threads; i++) {
+      workers[i].index = i;
+      workers[i].tasks = tasks;
+      workers[i].n_tasks = n_bands;
+      workers[i].next_task = &next_band;
+
+      workers_p[i] = &workers[i];
     }
 
     gst_parallelized_task_runner_run (compositor->blend_runner,
-        (GstParallelizedTaskFunc) blend_pads, (gpointer *) tasks_p);
+        (GstParallelizedTaskFunc) blend_worker, (gpointer *) workers_p);
   }
 
   GST_OBJECT_UNLOCK (vagg);
 
+  if (damage)
+    g_array_free (damage, TRUE);
+  if (refframe)
+    gst_video_frame_unmap (refframe);
+
   gst_video_frame_unmap (outframe);
 
   return GST_FLOW_OK;
@@ -1322,6 +2080,11 @@ gst_compositor_release_pad (GstElement * element, GstPad * pad)
 
   GST_DEBUG_OBJECT (compositor, "release pad %s:%s", GST_DEBUG_PAD_NAME (pad));
 
+  /* What was below the pad has to be drawn again */
+  GST_OBJECT_LOCK (compositor);
+  compositor->full_damage = TRUE;
+  GST_OBJECT_UNLOCK (compositor);
+
   gst_child_proxy_child_removed (GST_CHILD_PROXY (compositor), G_OBJECT (pad),
       GST_OBJECT_NAME (pad));
 
@@ -1379,6 +2142,8 @@ gst_compositor_finalize (GObject * object)
     gst_parallelized_task_runner_free (compositor->blend_runner);
   compositor->blend_runner = NULL;
 
+  gst_buffer_replace (&compositor->damage_ref, NULL);
+
   G_OBJECT_CLASS (parent_class)->finalize (object);
 }
 
@@ -1426,6 +2191,21 @@ gst_compositor_class_init (GstCompositorClass * klass)
           DEFAULT_ZERO_SIZE_IS_UNSCALED,
           G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
+  /**
+   * compositor:damage-tracking:
+   *
+   * Keep a copy of the previous output frame and only blend the lines again
+   * whose inputs changed, i.e. where a pad got a new buffer or was moved,
+   * resized or restacked. Useful when most inputs are static or repeated.
+   *
+   * Since: 1.20
+   */
+  g_object_class_install_property (gobject_class, PROP_DAMAGE_TRACKING,
+      g_param_spec_boolean ("damage-tracking", "Damage tracking",
+          "Only redraw the parts of the output whose inputs changed since "
+          "the previous output frame", DEFAULT_DAMAGE_TRACKING,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
   gst_element_class_add_static_pad_template_with_gtype (gstelement_class,
       &src_factory, GST_TYPE_AGGREGATOR_PAD);
   gst_element_class_add_static_pad_template_with_gtype (gstelement_class,
@@ -1447,6 +2227,7 @@ gst_compositor_init (GstCompositor * self)
   /* initialize variables */
   self->background = DEFAULT_BACKGROUND;
   self->zero_size_is_unscaled = DEFAULT_ZERO_SIZE_IS_UNSCALED;
+  self->damage_tracking = DEFAULT_DAMAGE_TRACKING;
 }
 
 /* GstChildProxy implementation */
@@ -24,6 +24,7 @@
 #include <gst/gst.h>
 #include <gst/video/video.h>
 #include <gst/video/gstvideoaggregator.h>
+#include <gst/base/gstqueuearray.h>
 
 #include "blend.h"
 
@@ -80,28 +81,20 @@ typedef enum
 typedef void (*GstParallelizedTaskFunc) (gpointer user_data);
 
 typedef struct _GstParallelizedTaskRunner GstParallelizedTaskRunner;
-typedef struct _GstParallelizedTaskThread GstParallelizedTaskThread;
-
-struct _GstParallelizedTaskThread
-{
-  GstParallelizedTaskRunner *runner;
-  guint idx;
-  GThread *thread;
-};
+typedef struct _GstCompositorScaler GstCompositorScaler;
 
 struct _GstParallelizedTaskRunner
 {
+  GstTaskPool *pool;
   guint n_threads;
 
-  GstParallelizedTaskThread *threads;
+  GstQueueArray *tasks;
 
   GstParallelizedTaskFunc func;
   gpointer *task_data;
 
   GMutex lock;
-  GCond cond_todo, cond_done;
-  gint n_todo, n_done;
-  gboolean quit;
+  gint n_todo;
 };
 
 /**
@@ -130,6 +123,12 @@ struct _GstCompositor
   FillColorFunction fill_color;
 
   GstParallelizedTaskRunner *blend_runner;
+
+  /* Damage tracking: copy of the previous output frame, only the lines whose
+   * inputs changed are blended again */
+  gboolean damage_tracking;
+  GstBuffer *damage_ref;
+  gboolean full_damage;
 };
 
 /**
@@ -147,6 +146,24 @@ struct _GstCompositorPad
   gdouble alpha;
 
   GstCompositorOperator op;
+
+  /* what was drawn for this pad in the previous output frame, for damage
+   * tracking */
+  GstBuffer *damage_buffer;
+  GstVideoRectangle damage_rect;
+  gdouble damage_alpha;
+  GstCompositorOperator damage_op;
+  gint damage_index;
+
+  /* If the input only needs to be scaled, the prepared frame is the unscaled
+   * input frame and it is scaled in strips of lines while blending, with one
+   * set of scalers per blend thread */
+  gboolean scale_on_blend;
+  gint scale_width, scale_height;
+  GstVideoInfo scale_info;
+  GstStructure *scale_config;
+  GstCompositorScaler *scalers;
+  guint n_scalers;
 };
 
 G_END_DECLS
@@ -685,7 +685,7 @@ gst_multi_fd_sink_handle_client_write (GstMultiFdSink * sink,
 
     if (!mhclient->sending) {
       /* client is not working on a buffer */
-      if (mhclient->bufpos == -1) {
+      if (CLIENT_BUFPOS (mhsink, mhclient) == -1) {
         /* client is too fast, remove from write queue until new buffer is
          * available */
         /* FIXME: specific */
@@ -710,9 +710,12 @@ gst_multi_fd_sink_handle_client_write (GstMultiFdSink * sink,
           if (position >= 0) {
             /* we got a valid spot in the queue */
             mhclient->new_connection = FALSE;
-            mhclient->bufpos = position;
+            gst_multi_handle_sink_client_set_bufpos (mhsink, mhclient,
+                position);
           } else {
-            /* cannot send data to this client yet */
+            /* cannot send data to this client yet, wait at the front of the
+             * queue so that the next buffer wakes it up again */
+            gst_multi_handle_sink_client_set_bufpos (mhsink, mhclient, -1);
             /* FIXME: specific */
             gst_poll_fd_ctl_write (sink->fdset, &client->gfd, FALSE);
             return TRUE;
@@ -724,8 +727,10 @@ gst_multi_fd_sink_handle_client_write (GstMultiFdSink * sink,
           goto flushed;
 
         /* grab buffer */
-        buf = g_array_index (mhsink->bufqueue, GstBuffer *, mhclient->bufpos);
-        mhclient->bufpos--;
+        buf = g_array_index (mhsink->bufqueue, GstBuffer *,
+            CLIENT_BUFPOS (mhsink, mhclient));
+        gst_multi_handle_sink_client_set_bufpos (mhsink, mhclient,
+            CLIENT_BUFPOS (mhsink, mhclient) - 1);
 
         /* update stats */
         timestamp = GST_BUFFER_TIMESTAMP (buf);
@@ -739,7 +744,7 @@ gst_multi_fd_sink_handle_client_write (GstMultiFdSink * sink,
           mhclient->flushcount--;
 
         GST_LOG_OBJECT (sink, "%s client %p at position %d",
-            mhclient->debug, client, mhclient->bufpos);
+            mhclient->debug, client, CLIENT_BUFPOS (mhsink, mhclient));
 
         /* queueing a buffer will ref it */
         mhsinkclass->client_queue_buffer (mhsink, mhclient, buf);
@@ -807,7 +812,7 @@ gst_multi_fd_sink_handle_client_write (GstMultiFdSink * sink,
         }
         /* update stats */
         mhclient->bytes_sent += wrote;
-        mhclient->last_activity_time = now;
+        gst_multi_handle_sink_client_set_activity (mhsink, mhclient, now);
         mhsink->bytes_served += wrote;
       }
     }
@@ -422,6 +422,9 @@ gst_multi_handle_sink_init (GstMultiHandleSink * this)
   CLIENTS_LOCK_INIT (this);
   this->clients = NULL;
 
+  this->clients_by_bufseq = g_sequence_new (NULL);
+  g_queue_init (&this->clients_by_activity);
+
   this->bufqueue = g_array_new (FALSE, TRUE, sizeof (GstBuffer *));
   this->unit_format = DEFAULT_UNIT_FORMAT;
   this->units_max = DEFAULT_UNITS_MAX;
@@ -452,6 +455,8 @@ gst_multi_handle_sink_finalize (GObject * object)
   CLIENTS_LOCK_CLEAR (this);
   g_array_free (this->bufqueue, TRUE);
   g_hash_table_destroy (this->handle_hash);
+  g_sequence_free (this->clients_by_bufseq);
+  gst_caps_replace (&this->caps, NULL);
 
   G_OBJECT_CLASS (parent_class)->finalize (object);
 }
@@ -528,7 +533,6 @@ gst_multi_handle_sink_client_init (GstMultiHandleClient * client,
     GstSyncMethod sync_method)
 {
   client->status = GST_CLIENT_STATUS_OK;
-  client->bufpos = -1;
   client->flushcount = -1;
   client->bufoffset = 0;
   client->sending = NULL;
@@ -548,6 +552,46 @@ gst_multi_handle_sink_client_init (GstMultiHandleClient * client,
   client->last_activity_time = client->connect_time;
 }
 
+static gint
+client_bufseq_compare (gconstpointer a, gconstpointer b, gpointer user_data)
+{
+  const GstMultiHandleClient *ca = a;
+  const GstMultiHandleClient *cb = b;
+
+  if (ca->bufseq < cb->bufseq)
+    return -1;
+  return ca->bufseq > cb->bufseq;
+}
+
+/* Move @client to position @bufpos in the global queue, -1 meaning after the
+ * newest buffer. Must be called with the clients lock held. */
+void
+gst_multi_handle_sink_client_set_bufpos (GstMultiHandleSink * sink,
+    GstMultiHandleClient * client, gint bufpos)
+{
+  client->bufseq = sink->bufqueue_seqnum - bufpos;
+
+  /* clients that are being removed are not sorted anymore */
+  if (client->bufseq_iter)
+    g_sequence_sort_changed (client->bufseq_iter, client_bufseq_compare, NULL);
+}
+
+/* Record activity on @client at @now. Must be called with the clients lock
+ * held. */
+void
+gst_multi_handle_sink_client_set_activity (GstMultiHandleSink * sink,
+    GstMultiHandleClient * client, GstClockTime now)
+{
+  client->last_activity_time = now;
+
+  /* the most recently active client goes last */
+  if (client->bufseq_iter) {
+    g_queue_unlink (&sink->clients_by_activity, &client->activity_link);
+    g_queue_push_tail_link (&sink->clients_by_activity,
+        &client->activity_link);
+  }
+}
+
 static void
 gst_multi_handle_sink_setup_dscp (GstMultiHandleSink * mhsink)
 {
@@ -614,6 +658,14 @@ gst_multi_handle_sink_add_full (GstMultiHandleSink * sink,
       mhsinkclass->handle_hash_key (mhclient->handle), clink);
   mhsink->clients_cookie++;
 
+  /* the client starts after the newest buffer, which sorts it last */
+  mhclient->bufseq = mhsink->bufqueue_seqnum + 1;
+  mhclient->bufseq_iter =
+      g_sequence_append (mhsink->clients_by_bufseq, mhclient);
+  mhclient->activity_link.data = mhclient;
+  g_queue_push_tail_link (&mhsink->clients_by_activity,
+      &mhclient->activity_link);
+
 
   mhclient->burst_min_format = min_format;
   mhclient->burst_min_value = min_value;
@@ -729,7 +781,7 @@ gst_multi_handle_sink_remove_flush (GstMultiHandleSink * sink,
     /* take the position of the client as the number of buffers left to flush.
      * If the client was at position -1, we flush 0 buffers, 0 == flush 1
      * buffer, etc... */
-    mhclient->flushcount = mhclient->bufpos + 1;
+    mhclient->flushcount = CLIENT_BUFPOS (mhsink, mhclient) + 1;
     /* mark client as flushing. We can not remove the client right away because
      * it might have some buffers to flush in the ->sending queue. */
     mhclient->status = GST_CLIENT_STATUS_FLUSHING;
@@ -856,6 +908,12 @@ gst_multi_handle_sink_remove_client_link (GstMultiHandleSink * sink,
     mhclient->currently_removing = TRUE;
   }
 
+  /* the client is not at a position in the queue anymore, so that the
+   * limit checks don't find it again */
+  g_sequence_remove (mhclient->bufseq_iter);
+  mhclient->bufseq_iter = NULL;
+  g_queue_unlink (&sink->clients_by_activity, &mhclient->activity_link);
+
   /* FIXME: if we keep track of ip we can log it here and signal */
   switch (mhclient->status) {
     case GST_CLIENT_STATUS_OK:
@@ -941,21 +999,19 @@ gst_multi_handle_sink_remove_client_link (GstMultiHandleSink * sink,
   CLIENTS_LOCK (sink);
 }
 
-static gboolean
-gst_multi_handle_sink_client_queue_buffer (GstMultiHandleSink * mhsink,
-    GstMultiHandleClient * mhclient, GstBuffer * buffer)
+/* Check if we need to queue streamheader buffers for @mhclient because it's
+ * a new client or because they changed in @caps. Must be called with the
+ * clients lock held. */
+void
+gst_multi_handle_sink_client_queue_caps (GstMultiHandleSink * mhsink,
+    GstMultiHandleClient * mhclient, GstCaps * caps)
 {
   GstMultiHandleSink *sink = GST_MULTI_HANDLE_SINK (mhsink);
-  GstCaps *caps;
 
   /* TRUE: send them if the new caps have them */
   gboolean send_streamheader = FALSE;
   GstStructure *s;
 
-  /* before we queue the buffer, we check if we need to queue streamheader
-   * buffers (because it's a new client, or because they changed) */
-  caps = gst_pad_get_current_caps (GST_BASE_SINK_PAD (sink));
-
   if (!mhclient->caps) {
     if (caps) {
       GST_DEBUG_OBJECT (sink,
@@ -1046,10 +1102,21 @@ gst_multi_handle_sink_client_queue_buffer (GstMultiHandleSink * mhsink,
       }
     }
   }
+}
 
+static gboolean
+gst_multi_handle_sink_client_queue_buffer (GstMultiHandleSink * mhsink,
+    GstMultiHandleClient * mhclient, GstBuffer * buffer)
+{
+  GstMultiHandleSink *sink = GST_MULTI_HANDLE_SINK (mhsink);
+  GstCaps *caps;
+
+  /* before we queue the buffer, we check if we need to queue streamheader
+   * buffers (because it's a new client, or because they changed) */
+  caps = gst_pad_get_current_caps (GST_BASE_SINK_PAD (sink));
+  gst_multi_handle_sink_client_queue_caps (mhsink, mhclient, caps);
   if (caps)
     gst_caps_unref (caps);
-  caps = NULL;
 
   GST_LOG_OBJECT (sink, "%s queueing buffer of length %" G_GSIZE_FORMAT,
       mhclient->debug, gst_buffer_get_size (buffer));
@@ -1345,7 +1412,7 @@ gst_multi_handle_sink_new_client_position (GstMultiHandleSink * sink,
   switch (client->sync_method) {
     case GST_SYNC_METHOD_LATEST:
       /* no syncing, we are happy with whatever the client is going to get */
-      result = client->bufpos;
+      result = CLIENT_BUFPOS (sink, client);
       GST_DEBUG_OBJECT (sink,
           "%s SYNC_METHOD_LATEST, position %d", client->debug, result);
       break;
@@ -1355,9 +1422,9 @@ gst_multi_handle_sink_new_client_position (GstMultiHandleSink * sink,
        * is a sync point, we can proceed, otherwise we need to keep waiting */
       GST_LOG_OBJECT (sink,
           "%s new client, bufpos %d, waiting for keyframe",
-          client->debug, client->bufpos);
+          client->debug, CLIENT_BUFPOS (sink, client));
 
-      result = find_prev_syncframe (sink, client->bufpos);
+      result = find_prev_syncframe (sink, CLIENT_BUFPOS (sink, client));
       if (result != -1) {
         GST_DEBUG_OBJECT (sink,
             "%s SYNC_METHOD_NEXT_KEYFRAME: result %d", client->debug, result);
@@ -1369,7 +1436,7 @@ gst_multi_handle_sink_new_client_position (GstMultiHandleSink * sink,
       GST_LOG_OBJECT (sink,
           "%s new client, skipping buffer(s), no syncpoint found",
           client->debug);
-      client->bufpos = -1;
+      gst_multi_handle_sink_client_set_bufpos (sink, client, -1);
       break;
     }
     case GST_SYNC_METHOD_LATEST_KEYFRAME:
@@ -1392,7 +1459,7 @@ gst_multi_handle_sink_new_client_position (GstMultiHandleSink * sink,
           "%s SYNC_METHOD_LATEST_KEYFRAME: no keyframe found, "
           "switching to SYNC_METHOD_NEXT_KEYFRAME", client->debug);
       /* throw client to the waiting state */
-      client->bufpos = -1;
+      gst_multi_handle_sink_client_set_bufpos (sink, client, -1);
       /* and make client sync to next keyframe */
       client->sync_method = GST_SYNC_METHOD_NEXT_KEYFRAME;
       break;
@@ -1467,7 +1534,7 @@ gst_multi_handle_sink_new_client_position (GstMultiHandleSink * sink,
           "no prev keyframe found in BURST_KEYFRAME sync mode, waiting for next");
 
       /* throw client to the waiting state */
-      client->bufpos = -1;
+      gst_multi_handle_sink_client_set_bufpos (sink, client, -1);
       /* and make client sync to next keyframe */
       client->sync_method = GST_SYNC_METHOD_NEXT_KEYFRAME;
       result = -1;
@@ -1514,7 +1581,7 @@ gst_multi_handle_sink_new_client_position (GstMultiHandleSink * sink,
     }
     default:
       g_warning ("unknown sync method %d", client->sync_method);
-      result = client->bufpos;
+      result = CLIENT_BUFPOS (sink, client);
       break;
   }
   return result;
@@ -1532,13 +1599,14 @@ gst_multi_handle_sink_recover_client (GstMultiHandleSink * sink,
 
   GST_WARNING_OBJECT (sink,
       "%s client %p is lagging at %d, recover using policy %d",
-      client->debug, client, client->bufpos, sink->recover_policy);
+      client->debug, client, CLIENT_BUFPOS (sink, client),
+      sink->recover_policy);
 
   switch (sink->recover_policy) {
     case GST_RECOVER_POLICY_NONE:
       /* do nothing, client will catch up or get kicked out when it reaches
        * the hard max */
-      newbufpos = client->bufpos;
+      newbufpos = CLIENT_BUFPOS (sink, client);
       break;
     case GST_RECOVER_POLICY_RESYNC_LATEST:
       /* move to beginning of queue */
@@ -1573,6 +1641,27 @@ gst_multi_handle_sink_recover_client (GstMultiHandleSink * sink,
   return newbufpos;
 }
 
+/* Remove @mhclient because it lags more than the hard max or was idle for
+ * longer than the timeout. Should be called with the clientslock held. */
+static void
+gst_multi_handle_sink_remove_slow_client (GstMultiHandleSink * sink,
+    GstMultiHandleClient * mhclient)
+{
+  GstMultiHandleSinkClass *mhsinkclass = GST_MULTI_HANDLE_SINK_GET_CLASS (sink);
+  GList *clink;
+
+  GST_WARNING_OBJECT (sink, "%s client %p is too slow, removing",
+      mhclient->debug, mhclient);
+  /* remove the client, the handle set will be cleared and the select thread
+   * will be signaled */
+  mhclient->status = GST_CLIENT_STATUS_SLOW;
+  /* set client to invalid position while being removed */
+  gst_multi_handle_sink_client_set_bufpos (sink, mhclient, -1);
+  clink = g_hash_table_lookup (sink->handle_hash,
+      mhsinkclass->handle_hash_key (mhclient->handle));
+  gst_multi_handle_sink_remove_client_link (sink, clink);
+}
+
 /* Queue a buffer on the global queue.
  *
  * This function adds the buffer to the front of a GArray. It removes the
@@ -1581,10 +1670,12 @@ gst_multi_handle_sink_recover_client (GstMultiHandleSink * sink,
  * started writing out this buffer will still have a reference to it in the
  * mhclient->sending queue.
  *
- * After adding the buffer, we update all client positions in the queue. If
- * a client moves over the soft max, we start the recovery procedure for this
- * slow client. If it goes over the hard max, it is put into the slow list
- * and removed.
+ * Adding the buffer moves all clients back by one position in the queue, as
+ * their position is derived from the sequence number of the newest buffer.
+ * The clients are kept sorted by position, so the cost of this function does
+ * not depend on the number of clients. If a client moves over the soft max,
+ * we start the recovery procedure for this slow client. If it goes over the
+ * hard max, it is put into the slow list and removed.
  *
  * Special care is taken of clients that were waiting for a new buffer (they
  * had a position of -1) because they can proceed after adding this new buffer.
@@ -1595,14 +1686,13 @@ static void
 gst_multi_handle_sink_queue_buffer (GstMultiHandleSink * mhsink,
     GstBuffer * buffer)
 {
-  GList *clients, *next;
+  GSequenceIter *iter;
   gint queuelen;
   gboolean hash_changed = FALSE;
   gint max_buffer_usage;
   gint i;
   GstClockTime now;
   gint max_buffers, soft_max_buffers;
-  guint cookie;
   GstMultiHandleSink *sink = GST_MULTI_HANDLE_SINK (mhsink);
   GstMultiHandleSinkClass *mhsinkclass =
       GST_MULTI_HANDLE_SINK_GET_CLASS (mhsink);
@@ -1610,8 +1700,14 @@ gst_multi_handle_sink_queue_buffer (GstMultiHandleSink * mhsink,
   CLIENTS_LOCK (mhsink);
   /* add buffer to queue */
   g_array_prepend_val (mhsink->bufqueue, buffer);
+  mhsink->bufqueue_seqnum++;
   queuelen = mhsink->bufqueue->len;
 
+  /* remember the caps of the queue so that the clients can check for
+   * streamheader changes without querying the pad for each buffer */
+  gst_caps_take (&mhsink->caps,
+      gst_pad_get_current_caps (GST_BASE_SINK_PAD (mhsink)));
+
   if (mhsink->units_max > 0)
     max_buffers = get_buffers_max (mhsink, mhsink->units_max);
   else
@@ -1624,75 +1720,103 @@ gst_multi_handle_sink_queue_buffer (GstMultiHandleSink * mhsink,
   GST_LOG_OBJECT (sink, "Using max %d, softmax %d", max_buffers,
       soft_max_buffers);
 
-  /* then loop over the clients and update the positions */
-  cookie = mhsink->clients_cookie;
-  for (clients = mhsink->clients; clients; clients = clients->next) {
-    GstMultiHandleClient *mhclient = clients->data;
+  /* the clients store the sequence number of the next buffer they send, so
+   * the new buffer moved all of them back by one position already. Only the
+   * clients at the ends of clients_by_bufseq need to be looked at: the ones
+   * that lag too much and the ones that were waiting for this buffer. */
+
+  /* check soft max if needed, recover clients. They are not moved with
+   * GST_RECOVER_POLICY_NONE. */
+  if (soft_max_buffers > 0
+      && mhsink->recover_policy != GST_RECOVER_POLICY_NONE) {
+    GSList *lagging = NULL, *walk;
+
+    /* collect them first, recovering reorders the sequence */
+    iter = g_sequence_get_begin_iter (mhsink->clients_by_bufseq);
+    for (; !g_sequence_iter_is_end (iter); iter = g_sequence_iter_next (iter)) {
+      GstMultiHandleClient *mhclient = g_sequence_get (iter);
 
-    mhclient->bufpos++;
-    GST_LOG_OBJECT (sink, "%s client %p at position %d",
-        mhclient->debug, mhclient, mhclient->bufpos);
+      if (CLIENT_BUFPOS (mhsink, mhclient) < soft_max_buffers)
+        break;
+      lagging = g_slist_prepend (lagging, mhclient);
+    }
 
-    /* check soft max if needed, recover client */
-    if (soft_max_buffers > 0 && mhclient->bufpos >= soft_max_buffers) {
+    for (walk = lagging; walk; walk = walk->next) {
+      GstMultiHandleClient *mhclient = walk->data;
+      gint bufpos = CLIENT_BUFPOS (mhsink, mhclient);
       gint newpos;
 
       newpos = gst_multi_handle_sink_recover_client (mhsink, mhclient);
-      if (newpos != mhclient->bufpos) {
-        mhclient->dropped_buffers += mhclient->bufpos - newpos;
-        mhclient->bufpos = newpos;
+      if (newpos != bufpos) {
+        mhclient->dropped_buffers += bufpos - newpos;
+        gst_multi_handle_sink_client_set_bufpos (mhsink, mhclient, newpos);
         mhclient->discont = TRUE;
         GST_INFO_OBJECT (sink, "%s client %p position reset to %d",
-            mhclient->debug, mhclient, mhclient->bufpos);
+            mhclient->debug, mhclient, newpos);
       } else {
         GST_INFO_OBJECT (sink,
             "%s client %p not recovering position", mhclient->debug, mhclient);
       }
     }
+    g_slist_free (lagging);
   }
 
-  max_buffer_usage = 0;
   now = g_get_real_time () * GST_USECOND;
 
-  /* now check for new or slow clients */
-restart:
-  cookie = mhsink->clients_cookie;
-  for (clients = mhsink->clients; clients; clients = next) {
-    GstMultiHandleClient *mhclient = clients->data;
+  /* check hard max and timeout, remove clients. Removing a client takes it
+   * out of both sorted collections, so we look at the first one until it is
+   * within the limits. */
+  while (max_buffers > 0) {
+    GstMultiHandleClient *mhclient;
 
-    if (cookie != mhsink->clients_cookie) {
-      GST_DEBUG_OBJECT (sink, "Clients cookie outdated, restarting");
-      goto restart;
-    }
+    iter = g_sequence_get_begin_iter (mhsink->clients_by_bufseq);
+    if (g_sequence_iter_is_end (iter))
+      break;
 
-    next = g_list_next (clients);
+    mhclient = g_sequence_get (iter);
+    if (CLIENT_BUFPOS (mhsink, mhclient) < max_buffers)
+      break;
 
-    /* check hard max and timeout, remove client */
-    if ((max_buffers > 0 && mhclient->bufpos >= max_buffers) ||
-        (mhsink->timeout > 0
-            && now - mhclient->last_activity_time > mhsink->timeout)) {
-      /* remove client */
-      GST_WARNING_OBJECT (sink, "%s client %p is too slow, removing",
-          mhclient->debug, mhclient);
-      /* remove the client, the handle set will be cleared and the select thread
-       * will be signaled */
-      mhclient->status = GST_CLIENT_STATUS_SLOW;
-      /* set client to invalid position while being removed */
-      mhclient->bufpos = -1;
-      gst_multi_handle_sink_remove_client_link (mhsink, clients);
-      hash_changed = TRUE;
-      continue;
-    } else if (mhclient->bufpos == 0 || mhclient->new_connection) {
-      /* can send data to this client now. need to signal the select thread that
-       * the handle_set changed */
-      mhsinkclass->hash_adding (mhsink, mhclient);
-      hash_changed = TRUE;
-    }
+    gst_multi_handle_sink_remove_slow_client (mhsink, mhclient);
+    hash_changed = TRUE;
+  }
+  while (mhsink->timeout > 0) {
+    GstMultiHandleClient *mhclient;
 
-    /* keep track of maximum buffer usage */
-    if (mhclient->bufpos > max_buffer_usage) {
-      max_buffer_usage = mhclient->bufpos;
-    }
+    if (g_queue_is_empty (&mhsink->clients_by_activity))
+      break;
+
+    mhclient = g_queue_peek_head (&mhsink->clients_by_activity);
+    if (now - mhclient->last_activity_time <= mhsink->timeout)
+      break;
+
+    gst_multi_handle_sink_remove_slow_client (mhsink, mhclient);
+    hash_changed = TRUE;
+  }
+
+  /* the clients that were waiting for a new buffer, at the end of the
+   * sequence, can send data now. need to signal the select thread that the
+   * handle_set changed */
+  iter = g_sequence_get_end_iter (mhsink->clients_by_bufseq);
+  while (!g_sequence_iter_is_begin (iter)) {
+    GstMultiHandleClient *mhclient;
+
+    iter = g_sequence_iter_prev (iter);
+    mhclient = g_sequence_get (iter);
+    if (CLIENT_BUFPOS (mhsink, mhclient) != 0)
+      break;
+
+    mhsinkclass->hash_adding (mhsink, mhclient);
+    hash_changed = TRUE;
+  }
+
+  /* keep track of maximum buffer usage, the first client lags the most */
+  max_buffer_usage = 0;
+  iter = g_sequence_get_begin_iter (mhsink->clients_by_bufseq);
+  if (!g_sequence_iter_is_end (iter)) {
+    GstMultiHandleClient *mhclient = g_sequence_get (iter);
+
+    max_buffer_usage = MAX (CLIENT_BUFPOS (mhsink, mhclient), 0);
   }
 
   /* make sure we respect bytes-min, buffers-min and time-min when they are set */
@@ -2134,6 +2258,9 @@ gst_multi_handle_sink_stop (GstBaseSink * bsink)
     }
     /* freeing the array is done in _finalize */
   }
+  CLIENTS_LOCK (mhsink);
+  gst_caps_replace (&mhsink->caps, NULL);
+  CLIENTS_UNLOCK (mhsink);
   GST_OBJECT_FLAG_UNSET (mhsink, GST_MULTI_HANDLE_SINK_OPEN);
 
   return TRUE;
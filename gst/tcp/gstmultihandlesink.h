@@ -136,7 +136,10 @@ typedef struct {
 
   gchar debug[30];              /* a debug string used in debug calls to
                                    identify the client */
-  gint bufpos;                  /* position of this client in the global queue */
+  guint64 bufseq;               /* sequence number of the next buffer of the
+                                   global queue to send, see CLIENT_BUFPOS */
+  GSequenceIter *bufseq_iter;   /* entry in the clients sorted by bufseq */
+  GList activity_link;          /* link in the clients sorted by activity */
   gint flushcount;              /* the remaining number of buffers to flush out or -1 if the 
                                    client is not flushing. */
 
@@ -176,10 +179,25 @@ typedef struct {
 #define CLIENTS_LOCK(mhsink)            (g_rec_mutex_lock(&(mhsink)->clientslock))
 #define CLIENTS_UNLOCK(mhsink)          (g_rec_mutex_unlock(&(mhsink)->clientslock))
 
+/* position of a client in the global queue: the index of the next buffer to
+ * send, or -1 when the client has sent all queued buffers. New buffers move
+ * all clients back in the queue without touching them. */
+#define CLIENT_BUFPOS(mhsink,client) \
+    ((gint) (gint64) ((mhsink)->bufqueue_seqnum - (client)->bufseq))
+
 gint gst_multi_handle_sink_setup_dscp_client (GstMultiHandleSink * sink, GstMultiHandleClient * client);
 gint
 gst_multi_handle_sink_new_client_position (GstMultiHandleSink * sink,
     GstMultiHandleClient * client);
+void
+gst_multi_handle_sink_client_queue_caps (GstMultiHandleSink * sink,
+    GstMultiHandleClient * client, GstCaps * caps);
+void
+gst_multi_handle_sink_client_set_bufpos (GstMultiHandleSink * sink,
+    GstMultiHandleClient * client, gint bufpos);
+void
+gst_multi_handle_sink_client_set_activity (GstMultiHandleSink * sink,
+    GstMultiHandleClient * client, GstClockTime now);
 
 /**
  * GstMultiHandleSink:
@@ -198,6 +216,10 @@ struct _GstMultiHandleSink {
   guint clients_cookie; /* Cookie to detect changes to the clients list */
 
   GHashTable *handle_hash;  /* index of handle -> GstMultiHandleClient */
+  GSequence *clients_by_bufseq; /* clients sorted by bufseq, the most
+                                   lagging client first */
+  GQueue clients_by_activity;   /* clients sorted by last activity, the
+                                   longest idle client first */
 
   GMainContext *main_context;
   GCancellable *cancellable;
@@ -205,6 +227,8 @@ struct _GstMultiHandleSink {
   gint qos_dscp;
 
   GArray *bufqueue;     /* global queue of buffers */
+  guint64 bufqueue_seqnum; /* sequence number of the newest queued buffer */
+  GstCaps *caps;        /* caps of the newest queued buffer */
 
   gboolean running;     /* the thread state */
   GThread *thread;      /* the sender thread */
@@ -97,6 +97,11 @@
  * buffers to the clients. This behaviour can be disabled by setting the sync
  * property to FALSE. Multisocketsink will by default not do QoS and will never
  * drop late buffers.
+ *
+ * By default all clients are serviced from a single thread. With the
+ * #GstMultiSocketSink:n-threads property the clients are distributed over
+ * multiple threads that each poll their own set of sockets, so that a large
+ * number of clients can be served using multiple cores.
  */
 
 #ifdef HAVE_CONFIG_H
@@ -105,7 +110,10 @@
 
 #include <gst/gst-i18n-plugin.h>
 #include <gst/net/gstnetcontrolmessagemeta.h>
+#include <gst/allocators/gstfdmemory.h>
 
+#include <errno.h>
+#include <limits.h>
 #include <string.h>
 
 #include "gstmultisocketsink.h"
@@ -114,6 +122,21 @@
 #include <netinet/in.h>
 #endif
 
+#ifdef HAVE_SYS_SOCKET_H
+#include <sys/socket.h>
+#endif
+
+#ifdef HAVE_SYS_SENDFILE_H
+#include <sys/sendfile.h>
+#endif
+
+#ifdef HAVE_LINUX_ERRQUEUE_H
+#include <linux/errqueue.h>
+#if defined(MSG_ZEROCOPY) && defined(SO_ZEROCOPY)
+#define HAVE_MSG_ZEROCOPY 1
+#endif
+#endif
+
 #define NOT_IMPLEMENTED 0
 
 GST_DEBUG_CATEGORY_STATIC (multisocketsink_debug);
@@ -139,12 +162,20 @@ enum
 
 #define DEFAULT_SEND_DISPATCHED FALSE
 #define DEFAULT_SEND_MESSAGES   FALSE
+#define DEFAULT_N_THREADS       1
+#define DEFAULT_ZERO_COPY       FALSE
+
+/* MSG_ZEROCOPY has a cost of its own (page pinning and a completion
+ * notification), it only pays off for larger writes */
+#define ZEROCOPY_MIN_SIZE       (16 * 1024)
 
 enum
 {
   PROP_0,
   PROP_SEND_DISPATCHED,
   PROP_SEND_MESSAGES,
+  PROP_N_THREADS,
+  PROP_ZERO_COPY,
   PROP_LAST
 };
 
@@ -188,6 +219,10 @@ static void gst_multi_socket_sink_hash_removing (GstMultiHandleSink * mhsink,
     GstMultiHandleClient * mhclient);
 static void gst_multi_socket_sink_stop_sending (GstMultiSocketSink * sink,
     GstSocketClient * client);
+#ifdef HAVE_MSG_ZEROCOPY
+static void gst_multi_socket_sink_client_reap_zero_copy (GstMultiSocketSink *
+    sink, GstSocketClient * client);
+#endif
 
 static gboolean gst_multi_socket_sink_socket_condition (GstMultiSinkHandle
     handle, GIOCondition condition, GstMultiSocketSink * sink);
@@ -261,6 +296,42 @@ gst_multi_socket_sink_class_init (GstMultiSocketSinkClass * klass)
           "If GstNetworkMessage events should be pushed", DEFAULT_SEND_MESSAGES,
           G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
+  /**
+   * GstMultiSocketSink:n-threads:
+   *
+   * Number of threads servicing the clients. Each thread polls the sockets
+   * of its own share of the clients, new clients are assigned to the thread
+   * with the fewest clients. With more than one thread, data is written to
+   * the sockets without holding the lock that protects the client list.
+   *
+   * Since: 1.20
+   */
+  g_object_class_install_property (gobject_class, PROP_N_THREADS,
+      g_param_spec_uint ("n-threads", "Threads",
+          "Number of threads servicing the clients (0 = number of processors)",
+          0, G_MAXUINT, DEFAULT_N_THREADS,
+          G_PARAM_READWRITE | GST_PARAM_MUTABLE_READY |
+          G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstMultiSocketSink:zero-copy:
+   *
+   * Avoid copying the data into the kernel where possible. Buffers made of
+   * a single fd-backed memory (see #GstFdMemory) are sent from their file
+   * descriptor with sendfile(), other buffers are sent with MSG_ZEROCOPY on
+   * sockets that support it. The buffers are then kept until the kernel
+   * reports that it is done with them, or until the socket is released by
+   * the application for clients that are removed before that. Only
+   * effective on Linux and for clients added after setting the property.
+   *
+   * Since: 1.20
+   */
+  g_object_class_install_property (gobject_class, PROP_ZERO_COPY,
+      g_param_spec_boolean ("zero-copy", "Zero Copy",
+          "Send fd-backed memory with sendfile and other memory with "
+          "MSG_ZEROCOPY where supported", DEFAULT_ZERO_COPY,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
   /**
    * GstMultiSocketSink::add:
    * @gstmultisocketsink: the multisocketsink element to emit this signal on
@@ -382,6 +453,11 @@ gst_multi_socket_sink_class_init (GstMultiSocketSinkClass * klass)
    * In this callback, @gstmultisocketsink has removed all the information
    * associated with @socket and it is therefore not possible to call get-stats
    * with @socket. It is however safe to `close()` and reuse @fd in the callback.
+   *
+   * Buffers that were sent with MSG_ZEROCOPY (see
+   * #GstMultiSocketSink:zero-copy) and that the kernel did not finish
+   * sending yet are kept alive with @socket, so the application must close
+   * and release @socket to free them.
    */
   gst_multi_socket_sink_signals[SIGNAL_CLIENT_SOCKET_REMOVED] =
       g_signal_new ("client-socket-removed", G_TYPE_FROM_CLASS (klass),
@@ -448,6 +524,8 @@ gst_multi_socket_sink_init (GstMultiSocketSink * this)
   this->cancellable = g_cancellable_new ();
   this->send_dispatched = DEFAULT_SEND_DISPATCHED;
   this->send_messages = DEFAULT_SEND_MESSAGES;
+  this->n_threads = DEFAULT_N_THREADS;
+  this->zero_copy = DEFAULT_ZERO_COPY;
 }
 
 static void
@@ -555,6 +633,20 @@ gst_multi_socket_sink_new_client (GstMultiHandleSink * mhsink,
   /* set the socket to non blocking */
   g_socket_set_blocking (handle.socket, FALSE);
 
+#ifdef HAVE_MSG_ZEROCOPY
+  if (GST_MULTI_SOCKET_SINK (mhsink)->zero_copy) {
+    GError *err = NULL;
+
+    client->zerocopy = g_socket_set_option (handle.socket, SOL_SOCKET,
+        SO_ZEROCOPY, 1, &err);
+    if (!client->zerocopy) {
+      GST_DEBUG_OBJECT (mhsink, "%s no MSG_ZEROCOPY support: %s",
+          mhclient->debug, err->message);
+      g_clear_error (&err);
+    }
+  }
+#endif
+
   /* we always read from a client */
   mhsinkclass->hash_adding (mhsink, mhclient);
 
@@ -569,12 +661,76 @@ gst_multi_socket_sink_client_get_fd (GstMultiHandleClient * client)
   return g_socket_get_fd (client->handle.socket);
 }
 
+#ifdef HAVE_MSG_ZEROCOPY
+/* buffers sent with MSG_ZEROCOPY, kept until the kernel completes the send
+ * with the given id */
+typedef struct
+{
+  guint32 id;
+  GstBufferList *buffers;
+} GstMultiSocketSinkZeroCopy;
+
+static void
+gst_multi_socket_sink_zero_copy_free (GstMultiSocketSinkZeroCopy * zc)
+{
+  gst_buffer_list_unref (zc->buffers);
+  g_free (zc);
+}
+
+#define ZERO_COPY_PENDING_KEY "GstMultiSocketSink.zero-copy-pending"
+
+static void
+gst_multi_socket_sink_zero_copy_queue_free (GQueue * pending)
+{
+  g_queue_free_full (pending,
+      (GDestroyNotify) gst_multi_socket_sink_zero_copy_free);
+}
+
+/* The kernel might still be sending from the buffers of unfinished
+ * MSG_ZEROCOPY sends, so they must not be reused yet. Once the socket is
+ * handed back we can't read its completions anymore, keep the buffers with
+ * the socket until the application closes and releases it. */
+static void
+gst_multi_socket_sink_client_release_zero_copy (GstMultiSocketSink * sink,
+    GstSocketClient * client)
+{
+  GstMultiHandleClient *mhclient = (GstMultiHandleClient *) client;
+  GObject *socket = G_OBJECT (mhclient->handle.socket);
+  GQueue *pending;
+
+  if (g_queue_is_empty (&client->zerocopy_pending))
+    return;
+
+  gst_multi_socket_sink_client_reap_zero_copy (sink, client);
+  if (g_queue_is_empty (&client->zerocopy_pending))
+    return;
+
+  GST_DEBUG_OBJECT (sink, "%s keeping %u unfinished zero-copy sends with "
+      "the socket", mhclient->debug, client->zerocopy_pending.length);
+
+  /* the socket may have been added and removed before */
+  pending = g_object_steal_data (socket, ZERO_COPY_PENDING_KEY);
+  if (pending == NULL)
+    pending = g_queue_new ();
+  while (!g_queue_is_empty (&client->zerocopy_pending))
+    g_queue_push_tail (pending, g_queue_pop_head (&client->zerocopy_pending));
+
+  g_object_set_data_full (socket, ZERO_COPY_PENDING_KEY, pending,
+      (GDestroyNotify) gst_multi_socket_sink_zero_copy_queue_free);
+}
+#endif
+
 static void
 gst_multi_socket_sink_client_free (GstMultiHandleSink * mhsink,
     GstMultiHandleClient * client)
 {
   g_assert (G_IS_SOCKET (client->handle.socket));
 
+#ifdef HAVE_MSG_ZEROCOPY
+  gst_multi_socket_sink_client_release_zero_copy (GST_MULTI_SOCKET_SINK
+      (mhsink), (GstSocketClient *) client);
+#endif
+
   g_signal_emit (mhsink,
       gst_multi_socket_sink_signals[SIGNAL_CLIENT_SOCKET_REMOVED], 0,
       client->handle.socket);
@@ -771,29 +927,429 @@ gst_buffer_get_cmsg_list (GstBuffer * buf, GSocketControlMessage ** msgs,
 
 #define CMSG_MAX 255
 
+/* maximum number of memory chunks handed to one send call */
+#if defined(IOV_MAX) && IOV_MAX < 256
+#define SEND_VECTORS_MAX IOV_MAX
+#else
+#define SEND_VECTORS_MAX 256
+#endif
+
+static gboolean
+gst_buffer_has_cmsg (GstBuffer * buf)
+{
+  return gst_buffer_get_meta (buf, GST_NET_CONTROL_MESSAGE_META_API_TYPE)
+      != NULL;
+}
+
+/* The buffers written to a client with one send call. The first @n_sending
+ * buffers come from the sending queue of the client (streamheaders and the
+ * remainder of a partially written buffer), the others are read directly from
+ * the shared queue, starting at the buffer with sequence number @seqnum. */
+typedef struct
+{
+  GstBuffer *buffers[SEND_VECTORS_MAX];
+  guint n_buffers;
+  guint n_sending;
+  guint n_mems;
+  gsize size;
+  guint64 seqnum;
+  gboolean reffed;
+
+  gboolean zero_copy;           /* the zero-copy property is enabled */
+  gboolean sendfile;            /* send the only buffer with sendfile() */
+  gint flags;                   /* flags for the send call */
+} GstMultiSocketSinkBatch;
+
+#ifdef HAVE_SYS_SENDFILE_H
+static gboolean
+gst_buffer_is_fd_backed (GstBuffer * buf)
+{
+  return gst_buffer_n_memory (buf) == 1 &&
+      gst_is_fd_memory (gst_buffer_peek_memory (buf, 0));
+}
+#endif
+
+/* Add @buf to @batch. Returns FALSE when no more buffers should be added. */
+static gboolean
+gst_multi_socket_sink_batch_add (GstMultiSocketSinkBatch * batch,
+    GstBuffer * buf)
+{
+  guint n = gst_buffer_n_memory (buf);
+  gboolean has_cmsg = gst_buffer_has_cmsg (buf);
+  gboolean fd_backed = FALSE;
+
+  if (batch->n_mems >= SEND_VECTORS_MAX)
+    return FALSE;
+
+#ifdef HAVE_SYS_SENDFILE_H
+  fd_backed = batch->zero_copy && !has_cmsg && gst_buffer_is_fd_backed (buf);
+#endif
+
+  if (batch->n_buffers > 0) {
+    if (n == 0 || gst_buffer_get_size (buf) == 0 ||
+        batch->n_mems + n > SEND_VECTORS_MAX || has_cmsg || fd_backed)
+      return FALSE;
+  }
+
+  batch->buffers[batch->n_buffers++] = buf;
+  batch->n_mems += n;
+  batch->size += gst_buffer_get_size (buf);
+
+  /* fd-backed buffers and buffers with control messages are always sent on
+   * their own */
+  if (fd_backed) {
+    batch->sendfile = TRUE;
+    return FALSE;
+  }
+  return !has_cmsg;
+}
+
+/* Collect the buffers that can go out to @client with one send call. This
+ * turns many small buffers, like those of an MPEG-TS stream, into a single
+ * syscall.
+ *
+ * Clients are read cursors into the shared queue: buffers are taken from the
+ * queue without a per-client reference or list node, only the buffer that is
+ * written partially is moved to the sending queue of the client. */
+static void
+gst_multi_socket_sink_gather (GstMultiSocketSink * sink,
+    GstSocketClient * client, GstMultiSocketSinkBatch * batch)
+{
+  GstMultiHandleSink *mhsink = GST_MULTI_HANDLE_SINK (sink);
+  GstMultiHandleClient *mhclient = (GstMultiHandleClient *) client;
+  gint bufpos, flushcount;
+  GSList *walk;
+
+  batch->n_buffers = 0;
+  batch->n_mems = 0;
+  batch->size = 0;
+  batch->reffed = FALSE;
+  batch->zero_copy = sink->zero_copy;
+  batch->sendfile = FALSE;
+  batch->flags = 0;
+
+  bufpos = CLIENT_BUFPOS (mhsink, mhclient);
+  flushcount = mhclient->flushcount;
+
+  /* queue the streamheaders first when the caps changed since the client
+   * last read from the shared queue */
+  if (bufpos >= 0 && flushcount != 0 && mhclient->caps != mhsink->caps)
+    gst_multi_handle_sink_client_queue_caps (mhsink, mhclient, mhsink->caps);
+
+  for (walk = mhclient->sending; walk; walk = walk->next) {
+    if (!gst_multi_socket_sink_batch_add (batch, GST_BUFFER (walk->data)))
+      break;
+  }
+  batch->n_sending = batch->n_buffers;
+
+  batch->seqnum = mhclient->bufseq;
+  for (; !walk && bufpos >= 0 && flushcount != 0; bufpos--) {
+    if (!gst_multi_socket_sink_batch_add (batch,
+            g_array_index (mhsink->bufqueue, GstBuffer *, bufpos)))
+      break;
+    if (flushcount > 0)
+      flushcount--;
+  }
+
+#ifdef HAVE_MSG_ZEROCOPY
+  if (client->zerocopy && !batch->sendfile && batch->size >= ZEROCOPY_MIN_SIZE)
+    batch->flags |= MSG_ZEROCOPY;
+#endif
+}
+
+/* Move the read cursor of @client past the first @n_done buffers of @batch
+ * that were read from the shared queue */
+static void
+gst_multi_socket_sink_client_advance (GstMultiSocketSink * sink,
+    GstSocketClient * client, GstMultiSocketSinkBatch * batch, guint n_done)
+{
+  GstMultiHandleSink *mhsink = GST_MULTI_HANDLE_SINK (sink);
+  GstMultiHandleClient *mhclient = (GstMultiHandleClient *) client;
+  GstClockTime timestamp;
+  guint i;
+
+  if (n_done == 0)
+    return;
+
+  for (i = batch->n_sending; i < batch->n_sending + n_done; i++) {
+    /* update stats */
+    timestamp = GST_BUFFER_TIMESTAMP (batch->buffers[i]);
+    if (mhclient->first_buffer_ts == GST_CLOCK_TIME_NONE)
+      mhclient->first_buffer_ts = timestamp;
+    if (timestamp != -1)
+      mhclient->last_buffer_ts = timestamp;
+
+    /* decrease flushcount */
+    if (mhclient->flushcount != -1)
+      mhclient->flushcount--;
+  }
+
+  gst_multi_handle_sink_client_set_bufpos (mhsink, mhclient,
+      CLIENT_BUFPOS (mhsink, mhclient) - n_done);
+
+  GST_LOG_OBJECT (sink, "%s client %p at position %d",
+      mhclient->debug, client, CLIENT_BUFPOS (mhsink, mhclient));
+}
+
+#ifdef HAVE_SYS_SENDFILE_H
+static gssize
+gst_multi_socket_sink_sendfile (GstMultiSocketSink * sink, GSocket * sock,
+    GstBuffer * buffer, gsize bufoffset, GError ** err)
+{
+  GstMemory *mem = gst_buffer_peek_memory (buffer, 0);
+  gsize offset, size;
+  off_t off;
+  gssize wrote;
+
+  size = gst_memory_get_sizes (mem, &offset, NULL);
+  off = offset + bufoffset;
+
+  wrote = sendfile (g_socket_get_fd (sock), gst_fd_memory_get_fd (mem), &off,
+      size - bufoffset);
+  if (wrote < 0) {
+    int errsv = errno;
+
+    g_set_error (err, G_IO_ERROR, g_io_error_from_errno (errsv),
+        "Error sending data: %s", g_strerror (errsv));
+  }
+  return wrote;
+}
+#endif
+
+/* Write the buffers of @batch, starting at @bufoffset in the first one, with a
+ * single send call. Only the control messages of the first buffer are sent,
+ * see gst_multi_socket_sink_batch_add(). */
 static gssize
 gst_multi_socket_sink_write (GstMultiSocketSink * sink,
-    GSocket * sock, GstBuffer * buffer, gsize bufoffset,
+    GSocket * sock, GstMultiSocketSinkBatch * batch, gsize bufoffset,
     GCancellable * cancellable, GError ** err)
 {
-  GstMapInfo maps[8];
-  GOutputVector vec[8];
-  guint mems_mapped;
+  GstMapInfo maps[SEND_VECTORS_MAX];
+  GOutputVector vec[SEND_VECTORS_MAX];
+  guint mems_mapped = 0;
   gssize wrote;
   GSocketControlMessage *cmsgs[CMSG_MAX];
   gsize msg_count;
+  guint i;
+
+#ifdef HAVE_SYS_SENDFILE_H
+  if (batch->sendfile) {
+    GError *sf_err = NULL;
+
+    wrote = gst_multi_socket_sink_sendfile (sink, sock, batch->buffers[0],
+        bufoffset, &sf_err);
+    if (wrote >= 0 ||
+        !(g_error_matches (sf_err, G_IO_ERROR, G_IO_ERROR_INVALID_ARGUMENT) ||
+            g_error_matches (sf_err, G_IO_ERROR, G_IO_ERROR_NOT_SUPPORTED))) {
+      g_propagate_error (err, sf_err);
+      return wrote;
+    }
+    /* not a file we can send from, like some dmabufs, map it instead */
+    GST_LOG_OBJECT (sink, "can't use sendfile: %s", sf_err->message);
+    g_clear_error (&sf_err);
+    batch->sendfile = FALSE;
+  }
+#endif
 
-  mems_mapped = map_n_memory_output_vector (buffer, bufoffset, vec, maps, 8);
+  for (i = 0; i < batch->n_buffers && mems_mapped < SEND_VECTORS_MAX; i++) {
+    mems_mapped += map_n_memory_output_vector (batch->buffers[i],
+        i == 0 ? bufoffset : 0, vec + mems_mapped, maps + mems_mapped,
+        SEND_VECTORS_MAX - mems_mapped);
+  }
 
-  msg_count = gst_buffer_get_cmsg_list (buffer, cmsgs, CMSG_MAX);
+  msg_count = gst_buffer_get_cmsg_list (batch->buffers[0], cmsgs, CMSG_MAX);
 
   wrote =
-      g_socket_send_message (sock, NULL, vec, mems_mapped, cmsgs, msg_count, 0,
-      cancellable, err);
+      g_socket_send_message (sock, NULL, vec, mems_mapped, cmsgs, msg_count,
+      batch->flags, cancellable, err);
+#ifdef HAVE_MSG_ZEROCOPY
+  if (wrote < 0 && (batch->flags & MSG_ZEROCOPY) &&
+      !g_error_matches (*err, G_IO_ERROR, G_IO_ERROR_WOULD_BLOCK)) {
+    /* the kernel can refuse to pin more pages (ENOBUFS), send a copy */
+    GST_LOG_OBJECT (sink, "MSG_ZEROCOPY send failed: %s", (*err)->message);
+    g_clear_error (err);
+    batch->flags &= ~MSG_ZEROCOPY;
+    wrote =
+        g_socket_send_message (sock, NULL, vec, mems_mapped, cmsgs, msg_count,
+        batch->flags, cancellable, err);
+  }
+#endif
   unmap_n_memorys (maps, mems_mapped);
   return wrote;
 }
 
+#ifdef HAVE_MSG_ZEROCOPY
+/* Keep the buffers of @batch until the kernel completes the MSG_ZEROCOPY send
+ * that was just done. The kernel numbers these sends consecutively per
+ * socket. */
+static void
+gst_multi_socket_sink_client_hold_zero_copy (GstSocketClient * client,
+    GstMultiSocketSinkBatch * batch)
+{
+  GstMultiSocketSinkZeroCopy *zc;
+  guint i;
+
+  zc = g_new (GstMultiSocketSinkZeroCopy, 1);
+  zc->id = client->zerocopy_id++;
+  zc->buffers = gst_buffer_list_new_sized (batch->n_buffers);
+  for (i = 0; i < batch->n_buffers; i++)
+    gst_buffer_list_add (zc->buffers, gst_buffer_ref (batch->buffers[i]));
+
+  g_queue_push_tail (&client->zerocopy_pending, zc);
+}
+
+/* Release the buffers of the MSG_ZEROCOPY sends the kernel reports as
+ * completed on the error queue of the socket. */
+static void
+gst_multi_socket_sink_client_reap_zero_copy (GstMultiSocketSink * sink,
+    GstSocketClient * client)
+{
+  GstMultiHandleClient *mhclient = (GstMultiHandleClient *) client;
+  gint fd = g_socket_get_fd (mhclient->handle.socket);
+  gchar control[128];
+
+  while (TRUE) {
+    struct msghdr msg = { 0, };
+    struct cmsghdr *cm;
+
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof (control);
+    if (recvmsg (fd, &msg, MSG_ERRQUEUE | MSG_DONTWAIT) < 0)
+      break;
+
+    for (cm = CMSG_FIRSTHDR (&msg); cm; cm = CMSG_NXTHDR (&msg, cm)) {
+      struct sock_extended_err *serr;
+      guint32 lo, hi;
+      GList *l, *next;
+
+      if (!(cm->cmsg_level == SOL_IP && cm->cmsg_type == IP_RECVERR) &&
+          !(cm->cmsg_level == SOL_IPV6 && cm->cmsg_type == IPV6_RECVERR))
+        continue;
+
+      serr = (struct sock_extended_err *) CMSG_DATA (cm);
+      if (serr->ee_errno != 0 || serr->ee_origin != SO_EE_ORIGIN_ZEROCOPY)
+        continue;
+
+      /* the kernel had to copy anyway, e.g. on loopback, stop paying for
+       * the notifications */
+      if ((serr->ee_code & SO_EE_CODE_ZEROCOPY_COPIED) && client->zerocopy) {
+        GST_DEBUG_OBJECT (sink, "%s data was copied, disabling MSG_ZEROCOPY",
+            mhclient->debug);
+        client->zerocopy = FALSE;
+      }
+
+      lo = serr->ee_info;
+      hi = serr->ee_data;
+      GST_LOG_OBJECT (sink, "%s completed zero-copy sends %u-%u",
+          mhclient->debug, lo, hi);
+
+      for (l = client->zerocopy_pending.head; l; l = next) {
+        GstMultiSocketSinkZeroCopy *zc = l->data;
+
+        next = l->next;
+        if ((guint32) (zc->id - lo) <= (guint32) (hi - lo)) {
+          gst_multi_socket_sink_zero_copy_free (zc);
+          g_queue_delete_link (&client->zerocopy_pending, l);
+        }
+      }
+    }
+  }
+}
+#endif
+
+/* Handle an error condition on a client. Returns TRUE when it only signaled
+ * completed MSG_ZEROCOPY sends and the client can be kept. */
+static gboolean
+gst_multi_socket_sink_handle_client_error (GstMultiSocketSink * sink,
+    GstSocketClient * client)
+{
+#ifdef HAVE_MSG_ZEROCOPY
+  GstMultiHandleClient *mhclient = (GstMultiHandleClient *) client;
+  gint sockerr = 0;
+
+  if (g_queue_is_empty (&client->zerocopy_pending))
+    return FALSE;
+
+  gst_multi_socket_sink_client_reap_zero_copy (sink, client);
+
+  return g_socket_get_option (mhclient->handle.socket, SOL_SOCKET, SO_ERROR,
+      &sockerr, NULL) && sockerr == 0;
+#else
+  return FALSE;
+#endif
+}
+
+/* Drop the references taken by gst_multi_socket_sink_write_client() */
+static void
+gst_multi_socket_sink_batch_clear (GstMultiSocketSinkBatch * batch)
+{
+  guint i;
+
+  if (!batch->reffed)
+    return;
+
+  for (i = 0; i < batch->n_buffers; i++)
+    gst_buffer_unref (batch->buffers[i]);
+  batch->reffed = FALSE;
+}
+
+/* Write @batch to @client. With multiple workers the clients lock is released
+ * while writing so that the workers and the streaming thread don't serialize
+ * on it. The buffers of @batch are then kept alive until
+ * gst_multi_socket_sink_batch_clear() as the shared queue might drop them in
+ * the meantime. When the client was removed, @gone is set to TRUE and @client
+ * must not be used anymore. */
+static gssize
+gst_multi_socket_sink_write_client (GstMultiSocketSink * sink,
+    GstSocketClient * client, GstMultiSocketSinkBatch * batch,
+    gboolean * gone, GError ** err)
+{
+  GstMultiHandleSink *mhsink = GST_MULTI_HANDLE_SINK (sink);
+  GstMultiHandleClient *mhclient = (GstMultiHandleClient *) client;
+  GstMultiSocketSinkWorker *worker = client->worker;
+  GCancellable *cancellable;
+  GSocket *socket;
+  gsize offset;
+  gssize wrote;
+  guint i;
+
+  *gone = FALSE;
+
+  if (sink->n_workers < 2 || worker == NULL)
+    return gst_multi_socket_sink_write (sink, mhclient->handle.socket, batch,
+        mhclient->bufoffset, sink->cancellable, err);
+
+  socket = g_object_ref (mhclient->handle.socket);
+  cancellable = g_object_ref (sink->cancellable);
+  for (i = 0; i < batch->n_buffers; i++)
+    gst_buffer_ref (batch->buffers[i]);
+  batch->reffed = TRUE;
+  offset = mhclient->bufoffset;
+
+  /* hash_removing waits for send_lock, so the client is not freed while we
+   * write but we might find it gone afterwards */
+  g_mutex_lock (&worker->send_lock);
+  worker->sending_client = client;
+  CLIENTS_UNLOCK (mhsink);
+
+  wrote = gst_multi_socket_sink_write (sink, socket, batch, offset,
+      cancellable, err);
+
+  g_mutex_unlock (&worker->send_lock);
+  CLIENTS_LOCK (mhsink);
+
+  if (worker->sending_client != client) {
+    GST_DEBUG_OBJECT (sink, "client %p was removed while writing", client);
+    *gone = TRUE;
+  }
+  worker->sending_client = NULL;
+
+  g_object_unref (cancellable);
+  g_object_unref (socket);
+
+  return wrote;
+}
+
 /* Handle a write on a client,
  * which indicates a read request from a client.
  *
@@ -803,22 +1359,25 @@ gst_multi_socket_sink_write (GstMultiSocketSink * sink,
  * We first check to see if we need to send streamheaders. If so, we queue them.
  *
  * Then we run into the main loop that tries to send as many buffers as
- * possible. It will first exhaust the mhclient->sending queue and if the queue
- * is empty, it will pick a buffer from the global queue.
+ * possible. It will first exhaust the mhclient->sending queue and then read
+ * on from the global queue at the position of the client.
  *
- * Sending the buffers from the mhclient->sending queue is basically writing
- * the bytes to the socket and maintaining a count of the bytes that were
- * sent. When the buffer is completely sent, it is removed from the
- * mhclient->sending queue and we try to pick a new buffer for sending.
+ * Sending the buffers is basically writing the bytes to the socket and
+ * maintaining a count of the bytes that were sent. As many buffers as fit are
+ * written with one send call. When a buffer is completely sent, it is removed
+ * from the mhclient->sending queue or the position of the client in the global
+ * queue is advanced. A partially sent buffer of the global queue is moved to
+ * the mhclient->sending queue.
  *
  * When the sending returns a partial buffer we stop sending more data as
  * the next send operation could block.
  *
- * This functions returns FALSE if some error occurred.
+ * This functions returns FALSE if some error occurred. @gone is set to TRUE
+ * when the client was removed by another thread while writing.
  */
 static gboolean
 gst_multi_socket_sink_handle_client_write (GstMultiSocketSink * sink,
-    GstSocketClient * client)
+    GstSocketClient * client, gboolean * gone)
 {
   gboolean more;
   gboolean flushing;
@@ -826,9 +1385,6 @@ gst_multi_socket_sink_handle_client_write (GstMultiSocketSink * sink,
   GError *err = NULL;
   GstMultiHandleSink *mhsink = GST_MULTI_HANDLE_SINK (sink);
   GstMultiHandleClient *mhclient = (GstMultiHandleClient *) client;
-  GstMultiHandleSinkClass *mhsinkclass =
-      GST_MULTI_HANDLE_SINK_GET_CLASS (mhsink);
-
 
   now = g_get_real_time () * GST_USECOND;
 
@@ -838,7 +1394,7 @@ gst_multi_socket_sink_handle_client_write (GstMultiSocketSink * sink,
   do {
     if (!mhclient->sending) {
       /* client is not working on a buffer */
-      if (mhclient->bufpos == -1) {
+      if (CLIENT_BUFPOS (mhsink, mhclient) == -1) {
         /* client is too fast, remove from write queue until new buffer is
          * available */
         gst_multi_socket_sink_stop_sending (sink, client);
@@ -850,9 +1406,6 @@ gst_multi_socket_sink_handle_client_write (GstMultiSocketSink * sink,
         return TRUE;
       } else {
         /* client can pick a buffer from the global queue */
-        GstBuffer *buf;
-        GstClockTime timestamp;
-
         /* for new connections, we need to find a good spot in the
          * bufqueue to start streaming from */
         if (mhclient->new_connection && !flushing) {
@@ -862,9 +1415,12 @@ gst_multi_socket_sink_handle_client_write (GstMultiSocketSink * sink,
           if (position >= 0) {
             /* we got a valid spot in the queue */
             mhclient->new_connection = FALSE;
-            mhclient->bufpos = position;
+            gst_multi_handle_sink_client_set_bufpos (mhsink, mhclient,
+                position);
           } else {
-            /* cannot send data to this client yet */
+            /* cannot send data to this client yet, wait at the front of the
+             * queue so that the next buffer wakes it up again */
+            gst_multi_handle_sink_client_set_bufpos (mhsink, mhclient, -1);
             gst_multi_socket_sink_stop_sending (sink, client);
             return TRUE;
           }
@@ -874,44 +1430,33 @@ gst_multi_socket_sink_handle_client_write (GstMultiSocketSink * sink,
         if (mhclient->flushcount == 0)
           goto flushed;
 
-        /* grab buffer */
-        buf = g_array_index (mhsink->bufqueue, GstBuffer *, mhclient->bufpos);
-        mhclient->bufpos--;
-
-        /* update stats */
-        timestamp = GST_BUFFER_TIMESTAMP (buf);
-        if (mhclient->first_buffer_ts == GST_CLOCK_TIME_NONE)
-          mhclient->first_buffer_ts = timestamp;
-        if (timestamp != -1)
-          mhclient->last_buffer_ts = timestamp;
-
-        /* decrease flushcount */
-        if (mhclient->flushcount != -1)
-          mhclient->flushcount--;
-
-        GST_LOG_OBJECT (sink, "%s client %p at position %d",
-            mhclient->debug, client, mhclient->bufpos);
-
-        /* queueing a buffer will ref it */
-        mhsinkclass->client_queue_buffer (mhsink, mhclient, buf);
-
-        /* need to start from the first byte for this new buffer */
+        /* need to start from the first byte for the next buffer */
         mhclient->bufoffset = 0;
       }
     }
 
-    /* see if we need to send something */
-    if (mhclient->sending) {
-      gssize wrote;
-      GstBuffer *head;
+    /* send the sending queue and as many buffers of the shared queue as
+     * possible */
+    {
+      GstMultiSocketSinkBatch batch;
+      gboolean in_queue;
+      guint i, n_done = 0;
+      gssize wrote, left;
+
+      gst_multi_socket_sink_gather (sink, client, &batch);
+      g_assert (batch.n_buffers > 0);
 
-      /* pick first buffer from list */
-      head = GST_BUFFER (mhclient->sending->data);
+      wrote = gst_multi_socket_sink_write_client (sink, client, &batch, gone,
+          &err);
 
-      wrote = gst_multi_socket_sink_write (sink, mhclient->handle.socket, head,
-          mhclient->bufoffset, sink->cancellable, &err);
+      if (G_UNLIKELY (*gone)) {
+        gst_multi_socket_sink_batch_clear (&batch);
+        g_clear_error (&err);
+        return TRUE;
+      }
 
       if (wrote < 0) {
+        gst_multi_socket_sink_batch_clear (&batch);
         /* hmm error.. */
         if (g_error_matches (err, G_IO_ERROR, G_IO_ERROR_CLOSED)) {
           goto connection_reset;
@@ -925,13 +1470,41 @@ gst_multi_socket_sink_handle_client_write (GstMultiSocketSink * sink,
           goto write_error;
         }
       } else {
-        if (wrote < (gst_buffer_get_size (head) - mhclient->bufoffset)) {
-          /* partial write, try again now */
-          GST_LOG_OBJECT (sink,
-              "partial write on %p of %" G_GSSIZE_FORMAT " bytes",
-              mhclient->handle.socket, wrote);
-          mhclient->bufoffset += wrote;
-        } else {
+        GST_LOG_OBJECT (sink, "wrote %" G_GSSIZE_FORMAT " bytes of %u "
+            "buffers on %p", wrote, batch.n_buffers, mhclient->handle.socket);
+
+#ifdef HAVE_MSG_ZEROCOPY
+        if (batch.flags & MSG_ZEROCOPY)
+          gst_multi_socket_sink_client_hold_zero_copy (client, &batch);
+#endif
+
+        /* the read cursor can only have moved while the clients lock was
+         * released for writing, when the client was recovered */
+        in_queue = mhclient->bufseq == batch.seqnum;
+
+        /* drop the buffers that were written completely */
+        left = wrote;
+        for (i = 0; i < batch.n_buffers; i++) {
+          GstBuffer *head = batch.buffers[i];
+          gsize size = gst_buffer_get_size (head) - mhclient->bufoffset;
+
+          if (i >= batch.n_sending && in_queue)
+            n_done++;
+
+          if ((gsize) left < size) {
+            /* partial write, try again now */
+            GST_LOG_OBJECT (sink, "partial write on %p",
+                mhclient->handle.socket);
+            if (i >= batch.n_sending) {
+              /* keep the remainder of the buffer for the next write */
+              mhclient->sending = g_slist_append (mhclient->sending,
+                  gst_buffer_ref (head));
+            }
+            mhclient->bufoffset += left;
+            break;
+          }
+          left -= size;
+
           if (sink->send_dispatched) {
             gst_pad_push_event (GST_BASE_SINK_PAD (mhsink),
                 gst_event_new_custom (GST_EVENT_CUSTOM_UPSTREAM,
@@ -940,14 +1513,19 @@ gst_multi_socket_sink_handle_client_write (GstMultiSocketSink * sink,
                         "buffer", GST_TYPE_BUFFER, head, NULL)));
           }
           /* complete buffer was written, we can proceed to the next one */
-          mhclient->sending = g_slist_remove (mhclient->sending, head);
-          gst_buffer_unref (head);
+          if (i < batch.n_sending) {
+            mhclient->sending = g_slist_remove (mhclient->sending, head);
+            gst_buffer_unref (head);
+          }
           /* make sure we start from byte 0 for the next buffer */
           mhclient->bufoffset = 0;
         }
+        gst_multi_socket_sink_client_advance (sink, client, &batch, n_done);
+        gst_multi_socket_sink_batch_clear (&batch);
+
         /* update stats */
         mhclient->bytes_sent += wrote;
-        mhclient->last_activity_time = now;
+        gst_multi_handle_sink_client_set_activity (mhsink, mhclient, now);
         mhsink->bytes_served += wrote;
       }
     }
@@ -994,13 +1572,13 @@ ensure_condition (GstMultiSocketSink * sink, GstSocketClient * client,
     g_source_destroy (client->source);
     g_source_unref (client->source);
   }
-  if (condition && sink->main_context) {
+  if (condition && client->worker) {
     client->source = g_socket_create_source (mhclient->handle.socket,
         condition, sink->cancellable);
     g_source_set_callback (client->source,
         (GSourceFunc) gst_multi_socket_sink_socket_condition,
         gst_object_ref (sink), (GDestroyNotify) gst_object_unref);
-    g_source_attach (client->source, sink->main_context);
+    g_source_attach (client->source, client->worker->context);
   } else {
     client->source = NULL;
     condition = 0;
@@ -1015,6 +1593,22 @@ gst_multi_socket_sink_hash_adding (GstMultiHandleSink * mhsink,
   GstMultiSocketSink *sink = GST_MULTI_SOCKET_SINK (mhsink);
   GstSocketClient *client = (GstSocketClient *) (mhclient);
 
+  /* assign new clients to the worker with the fewest clients */
+  if (client->worker == NULL && sink->workers) {
+    GstMultiSocketSinkWorker *worker = &sink->workers[0];
+    guint i;
+
+    for (i = 1; i < sink->n_workers; i++) {
+      if (sink->workers[i].n_clients < worker->n_clients)
+        worker = &sink->workers[i];
+    }
+    worker->n_clients++;
+    client->worker = worker;
+
+    GST_DEBUG_OBJECT (sink, "%s assigned to worker %u", mhclient->debug,
+        (guint) (worker - sink->workers));
+  }
+
   ensure_condition (sink, client,
       G_IO_IN | G_IO_OUT | G_IO_PRI | G_IO_ERR | G_IO_HUP);
 }
@@ -1025,8 +1619,21 @@ gst_multi_socket_sink_hash_removing (GstMultiHandleSink * mhsink,
 {
   GstMultiSocketSink *sink = GST_MULTI_SOCKET_SINK (mhsink);
   GstSocketClient *client = (GstSocketClient *) (mhclient);
+  GstMultiSocketSinkWorker *worker = client->worker;
 
   ensure_condition (sink, client, 0);
+
+  if (worker) {
+    /* wait until the worker is done writing to this client and tell it the
+     * client is gone */
+    g_mutex_lock (&worker->send_lock);
+    if (worker->sending_client == client)
+      worker->sending_client = NULL;
+    g_mutex_unlock (&worker->send_lock);
+
+    worker->n_clients--;
+    client->worker = NULL;
+  }
 }
 
 static void
@@ -1070,7 +1677,8 @@ gst_multi_socket_sink_socket_condition (GstMultiSinkHandle handle,
     goto done;
   }
 
-  if ((condition & G_IO_ERR)) {
+  if ((condition & G_IO_ERR)
+      && !gst_multi_socket_sink_handle_client_error (sink, client)) {
     GST_WARNING_OBJECT (sink, "%s has error", mhclient->debug);
     mhclient->status = GST_CLIENT_STATUS_ERROR;
     gst_multi_handle_sink_remove_client_link (mhsink, clink);
@@ -1091,11 +1699,17 @@ gst_multi_socket_sink_socket_condition (GstMultiSinkHandle handle,
     }
   }
   if ((condition & G_IO_OUT)) {
+    gboolean gone = FALSE;
+
     /* handle client write */
-    if (!gst_multi_socket_sink_handle_client_write (sink, client)) {
+    if (!gst_multi_socket_sink_handle_client_write (sink, client, &gone)) {
       gst_multi_handle_sink_remove_client_link (mhsink, clink);
       ret = FALSE;
       goto done;
+    } else if (gone) {
+      /* removed while we were writing, its source is destroyed already */
+      ret = FALSE;
+      goto done;
     }
   }
 
@@ -1132,13 +1746,32 @@ gst_multi_socket_sink_timeout (GstMultiSocketSink * sink)
   return FALSE;
 }
 
+static gpointer
+gst_multi_socket_sink_worker_thread (GstMultiSocketSinkWorker * worker)
+{
+  GstMultiHandleSink *mhsink = GST_MULTI_HANDLE_SINK (worker->sink);
+
+  while (mhsink->running)
+    g_main_context_iteration (worker->context, TRUE);
+
+  return NULL;
+}
+
 /* we handle the client communication in another thread so that we do not block
- * the gstreamer thread while we select() on the client fds */
+ * the gstreamer thread while we select() on the client fds. The first worker
+ * runs in this thread and also handles the timeouts, the other workers get a
+ * thread of their own */
 static gpointer
 gst_multi_socket_sink_thread (GstMultiHandleSink * mhsink)
 {
   GstMultiSocketSink *sink = GST_MULTI_SOCKET_SINK (mhsink);
   GSource *timeout = NULL;
+  guint i;
+
+  for (i = 1; i < sink->n_workers; i++) {
+    sink->workers[i].thread = g_thread_new ("multisocketsink",
+        (GThreadFunc) gst_multi_socket_sink_worker_thread, &sink->workers[i]);
+  }
 
   while (mhsink->running) {
     if (mhsink->timeout > 0) {
@@ -1162,6 +1795,11 @@ gst_multi_socket_sink_thread (GstMultiHandleSink * mhsink)
     }
   }
 
+  for (i = 1; i < sink->n_workers; i++) {
+    g_thread_join (sink->workers[i].thread);
+    sink->workers[i].thread = NULL;
+  }
+
   return NULL;
 }
 
@@ -1178,6 +1816,12 @@ gst_multi_socket_sink_set_property (GObject * object, guint prop_id,
     case PROP_SEND_MESSAGES:
       sink->send_messages = g_value_get_boolean (value);
       break;
+    case PROP_N_THREADS:
+      sink->n_threads = g_value_get_uint (value);
+      break;
+    case PROP_ZERO_COPY:
+      sink->zero_copy = g_value_get_boolean (value);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -1197,6 +1841,12 @@ gst_multi_socket_sink_get_property (GObject * object, guint prop_id,
     case PROP_SEND_MESSAGES:
       g_value_set_boolean (value, sink->send_messages);
       break;
+    case PROP_N_THREADS:
+      g_value_set_uint (value, sink->n_threads);
+      break;
+    case PROP_ZERO_COPY:
+      g_value_set_boolean (value, sink->zero_copy);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -1210,10 +1860,23 @@ gst_multi_socket_sink_start_pre (GstMultiHandleSink * mhsink)
   GstMultiHandleSinkClass *mhsinkclass =
       GST_MULTI_HANDLE_SINK_GET_CLASS (mhsink);
   GList *clients;
+  guint i;
 
-  GST_INFO_OBJECT (mssink, "starting");
+  mssink->n_workers = mssink->n_threads;
+  if (mssink->n_workers == 0)
+    mssink->n_workers = g_get_num_processors ();
 
-  mssink->main_context = g_main_context_new ();
+  GST_INFO_OBJECT (mssink, "starting with %u threads", mssink->n_workers);
+
+  mssink->workers = g_new0 (GstMultiSocketSinkWorker, mssink->n_workers);
+  for (i = 0; i < mssink->n_workers; i++) {
+    GstMultiSocketSinkWorker *worker = &mssink->workers[i];
+
+    worker->sink = mssink;
+    worker->context = g_main_context_new ();
+    g_mutex_init (&worker->send_lock);
+  }
+  mssink->main_context = mssink->workers[0].context;
 
   CLIENTS_LOCK (mhsink);
   for (clients = mhsink->clients; clients; clients = clients->next) {
@@ -1239,20 +1902,26 @@ static void
 gst_multi_socket_sink_stop_pre (GstMultiHandleSink * mhsink)
 {
   GstMultiSocketSink *mssink = GST_MULTI_SOCKET_SINK (mhsink);
+  guint i;
 
-  if (mssink->main_context)
-    g_main_context_wakeup (mssink->main_context);
+  for (i = 0; i < mssink->n_workers; i++)
+    g_main_context_wakeup (mssink->workers[i].context);
 }
 
 static void
 gst_multi_socket_sink_stop_post (GstMultiHandleSink * mhsink)
 {
   GstMultiSocketSink *mssink = GST_MULTI_SOCKET_SINK (mhsink);
+  guint i;
 
-  if (mssink->main_context) {
-    g_main_context_unref (mssink->main_context);
-    mssink->main_context = NULL;
+  for (i = 0; i < mssink->n_workers; i++) {
+    g_main_context_unref (mssink->workers[i].context);
+    g_mutex_clear (&mssink->workers[i].send_lock);
   }
+  g_free (mssink->workers);
+  mssink->workers = NULL;
+  mssink->n_workers = 0;
+  mssink->main_context = NULL;
 
   g_hash_table_foreach_remove (mhsink->handle_hash, multisocketsink_hash_remove,
       mssink);
@@ -48,14 +48,39 @@ G_BEGIN_DECLS
 typedef struct _GstMultiSocketSink GstMultiSocketSink;
 typedef struct _GstMultiSocketSinkClass GstMultiSocketSinkClass;
 
-/* structure for a client
+typedef struct _GstSocketClient GstSocketClient;
+
+/* a thread servicing a subset of the clients from its own main context
  */
 typedef struct {
+  GstMultiSocketSink *sink;
+
+  GMainContext *context;
+  GThread *thread;
+  guint n_clients;              /* number of clients assigned to this worker */
+
+  /* held while writing to a client without the clients lock */
+  GMutex send_lock;
+  /* client being written to, protected by the clients lock and send_lock.
+   * Set to NULL when the client is removed during the write */
+  GstSocketClient *sending_client;
+} GstMultiSocketSinkWorker;
+
+/* structure for a client
+ */
+struct _GstSocketClient {
   GstMultiHandleClient client;
 
   GSource *source;
   GIOCondition condition;
-} GstSocketClient;
+
+  GstMultiSocketSinkWorker *worker;
+
+  /* MSG_ZEROCOPY state */
+  gboolean zerocopy;            /* use MSG_ZEROCOPY for large writes */
+  guint32 zerocopy_id;          /* id of the next MSG_ZEROCOPY send */
+  GQueue zerocopy_pending;      /* sends the kernel did not complete yet */
+};
 
 /**
  * GstMultiSocketSink:
@@ -66,10 +91,16 @@ struct _GstMultiSocketSink {
   GstMultiHandleSink element;
 
   /*< private >*/
-  GMainContext *main_context;
+  GMainContext *main_context;  /* context of the first worker */
   GCancellable *cancellable;
   gboolean send_messages;
   gboolean send_dispatched;
+
+  guint n_threads;
+  GstMultiSocketSinkWorker *workers;
+  guint n_workers;
+
+  gboolean zero_copy;
 };
 
 struct _GstMultiSocketSinkClass {
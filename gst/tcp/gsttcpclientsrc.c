@@ -53,6 +53,13 @@ GST_DEBUG_CATEGORY_STATIC (tcpclientsrc_debug);
 
 #define MAX_READ_SIZE                   4 * 1024
 #define TCP_DEFAULT_TIMEOUT             0
+#define DEFAULT_BUFFER_LIST             FALSE
+#define DEFAULT_MAX_READ_SIZE           MAX_READ_SIZE
+
+/* maximum number of buffers read into one buffer list */
+#define MAX_LIST_LENGTH                 64
+/* number of consecutive small reads before the read size is lowered again */
+#define SMALL_READS_SHRINK              16
 
 
 static GstStaticPadTemplate srctemplate = GST_STATIC_PAD_TEMPLATE ("src",
@@ -68,6 +75,8 @@ enum
   PROP_PORT,
   PROP_TIMEOUT,
   PROP_STATS,
+  PROP_BUFFER_LIST,
+  PROP_MAX_READ_SIZE,
 };
 
 #define gst_tcp_client_src_parent_class parent_class
@@ -155,6 +164,39 @@ gst_tcp_client_src_class_init (GstTCPClientSrcClass * klass)
       g_param_spec_boxed ("stats", "Stats", "Retrieve a statistics structure",
           GST_TYPE_STRUCTURE, G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
 
+  /**
+   * GstTCPClientSrc:buffer-list:
+   *
+   * Push buffer lists with all the data that can be read from the socket
+   * without blocking instead of a single buffer per read. This cuts the
+   * per-buffer overhead downstream when the data arrives faster than it
+   * is pushed.
+   *
+   * Since: 1.20
+   */
+  g_object_class_install_property (gobject_class, PROP_BUFFER_LIST,
+      g_param_spec_boolean ("buffer-list", "Buffer List",
+          "Push buffer lists of all the data readable without blocking",
+          DEFAULT_BUFFER_LIST, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstTCPClientSrc:max-read-size:
+   *
+   * Maximum number of bytes read from the socket at once. Reads start at
+   * 4096 bytes and grow up to this size while the socket has more data
+   * queued than what is read at once, they shrink again when the data
+   * arrives in smaller amounts. The buffers are taken from an internal
+   * pool of buffers of the current read size.
+   *
+   * Since: 1.20
+   */
+  g_object_class_install_property (gobject_class, PROP_MAX_READ_SIZE,
+      g_param_spec_uint ("max-read-size", "Max Read Size",
+          "Maximum number of bytes to read from the socket at once",
+          MAX_READ_SIZE, G_MAXINT, DEFAULT_MAX_READ_SIZE,
+          G_PARAM_READWRITE | GST_PARAM_MUTABLE_READY |
+          G_PARAM_STATIC_STRINGS));
+
   gst_element_class_add_static_pad_template (gstelement_class, &srctemplate);
 
   gst_element_class_set_static_metadata (gstelement_class,
@@ -180,6 +222,8 @@ gst_tcp_client_src_init (GstTCPClientSrc * this)
   this->port = TCP_DEFAULT_PORT;
   this->host = g_strdup (TCP_DEFAULT_HOST);
   this->timeout = TCP_DEFAULT_TIMEOUT;
+  this->buffer_list = DEFAULT_BUFFER_LIST;
+  this->max_read_size = DEFAULT_MAX_READ_SIZE;
   this->socket = NULL;
   this->cancellable = g_cancellable_new ();
 
@@ -219,58 +263,72 @@ gst_tcp_client_src_getcaps (GstBaseSrc * bsrc, GstCaps * filter)
   return caps;
 }
 
-static GstFlowReturn
-gst_tcp_client_src_create (GstPushSrc * psrc, GstBuffer ** outbuf)
+/* Adapt the size of the reads to the amount of data queued on the socket and
+ * make sure the pool has buffers of that size. */
+static gboolean
+gst_tcp_client_src_update_read_size (GstTCPClientSrc * src, gssize avail)
 {
-  GstTCPClientSrc *src;
-  GstFlowReturn ret = GST_FLOW_OK;
-  gssize rret;
-  GError *err = NULL;
-  GstMapInfo map;
-  gssize avail, read;
-
-  src = GST_TCP_CLIENT_SRC (psrc);
+  guint read_size = src->read_size;
+  GstStructure *config;
+
+  if (avail > read_size && read_size < src->max_read_size) {
+    read_size = MIN ((guint64) read_size * 2, src->max_read_size);
+    src->small_reads = 0;
+  } else if (avail < read_size / 4 && read_size > MAX_READ_SIZE) {
+    if (++src->small_reads >= SMALL_READS_SHRINK) {
+      read_size = MAX (read_size / 2, MAX_READ_SIZE);
+      src->small_reads = 0;
+    }
+  } else {
+    src->small_reads = 0;
+  }
 
-  if (!GST_OBJECT_FLAG_IS_SET (src, GST_TCP_CLIENT_SRC_OPEN))
-    goto wrong_state;
+  if (src->pool && read_size == src->read_size)
+    return TRUE;
 
-  GST_LOG_OBJECT (src, "asked for a buffer");
+  GST_DEBUG_OBJECT (src, "reading %u bytes at once", read_size);
+  src->read_size = read_size;
 
-  /* read the buffer header */
-  avail = g_socket_get_available_bytes (src->socket);
-  if (avail < 0) {
-    goto get_available_error;
-  } else if (avail == 0) {
-    GIOCondition condition;
+  /* buffers still in use keep the old pool alive until they are freed */
+  if (src->pool) {
+    gst_buffer_pool_set_active (src->pool, FALSE);
+    gst_object_unref (src->pool);
+  }
 
-    if (!g_socket_condition_wait (src->socket,
-            G_IO_IN | G_IO_PRI | G_IO_ERR | G_IO_HUP, src->cancellable, &err))
-      goto select_error;
+  src->pool = gst_buffer_pool_new ();
+  config = gst_buffer_pool_get_config (src->pool);
+  gst_buffer_pool_config_set_params (config, NULL, read_size, 0, 0);
+  if (!gst_buffer_pool_set_config (src->pool, config) ||
+      !gst_buffer_pool_set_active (src->pool, TRUE)) {
+    gst_clear_object (&src->pool);
+    return FALSE;
+  }
 
-    condition =
-        g_socket_condition_check (src->socket,
-        G_IO_IN | G_IO_PRI | G_IO_ERR | G_IO_HUP);
+  return TRUE;
+}
 
-    if ((condition & G_IO_ERR)) {
-      GST_ELEMENT_ERROR (src, RESOURCE, READ, (NULL),
-          ("Socket in error state"));
-      *outbuf = NULL;
-      ret = GST_FLOW_ERROR;
-      goto done;
-    } else if ((condition & G_IO_HUP)) {
-      GST_DEBUG_OBJECT (src, "Connection closed");
-      *outbuf = NULL;
-      ret = GST_FLOW_EOS;
-      goto done;
-    }
-    avail = g_socket_get_available_bytes (src->socket);
-    if (avail < 0)
-      goto get_available_error;
-  }
+/* Read up to @avail bytes from the socket into a new buffer, @avail 0 means
+ * the connection was closed. Errors are returned in @error and are left to
+ * the caller to post. */
+static GstFlowReturn
+gst_tcp_client_src_receive (GstTCPClientSrc * src, gssize avail,
+    GstBuffer ** outbuf, GError ** error)
+{
+  GstFlowReturn ret = GST_FLOW_OK;
+  gssize rret;
+  GError *err = NULL;
+  GstMapInfo map;
+  gssize read;
 
   if (avail > 0) {
-    read = MIN (avail, MAX_READ_SIZE);
-    *outbuf = gst_buffer_new_and_alloc (read);
+    if (!gst_tcp_client_src_update_read_size (src, avail))
+      goto no_pool;
+
+    if (gst_buffer_pool_acquire_buffer (src->pool, outbuf,
+            NULL) != GST_FLOW_OK)
+      goto no_pool;
+
+    read = MIN (avail, src->read_size);
     gst_buffer_map (*outbuf, &map, GST_MAP_READWRITE);
     rret =
         g_socket_receive (src->socket, (gchar *) map.data, read,
@@ -296,8 +354,8 @@ gst_tcp_client_src_create (GstPushSrc * psrc, GstBuffer ** outbuf)
       GST_DEBUG_OBJECT (src, "Cancelled reading from socket");
     } else {
       ret = GST_FLOW_ERROR;
-      GST_ELEMENT_ERROR (src, RESOURCE, READ, (NULL),
-          ("Failed to read from socket: %s", err->message));
+      g_set_error (error, GST_RESOURCE_ERROR, GST_RESOURCE_ERROR_READ,
+          "Failed to read from socket: %s", err->message);
     }
     gst_buffer_unmap (*outbuf, &map);
     gst_buffer_unref (*outbuf);
@@ -306,7 +364,7 @@ gst_tcp_client_src_create (GstPushSrc * psrc, GstBuffer ** outbuf)
     ret = GST_FLOW_OK;
     gst_buffer_unmap (*outbuf, &map);
     gst_buffer_resize (*outbuf, 0, rret);
-    src->bytes_received += read;
+    src->bytes_received += rret;
 
     GST_LOG_OBJECT (src,
         "Returning buffer from _get of size %" G_GSIZE_FORMAT ", ts %"
@@ -319,6 +377,93 @@ gst_tcp_client_src_create (GstPushSrc * psrc, GstBuffer ** outbuf)
   }
   g_clear_error (&err);
 
+  return ret;
+
+no_pool:
+  {
+    g_set_error (error, GST_RESOURCE_ERROR, GST_RESOURCE_ERROR_READ,
+        "Failed to allocate a buffer of %u bytes", src->read_size);
+    *outbuf = NULL;
+    return GST_FLOW_ERROR;
+  }
+}
+
+static GstFlowReturn
+gst_tcp_client_src_create (GstPushSrc * psrc, GstBuffer ** outbuf)
+{
+  GstTCPClientSrc *src;
+  GstFlowReturn ret = GST_FLOW_OK;
+  GError *err = NULL;
+  gssize avail;
+
+  src = GST_TCP_CLIENT_SRC (psrc);
+
+  if (!GST_OBJECT_FLAG_IS_SET (src, GST_TCP_CLIENT_SRC_OPEN))
+    goto wrong_state;
+
+  GST_LOG_OBJECT (src, "asked for a buffer");
+
+  /* read the buffer header */
+  avail = g_socket_get_available_bytes (src->socket);
+  if (avail < 0) {
+    goto get_available_error;
+  } else if (avail == 0) {
+    GIOCondition condition;
+
+    if (!g_socket_condition_wait (src->socket,
+            G_IO_IN | G_IO_PRI | G_IO_ERR | G_IO_HUP, src->cancellable, &err))
+      goto select_error;
+
+    condition =
+        g_socket_condition_check (src->socket,
+        G_IO_IN | G_IO_PRI | G_IO_ERR | G_IO_HUP);
+
+    if ((condition & G_IO_ERR)) {
+      GST_ELEMENT_ERROR (src, RESOURCE, READ, (NULL),
+          ("Socket in error state"));
+      *outbuf = NULL;
+      ret = GST_FLOW_ERROR;
+      goto done;
+    } else if ((condition & G_IO_HUP)) {
+      GST_DEBUG_OBJECT (src, "Connection closed");
+      *outbuf = NULL;
+      ret = GST_FLOW_EOS;
+      goto done;
+    }
+    avail = g_socket_get_available_bytes (src->socket);
+    if (avail < 0)
+      goto get_available_error;
+  }
+
+  ret = gst_tcp_client_src_receive (src, avail, outbuf, &err);
+  if (ret == GST_FLOW_ERROR)
+    goto receive_error;
+
+  if (ret == GST_FLOW_OK && src->buffer_list) {
+    GstBufferList *list;
+    GstBuffer *buf;
+
+    /* add everything that can be read without blocking */
+    list = gst_buffer_list_new_sized (MAX_LIST_LENGTH);
+    gst_buffer_list_add (list, *outbuf);
+    *outbuf = NULL;
+
+    while (gst_buffer_list_length (list) < MAX_LIST_LENGTH) {
+      avail = g_socket_get_available_bytes (src->socket);
+      if (avail <= 0)
+        break;
+      /* errors and EOS will show up again on the next read, which is the
+       * one to report them */
+      if (gst_tcp_client_src_receive (src, avail, &buf, NULL) != GST_FLOW_OK)
+        break;
+      gst_buffer_list_add (list, buf);
+    }
+
+    GST_LOG_OBJECT (src, "submitting list of %u buffers",
+        gst_buffer_list_length (list));
+    gst_base_src_submit_buffer_list (GST_BASE_SRC (src), list);
+  }
+
 done:
   return ret;
 
@@ -335,6 +480,12 @@ select_error:
     g_clear_error (&err);
     return ret;
   }
+receive_error:
+  {
+    GST_ELEMENT_ERROR (src, RESOURCE, READ, (NULL), ("%s", err->message));
+    g_clear_error (&err);
+    return ret;
+  }
 get_available_error:
   {
     GST_ELEMENT_ERROR (src, RESOURCE, READ, (NULL),
@@ -369,6 +520,12 @@ gst_tcp_client_src_set_property (GObject * object, guint prop_id,
     case PROP_TIMEOUT:
       tcpclientsrc->timeout = g_value_get_uint (value);
       break;
+    case PROP_BUFFER_LIST:
+      tcpclientsrc->buffer_list = g_value_get_boolean (value);
+      break;
+    case PROP_MAX_READ_SIZE:
+      tcpclientsrc->max_read_size = g_value_get_uint (value);
+      break;
 
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
@@ -395,6 +552,12 @@ gst_tcp_client_src_get_property (GObject * object, guint prop_id,
     case PROP_STATS:
       g_value_take_boxed (value, gst_tcp_client_src_get_stats (tcpclientsrc));
       break;
+    case PROP_BUFFER_LIST:
+      g_value_set_boolean (value, tcpclientsrc->buffer_list);
+      break;
+    case PROP_MAX_READ_SIZE:
+      g_value_set_uint (value, tcpclientsrc->max_read_size);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -413,6 +576,8 @@ gst_tcp_client_src_start (GstBaseSrc * bsrc)
 
   src->bytes_received = 0;
   gst_clear_structure (&src->stats);
+  src->read_size = MAX_READ_SIZE;
+  src->small_reads = 0;
 
   /* look up name if we need to */
   addr = g_inet_address_new_from_string (src->host);
@@ -525,6 +690,11 @@ gst_tcp_client_src_stop (GstBaseSrc * bsrc)
     src->socket = NULL;
   }
 
+  if (src->pool) {
+    gst_buffer_pool_set_active (src->pool, FALSE);
+    gst_clear_object (&src->pool);
+  }
+
   GST_OBJECT_FLAG_UNSET (src, GST_TCP_CLIENT_SRC_OPEN);
 
   return TRUE;
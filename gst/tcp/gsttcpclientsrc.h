@@ -63,6 +63,13 @@ struct _GstTCPClientSrc {
 
   guint64 bytes_received;
   GstStructure *stats;
+
+  /* reading */
+  gboolean buffer_list;
+  guint max_read_size;
+  guint read_size;              /* current size of the reads */
+  guint small_reads;            /* consecutive reads much smaller than that */
+  GstBufferPool *pool;          /* pool of buffers of read_size */
 };
 
 struct _GstTCPClientSrcClass {
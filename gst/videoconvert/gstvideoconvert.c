@@ -45,6 +45,7 @@
 #include <gst/video/video.h>
 #include <gst/video/gstvideometa.h>
 #include <gst/video/gstvideopool.h>
+#include <gst/video/video-frame-crop-private.h>
 
 #include <string.h>
 
@@ -110,6 +111,8 @@ static gboolean gst_video_convert_set_info (GstVideoFilter * filter,
     GstVideoInfo * out_info);
 static GstFlowReturn gst_video_convert_transform_frame (GstVideoFilter * filter,
     GstVideoFrame * in_frame, GstVideoFrame * out_frame);
+static gboolean gst_video_convert_propose_allocation (GstBaseTransform * trans,
+    GstQuery * decide_query, GstQuery * query);
 
 static GstCapsFeatures *features_format_interlaced,
     *features_format_interlaced_sysmem;
@@ -480,7 +483,8 @@ gst_video_convert_filter_meta (GstBaseTransform * trans, GstQuery * query,
 {
   /* This element cannot passthrough the crop meta, because it would convert the
    * wrong sub-region of the image, and worst, our output image may not be large
-   * enough for the crop to be applied later */
+   * enough for the crop to be applied later. We apply the crop ourselves
+   * instead, see gst_video_convert_propose_allocation() */
   if (api == GST_VIDEO_CROP_META_API_TYPE)
     return FALSE;
 
@@ -522,7 +526,10 @@ gst_video_convert_transform_meta (GstBaseTransform * trans, GstBuffer * outbuf,
   const GstMetaInfo *info = meta->info;
   gboolean ret;
 
-  if (gst_meta_api_type_has_tag (info->api, _colorspace_quark)) {
+  if (info->api == GST_VIDEO_CROP_META_API_TYPE) {
+    /* the crop was applied while converting */
+    ret = FALSE;
+  } else if (gst_meta_api_type_has_tag (info->api, _colorspace_quark)) {
     /* don't copy colorspace specific metadata, FIXME, we need a MetaTransform
      * for the colorspace metadata. */
     ret = FALSE;
@@ -533,6 +540,30 @@ gst_video_convert_transform_meta (GstBaseTransform * trans, GstBuffer * outbuf,
   return ret;
 }
 
+static gboolean
+gst_video_convert_propose_allocation (GstBaseTransform * trans,
+    GstQuery * decide_query, GstQuery * query)
+{
+  GstVideoFilter *filter = GST_VIDEO_FILTER_CAST (trans);
+
+  if (!GST_BASE_TRANSFORM_CLASS (parent_class)->propose_allocation (trans,
+          decide_query, query))
+    return FALSE;
+
+  /* passthrough, downstream answered the query */
+  if (decide_query == NULL)
+    return TRUE;
+
+  /* Let upstream hand us the uncropped frame, we only convert the visible
+   * region of it. This saves upstream from copying out the crop. */
+  if (__gst_video_frame_can_apply_crop_meta (&filter->in_info)
+      && !gst_query_find_allocation_meta (query,
+          GST_VIDEO_CROP_META_API_TYPE, NULL))
+    gst_query_add_allocation_meta (query, GST_VIDEO_CROP_META_API_TYPE, NULL);
+
+  return TRUE;
+}
+
 static gboolean
 gst_video_convert_set_info (GstVideoFilter * filter,
     GstCaps * incaps, GstVideoInfo * in_info, GstCaps * outcaps,
@@ -542,6 +573,7 @@ gst_video_convert_set_info (GstVideoFilter * filter,
   GstBaseTransformClass *gstbasetransform_class =
       GST_BASE_TRANSFORM_GET_CLASS (filter);
   GstVideoInfo tmp_info;
+  GstTaskPool *pool;
 
   space = GST_VIDEO_CONVERT_CAST (filter);
 
@@ -579,7 +611,9 @@ gst_video_convert_set_info (GstVideoFilter * filter,
   gstbasetransform_class->passthrough_on_same_caps = TRUE;
   gst_base_transform_set_passthrough (GST_BASE_TRANSFORM (filter), FALSE);
 
-  space->convert = gst_video_converter_new (in_info, out_info,
+  /* Slices of all converters in the process run on one set of threads */
+  pool = gst_video_converter_get_shared_task_pool ();
+  space->convert = gst_video_converter_new_with_pool (in_info, out_info,
       gst_structure_new ("GstVideoConvertConfig",
           GST_VIDEO_CONVERTER_OPT_DITHER_METHOD, GST_TYPE_VIDEO_DITHER_METHOD,
           space->dither,
@@ -600,7 +634,8 @@ gst_video_convert_set_info (GstVideoFilter * filter,
           GST_VIDEO_CONVERTER_OPT_PRIMARIES_MODE,
           GST_TYPE_VIDEO_PRIMARIES_MODE, space->primaries_mode,
           GST_VIDEO_CONVERTER_OPT_THREADS, G_TYPE_UINT,
-          space->n_threads, NULL));
+          space->n_threads, NULL), pool);
+  gst_object_unref (pool);
   if (space->convert == NULL)
     goto no_convert;
 
@@ -666,6 +701,8 @@ gst_video_convert_class_init (GstVideoConvertClass * klass)
       GST_DEBUG_FUNCPTR (gst_video_convert_filter_meta);
   gstbasetransform_class->transform_meta =
       GST_DEBUG_FUNCPTR (gst_video_convert_transform_meta);
+  gstbasetransform_class->propose_allocation =
+      GST_DEBUG_FUNCPTR (gst_video_convert_propose_allocation);
 
   gstbasetransform_class->passthrough_on_same_caps = TRUE;
 
@@ -837,6 +874,12 @@ gst_video_convert_transform_frame (GstVideoFilter * filter,
       GST_VIDEO_INFO_NAME (&filter->in_info),
       GST_VIDEO_INFO_NAME (&filter->out_info));
 
+  /* upstream may hand us the uncropped frame, see propose_allocation */
+  if (!__gst_video_frame_apply_crop_meta (in_frame,
+          GST_VIDEO_INFO_WIDTH (&filter->in_info),
+          GST_VIDEO_INFO_HEIGHT (&filter->in_info)))
+    GST_WARNING_OBJECT (filter, "ignoring crop meta on %dx%d frame",
+        GST_VIDEO_FRAME_WIDTH (in_frame), GST_VIDEO_FRAME_HEIGHT (in_frame));
   gst_video_converter_frame (space->convert, in_frame, out_frame);
 
   return GST_FLOW_OK;
@@ -77,6 +77,7 @@
 
 #include <gst/video/gstvideometa.h>
 #include <gst/video/gstvideopool.h>
+#include <gst/video/video-frame-crop-private.h>
 
 #include "gstvideoscale.h"
 
@@ -197,6 +198,8 @@ static GstCaps *gst_video_scale_fixate_caps (GstBaseTransform * base,
 static gboolean gst_video_scale_transform_meta (GstBaseTransform * trans,
     GstBuffer * outbuf, GstMeta * meta, GstBuffer * inbuf);
 
+static gboolean gst_video_scale_propose_allocation (GstBaseTransform * trans,
+    GstQuery * decide_query, GstQuery * query);
 static gboolean gst_video_scale_set_info (GstVideoFilter * filter,
     GstCaps * in, GstVideoInfo * in_info, GstCaps * out,
     GstVideoInfo * out_info);
@@ -293,6 +296,8 @@ gst_video_scale_class_init (GstVideoScaleClass * klass)
   trans_class->src_event = GST_DEBUG_FUNCPTR (gst_video_scale_src_event);
   trans_class->transform_meta =
       GST_DEBUG_FUNCPTR (gst_video_scale_transform_meta);
+  trans_class->propose_allocation =
+      GST_DEBUG_FUNCPTR (gst_video_scale_propose_allocation);
 
   filter_class->set_info = GST_DEBUG_FUNCPTR (gst_video_scale_set_info);
   filter_class->transform_frame =
@@ -520,6 +525,10 @@ gst_video_scale_transform_meta (GstBaseTransform * trans, GstBuffer * outbuf,
     GST_META_TAG_VIDEO_SIZE_STR
   };
 
+  /* The crop was applied while scaling */
+  if (info->api == GST_VIDEO_CROP_META_API_TYPE)
+    return FALSE;
+
   tags = gst_meta_api_type_get_tags (info->api);
 
   /* No specific tags, we are good to copy */
@@ -558,6 +567,30 @@ gst_video_scale_transform_meta (GstBaseTransform * trans, GstBuffer * outbuf,
   return TRUE;
 }
 
+static gboolean
+gst_video_scale_propose_allocation (GstBaseTransform * trans,
+    GstQuery * decide_query, GstQuery * query)
+{
+  GstVideoFilter *filter = GST_VIDEO_FILTER_CAST (trans);
+
+  if (!GST_BASE_TRANSFORM_CLASS (parent_class)->propose_allocation (trans,
+          decide_query, query))
+    return FALSE;
+
+  /* passthrough, downstream answered the query */
+  if (decide_query == NULL)
+    return TRUE;
+
+  /* Let upstream hand us the uncropped frame, we only scale the visible
+   * region of it. This saves upstream from copying out the crop. */
+  if (__gst_video_frame_can_apply_crop_meta (&filter->in_info)
+      && !gst_query_find_allocation_meta (query,
+          GST_VIDEO_CROP_META_API_TYPE, NULL))
+    gst_query_add_allocation_meta (query, GST_VIDEO_CROP_META_API_TYPE, NULL);
+
+  return TRUE;
+}
+
 static gboolean
 gst_video_scale_set_info (GstVideoFilter * filter, GstCaps * in,
     GstVideoInfo * in_info, GstCaps * out, GstVideoInfo * out_info)
@@ -608,6 +641,8 @@ gst_video_scale_set_info (GstVideoFilter * filter, GstCaps * in,
     gst_base_transform_set_passthrough (GST_BASE_TRANSFORM (filter), TRUE);
   } else {
     GstStructure *options;
+    GstTaskPool *pool;
+
     GST_CAT_DEBUG_OBJECT (CAT_PERFORMANCE, filter, "setup videoscaling");
     gst_base_transform_set_passthrough (GST_BASE_TRANSFORM (filter), FALSE);
 
@@ -709,7 +744,11 @@ gst_video_scale_set_info (GstVideoFilter * filter, GstCaps * in,
 
     if (videoscale->convert)
       gst_video_converter_free (videoscale->convert);
-    videoscale->convert = gst_video_converter_new (in_info, out_info, options);
+    /* Slices of all converters in the process run on one set of threads */
+    pool = gst_video_converter_get_shared_task_pool ();
+    videoscale->convert =
+        gst_video_converter_new_with_pool (in_info, out_info, options, pool);
+    gst_object_unref (pool);
   }
 
   GST_DEBUG_OBJECT (videoscale, "from=%dx%d (par=%d/%d dar=%d/%d), size %"
@@ -1180,6 +1219,12 @@ gst_video_scale_transform_frame (GstVideoFilter * filter,
 
   GST_CAT_DEBUG_OBJECT (CAT_PERFORMANCE, filter, "doing video scaling");
 
+  /* upstream may hand us the uncropped frame, see propose_allocation */
+  if (!__gst_video_frame_apply_crop_meta (in_frame,
+          GST_VIDEO_INFO_WIDTH (&filter->in_info),
+          GST_VIDEO_INFO_HEIGHT (&filter->in_info)))
+    GST_WARNING_OBJECT (filter, "ignoring crop meta on %dx%d frame",
+        GST_VIDEO_FRAME_WIDTH (in_frame), GST_VIDEO_FRAME_HEIGHT (in_frame));
   gst_video_converter_frame (videoscale->convert, in_frame, out_frame);
 
   return ret;
@@ -0,0 +1,704 @@
+/* GStreamer video conversion and scaling benchmark
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/* Sweeps GstVideoConverter over input format x output format x input size x
+ * output size x resampler method x thread count, and GstVideoScaler over
+ * format x input size x output size x resampler method, measuring the
+ * horizontal, vertical and combined passes separately.
+ *
+ * Results are printed as a table and can be written as JSON with --json for
+ * comparing runs of different versions, e.g.
+ *
+ *   video-convert-scale -f I420,NV12 -t BGRx -s 1280x720,1920x1080 \
+ *       --json=before.json
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdio.h>
+#include <string.h>
+
+#include <gst/gst.h>
+#include <gst/video/video.h>
+
+#define DEFAULT_FORMATS "I420,NV12,YUY2,AYUV,BGRx,RGB"
+#define DEFAULT_SIZES "640x480,1280x720,1920x1080"
+#define DEFAULT_METHODS "nearest,linear,cubic,lanczos"
+#define DEFAULT_DURATION 0.5
+
+#define QUICK_FORMATS "I420,BGRx"
+#define QUICK_SIZES "320x240,640x480"
+#define QUICK_METHODS "linear"
+#define QUICK_DURATION 0.05
+
+typedef struct
+{
+  gint width, height;
+} Size;
+
+typedef struct
+{
+  GArray *in_formats;
+  GArray *out_formats;
+  GArray *sizes;
+  GArray *methods;
+  GArray *threads;
+  gdouble duration;
+
+  GString *json;
+  guint n_results;
+} Benchmark;
+
+static GArray *
+parse_formats (const gchar * str)
+{
+  GArray *formats = g_array_new (FALSE, FALSE, sizeof (GstVideoFormat));
+  gchar **strv = g_strsplit (str, ",", -1);
+  guint i;
+
+  for (i = 0; strv[i]; i++) {
+    GstVideoFormat format = gst_video_format_from_string (g_strstrip (strv[i]));
+
+    if (format == GST_VIDEO_FORMAT_UNKNOWN) {
+      g_printerr ("Unknown format '%s'\n", strv[i]);
+      continue;
+    }
+    g_array_append_val (formats, format);
+  }
+  g_strfreev (strv);
+
+  return formats;
+}
+
+static GArray *
+parse_sizes (const gchar * str)
+{
+  GArray *sizes = g_array_new (FALSE, FALSE, sizeof (Size));
+  gchar **strv = g_strsplit (str, ",", -1);
+  guint i;
+
+  for (i = 0; strv[i]; i++) {
+    Size size;
+
+    if (sscanf (strv[i], "%dx%d", &size.width, &size.height) != 2
+        || size.width <= 0 || size.height <= 0) {
+      g_printerr ("Invalid size '%s'\n", strv[i]);
+      continue;
+    }
+    g_array_append_val (sizes, size);
+  }
+  g_strfreev (strv);
+
+  return sizes;
+}
+
+static GArray *
+parse_methods (const gchar * str)
+{
+  GArray *methods = g_array_new (FALSE, FALSE, sizeof (gint));
+  GEnumClass *klass = g_type_class_ref (GST_TYPE_VIDEO_RESAMPLER_METHOD);
+  gchar **strv = g_strsplit (str, ",", -1);
+  guint i;
+
+  for (i = 0; strv[i]; i++) {
+    GEnumValue *value = g_enum_get_value_by_nick (klass, g_strstrip (strv[i]));
+
+    if (value == NULL) {
+      g_printerr ("Unknown resampler method '%s'\n", strv[i]);
+      continue;
+    }
+    g_array_append_val (methods, value->value);
+  }
+  g_strfreev (strv);
+  g_type_class_unref (klass);
+
+  return methods;
+}
+
+static GArray *
+parse_threads (const gchar * str)
+{
+  GArray *threads = g_array_new (FALSE, FALSE, sizeof (guint));
+  gchar **strv = g_strsplit (str, ",", -1);
+  guint i;
+
+  for (i = 0; strv[i]; i++) {
+    guint n = g_ascii_strtoull (strv[i], NULL, 10);
+
+    /* 0 means the number of processors, like for the converter option */
+    if (n == 0)
+      n = g_get_num_processors ();
+    g_array_append_val (threads, n);
+  }
+  g_strfreev (strv);
+
+  return threads;
+}
+
+static const gchar *
+method_nick (gint method)
+{
+  GEnumClass *klass = g_type_class_ref (GST_TYPE_VIDEO_RESAMPLER_METHOD);
+  GEnumValue *value = g_enum_get_value (klass, method);
+  const gchar *nick = value ? value->value_nick : "unknown";
+
+  /* Static enum types are never freed, so the nick stays valid */
+  g_type_class_unref (klass);
+
+  return nick;
+}
+
+static GstBuffer *
+alloc_frame (GstVideoFrame * frame, GstVideoInfo * info, GstMapFlags flags)
+{
+  GstBuffer *buffer = gst_buffer_new_allocate (NULL, info->size, NULL);
+  guint8 *data;
+  gsize i;
+  GstMapInfo map;
+
+  /* Some non-uniform content so that no shortcut applies */
+  gst_buffer_map (buffer, &map, GST_MAP_WRITE);
+  data = map.data;
+  for (i = 0; i < map.size; i++)
+    data[i] = (i * 7 + (i >> 8)) & 0xff;
+  gst_buffer_unmap (buffer, &map);
+
+  gst_video_frame_map (frame, info, buffer, flags);
+
+  return buffer;
+}
+
+/* Calls @func until @duration seconds passed and returns the number of
+ * calls, and the time they took in @elapsed */
+static guint
+run_timed (void (*func) (gpointer), gpointer data, gdouble duration,
+    gdouble * elapsed)
+{
+  GTimer *timer = g_timer_new ();
+  guint count = 0;
+
+  /* warmup */
+  func (data);
+
+  g_timer_start (timer);
+  do {
+    func (data);
+    count++;
+    *elapsed = g_timer_elapsed (timer, NULL);
+  } while (*elapsed < duration);
+  g_timer_destroy (timer);
+
+  return count;
+}
+
+static void
+json_begin_result (Benchmark * bench, const gchar * name)
+{
+  if (!bench->json)
+    return;
+
+  g_string_append_printf (bench->json, "%s\n    {\"benchmark\": \"%s\"",
+      bench->n_results > 0 ? "," : "", name);
+  bench->n_results++;
+}
+
+static void
+json_add_string (Benchmark * bench, const gchar * key, const gchar * value)
+{
+  if (bench->json)
+    g_string_append_printf (bench->json, ", \"%s\": \"%s\"", key, value);
+}
+
+static void
+json_add_int (Benchmark * bench, const gchar * key, gint64 value)
+{
+  if (bench->json)
+    g_string_append_printf (bench->json, ", \"%s\": %" G_GINT64_FORMAT, key,
+        value);
+}
+
+static void
+json_add_double (Benchmark * bench, const gchar * key, gdouble value)
+{
+  gchar buf[G_ASCII_DTOSTR_BUF_SIZE];
+
+  if (bench->json)
+    g_string_append_printf (bench->json, ", \"%s\": %s", key,
+        g_ascii_formatd (buf, sizeof (buf), "%.3f", value));
+}
+
+static void
+json_end_result (Benchmark * bench)
+{
+  if (bench->json)
+    g_string_append (bench->json, "}");
+}
+
+/* GstVideoConverter */
+
+typedef struct
+{
+  GstVideoConverter *convert;
+  GstVideoFrame *in_frame, *out_frame;
+} ConvertData;
+
+static void
+convert_frame (ConvertData * data)
+{
+  gst_video_converter_frame (data->convert, data->in_frame, data->out_frame);
+}
+
+static void
+benchmark_converter_run (Benchmark * bench, GstVideoFormat in_format,
+    GstVideoFormat out_format, const Size * in_size, const Size * out_size,
+    gint method, guint n_threads)
+{
+  GstVideoInfo in_info, out_info;
+  GstVideoFrame in_frame, out_frame;
+  GstBuffer *in_buf, *out_buf;
+  ConvertData data;
+  gboolean scaling;
+  gint64 setup_start, setup_time;
+  gdouble elapsed, mpix;
+  guint count;
+
+  gst_video_info_set_format (&in_info, in_format, in_size->width,
+      in_size->height);
+  gst_video_info_set_format (&out_info, out_format, out_size->width,
+      out_size->height);
+  in_buf = alloc_frame (&in_frame, &in_info, GST_MAP_READ);
+  out_buf = alloc_frame (&out_frame, &out_info, GST_MAP_WRITE);
+
+  scaling = in_size->width != out_size->width
+      || in_size->height != out_size->height;
+
+  setup_start = g_get_monotonic_time ();
+  data.convert = gst_video_converter_new (&in_info, &out_info,
+      gst_structure_new ("GstVideoConverter",
+          GST_VIDEO_CONVERTER_OPT_RESAMPLER_METHOD,
+          GST_TYPE_VIDEO_RESAMPLER_METHOD, method,
+          GST_VIDEO_CONVERTER_OPT_THREADS, G_TYPE_UINT, n_threads, NULL));
+  setup_time = g_get_monotonic_time () - setup_start;
+
+  if (data.convert == NULL) {
+    g_printerr ("No conversion from %s to %s\n",
+        gst_video_format_to_string (in_format),
+        gst_video_format_to_string (out_format));
+    goto done;
+  }
+
+  data.in_frame = &in_frame;
+  data.out_frame = &out_frame;
+  count = run_timed ((void (*)(gpointer)) convert_frame, &data,
+      bench->duration, &elapsed);
+  mpix = (gdouble) out_size->width * out_size->height * count / elapsed / 1e6;
+
+  gst_println ("converter %-6s -> %-6s %5dx%-5d -> %5dx%-5d %-8s %2u threads:"
+      " %9.2f Mpix/s %8.3f ms/frame (setup %.3f ms)",
+      gst_video_format_to_string (in_format),
+      gst_video_format_to_string (out_format), in_size->width,
+      in_size->height, out_size->width, out_size->height,
+      scaling ? method_nick (method) : "-", n_threads, mpix,
+      elapsed * 1000.0 / count, setup_time / 1000.0);
+
+  json_begin_result (bench, "converter");
+  json_add_string (bench, "in_format", gst_video_format_to_string (in_format));
+  json_add_string (bench, "out_format",
+      gst_video_format_to_string (out_format));
+  json_add_int (bench, "in_width", in_size->width);
+  json_add_int (bench, "in_height", in_size->height);
+  json_add_int (bench, "out_width", out_size->width);
+  json_add_int (bench, "out_height", out_size->height);
+  json_add_string (bench, "method", scaling ? method_nick (method) : "none");
+  json_add_int (bench, "threads", n_threads);
+  json_add_int (bench, "frames", count);
+  json_add_double (bench, "seconds", elapsed);
+  json_add_double (bench, "mpix_per_sec", mpix);
+  json_add_double (bench, "ms_per_frame", elapsed * 1000.0 / count);
+  json_add_double (bench, "setup_ms", setup_time / 1000.0);
+  json_end_result (bench);
+
+  gst_video_converter_free (data.convert);
+
+done:
+  gst_video_frame_unmap (&in_frame);
+  gst_video_frame_unmap (&out_frame);
+  gst_buffer_unref (in_buf);
+  gst_buffer_unref (out_buf);
+}
+
+static void
+benchmark_converter (Benchmark * bench)
+{
+  guint i, o, s, t, m, th;
+
+  for (i = 0; i < bench->in_formats->len; i++) {
+    for (o = 0; o < bench->out_formats->len; o++) {
+      for (s = 0; s < bench->sizes->len; s++) {
+        for (t = 0; t < bench->sizes->len; t++) {
+          const Size *in_size = &g_array_index (bench->sizes, Size, s);
+          const Size *out_size = &g_array_index (bench->sizes, Size, t);
+          gboolean scaling = s != t;
+
+          for (m = 0; m < bench->methods->len; m++) {
+            /* The method only matters when scaling */
+            if (!scaling && m > 0)
+              break;
+
+            for (th = 0; th < bench->threads->len; th++) {
+              benchmark_converter_run (bench,
+                  g_array_index (bench->in_formats, GstVideoFormat, i),
+                  g_array_index (bench->out_formats, GstVideoFormat, o),
+                  in_size, out_size, g_array_index (bench->methods, gint, m),
+                  g_array_index (bench->threads, guint, th));
+            }
+          }
+        }
+      }
+    }
+  }
+}
+
+/* GstVideoScaler */
+
+typedef struct
+{
+  GstVideoScaler *h_scaler, *v_scaler;
+  GstVideoFormat format;
+  gpointer src, dest;
+  gint src_stride, dest_stride;
+  gint width, height;
+} ScaleData;
+
+static void
+scale_plane (ScaleData * data)
+{
+  gst_video_scaler_2d (data->h_scaler, data->v_scaler, data->format,
+      data->src, data->src_stride, data->dest, data->dest_stride, 0, 0,
+      data->width, data->height);
+}
+
+/* The formats gst_video_scaler_2d() can handle directly */
+static gboolean
+scaler_supports_format (GstVideoFormat format)
+{
+  switch (format) {
+    case GST_VIDEO_FORMAT_GRAY8:
+    case GST_VIDEO_FORMAT_GRAY16_LE:
+    case GST_VIDEO_FORMAT_GRAY16_BE:
+    case GST_VIDEO_FORMAT_YUY2:
+    case GST_VIDEO_FORMAT_YVYU:
+    case GST_VIDEO_FORMAT_UYVY:
+    case GST_VIDEO_FORMAT_RGB:
+    case GST_VIDEO_FORMAT_BGR:
+    case GST_VIDEO_FORMAT_v308:
+    case GST_VIDEO_FORMAT_IYU2:
+    case GST_VIDEO_FORMAT_AYUV:
+    case GST_VIDEO_FORMAT_RGBx:
+    case GST_VIDEO_FORMAT_BGRx:
+    case GST_VIDEO_FORMAT_xRGB:
+    case GST_VIDEO_FORMAT_xBGR:
+    case GST_VIDEO_FORMAT_RGBA:
+    case GST_VIDEO_FORMAT_BGRA:
+    case GST_VIDEO_FORMAT_ARGB:
+    case GST_VIDEO_FORMAT_ABGR:
+    case GST_VIDEO_FORMAT_ARGB64:
+    case GST_VIDEO_FORMAT_AYUV64:
+    case GST_VIDEO_FORMAT_NV12:
+      return TRUE;
+    default:
+      return FALSE;
+  }
+}
+
+static GstVideoScaler *
+new_scaler (GstVideoFormat format, gint method, guint in_size, guint out_size)
+{
+  GstVideoScaler *scaler, *y_scaler, *uv_scaler;
+
+  if (in_size == out_size)
+    return NULL;
+
+  if (format != GST_VIDEO_FORMAT_YUY2 && format != GST_VIDEO_FORMAT_YVYU
+      && format != GST_VIDEO_FORMAT_UYVY)
+    return gst_video_scaler_new (method, GST_VIDEO_SCALER_FLAG_NONE, 0,
+        in_size, out_size, NULL);
+
+  /* Packed 4:2:2 needs the luma and chroma scalers combined like the
+   * converter does */
+  y_scaler = gst_video_scaler_new (method, GST_VIDEO_SCALER_FLAG_NONE, 0,
+      in_size, out_size, NULL);
+  uv_scaler = gst_video_scaler_new (method, GST_VIDEO_SCALER_FLAG_NONE,
+      gst_video_scaler_get_max_taps (y_scaler), (in_size + 1) / 2,
+      (out_size + 1) / 2, NULL);
+  scaler = gst_video_scaler_combine_packed_YUV (y_scaler, uv_scaler, format,
+      format);
+  gst_video_scaler_free (y_scaler);
+  gst_video_scaler_free (uv_scaler);
+
+  return scaler;
+}
+
+static void
+benchmark_scaler_run (Benchmark * bench, GstVideoFormat format,
+    const Size * in_size, const Size * out_size, gint method)
+{
+  /* Each pass separately, and both of them combined */
+  static const struct
+  {
+    const gchar *name;
+    gboolean h, v;
+  } passes[] = {
+    {"horizontal", TRUE, FALSE},
+    {"vertical", FALSE, TRUE},
+    {"2d", TRUE, TRUE},
+  };
+  GstVideoInfo in_info, out_info;
+  GstVideoFrame in_frame, out_frame;
+  GstBuffer *in_buf, *out_buf;
+  GstVideoScaler *h_scaler, *v_scaler;
+  guint p;
+
+  gst_video_info_set_format (&in_info, format, in_size->width,
+      in_size->height);
+  gst_video_info_set_format (&out_info, format, out_size->width,
+      out_size->height);
+  in_buf = alloc_frame (&in_frame, &in_info, GST_MAP_READ);
+  out_buf = alloc_frame (&out_frame, &out_info, GST_MAP_WRITE);
+
+  h_scaler = new_scaler (format, method, in_size->width, out_size->width);
+  v_scaler = new_scaler (GST_VIDEO_FORMAT_GRAY8, method, in_size->height,
+      out_size->height);
+
+  for (p = 0; p < G_N_ELEMENTS (passes); p++) {
+    ScaleData data;
+    gdouble elapsed, mpix;
+    guint count, plane = 0;
+    gint width, height;
+
+    /* Skip passes without a scaler */
+    if ((passes[p].h && !h_scaler) || (passes[p].v && !v_scaler))
+      continue;
+
+    width = passes[p].h ? out_size->width : MIN (in_size->width,
+        out_size->width);
+    height = passes[p].v ? out_size->height : MIN (in_size->height,
+        out_size->height);
+
+    /* NV12 is scaled per plane, use the chroma plane with its own format
+     * for the horizontal pass */
+    if (format == GST_VIDEO_FORMAT_NV12) {
+      plane = 1;
+      width = (width + 1) / 2;
+      height = (height + 1) / 2;
+    }
+
+    data.h_scaler = passes[p].h ? h_scaler : NULL;
+    data.v_scaler = passes[p].v ? v_scaler : NULL;
+    data.format = format;
+    data.src = GST_VIDEO_FRAME_PLANE_DATA (&in_frame, plane);
+    data.src_stride = GST_VIDEO_FRAME_PLANE_STRIDE (&in_frame, plane);
+    data.dest = GST_VIDEO_FRAME_PLANE_DATA (&out_frame, plane);
+    data.dest_stride = GST_VIDEO_FRAME_PLANE_STRIDE (&out_frame, plane);
+    data.width = width;
+    data.height = height;
+
+    if (format == GST_VIDEO_FORMAT_NV12) {
+      /* The chroma plane is half the size, so are its scalers */
+      data.h_scaler = passes[p].h ? gst_video_scaler_new (method,
+          GST_VIDEO_SCALER_FLAG_NONE, 0, (in_size->width + 1) / 2,
+          (out_size->width + 1) / 2, NULL) : NULL;
+      data.v_scaler = passes[p].v ? gst_video_scaler_new (method,
+          GST_VIDEO_SCALER_FLAG_NONE, 0, (in_size->height + 1) / 2,
+          (out_size->height + 1) / 2, NULL) : NULL;
+    }
+
+    count = run_timed ((void (*)(gpointer)) scale_plane, &data,
+        bench->duration, &elapsed);
+    mpix = (gdouble) width * height * count / elapsed / 1e6;
+
+    gst_println ("scaler    %-6s %-10s %5dx%-5d -> %5dx%-5d %-8s           :"
+        " %9.2f Mpix/s %8.3f ms/frame", gst_video_format_to_string (format),
+        passes[p].name, in_size->width, in_size->height, out_size->width,
+        out_size->height, method_nick (method), mpix,
+        elapsed * 1000.0 / count);
+
+    json_begin_result (bench, "scaler");
+    json_add_string (bench, "format", gst_video_format_to_string (format));
+    json_add_string (bench, "pass", passes[p].name);
+    json_add_int (bench, "in_width", in_size->width);
+    json_add_int (bench, "in_height", in_size->height);
+    json_add_int (bench, "out_width", out_size->width);
+    json_add_int (bench, "out_height", out_size->height);
+    json_add_string (bench, "method", method_nick (method));
+    json_add_int (bench, "frames", count);
+    json_add_double (bench, "seconds", elapsed);
+    json_add_double (bench, "mpix_per_sec", mpix);
+    json_add_double (bench, "ms_per_frame", elapsed * 1000.0 / count);
+    json_end_result (bench);
+
+    if (format == GST_VIDEO_FORMAT_NV12) {
+      if (data.h_scaler)
+        gst_video_scaler_free (data.h_scaler);
+      if (data.v_scaler)
+        gst_video_scaler_free (data.v_scaler);
+    }
+  }
+
+  if (h_scaler)
+    gst_video_scaler_free (h_scaler);
+  if (v_scaler)
+    gst_video_scaler_free (v_scaler);
+
+  gst_video_frame_unmap (&in_frame);
+  gst_video_frame_unmap (&out_frame);
+  gst_buffer_unref (in_buf);
+  gst_buffer_unref (out_buf);
+}
+
+static void
+benchmark_scaler (Benchmark * bench)
+{
+  guint f, s, t, m;
+
+  for (f = 0; f < bench->in_formats->len; f++) {
+    GstVideoFormat format = g_array_index (bench->in_formats, GstVideoFormat,
+        f);
+
+    if (!scaler_supports_format (format))
+      continue;
+
+    for (s = 0; s < bench->sizes->len; s++) {
+      for (t = 0; t < bench->sizes->len; t++) {
+        if (s == t)
+          continue;
+
+        for (m = 0; m < bench->methods->len; m++) {
+          benchmark_scaler_run (bench, format,
+              &g_array_index (bench->sizes, Size, s),
+              &g_array_index (bench->sizes, Size, t),
+              g_array_index (bench->methods, gint, m));
+        }
+      }
+    }
+  }
+}
+
+int
+main (int argc, char **argv)
+{
+  GError *err = NULL;
+  gchar *in_formats = NULL, *out_formats = NULL, *sizes = NULL;
+  gchar *methods = NULL, *threads = NULL, *json_file = NULL;
+  gdouble duration = -1;
+  gboolean quick = FALSE, no_converter = FALSE, no_scaler = FALSE;
+  gchar *default_threads;
+  Benchmark bench = { NULL, };
+  GOptionContext *ctx;
+  GOptionEntry options[] = {
+    {"from-formats", 'f', 0, G_OPTION_ARG_STRING, &in_formats,
+        "Comma separated input formats (default " DEFAULT_FORMATS ")", NULL},
+    {"to-formats", 't', 0, G_OPTION_ARG_STRING, &out_formats,
+        "Comma separated output formats (default: the input formats)", NULL},
+    {"sizes", 's', 0, G_OPTION_ARG_STRING, &sizes,
+          "Comma separated WIDTHxHEIGHT sizes, all combinations are used as "
+          "input and output size (default " DEFAULT_SIZES ")", NULL},
+    {"methods", 'm', 0, G_OPTION_ARG_STRING, &methods,
+        "Comma separated resampler methods (default " DEFAULT_METHODS ")",
+        NULL},
+    {"threads", 'n', 0, G_OPTION_ARG_STRING, &threads,
+          "Comma separated converter thread counts, 0 for the number of "
+          "processors (default 1,0)", NULL},
+    {"duration", 'd', 0, G_OPTION_ARG_DOUBLE, &duration,
+        "Duration of each run in seconds", NULL},
+    {"quick", 'q', 0, G_OPTION_ARG_NONE, &quick,
+        "Only run a small subset of the matrix", NULL},
+    {"no-converter", 0, 0, G_OPTION_ARG_NONE, &no_converter,
+        "Don't benchmark GstVideoConverter", NULL},
+    {"no-scaler", 0, 0, G_OPTION_ARG_NONE, &no_scaler,
+        "Don't benchmark GstVideoScaler", NULL},
+    {"json", 'j', 0, G_OPTION_ARG_FILENAME, &json_file,
+        "Write the results as JSON to this file, - for stdout", NULL},
+    {NULL}
+  };
+
+  ctx = g_option_context_new ("- benchmark video conversion and scaling");
+  g_option_context_add_main_entries (ctx, options, NULL);
+  g_option_context_add_group (ctx, gst_init_get_option_group ());
+  if (!g_option_context_parse (ctx, &argc, &argv, &err)) {
+    g_print ("Error initializing: %s\n", GST_STR_NULL (err->message));
+    g_option_context_free (ctx);
+    g_clear_error (&err);
+    return 1;
+  }
+  g_option_context_free (ctx);
+
+  default_threads = quick ? g_strdup ("1") : g_strdup ("1,0");
+
+  bench.in_formats = parse_formats (in_formats ? in_formats :
+      quick ? QUICK_FORMATS : DEFAULT_FORMATS);
+  bench.out_formats = parse_formats (out_formats ? out_formats :
+      in_formats ? in_formats : quick ? QUICK_FORMATS : DEFAULT_FORMATS);
+  bench.sizes = parse_sizes (sizes ? sizes : quick ? QUICK_SIZES :
+      DEFAULT_SIZES);
+  bench.methods = parse_methods (methods ? methods : quick ? QUICK_METHODS :
+      DEFAULT_METHODS);
+  bench.threads = parse_threads (threads ? threads : default_threads);
+  bench.duration = duration > 0 ? duration : quick ? QUICK_DURATION :
+      DEFAULT_DURATION;
+
+  if (json_file) {
+    bench.json = g_string_new ("{\n  \"version\": \"");
+    g_string_append (bench.json, PACKAGE_VERSION);
+    g_string_append (bench.json, "\",\n  \"results\": [");
+  }
+
+  if (!no_converter)
+    benchmark_converter (&bench);
+  if (!no_scaler)
+    benchmark_scaler (&bench);
+
+  if (json_file) {
+    g_string_append (bench.json, "\n  ]\n}\n");
+
+    if (!strcmp (json_file, "-")) {
+      g_print ("%s", bench.json->str);
+    } else if (!g_file_set_contents (json_file, bench.json->str, -1, &err)) {
+      g_printerr ("Could not write %s: %s\n", json_file, err->message);
+      g_clear_error (&err);
+    }
+    g_string_free (bench.json, TRUE);
+  }
+
+  g_array_free (bench.in_formats, TRUE);
+  g_array_free (bench.out_formats, TRUE);
+  g_array_free (bench.sizes, TRUE);
+  g_array_free (bench.methods, TRUE);
+  g_array_free (bench.threads, TRUE);
+  g_free (default_threads);
+  g_free (in_formats);
+  g_free (out_formats);
+  g_free (sizes);
+  g_free (methods);
+  g_free (threads);
+  g_free (json_file);
+
+  return 0;
+}
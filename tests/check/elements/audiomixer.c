@@ -1546,6 +1546,104 @@ GST_START_TEST (test_sync_unaligned)
 
 GST_END_TEST;
 
+/* Mix three S16 streams whose sum is in range although the sum of the first
+ * two is not. In accumulate mode no intermediate result must be clamped. */
+GST_START_TEST (test_accumulate)
+{
+  /* 0x7575 = 30069 and 0x8a8a = -30070 */
+  static const gint values[] = { 0x75, 0x75, 0x8a };
+  GstElement *bin, *audiomixer, *sink;
+  GstPad *sinkpads[G_N_ELEMENTS (values)];
+  GstPad *queue_sinkpads[G_N_ELEMENTS (values)];
+  GstBus *bus;
+  GstStateChangeReturn state_res;
+  GstFlowReturn ret;
+  GstSegment segment;
+  GstCaps *caps;
+  GList *received_buffers = NULL, *l;
+  GstMapInfo map;
+  gsize i;
+
+  bin = gst_pipeline_new ("pipeline");
+  bus = gst_element_get_bus (bin);
+  gst_bus_add_signal_watch_full (bus, G_PRIORITY_HIGH);
+
+  g_signal_connect (bus, "message::error", (GCallback) message_received, bin);
+  g_signal_connect (bus, "message::warning", (GCallback) message_received, bin);
+  g_signal_connect (bus, "message::eos", (GCallback) message_received, bin);
+
+  audiomixer = gst_element_factory_make ("audiomixer", "audiomixer");
+  g_object_set (audiomixer, "output-buffer-duration", 500 * GST_MSECOND,
+      "accumulate", TRUE, NULL);
+  sink = gst_element_factory_make ("fakesink", "sink");
+  g_object_set (sink, "signal-handoffs", TRUE, NULL);
+  g_signal_connect (sink, "handoff", (GCallback) handoff_buffer_collect_cb,
+      &received_buffers);
+  gst_bin_add_many (GST_BIN (bin), audiomixer, sink, NULL);
+  fail_unless (gst_element_link (audiomixer, sink));
+
+  state_res = gst_element_set_state (bin, GST_STATE_PAUSED);
+  ck_assert_int_ne (state_res, GST_STATE_CHANGE_FAILURE);
+
+  caps = gst_caps_new_simple ("audio/x-raw",
+      "format", G_TYPE_STRING, GST_AUDIO_NE (S16),
+      "layout", G_TYPE_STRING, "interleaved",
+      "rate", G_TYPE_INT, 1000, "channels", G_TYPE_INT, 1, NULL);
+  gst_segment_init (&segment, GST_FORMAT_TIME);
+
+  for (i = 0; i < G_N_ELEMENTS (values); i++) {
+    GstElement *queue = gst_element_factory_make ("queue", NULL);
+    GstPad *pad;
+
+    gst_bin_add (GST_BIN (bin), queue);
+    gst_element_sync_state_with_parent (queue);
+
+    sinkpads[i] = gst_element_get_request_pad (audiomixer, "sink_%u");
+    fail_if (sinkpads[i] == NULL, NULL);
+    pad = gst_element_get_static_pad (queue, "src");
+    fail_unless (gst_pad_link (pad, sinkpads[i]) == GST_PAD_LINK_OK);
+    gst_object_unref (pad);
+
+    queue_sinkpads[i] = gst_element_get_static_pad (queue, "sink");
+    gst_pad_send_event (queue_sinkpads[i], gst_event_new_stream_start ("test"));
+    gst_pad_set_caps (queue_sinkpads[i], caps);
+    gst_pad_send_event (queue_sinkpads[i], gst_event_new_segment (&segment));
+  }
+  gst_caps_unref (caps);
+
+  for (i = 0; i < G_N_ELEMENTS (values); i++) {
+    ret = gst_pad_chain (queue_sinkpads[i],
+        new_buffer (2000, values[i], 0, GST_SECOND, 0));
+    ck_assert_int_eq (ret, GST_FLOW_OK);
+    gst_pad_send_event (queue_sinkpads[i], gst_event_new_eos ());
+  }
+
+  g_idle_add ((GSourceFunc) set_playing, bin);
+  g_main_loop_run (main_loop);
+
+  fail_unless_equals_int (g_list_length (received_buffers), 2);
+  for (l = received_buffers; l; l = l->next) {
+    gst_buffer_map (l->data, &map, GST_MAP_READ);
+    fail_unless_equals_int (map.size, 1000);
+    for (i = 0; i < map.size / 2; i++)
+      fail_unless_equals_int (((gint16 *) map.data)[i], 30068);
+    gst_buffer_unmap (l->data, &map);
+  }
+  g_list_free_full (received_buffers, (GDestroyNotify) gst_buffer_unref);
+
+  for (i = 0; i < G_N_ELEMENTS (values); i++) {
+    gst_element_release_request_pad (audiomixer, sinkpads[i]);
+    gst_object_unref (sinkpads[i]);
+    gst_object_unref (queue_sinkpads[i]);
+  }
+  gst_element_set_state (bin, GST_STATE_NULL);
+  gst_bus_remove_signal_watch (bus);
+  gst_object_unref (bus);
+  gst_object_unref (bin);
+}
+
+GST_END_TEST;
+
 GST_START_TEST (test_segment_base_handling)
 {
   GstElement *pipeline, *sink, *mix, *src1, *src2;
@@ -1970,6 +2068,7 @@ audiomixer_suite (void)
   tcase_add_test (tc_chain, test_sync);
   tcase_add_test (tc_chain, test_sync_discont);
   tcase_add_test (tc_chain, test_sync_unaligned);
+  tcase_add_test (tc_chain, test_accumulate);
   tcase_add_test (tc_chain, test_segment_base_handling);
   tcase_add_test (tc_chain, test_sinkpad_property_controller);
   tcase_add_checked_fixture (tc_chain, test_setup, test_teardown);
@@ -25,6 +25,7 @@
 #endif
 
 #include <gst/check/gstcheck.h>
+#include <gst/check/gstharness.h>
 
 #include <gst/audio/audio.h>
 
@@ -1260,6 +1261,59 @@ GST_START_TEST (test_fft)
 
 GST_END_TEST;
 
+#define DRIFT_CAPS "audio/x-raw, format=" GST_AUDIO_NE (F32) \
+    ", rate=48000, channels=1, layout=interleaved"
+
+GST_START_TEST (test_drift_compensation)
+{
+  GstHarness *h;
+  GstBuffer *inbuffer, *outbuffer;
+  guint64 in_samples, out_samples = 0;
+  gdouble drift;
+  gint i;
+
+  h = gst_harness_new ("audioresample");
+  g_object_set (h->element, "drift-compensation", TRUE, NULL);
+  gst_harness_set_caps_str (h, DRIFT_CAPS, DRIFT_CAPS);
+
+  /* 30s of 10ms buffers whose timestamps advance 500ppm faster than the
+   * sample count suggests, so samples have to be added */
+  for (i = 0; i < 3000; i++) {
+    inbuffer = gst_buffer_new_allocate (NULL, 480 * sizeof (gfloat), NULL);
+    gst_buffer_memset (inbuffer, 0, 0, 480 * sizeof (gfloat));
+    GST_BUFFER_PTS (inbuffer) = i * 10005 * GST_USECOND;
+    GST_BUFFER_DURATION (inbuffer) = 10005 * GST_USECOND;
+    GST_BUFFER_OFFSET (inbuffer) = i * 480;
+    GST_BUFFER_OFFSET_END (inbuffer) = (i + 1) * 480;
+    if (i == 0)
+      GST_BUFFER_FLAG_SET (inbuffer, GST_BUFFER_FLAG_DISCONT);
+
+    fail_unless_equals_int (gst_harness_push (h, inbuffer), GST_FLOW_OK);
+
+    while ((outbuffer = gst_harness_try_pull (h))) {
+      /* no new discont must have been detected */
+      if (out_samples > 0)
+        fail_if (GST_BUFFER_FLAG_IS_SET (outbuffer, GST_BUFFER_FLAG_DISCONT));
+      out_samples += gst_buffer_get_size (outbuffer) / sizeof (gfloat);
+      gst_buffer_unref (outbuffer);
+    }
+  }
+
+  g_object_get (h->element, "drift", &drift, NULL);
+  GST_DEBUG ("drift after 30s: %f ppm", drift);
+  fail_unless (drift > 400.0 && drift < 700.0);
+
+  /* the output covers the input timestamps, not the input sample count,
+   * minus the filter latency */
+  in_samples = 3000 * 480;
+  fail_unless (out_samples > in_samples);
+  fail_unless (out_samples < in_samples + in_samples / 1000);
+
+  gst_harness_teardown (h);
+}
+
+GST_END_TEST;
+
 static Suite *
 audioresample_suite (void)
 {
@@ -1274,6 +1328,7 @@ audioresample_suite (void)
   tcase_add_test (tc_chain, test_live_switch);
   tcase_add_test (tc_chain, test_live_switch_downstream);
   tcase_add_test (tc_chain, test_timestamp_drift);
+  tcase_add_test (tc_chain, test_drift_compensation);
   tcase_add_test (tc_chain, test_fft);
 
 #ifndef GST_DISABLE_PARSE
@@ -1984,6 +1984,408 @@ typedef struct
   gboolean drop;
 } TestStartTimeSelectionData;
 
+static GstPadProbeReturn
+grab_buffer_cb (GstPad * pad, GstPadProbeInfo * info, gpointer user_data)
+{
+  GstBuffer **out = user_data;
+
+  if (*out == NULL)
+    *out = gst_buffer_ref (GST_PAD_PROBE_INFO_BUFFER (info));
+
+  return GST_PAD_PROBE_OK;
+}
+
+static GstBuffer *
+run_mosaic (guint prepare_threads)
+{
+  GstElement *pipeline, *compositor, *sink;
+  GstBuffer *out = NULL;
+  GstMessage *msg;
+  GstPad *pad;
+  GstBus *bus;
+  GError *error = NULL;
+
+  pipeline = gst_parse_launch ("compositor name=c background=black "
+      "sink_1::xpos=32 sink_2::ypos=32 "
+      "sink_3::xpos=32 sink_3::ypos=32 sink_3::width=16 "
+      "! video/x-raw,format=AYUV,width=64,height=64 ! fakesink name=sink "
+      "videotestsrc num-buffers=1 pattern=smpte "
+      "! video/x-raw,format=I420,width=32,height=32 ! c. "
+      "videotestsrc num-buffers=1 pattern=ball "
+      "! video/x-raw,format=RGBA,width=32,height=32 ! c. "
+      "videotestsrc num-buffers=1 pattern=zone-plate "
+      "! video/x-raw,format=NV12,width=48,height=48 ! c. "
+      "videotestsrc num-buffers=1 pattern=checkers-8 "
+      "! video/x-raw,format=YUY2,width=32,height=32 ! c. ", &error);
+  fail_unless (pipeline != NULL, "%s", error ? error->message : "");
+
+  compositor = gst_bin_get_by_name (GST_BIN (pipeline), "c");
+  g_object_set (compositor, "prepare-threads", prepare_threads, NULL);
+  gst_object_unref (compositor);
+
+  sink = gst_bin_get_by_name (GST_BIN (pipeline), "sink");
+  pad = gst_element_get_static_pad (sink, "sink");
+  gst_pad_add_probe (pad, GST_PAD_PROBE_TYPE_BUFFER, grab_buffer_cb, &out,
+      NULL);
+  gst_object_unref (pad);
+  gst_object_unref (sink);
+
+  fail_unless (gst_element_set_state (pipeline,
+          GST_STATE_PLAYING) != GST_STATE_CHANGE_FAILURE);
+
+  bus = gst_element_get_bus (pipeline);
+  msg = gst_bus_timed_pop_filtered (bus, GST_CLOCK_TIME_NONE,
+      GST_MESSAGE_EOS | GST_MESSAGE_ERROR);
+  fail_unless_equals_int (GST_MESSAGE_TYPE (msg), GST_MESSAGE_EOS);
+  gst_message_unref (msg);
+  gst_object_unref (bus);
+
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+  gst_object_unref (pipeline);
+
+  fail_unless (out != NULL);
+
+  return out;
+}
+
+GST_START_TEST (test_prepare_threads)
+{
+  GstBuffer *serial, *parallel;
+  GstMapInfo map;
+
+  serial = run_mosaic (1);
+  parallel = run_mosaic (4);
+
+  gst_buffer_map (serial, &map, GST_MAP_READ);
+  fail_unless_equals_int (gst_buffer_get_size (parallel), map.size);
+  fail_unless (gst_buffer_memcmp (parallel, 0, map.data, map.size) == 0);
+  gst_buffer_unmap (serial, &map);
+
+  gst_buffer_unref (serial);
+  gst_buffer_unref (parallel);
+}
+
+GST_END_TEST;
+
+static GstPadProbeReturn
+grab_buffer_list_cb (GstPad * pad, GstPadProbeInfo * info, gpointer user_data)
+{
+  GList **out = user_data;
+
+  *out = g_list_append (*out, gst_buffer_ref (GST_PAD_PROBE_INFO_BUFFER (info)));
+
+  return GST_PAD_PROBE_OK;
+}
+
+/* Runs @desc to EOS and returns all buffers that arrived at the sink named
+ * "sink" */
+static GList *
+run_compositor_pipeline (const gchar * desc)
+{
+  GstElement *pipeline, *sink;
+  GList *out = NULL;
+  GstMessage *msg;
+  GstPad *pad;
+  GstBus *bus;
+  GError *error = NULL;
+
+  pipeline = gst_parse_launch (desc, &error);
+  fail_unless (pipeline != NULL, "%s", error ? error->message : "");
+
+  sink = gst_bin_get_by_name (GST_BIN (pipeline), "sink");
+  pad = gst_element_get_static_pad (sink, "sink");
+  gst_pad_add_probe (pad, GST_PAD_PROBE_TYPE_BUFFER, grab_buffer_list_cb, &out,
+      NULL);
+  gst_object_unref (pad);
+  gst_object_unref (sink);
+
+  fail_unless (gst_element_set_state (pipeline,
+          GST_STATE_PLAYING) != GST_STATE_CHANGE_FAILURE);
+
+  bus = gst_element_get_bus (pipeline);
+  msg = gst_bus_timed_pop_filtered (bus, GST_CLOCK_TIME_NONE,
+      GST_MESSAGE_EOS | GST_MESSAGE_ERROR);
+  fail_unless_equals_int (GST_MESSAGE_TYPE (msg), GST_MESSAGE_EOS);
+  gst_message_unref (msg);
+  gst_object_unref (bus);
+
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+  gst_object_unref (pipeline);
+
+  fail_unless (out != NULL);
+
+  return out;
+}
+
+static void
+compare_buffer_lists (GList * l1, GList * l2)
+{
+  GstMapInfo map;
+
+  fail_unless_equals_int (g_list_length (l1), g_list_length (l2));
+
+  for (; l1 && l2; l1 = l1->next, l2 = l2->next) {
+    gst_buffer_map (l1->data, &map, GST_MAP_READ);
+    fail_unless_equals_int (gst_buffer_get_size (l2->data), map.size);
+    fail_unless (gst_buffer_memcmp (l2->data, 0, map.data, map.size) == 0);
+    gst_buffer_unmap (l1->data, &map);
+  }
+}
+
+#define MOSAIC_PIPELINE \
+    "compositor name=c background=black %s " \
+    "sink_0::repeat-after-eos=true sink_1::xpos=32 sink_2::ypos=32 " \
+    "sink_3::xpos=32 sink_3::ypos=32 sink_3::width=16 " \
+    "! video/x-raw,format=AYUV,width=64,height=96 ! fakesink name=sink " \
+    "videotestsrc num-buffers=1 pattern=smpte " \
+    "! video/x-raw,format=I420,width=32,height=32 ! c. " \
+    "videotestsrc num-buffers=3 pattern=ball " \
+    "! video/x-raw,format=RGBA,width=32,height=32 ! c. " \
+    "videotestsrc num-buffers=3 pattern=zone-plate " \
+    "! video/x-raw,format=NV12,width=48,height=48 ! c. " \
+    "videotestsrc num-buffers=3 pattern=checkers-8 " \
+    "! video/x-raw,format=YUY2,width=32,height=32 ! c. "
+
+/* Runs the pipeline @desc_format with the compositor properties @ref_props
+ * and @props and checks that both produce the same output */
+static void
+compare_pipelines (const gchar * desc_format, const gchar * ref_props,
+    const gchar * props)
+{
+  GList *ref, *out;
+  gchar *desc;
+
+  desc = g_strdup_printf (desc_format, ref_props);
+  ref = run_compositor_pipeline (desc);
+  g_free (desc);
+
+  desc = g_strdup_printf (desc_format, props);
+  out = run_compositor_pipeline (desc);
+  g_free (desc);
+
+  compare_buffer_lists (ref, out);
+
+  g_list_free_full (ref, (GDestroyNotify) gst_buffer_unref);
+  g_list_free_full (out, (GDestroyNotify) gst_buffer_unref);
+}
+
+GST_START_TEST (test_damage_tracking)
+{
+  /* The first pad repeats its only buffer and the bottom lines of the output
+   * are only background, which are then taken from the previous output */
+  compare_pipelines (MOSAIC_PIPELINE, "", "damage-tracking=true");
+}
+
+GST_END_TEST;
+
+/* sink_0 is hidden by the four pads above it, none of which covers it on its
+ * own. sink_5 is only covered by three pads and stays visible in the top
+ * right corner */
+#define OCCLUSION_PIPELINE \
+    "compositor name=c background=black %s " \
+    "sink_1::xpos=0 sink_1::ypos=0 sink_2::xpos=32 sink_2::ypos=0 " \
+    "sink_3::xpos=0 sink_3::ypos=32 sink_4::xpos=32 sink_4::ypos=32 " \
+    "sink_5::xpos=64 sink_5::ypos=0 " \
+    "sink_6::xpos=64 sink_6::ypos=0 sink_7::xpos=96 sink_7::ypos=32 " \
+    "sink_8::xpos=64 sink_8::ypos=32 " \
+    "! video/x-raw,format=AYUV,width=128,height=64 ! fakesink name=sink " \
+    "videotestsrc num-buffers=2 pattern=zone-plate " \
+    "! video/x-raw,format=I420,width=64,height=64 ! c.sink_0 " \
+    "videotestsrc num-buffers=2 pattern=smpte " \
+    "! video/x-raw,format=I420,width=32,height=32 ! c.sink_1 " \
+    "videotestsrc num-buffers=2 pattern=ball " \
+    "! video/x-raw,format=I420,width=32,height=32 ! c.sink_2 " \
+    "videotestsrc num-buffers=2 pattern=gamut " \
+    "! video/x-raw,format=I420,width=32,height=32 ! c.sink_3 " \
+    "videotestsrc num-buffers=2 pattern=checkers-8 " \
+    "! video/x-raw,format=I420,width=32,height=32 ! c.sink_4 " \
+    "videotestsrc num-buffers=2 pattern=circular " \
+    "! video/x-raw,format=I420,width=64,height=64 ! c.sink_5 " \
+    "videotestsrc num-buffers=2 pattern=smpte " \
+    "! video/x-raw,format=I420,width=32,height=32 ! c.sink_6 " \
+    "videotestsrc num-buffers=2 pattern=ball " \
+    "! video/x-raw,format=I420,width=32,height=32 ! c.sink_7 " \
+    "videotestsrc num-buffers=2 pattern=checkers-8 " \
+    "! video/x-raw,format=I420,width=32,height=32 ! c.sink_8 "
+
+GST_START_TEST (test_cull_multiple_occluders)
+{
+  GList *ref, *out, *l1, *l2;
+  gchar *desc;
+
+  /* sink_0 is culled, so what it shows and how it's blended must not make a
+   * difference */
+  compare_pipelines (OCCLUSION_PIPELINE, "", "sink_0::alpha=0.5");
+  compare_pipelines (OCCLUSION_PIPELINE, "", "sink_0::width=48");
+
+  /* sink_5 is not, and has to show through the gap between its occluders */
+  desc = g_strdup_printf (OCCLUSION_PIPELINE, "");
+  ref = run_compositor_pipeline (desc);
+  g_free (desc);
+
+  desc = g_strdup_printf (OCCLUSION_PIPELINE, "sink_5::alpha=0.0");
+  out = run_compositor_pipeline (desc);
+  g_free (desc);
+
+  fail_unless_equals_int (g_list_length (ref), g_list_length (out));
+  for (l1 = ref, l2 = out; l1 && l2; l1 = l1->next, l2 = l2->next) {
+    GstMapInfo map;
+
+    gst_buffer_map (l1->data, &map, GST_MAP_READ);
+    fail_unless (gst_buffer_memcmp (l2->data, 0, map.data, map.size) != 0);
+    gst_buffer_unmap (l1->data, &map);
+  }
+
+  g_list_free_full (ref, (GDestroyNotify) gst_buffer_unref);
+  g_list_free_full (out, (GDestroyNotify) gst_buffer_unref);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_reuse_converted_frame)
+{
+  GstElement *pipeline, *compositor;
+  GstStructure *stats;
+  GstMessage *msg;
+  GstPad *pad;
+  GstBus *bus;
+  GError *error = NULL;
+  guint64 converted, reused;
+
+  /* sink_0 needs a conversion and repeats its only buffer while sink_1
+   * produces five frames */
+  pipeline = gst_parse_launch ("compositor name=c background=black "
+      "sink_0::repeat-after-eos=true sink_1::xpos=32 "
+      "! video/x-raw,format=AYUV,width=64,height=32 ! fakesink "
+      "videotestsrc num-buffers=1 pattern=smpte "
+      "! video/x-raw,format=I420,width=32,height=32,framerate=30/1 ! c.sink_0 "
+      "videotestsrc num-buffers=5 pattern=ball "
+      "! video/x-raw,format=AYUV,width=32,height=32,framerate=30/1 ! c.sink_1 ",
+      &error);
+  fail_unless (pipeline != NULL, "%s", error ? error->message : "");
+
+  fail_unless (gst_element_set_state (pipeline,
+          GST_STATE_PLAYING) != GST_STATE_CHANGE_FAILURE);
+
+  bus = gst_element_get_bus (pipeline);
+  msg = gst_bus_timed_pop_filtered (bus, GST_CLOCK_TIME_NONE,
+      GST_MESSAGE_EOS | GST_MESSAGE_ERROR);
+  fail_unless_equals_int (GST_MESSAGE_TYPE (msg), GST_MESSAGE_EOS);
+  gst_message_unref (msg);
+  gst_object_unref (bus);
+
+  compositor = gst_bin_get_by_name (GST_BIN (pipeline), "c");
+  pad = gst_element_get_static_pad (compositor, "sink_0");
+  g_object_get (pad, "stats", &stats, NULL);
+  fail_unless (gst_structure_get_uint64 (stats, "converted", &converted));
+  fail_unless (gst_structure_get_uint64 (stats, "reused", &reused));
+  fail_unless_equals_uint64 (converted, 1);
+  fail_unless_equals_uint64 (reused, 4);
+  gst_structure_free (stats);
+  gst_object_unref (pad);
+  gst_object_unref (compositor);
+
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+  gst_object_unref (pipeline);
+}
+
+GST_END_TEST;
+
+static void
+input_freed_cb (gpointer user_data, GstMiniObject * obj)
+{
+  g_atomic_int_set ((gint *) user_data, TRUE);
+}
+
+/* Replaces the pool buffer from upstream with a buffer that is freed, not
+ * recycled, once the compositor is done with it */
+static GstPadProbeReturn
+copy_input_cb (GstPad * pad, GstPadProbeInfo * info, gpointer user_data)
+{
+  GstBuffer *copy = gst_buffer_copy_deep (GST_PAD_PROBE_INFO_BUFFER (info));
+
+  gst_mini_object_weak_ref (GST_MINI_OBJECT (copy), input_freed_cb,
+      user_data);
+  gst_buffer_unref (GST_PAD_PROBE_INFO_BUFFER (info));
+  GST_PAD_PROBE_INFO_DATA (info) = copy;
+
+  return GST_PAD_PROBE_OK;
+}
+
+GST_START_TEST (test_converted_frame_releases_input)
+{
+  GstElement *pipeline, *compositor;
+  GstMessage *msg;
+  GstPad *pad;
+  GstBus *bus;
+  GError *error = NULL;
+  gint freed = FALSE;
+
+  /* sink_0 needs a conversion and goes EOS after its only buffer, the
+   * converted frame must not keep that buffer alive afterwards */
+  pipeline = gst_parse_launch ("compositor name=c background=black "
+      "sink_1::xpos=32 "
+      "! video/x-raw,format=AYUV,width=64,height=32 ! fakesink "
+      "videotestsrc num-buffers=1 pattern=smpte "
+      "! video/x-raw,format=I420,width=32,height=32,framerate=30/1 ! c.sink_0 "
+      "videotestsrc num-buffers=5 pattern=ball "
+      "! video/x-raw,format=AYUV,width=32,height=32,framerate=30/1 ! c.sink_1 ",
+      &error);
+  fail_unless (pipeline != NULL, "%s", error ? error->message : "");
+
+  compositor = gst_bin_get_by_name (GST_BIN (pipeline), "c");
+  pad = gst_element_get_static_pad (compositor, "sink_0");
+  gst_pad_add_probe (pad, GST_PAD_PROBE_TYPE_BUFFER, copy_input_cb, &freed,
+      NULL);
+  gst_object_unref (pad);
+  gst_object_unref (compositor);
+
+  fail_unless (gst_element_set_state (pipeline,
+          GST_STATE_PLAYING) != GST_STATE_CHANGE_FAILURE);
+
+  bus = gst_element_get_bus (pipeline);
+  msg = gst_bus_timed_pop_filtered (bus, GST_CLOCK_TIME_NONE,
+      GST_MESSAGE_EOS | GST_MESSAGE_ERROR);
+  fail_unless_equals_int (GST_MESSAGE_TYPE (msg), GST_MESSAGE_EOS);
+  gst_message_unref (msg);
+  gst_object_unref (bus);
+
+  /* still playing, nothing but the converted frame could hold it */
+  fail_unless (g_atomic_int_get (&freed));
+
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+  gst_object_unref (pipeline);
+}
+
+GST_END_TEST;
+
+#define SCALE_PIPELINE \
+    "compositor name=c background=black %s " \
+    "sink_0::xpos=7 sink_0::ypos=5 sink_0::width=90 sink_0::height=70 " \
+    "sink_1::xpos=-9 sink_1::ypos=33 sink_1::width=50 sink_1::height=61 " \
+    "sink_1::alpha=0.5 " \
+    "! video/x-raw,format=I420,width=128,height=96 ! fakesink name=sink " \
+    "videotestsrc num-buffers=2 pattern=smpte " \
+    "! video/x-raw,format=I420,width=64,height=48 ! c. " \
+    "videotestsrc num-buffers=2 pattern=zone-plate " \
+    "! video/x-raw,format=I420,width=40,height=40 ! c. "
+
+/* Any converter option that isn't about scaling makes the pads go through
+ * a GstVideoConverter again */
+#define CONVERTER_CONFIG \
+    "\"config,GstVideoConverter.fill-border=(boolean)true\""
+
+GST_START_TEST (test_scale_on_blend)
+{
+  /* Pads that only need scaling are scaled while blending, which has to
+   * give the same result as scaling with a converter first */
+  compare_pipelines (SCALE_PIPELINE,
+      "sink_0::converter-config=" CONVERTER_CONFIG
+      " sink_1::converter-config=" CONVERTER_CONFIG, "");
+}
+
+GST_END_TEST;
+
 static GstPadProbeReturn
 drop_buffer_cb (GstPad * pad, GstPadProbeInfo * info, gpointer user_data)
 {
@@ -2300,6 +2702,12 @@ compositor_suite (void)
   tcase_add_test (tc_chain, test_repeat_after_eos_3pads_no_repeating);
   tcase_add_test (tc_chain, test_pad_z_order);
   tcase_add_test (tc_chain, test_pad_numbering);
+  tcase_add_test (tc_chain, test_prepare_threads);
+  tcase_add_test (tc_chain, test_damage_tracking);
+  tcase_add_test (tc_chain, test_cull_multiple_occluders);
+  tcase_add_test (tc_chain, test_reuse_converted_frame);
+  tcase_add_test (tc_chain, test_converted_frame_releases_input);
+  tcase_add_test (tc_chain, test_scale_on_blend);
   tcase_add_test (tc_chain, test_start_time_zero_live_drop_0);
   tcase_add_test (tc_chain, test_start_time_zero_live_drop_3);
   tcase_add_test (tc_chain, test_start_time_zero_live_drop_3_unlinked_1);
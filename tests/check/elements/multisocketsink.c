@@ -26,7 +26,9 @@
 #include <sys/socket.h>
 
 #include <gio/gio.h>
+#include <glib/gstdio.h>
 #include <gst/check/gstcheck.h>
+#include <gst/allocators/gstfdmemory.h>
 
 static GstPad *mysrcpad;
 
@@ -124,6 +126,44 @@ setup_handles (GSocket ** sinkhandle, GSocket ** srchandle)
   return TRUE;
 }
 
+/* A connected TCP socket pair on the loopback interface, unlike unix sockets
+ * these accept SO_ZEROCOPY */
+static gboolean
+setup_tcp_handles (GSocket ** sinkhandle, GSocket ** srchandle)
+{
+  GSocket *listener;
+  GInetAddress *loopback;
+  GSocketAddress *addr;
+  GError *error = NULL;
+
+  listener = g_socket_new (G_SOCKET_FAMILY_IPV4, G_SOCKET_TYPE_STREAM,
+      G_SOCKET_PROTOCOL_TCP, &error);
+  fail_if (listener == NULL, "%s", error ? error->message : "");
+
+  loopback = g_inet_address_new_loopback (G_SOCKET_FAMILY_IPV4);
+  addr = g_inet_socket_address_new (loopback, 0);
+  fail_unless (g_socket_bind (listener, addr, TRUE, &error));
+  fail_unless (g_socket_listen (listener, &error));
+  g_object_unref (addr);
+  g_object_unref (loopback);
+
+  addr = g_socket_get_local_address (listener, &error);
+  fail_if (addr == NULL);
+
+  *srchandle = g_socket_new (G_SOCKET_FAMILY_IPV4, G_SOCKET_TYPE_STREAM,
+      G_SOCKET_PROTOCOL_TCP, &error);
+  fail_if (*srchandle == NULL);
+  fail_unless (g_socket_connect (*srchandle, addr, NULL, &error));
+  *sinkhandle = g_socket_accept (listener, NULL, &error);
+  fail_if (error);
+  fail_if (*sinkhandle == NULL);
+
+  g_object_unref (addr);
+  g_object_unref (listener);
+
+  return TRUE;
+}
+
 static gboolean
 read_handle_n_bytes_exactly (GSocket * srchandle, void *buf, size_t count)
 {
@@ -236,6 +276,59 @@ GST_START_TEST (test_add_client)
 
 GST_END_TEST;
 
+#define N_THREADED_CLIENTS 8
+
+GST_START_TEST (test_add_clients_threaded)
+{
+  GstElement *sink;
+  GstBuffer *buffer;
+  GstCaps *caps;
+  gchar data[9];
+  GSocket *sinksocket[N_THREADED_CLIENTS], *srcsocket[N_THREADED_CLIENTS];
+  gint i;
+
+  sink = setup_multisocketsink ();
+  g_object_set (sink, "n-threads", 4, NULL);
+  for (i = 0; i < N_THREADED_CLIENTS; i++)
+    fail_unless (setup_handles (&sinksocket[i], &srcsocket[i]));
+
+  ASSERT_SET_STATE (sink, GST_STATE_PLAYING, GST_STATE_CHANGE_ASYNC);
+
+  /* the clients are spread over the threads */
+  for (i = 0; i < N_THREADED_CLIENTS; i++)
+    g_signal_emit_by_name (sink, "add", sinksocket[i]);
+  fail_unless_num_handles (sink, N_THREADED_CLIENTS);
+
+  caps = gst_caps_from_string ("application/x-gst-check");
+  gst_check_setup_events (mysrcpad, sink, caps, GST_FORMAT_BYTES);
+  gst_caps_unref (caps);
+
+  buffer = gst_buffer_new_and_alloc (9);
+  gst_buffer_fill (buffer, 0, "dead good", 9);
+  fail_unless (gst_pad_push (mysrcpad, buffer) == GST_FLOW_OK);
+
+  for (i = 0; i < N_THREADED_CLIENTS; i++) {
+    fail_unless (read_handle_n_bytes_exactly (srcsocket[i], data, 9));
+    fail_unless (strncmp (data, "dead good", 9) == 0);
+  }
+  wait_bytes_served (sink, 9 * N_THREADED_CLIENTS);
+
+  /* removing clients from another thread than the one servicing them */
+  g_signal_emit_by_name (sink, "remove", sinksocket[0]);
+  fail_unless_num_handles (sink, N_THREADED_CLIENTS - 1);
+
+  GST_DEBUG ("cleaning up multisocketsink");
+  ASSERT_SET_STATE (sink, GST_STATE_NULL, GST_STATE_CHANGE_SUCCESS);
+  cleanup_multisocketsink (sink);
+
+  for (i = 0; i < N_THREADED_CLIENTS; i++) {
+    g_object_unref (srcsocket[i]);
+    g_object_unref (sinksocket[i]);
+  }
+}
+
+GST_END_TEST;
+
 typedef struct
 {
   GSocket *sinksocket, *srcsocket;
@@ -278,6 +371,412 @@ teardown_sink_with_socket (TestSinkAndSocket * tsas)
   }
 }
 
+/* many small buffers, such as MPEG-TS packets, are gathered into one send
+ * call and must arrive complete and in order */
+GST_START_TEST (test_small_buffers)
+{
+  GstElement *sink;
+  GstBuffer *buffer;
+  GstCaps *caps;
+  guint8 data[20 * 188];
+  GSocket *sinksocket, *srcsocket;
+  gint i, j;
+
+  sink = setup_multisocketsink ();
+  fail_unless (setup_handles (&sinksocket, &srcsocket));
+
+  ASSERT_SET_STATE (sink, GST_STATE_PLAYING, GST_STATE_CHANGE_ASYNC);
+
+  /* add the client */
+  g_signal_emit_by_name (sink, "add", sinksocket);
+
+  caps = gst_caps_from_string ("application/x-gst-check");
+  gst_check_setup_events (mysrcpad, sink, caps, GST_FORMAT_BYTES);
+
+  for (i = 0; i < 20; i++) {
+    buffer = gst_buffer_new_and_alloc (188);
+    gst_buffer_memset (buffer, 0, i, 188);
+    fail_unless (gst_pad_push (mysrcpad, buffer) == GST_FLOW_OK);
+  }
+
+  GST_DEBUG ("reading");
+  fail_unless (read_handle_n_bytes_exactly (srcsocket, data, sizeof (data)));
+  for (i = 0; i < 20; i++) {
+    for (j = 0; j < 188; j++)
+      fail_unless_equals_int (data[i * 188 + j], i);
+  }
+  wait_bytes_served (sink, sizeof (data));
+
+  GST_DEBUG ("cleaning up multisocketsink");
+  ASSERT_SET_STATE (sink, GST_STATE_NULL, GST_STATE_CHANGE_SUCCESS);
+  cleanup_multisocketsink (sink);
+
+  gst_caps_unref (caps);
+
+  g_object_unref (srcsocket);
+  g_object_unref (sinksocket);
+}
+
+GST_END_TEST;
+
+#define CURSOR_BUFFER_SIZE (16 * 1024)
+
+/* fill a buffer with the byte @value, so that the reader can tell which
+ * buffer a chunk of the stream came from */
+static GstBuffer *
+new_cursor_buffer (guint8 value)
+{
+  GstBuffer *buffer;
+
+  buffer = gst_buffer_new_and_alloc (CURSOR_BUFFER_SIZE);
+  gst_buffer_memset (buffer, 0, value, CURSOR_BUFFER_SIZE);
+
+  return buffer;
+}
+
+/* read the next buffer from @srcsocket, it must be sent complete */
+static gint
+read_cursor_buffer (GSocket * srcsocket)
+{
+  guint8 data[CURSOR_BUFFER_SIZE];
+  gint i;
+
+  fail_unless (read_handle_n_bytes_exactly (srcsocket, data, sizeof (data)));
+  for (i = 1; i < CURSOR_BUFFER_SIZE; i++)
+    fail_unless_equals_int (data[i], data[0]);
+
+  return data[0];
+}
+
+/* a client that can't keep up is written to partially. The remainder of
+ * the buffer must be sent before the client reads on from the shared
+ * queue */
+GST_START_TEST (test_partial_write)
+{
+  GstElement *sink;
+  GstCaps *caps;
+  GSocket *sinksocket, *srcsocket;
+  gint i;
+
+  sink = setup_multisocketsink ();
+  fail_unless (setup_handles (&sinksocket, &srcsocket));
+  fail_unless (g_socket_set_option (sinksocket, SOL_SOCKET, SO_SNDBUF, 4096,
+          NULL));
+
+  ASSERT_SET_STATE (sink, GST_STATE_PLAYING, GST_STATE_CHANGE_ASYNC);
+
+  /* add the client */
+  g_signal_emit_by_name (sink, "add", sinksocket);
+
+  caps = gst_caps_from_string ("application/x-gst-check");
+  gst_check_setup_events (mysrcpad, sink, caps, GST_FORMAT_BYTES);
+
+  /* don't read yet, the socket fills up in the middle of a buffer */
+  for (i = 0; i < 16; i++)
+    fail_unless (gst_pad_push (mysrcpad, new_cursor_buffer (i)) == GST_FLOW_OK);
+
+  GST_DEBUG ("reading");
+  for (i = 0; i < 16; i++)
+    fail_unless_equals_int (read_cursor_buffer (srcsocket), i);
+  wait_bytes_served (sink, 16 * CURSOR_BUFFER_SIZE);
+  fail_unless_num_handles (sink, 1);
+
+  GST_DEBUG ("cleaning up multisocketsink");
+  ASSERT_SET_STATE (sink, GST_STATE_NULL, GST_STATE_CHANGE_SUCCESS);
+  cleanup_multisocketsink (sink);
+
+  gst_caps_unref (caps);
+
+  g_object_unref (srcsocket);
+  g_object_unref (sinksocket);
+}
+
+GST_END_TEST;
+
+/* a lagging client is moved to the latest buffer while another thread is
+ * writing to it. The buffers it receives must be complete, in order and
+ * not repeated. */
+GST_START_TEST (test_recover_threaded)
+{
+  GstElement *sink;
+  GstStructure *stats;
+  GstCaps *caps;
+  GSocket *sinksocket, *srcsocket;
+  guint64 dropped;
+  gint i, prev, value;
+
+  sink = setup_multisocketsink ();
+  g_object_set (sink, "n-threads", 2, "unit-format", GST_FORMAT_BUFFERS,
+      "units-soft-max", (gint64) 2, "recover-policy", 1 /* latest */ , NULL);
+  fail_unless (setup_handles (&sinksocket, &srcsocket));
+  fail_unless (g_socket_set_option (sinksocket, SOL_SOCKET, SO_SNDBUF, 4096,
+          NULL));
+
+  ASSERT_SET_STATE (sink, GST_STATE_PLAYING, GST_STATE_CHANGE_ASYNC);
+
+  /* add the client */
+  g_signal_emit_by_name (sink, "add", sinksocket);
+
+  caps = gst_caps_from_string ("application/x-gst-check");
+  gst_check_setup_events (mysrcpad, sink, caps, GST_FORMAT_BYTES);
+
+  for (i = 0; i < 32; i++)
+    fail_unless (gst_pad_push (mysrcpad, new_cursor_buffer (i)) == GST_FLOW_OK);
+
+  /* read what the client got until it caught up */
+  GST_DEBUG ("reading");
+  prev = -1;
+  while (g_socket_condition_timed_wait (srcsocket, G_IO_IN, G_USEC_PER_SEC / 2,
+          NULL, NULL)) {
+    value = read_cursor_buffer (srcsocket);
+    fail_unless (value > prev, "buffer %d after buffer %d", value, prev);
+    prev = value;
+  }
+  fail_unless (prev >= 0);
+
+  /* the client skipped buffers and still gets new ones */
+  g_signal_emit_by_name (sink, "get-stats", sinksocket, &stats);
+  fail_unless (gst_structure_get_uint64 (stats, "buffers-dropped", &dropped));
+  fail_unless (dropped > 0);
+  gst_structure_free (stats);
+  fail_unless_num_handles (sink, 1);
+
+  fail_unless (gst_pad_push (mysrcpad, new_cursor_buffer (32)) == GST_FLOW_OK);
+  fail_unless_equals_int (read_cursor_buffer (srcsocket), 32);
+
+  GST_DEBUG ("cleaning up multisocketsink");
+  ASSERT_SET_STATE (sink, GST_STATE_NULL, GST_STATE_CHANGE_SUCCESS);
+  cleanup_multisocketsink (sink);
+
+  gst_caps_unref (caps);
+
+  g_object_unref (srcsocket);
+  g_object_unref (sinksocket);
+}
+
+GST_END_TEST;
+
+/* fd-backed memory is sent from its file descriptor and large buffers
+ * may be sent with MSG_ZEROCOPY, the data must arrive unchanged either way */
+GST_START_TEST (test_zero_copy)
+{
+  GstElement *sink;
+  GstBuffer *buffer;
+  GstAllocator *allocator;
+  GstCaps *caps;
+  GSocket *sinksocket, *srcsocket;
+  const gchar *content = "dead good";
+  gchar *filename;
+  guint8 *big, *data;
+  gint fd, i;
+
+  sink = setup_multisocketsink ();
+  g_object_set (sink, "zero-copy", TRUE, NULL);
+  fail_unless (setup_handles (&sinksocket, &srcsocket));
+
+  ASSERT_SET_STATE (sink, GST_STATE_PLAYING, GST_STATE_CHANGE_ASYNC);
+
+  /* add the client */
+  g_signal_emit_by_name (sink, "add", sinksocket);
+
+  caps = gst_caps_from_string ("application/x-gst-check");
+  gst_check_setup_events (mysrcpad, sink, caps, GST_FORMAT_BYTES);
+
+  fd = g_file_open_tmp (NULL, &filename, NULL);
+  fail_unless (fd >= 0);
+  fail_unless (write (fd, content, 9) == 9);
+
+  allocator = gst_fd_allocator_new ();
+  buffer = gst_buffer_new ();
+  gst_buffer_append_memory (buffer, gst_fd_allocator_alloc (allocator, fd, 9,
+          GST_FD_MEMORY_FLAG_NONE));
+  fail_unless (gst_pad_push (mysrcpad, buffer) == GST_FLOW_OK);
+
+  big = g_malloc (64 * 1024);
+  for (i = 0; i < 64 * 1024; i++)
+    big[i] = i & 0xff;
+  buffer = gst_buffer_new_and_alloc (64 * 1024);
+  gst_buffer_fill (buffer, 0, big, 64 * 1024);
+  fail_unless (gst_pad_push (mysrcpad, buffer) == GST_FLOW_OK);
+
+  GST_DEBUG ("reading");
+  data = g_malloc (9 + 64 * 1024);
+  fail_unless (read_handle_n_bytes_exactly (srcsocket, data, 9 + 64 * 1024));
+  fail_unless (memcmp (data, content, 9) == 0);
+  fail_unless (memcmp (data + 9, big, 64 * 1024) == 0);
+  wait_bytes_served (sink, 9 + 64 * 1024);
+
+  GST_DEBUG ("cleaning up multisocketsink");
+  ASSERT_SET_STATE (sink, GST_STATE_NULL, GST_STATE_CHANGE_SUCCESS);
+  cleanup_multisocketsink (sink);
+
+  gst_caps_unref (caps);
+  gst_object_unref (allocator);
+  g_unlink (filename);
+  g_free (filename);
+  g_free (data);
+  g_free (big);
+
+  g_object_unref (srcsocket);
+  g_object_unref (sinksocket);
+}
+
+GST_END_TEST;
+
+#define ZERO_COPY_BUFFER_SIZE (64 * 1024)
+#define ZERO_COPY_N_BUFFERS 8
+
+static gint zero_copy_freed;
+
+static void
+zero_copy_memory_free (gpointer data)
+{
+  g_free (data);
+  g_atomic_int_inc (&zero_copy_freed);
+}
+
+/* Over TCP the large buffers are sent with MSG_ZEROCOPY. The sink has to
+ * release them once the kernel reports the sends as completed on the error
+ * queue, which also tells it that loopback copied the data and MSG_ZEROCOPY
+ * is switched off. The client must survive these G_IO_ERR wakeups. */
+GST_START_TEST (test_zero_copy_tcp)
+{
+  GstElement *sink;
+  GstBuffer *buffer;
+  GstCaps *caps;
+  GSocket *sinksocket, *srcsocket;
+  guint8 *expected, *data;
+  gint i, tries;
+
+  sink = setup_multisocketsink ();
+  g_object_set (sink, "zero-copy", TRUE, NULL);
+  fail_unless (setup_tcp_handles (&sinksocket, &srcsocket));
+
+  ASSERT_SET_STATE (sink, GST_STATE_PLAYING, GST_STATE_CHANGE_ASYNC);
+
+  g_signal_emit_by_name (sink, "add", sinksocket);
+
+  caps = gst_caps_from_string ("application/x-gst-check");
+  gst_check_setup_events (mysrcpad, sink, caps, GST_FORMAT_BYTES);
+
+  g_atomic_int_set (&zero_copy_freed, 0);
+  expected = g_malloc (ZERO_COPY_BUFFER_SIZE);
+  data = g_malloc (ZERO_COPY_BUFFER_SIZE);
+
+  for (i = 0; i < ZERO_COPY_N_BUFFERS; i++) {
+    guint8 *mem = g_malloc (ZERO_COPY_BUFFER_SIZE);
+
+    memset (mem, i, ZERO_COPY_BUFFER_SIZE);
+    memset (expected, i, ZERO_COPY_BUFFER_SIZE);
+
+    buffer = gst_buffer_new ();
+    gst_buffer_append_memory (buffer, gst_memory_new_wrapped (0, mem,
+            ZERO_COPY_BUFFER_SIZE, 0, ZERO_COPY_BUFFER_SIZE, mem,
+            zero_copy_memory_free));
+    fail_unless (gst_pad_push (mysrcpad, buffer) == GST_FLOW_OK);
+
+    fail_unless (read_handle_n_bytes_exactly (srcsocket, data,
+            ZERO_COPY_BUFFER_SIZE));
+    fail_unless (memcmp (data, expected, ZERO_COPY_BUFFER_SIZE) == 0);
+    wait_bytes_served (sink, (guint64) (i + 1) * ZERO_COPY_BUFFER_SIZE);
+  }
+
+  /* the client has read everything, so queueing another buffer drops the
+   * large ones from the queue of the sink. After that only pending
+   * zero-copy sends can keep them alive */
+  buffer = gst_buffer_new_and_alloc (4);
+  gst_buffer_fill (buffer, 0, "dead", 4);
+  fail_unless (gst_pad_push (mysrcpad, buffer) == GST_FLOW_OK);
+  fail_unless_read ("first small buffer", srcsocket, 4, "dead");
+
+  for (tries = 0; tries < 500; tries++) {
+    if (g_atomic_int_get (&zero_copy_freed) == ZERO_COPY_N_BUFFERS)
+      break;
+    g_usleep (10 * 1000);
+  }
+  fail_unless_equals_int (g_atomic_int_get (&zero_copy_freed),
+      ZERO_COPY_N_BUFFERS);
+
+  /* the completion notifications did not get the client removed */
+  fail_unless_num_handles (sink, 1);
+
+  buffer = gst_buffer_new_and_alloc (4);
+  gst_buffer_fill (buffer, 0, "good", 4);
+  fail_unless (gst_pad_push (mysrcpad, buffer) == GST_FLOW_OK);
+  fail_unless_read ("second small buffer", srcsocket, 4, "good");
+
+  GST_DEBUG ("cleaning up multisocketsink");
+  ASSERT_SET_STATE (sink, GST_STATE_NULL, GST_STATE_CHANGE_SUCCESS);
+  cleanup_multisocketsink (sink);
+
+  gst_caps_unref (caps);
+  g_free (expected);
+  g_free (data);
+
+  g_object_unref (srcsocket);
+  g_object_unref (sinksocket);
+}
+
+GST_END_TEST;
+
+/* Removing a client while the kernel may still send from its buffers must
+ * not free them before the application released the socket */
+GST_START_TEST (test_zero_copy_remove_client)
+{
+  GstElement *sink;
+  GstBuffer *buffer;
+  GstCaps *caps;
+  GSocket *sinksocket, *srcsocket;
+  guint8 *mem, *data;
+  gint i;
+
+  sink = setup_multisocketsink ();
+  g_object_set (sink, "zero-copy", TRUE, NULL);
+  fail_unless (setup_tcp_handles (&sinksocket, &srcsocket));
+
+  ASSERT_SET_STATE (sink, GST_STATE_PLAYING, GST_STATE_CHANGE_ASYNC);
+
+  g_signal_emit_by_name (sink, "add", sinksocket);
+
+  caps = gst_caps_from_string ("application/x-gst-check");
+  gst_check_setup_events (mysrcpad, sink, caps, GST_FORMAT_BYTES);
+
+  g_atomic_int_set (&zero_copy_freed, 0);
+  data = g_malloc (ZERO_COPY_BUFFER_SIZE);
+
+  for (i = 0; i < ZERO_COPY_N_BUFFERS; i++) {
+    mem = g_malloc0 (ZERO_COPY_BUFFER_SIZE);
+    buffer = gst_buffer_new ();
+    gst_buffer_append_memory (buffer, gst_memory_new_wrapped (0, mem,
+            ZERO_COPY_BUFFER_SIZE, 0, ZERO_COPY_BUFFER_SIZE, mem,
+            zero_copy_memory_free));
+    fail_unless (gst_pad_push (mysrcpad, buffer) == GST_FLOW_OK);
+
+    fail_unless (read_handle_n_bytes_exactly (srcsocket, data,
+            ZERO_COPY_BUFFER_SIZE));
+    wait_bytes_served (sink, (guint64) (i + 1) * ZERO_COPY_BUFFER_SIZE);
+  }
+
+  g_signal_emit_by_name (sink, "remove", sinksocket);
+  fail_unless_num_handles (sink, 0);
+
+  GST_DEBUG ("cleaning up multisocketsink");
+  ASSERT_SET_STATE (sink, GST_STATE_NULL, GST_STATE_CHANGE_SUCCESS);
+  cleanup_multisocketsink (sink);
+
+  /* whatever the kernel did not complete yet is released with the socket */
+  g_object_unref (sinksocket);
+  fail_unless_equals_int (g_atomic_int_get (&zero_copy_freed),
+      ZERO_COPY_N_BUFFERS);
+
+  gst_caps_unref (caps);
+  g_free (data);
+
+  g_object_unref (srcsocket);
+}
+
+GST_END_TEST;
+
 GST_START_TEST (test_sending_buffers_with_9_gstmemories)
 {
   TestSinkAndSocket tsas = { 0 };
@@ -981,6 +1480,13 @@ multisocketsink_suite (void)
   suite_add_tcase (s, tc_chain);
   tcase_add_test (tc_chain, test_no_clients);
   tcase_add_test (tc_chain, test_add_client);
+  tcase_add_test (tc_chain, test_add_clients_threaded);
+  tcase_add_test (tc_chain, test_small_buffers);
+  tcase_add_test (tc_chain, test_partial_write);
+  tcase_add_test (tc_chain, test_recover_threaded);
+  tcase_add_test (tc_chain, test_zero_copy);
+  tcase_add_test (tc_chain, test_zero_copy_tcp);
+  tcase_add_test (tc_chain, test_zero_copy_remove_client);
   tcase_add_test (tc_chain, test_sending_buffers_with_9_gstmemories);
   tcase_add_test (tc_chain, test_streamheader);
   tcase_add_test (tc_chain, test_change_streamheader);
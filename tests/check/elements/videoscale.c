@@ -965,6 +965,87 @@ GST_END_TEST;
 
 #endif /* !defined(VSCALE_TEST_GROUP) */
 
+static GstBuffer *
+scale_gray8_buffer (GstBuffer * buffer, gboolean check_crop_meta)
+{
+  GstHarness *h;
+  GstQuery *query;
+  GstCaps *caps;
+  GstBuffer *out;
+
+  h = gst_harness_new ("videoscale");
+  gst_harness_set_src_caps_str (h,
+      "video/x-raw,format=GRAY8,width=4,height=4,framerate=30/1");
+  gst_harness_set_sink_caps_str (h,
+      "video/x-raw,format=GRAY8,width=8,height=6,framerate=30/1");
+
+  if (check_crop_meta) {
+    caps = gst_caps_from_string
+        ("video/x-raw,format=GRAY8,width=4,height=4,framerate=30/1");
+    query = gst_query_new_allocation (caps, TRUE);
+    fail_unless (gst_pad_peer_query (h->srcpad, query));
+    fail_unless (gst_query_find_allocation_meta (query,
+            GST_VIDEO_CROP_META_API_TYPE, NULL));
+    gst_query_unref (query);
+    gst_caps_unref (caps);
+  }
+
+  fail_unless_equals_int (gst_harness_push (h, buffer), GST_FLOW_OK);
+  out = gst_harness_pull (h);
+  fail_unless (out != NULL);
+  fail_if (gst_buffer_get_video_crop_meta (out) != NULL);
+
+  gst_harness_teardown (h);
+
+  return out;
+}
+
+GST_START_TEST (test_crop_meta)
+{
+  GstBuffer *full, *cropped, *out, *ref;
+  GstVideoCropMeta *crop;
+  GstMapInfo map;
+  gsize offset[GST_VIDEO_MAX_PLANES] = { 0, };
+  gint stride[GST_VIDEO_MAX_PLANES] = { 8, };
+  guint x, y;
+
+  /* uncropped 8x8 frame, only the 4x4 region at 2,3 is visible */
+  full = gst_buffer_new_and_alloc (8 * 8);
+  gst_buffer_map (full, &map, GST_MAP_WRITE);
+  for (y = 0; y < 8; y++)
+    for (x = 0; x < 8; x++)
+      map.data[y * 8 + x] = y * 8 + x;
+  gst_buffer_unmap (full, &map);
+  gst_buffer_add_video_meta_full (full, GST_VIDEO_FRAME_FLAG_NONE,
+      GST_VIDEO_FORMAT_GRAY8, 8, 8, 1, offset, stride);
+  crop = gst_buffer_add_video_crop_meta (full);
+  crop->x = 2;
+  crop->y = 3;
+  crop->width = 4;
+  crop->height = 4;
+
+  /* the same region, copied out */
+  cropped = gst_buffer_new_and_alloc (4 * 4);
+  gst_buffer_map (cropped, &map, GST_MAP_WRITE);
+  for (y = 0; y < 4; y++)
+    for (x = 0; x < 4; x++)
+      map.data[y * 4 + x] = (y + 3) * 8 + x + 2;
+  gst_buffer_unmap (cropped, &map);
+
+  out = scale_gray8_buffer (full, TRUE);
+  ref = scale_gray8_buffer (cropped, FALSE);
+
+  gst_buffer_map (ref, &map, GST_MAP_READ);
+  fail_unless_equals_int (gst_buffer_get_size (out), map.size);
+  fail_unless (gst_buffer_memcmp (out, 0, map.data, map.size) == 0);
+  gst_buffer_unmap (ref, &map);
+
+  gst_buffer_unref (out);
+  gst_buffer_unref (ref);
+}
+
+GST_END_TEST;
+
 static Suite *
 videoscale_suite (void)
 {
@@ -985,6 +1066,7 @@ videoscale_suite (void)
   tcase_add_test (tc_chain, test_reverse_negotiation);
 #endif
   tcase_add_test (tc_chain, test_basetransform_negotiation);
+  tcase_add_test (tc_chain, test_crop_meta);
 #else
 #if VSCALE_TEST_GROUP == 1
   tcase_add_test (tc_chain, test_downscale_640x480_320x240_method_0);
@@ -29,6 +29,7 @@
 
 #include <gst/audio/audio.h>
 #include <string.h>
+#include <math.h>
 
 static GstBuffer *
 make_buffer (guint8 ** _data)
@@ -1578,6 +1579,386 @@ GST_START_TEST (test_audio_make_raw_caps)
 
 GST_END_TEST;
 
+#define MIX_IN_CHANNELS 4
+#define MIX_OUT_CHANNELS 4
+#define MIX_SAMPLES 37
+
+static gdouble
+mix_get_sample (GstAudioFormat format, gconstpointer data, gint idx)
+{
+  switch (format) {
+    case GST_AUDIO_FORMAT_S16:
+      return ((const gint16 *) data)[idx];
+    case GST_AUDIO_FORMAT_S32:
+      return ((const gint32 *) data)[idx];
+    case GST_AUDIO_FORMAT_F32:
+      return ((const gfloat *) data)[idx];
+    default:
+      return ((const gdouble *) data)[idx];
+  }
+}
+
+static void
+mix_set_sample (GstAudioFormat format, gpointer data, gint idx, gdouble val)
+{
+  switch (format) {
+    case GST_AUDIO_FORMAT_S16:
+      ((gint16 *) data)[idx] = val * G_MAXINT16;
+      break;
+    case GST_AUDIO_FORMAT_S32:
+      ((gint32 *) data)[idx] = val * G_MAXINT32;
+      break;
+    case GST_AUDIO_FORMAT_F32:
+      ((gfloat *) data)[idx] = val;
+      break;
+    default:
+      ((gdouble *) data)[idx] = val;
+      break;
+  }
+}
+
+/* the mixer skips zero coefficients and uses SIMD kernels for planar
+ * samples, check all layouts against a plain matrix multiplication */
+GST_START_TEST (test_channel_mixer_sparse)
+{
+  static const GstAudioFormat formats[] = {
+    GST_AUDIO_FORMAT_S16, GST_AUDIO_FORMAT_S32,
+    GST_AUDIO_FORMAT_F32, GST_AUDIO_FORMAT_F64
+  };
+  /* out 0 copies in 0, out 1 mixes two channels, out 2 is silent and
+   * out 3 has a coefficient that is zero in the integer matrix */
+  static const gfloat coeffs[MIX_IN_CHANNELS][MIX_OUT_CHANNELS] = {
+    {1.0, 0.0, 0.0, 0.5},
+    {0.0, 0.5, 0.0, 0.0},
+    {0.0, 0.0, 0.0, 0.0001},
+    {0.0, -0.25, 0.0, 0.5},
+  };
+  gint f, l, i, o, n;
+
+  for (f = 0; f < G_N_ELEMENTS (formats); f++) {
+    const GstAudioFormatInfo *finfo = gst_audio_format_get_info (formats[f]);
+    gint bps = GST_AUDIO_FORMAT_INFO_WIDTH (finfo) / 8;
+    gboolean is_int = GST_AUDIO_FORMAT_INFO_IS_INTEGER (finfo);
+
+    for (l = 0; l < 4; l++) {
+      GstAudioChannelMixerFlags flags = 0;
+      GstAudioChannelMixer *mix;
+      gboolean planar_in = l & 1, planar_out = l & 2;
+      guint8 *in_mem, *out_mem;
+      gpointer in[MIX_IN_CHANNELS], out[MIX_OUT_CHANNELS];
+      gfloat **matrix;
+
+      if (planar_in)
+        flags |= GST_AUDIO_CHANNEL_MIXER_FLAGS_NON_INTERLEAVED_IN;
+      if (planar_out)
+        flags |= GST_AUDIO_CHANNEL_MIXER_FLAGS_NON_INTERLEAVED_OUT;
+
+      matrix = g_new (gfloat *, MIX_IN_CHANNELS);
+      for (i = 0; i < MIX_IN_CHANNELS; i++) {
+        matrix[i] = g_new (gfloat, MIX_OUT_CHANNELS);
+        memcpy (matrix[i], coeffs[i], sizeof (coeffs[i]));
+      }
+
+      mix = gst_audio_channel_mixer_new_with_matrix (flags, formats[f],
+          MIX_IN_CHANNELS, MIX_OUT_CHANNELS, matrix);
+      fail_unless (mix != NULL);
+      fail_if (gst_audio_channel_mixer_is_passthrough (mix));
+
+      in_mem = g_malloc (MIX_IN_CHANNELS * MIX_SAMPLES * bps);
+      out_mem = g_malloc (MIX_OUT_CHANNELS * MIX_SAMPLES * bps);
+      for (i = 0; i < MIX_IN_CHANNELS; i++)
+        in[i] = in_mem + (planar_in ? i * MIX_SAMPLES * bps : 0);
+      for (o = 0; o < MIX_OUT_CHANNELS; o++)
+        out[o] = out_mem + (planar_out ? o * MIX_SAMPLES * bps : 0);
+
+      for (n = 0; n < MIX_SAMPLES; n++) {
+        for (i = 0; i < MIX_IN_CHANNELS; i++) {
+          gdouble val = ((n * 7 + i * 13) % 19) / 9.5 - 1.0;
+
+          if (planar_in)
+            mix_set_sample (formats[f], in[i], n, val);
+          else
+            mix_set_sample (formats[f], in[0], n * MIX_IN_CHANNELS + i, val);
+        }
+      }
+
+      gst_audio_channel_mixer_samples (mix, in, out, MIX_SAMPLES);
+
+      for (n = 0; n < MIX_SAMPLES; n++) {
+        for (o = 0; o < MIX_OUT_CHANNELS; o++) {
+          gdouble expected = 0.0, res;
+
+          for (i = 0; i < MIX_IN_CHANNELS; i++) {
+            gdouble val = planar_in ? mix_get_sample (formats[f], in[i], n) :
+                mix_get_sample (formats[f], in[0], n * MIX_IN_CHANNELS + i);
+
+            if (is_int)
+              expected += val * (gint) (coeffs[i][o] * 1024);
+            else
+              expected += val * coeffs[i][o];
+          }
+          if (is_int)
+            expected = floor ((expected + 512) / 1024);
+
+          res = planar_out ? mix_get_sample (formats[f], out[o], n) :
+              mix_get_sample (formats[f], out[0], n * MIX_OUT_CHANNELS + o);
+
+          fail_unless (fabs (res - expected) <= (is_int ? 0.0 : 1e-6),
+              "format %s layout %d sample %d channel %d: %f != %f",
+              gst_audio_format_to_string (formats[f]), l, n, o, res,
+              expected);
+        }
+      }
+
+      g_free (in_mem);
+      g_free (out_mem);
+      gst_audio_channel_mixer_free (mix);
+    }
+  }
+}
+
+GST_END_TEST;
+
+#define QUANT_CHANNELS 3
+#define QUANT_SAMPLES 64
+
+/* noise shaping keeps a history per channel, planar samples must give the
+ * same result as interleaved ones, also across calls */
+GST_START_TEST (test_quantize_planar)
+{
+  static const GstAudioNoiseShapingMethod methods[] = {
+    GST_AUDIO_NOISE_SHAPING_ERROR_FEEDBACK,
+    GST_AUDIO_NOISE_SHAPING_SIMPLE,
+    GST_AUDIO_NOISE_SHAPING_HIGH,
+  };
+  gint m, i, c, n;
+
+  for (m = 0; m < G_N_ELEMENTS (methods); m++) {
+    GstAudioQuantize *qi, *qp;
+    gint32 in_i[QUANT_CHANNELS * QUANT_SAMPLES];
+    gint32 out_i[QUANT_CHANNELS * QUANT_SAMPLES];
+    gint32 in_p[QUANT_CHANNELS][QUANT_SAMPLES];
+    gint32 out_p[QUANT_CHANNELS][QUANT_SAMPLES];
+    gpointer ii[1] = { in_i }, oi[1] = { out_i };
+    gpointer ip[QUANT_CHANNELS], op[QUANT_CHANNELS];
+
+    qi = gst_audio_quantize_new (GST_AUDIO_DITHER_NONE, methods[m], 0,
+        GST_AUDIO_FORMAT_S32, QUANT_CHANNELS, 1 << 16);
+    qp = gst_audio_quantize_new (GST_AUDIO_DITHER_NONE, methods[m],
+        GST_AUDIO_QUANTIZE_FLAG_NON_INTERLEAVED, GST_AUDIO_FORMAT_S32,
+        QUANT_CHANNELS, 1 << 16);
+
+    for (c = 0; c < QUANT_CHANNELS; c++) {
+      ip[c] = in_p[c];
+      op[c] = out_p[c];
+    }
+
+    for (i = 0; i < 3; i++) {
+      for (n = 0; n < QUANT_SAMPLES; n++) {
+        for (c = 0; c < QUANT_CHANNELS; c++) {
+          gint32 val = (gint32) (((i * 37 + n * 11 + c * 5) % 23) * 91234567);
+
+          in_i[n * QUANT_CHANNELS + c] = val;
+          in_p[c][n] = val;
+        }
+      }
+
+      gst_audio_quantize_samples (qi, ii, oi, QUANT_SAMPLES);
+      gst_audio_quantize_samples (qp, ip, op, QUANT_SAMPLES);
+
+      for (n = 0; n < QUANT_SAMPLES; n++)
+        for (c = 0; c < QUANT_CHANNELS; c++)
+          fail_unless_equals_int (out_p[c][n], out_i[n * QUANT_CHANNELS + c]);
+    }
+
+    gst_audio_quantize_free (qi);
+    gst_audio_quantize_free (qp);
+  }
+}
+
+GST_END_TEST;
+
+#define CONVERT_BLOCKS 3
+#define CONVERT_SAMPLES 480
+
+static GstAudioConverter *
+make_quantizing_converter (GstAudioFormat in_format, gint in_rate,
+    gint in_channels, GstAudioFormat out_format, gint out_rate,
+    gint out_channels)
+{
+  GstAudioInfo in_info, out_info;
+  GstStructure *config;
+
+  gst_audio_info_set_format (&in_info, in_format, in_rate, in_channels, NULL);
+  gst_audio_info_set_format (&out_info, out_format, out_rate, out_channels,
+      NULL);
+
+  /* no random dither, so that the output can be compared */
+  config = gst_structure_new ("GstAudioConverterConfig",
+      GST_AUDIO_CONVERTER_OPT_DITHER_METHOD, GST_TYPE_AUDIO_DITHER_METHOD,
+      GST_AUDIO_DITHER_NONE,
+      GST_AUDIO_CONVERTER_OPT_NOISE_SHAPING_METHOD,
+      GST_TYPE_AUDIO_NOISE_SHAPING_METHOD,
+      GST_AUDIO_NOISE_SHAPING_ERROR_FEEDBACK, NULL);
+
+  return gst_audio_converter_new (GST_AUDIO_CONVERTER_FLAG_NONE, &in_info,
+      &out_info, config);
+}
+
+/* Mixing 5.1 down to stereo while resampling deinterleaves the samples
+ * while unpacking. The result must be the same as mixing the interleaved
+ * samples first and resampling and quantizing them in a second converter,
+ * which never takes that path. */
+GST_START_TEST (test_converter_unpack_deinterleave)
+{
+  GstAudioConverter *direct, *mix, *resample;
+  gint16 in[CONVERT_SAMPLES * 6];
+  gint32 mixed[CONVERT_SAMPLES * 2];
+  /* downsampling, so the output is never larger than the input */
+  gint16 out[CONVERT_SAMPLES * 2], ref[CONVERT_SAMPLES * 2];
+  gpointer in_p[1] = { in }, mixed_p[1] = { mixed };
+  gpointer out_p[1] = { out }, ref_p[1] = { ref };
+  gsize out_frames, i;
+  gint b, n, c;
+
+  direct = make_quantizing_converter (GST_AUDIO_FORMAT_S16, 48000, 6,
+      GST_AUDIO_FORMAT_S16, 44100, 2);
+  mix = make_quantizing_converter (GST_AUDIO_FORMAT_S16, 48000, 6,
+      GST_AUDIO_FORMAT_S32, 48000, 2);
+  resample = make_quantizing_converter (GST_AUDIO_FORMAT_S32, 48000, 2,
+      GST_AUDIO_FORMAT_S16, 44100, 2);
+  fail_unless (direct != NULL && mix != NULL && resample != NULL);
+
+  /* several blocks, the resampler and noise shaping history carry over */
+  for (b = 0; b < CONVERT_BLOCKS; b++) {
+    for (n = 0; n < CONVERT_SAMPLES; n++)
+      for (c = 0; c < 6; c++)
+        in[n * 6 + c] = (gint16) ((((b * CONVERT_SAMPLES + n) * (c + 3)) %
+                509 - 254) * 97);
+
+    out_frames = gst_audio_converter_get_out_frames (direct, CONVERT_SAMPLES);
+    fail_unless_equals_int (out_frames,
+        gst_audio_converter_get_out_frames (resample, CONVERT_SAMPLES));
+    fail_unless (out_frames <= CONVERT_SAMPLES);
+
+    fail_unless (gst_audio_converter_samples (direct, 0, in_p,
+            CONVERT_SAMPLES, out_p, out_frames));
+    fail_unless (gst_audio_converter_samples (mix, 0, in_p,
+            CONVERT_SAMPLES, mixed_p, CONVERT_SAMPLES));
+    fail_unless (gst_audio_converter_samples (resample, 0, mixed_p,
+            CONVERT_SAMPLES, ref_p, out_frames));
+
+    for (i = 0; i < out_frames * 2; i++)
+      fail_unless_equals_int (out[i], ref[i]);
+  }
+
+  gst_audio_converter_free (direct);
+  gst_audio_converter_free (mix);
+  gst_audio_converter_free (resample);
+}
+
+GST_END_TEST;
+
+#define RESAMPLE_CHANNELS 6
+#define RESAMPLE_SAMPLES 480
+
+static GstAudioResampler *
+make_threaded_resampler (GstAudioFormat format, GstAudioResamplerFlags flags,
+    guint n_threads)
+{
+  GstStructure *options;
+  GstAudioResampler *resampler;
+
+  options = gst_structure_new_empty ("options");
+  gst_audio_resampler_options_set_quality (GST_AUDIO_RESAMPLER_METHOD_KAISER,
+      GST_AUDIO_RESAMPLER_QUALITY_DEFAULT, 44100, 48000, options);
+  gst_structure_set (options, GST_AUDIO_RESAMPLER_OPT_THREADS, G_TYPE_UINT,
+      n_threads, NULL);
+
+  resampler = gst_audio_resampler_new (GST_AUDIO_RESAMPLER_METHOD_KAISER,
+      flags, format, RESAMPLE_CHANNELS, 44100, 48000, options);
+  gst_structure_free (options);
+
+  return resampler;
+}
+
+GST_START_TEST (test_resampler_threads)
+{
+  static const GstAudioFormat formats[] = {
+    GST_AUDIO_FORMAT_S16, GST_AUDIO_FORMAT_F32
+  };
+  static const GstAudioResamplerFlags flags[] = {
+    GST_AUDIO_RESAMPLER_FLAG_NONE,
+    GST_AUDIO_RESAMPLER_FLAG_NON_INTERLEAVED_IN |
+        GST_AUDIO_RESAMPLER_FLAG_NON_INTERLEAVED_OUT
+  };
+  gint f, l, i, c, n;
+
+  for (f = 0; f < G_N_ELEMENTS (formats); f++) {
+    gint bps = formats[f] == GST_AUDIO_FORMAT_S16 ? 2 : 4;
+
+    for (l = 0; l < G_N_ELEMENTS (flags); l++) {
+      gboolean planar = flags[l] != GST_AUDIO_RESAMPLER_FLAG_NONE;
+      GstAudioResampler *single, *threaded;
+      gint8 *in, *out1, *out2;
+      gpointer in_p[RESAMPLE_CHANNELS], out1_p[RESAMPLE_CHANNELS],
+          out2_p[RESAMPLE_CHANNELS];
+      gsize out_size = 2 * RESAMPLE_SAMPLES * RESAMPLE_CHANNELS * bps;
+
+      single = make_threaded_resampler (formats[f], flags[l], 1);
+      threaded = make_threaded_resampler (formats[f], flags[l], 4);
+
+      in = g_malloc (RESAMPLE_SAMPLES * RESAMPLE_CHANNELS * bps);
+      out1 = g_malloc0 (out_size);
+      out2 = g_malloc0 (out_size);
+
+      for (c = 0; c < RESAMPLE_CHANNELS; c++) {
+        gsize stride = planar ? 2 * RESAMPLE_SAMPLES * bps : 0;
+
+        in_p[c] = in + c * RESAMPLE_SAMPLES * bps;
+        out1_p[c] = out1 + c * stride;
+        out2_p[c] = out2 + c * stride;
+      }
+
+      for (i = 0; i < 4; i++) {
+        gsize out_frames;
+
+        for (n = 0; n < RESAMPLE_SAMPLES * RESAMPLE_CHANNELS; n++) {
+          gdouble val = sin ((i * RESAMPLE_SAMPLES + n) * 0.01 * (n % 7 + 1));
+
+          if (bps == 2)
+            ((gint16 *) in)[n] = (gint16) (val * 16000);
+          else
+            ((gfloat *) in)[n] = (gfloat) val;
+        }
+
+        out_frames =
+            gst_audio_resampler_get_out_frames (single, RESAMPLE_SAMPLES);
+        fail_unless_equals_int (out_frames,
+            gst_audio_resampler_get_out_frames (threaded, RESAMPLE_SAMPLES));
+        fail_unless (out_frames <= 2 * RESAMPLE_SAMPLES);
+
+        gst_audio_resampler_resample (single, planar ? in_p : (gpointer *) & in,
+            RESAMPLE_SAMPLES, planar ? out1_p : (gpointer *) & out1,
+            out_frames);
+        gst_audio_resampler_resample (threaded,
+            planar ? in_p : (gpointer *) & in, RESAMPLE_SAMPLES,
+            planar ? out2_p : (gpointer *) & out2, out_frames);
+
+        fail_unless (memcmp (out1, out2, out_size) == 0);
+      }
+
+      gst_audio_resampler_free (single);
+      gst_audio_resampler_free (threaded);
+      g_free (in);
+      g_free (out1);
+      g_free (out2);
+    }
+  }
+}
+
+GST_END_TEST;
+
 static Suite *
 audio_suite (void)
 {
@@ -1616,6 +1997,10 @@ audio_suite (void)
   tcase_add_test (tc_chain, test_audio_buffer_and_audio_meta);
   tcase_add_test (tc_chain, test_audio_info_from_caps);
   tcase_add_test (tc_chain, test_audio_make_raw_caps);
+  tcase_add_test (tc_chain, test_channel_mixer_sparse);
+  tcase_add_test (tc_chain, test_quantize_planar);
+  tcase_add_test (tc_chain, test_converter_unpack_deinterleave);
+  tcase_add_test (tc_chain, test_resampler_threads);
 
   return s;
 }
@@ -0,0 +1,244 @@
+/* GStreamer
+ *
+ * unit test for the AVX2 audio resampler kernels
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <gst/check/gstcheck.h>
+
+/* The kernels are only reachable through the function table of the
+ * resampler, build it in so that the table can be switched */
+#undef GST_CAT_DEFAULT
+#include <gst/audio/audio-resampler.c>
+
+#define N_CHANNELS 2
+#define N_BLOCKS 3
+#define IN_FRAMES 1024
+
+#define N_RESAMPLE_FUNCS G_N_ELEMENTS (resample_funcs)
+
+static ResampleFunc ref_funcs[N_RESAMPLE_FUNCS];
+static ResampleFunc avx2_funcs[N_RESAMPLE_FUNCS];
+
+static gboolean
+setup_funcs (void)
+{
+  ResampleFunc c_funcs[N_RESAMPLE_FUNCS];
+
+  memcpy (c_funcs, resample_funcs, sizeof (c_funcs));
+
+  /* picks the AVX2 kernels where the CPU supports them */
+  audio_resampler_init ();
+  memcpy (avx2_funcs, resample_funcs, sizeof (avx2_funcs));
+
+  /* the same selection without AVX2 */
+  memcpy (resample_funcs, c_funcs, sizeof (c_funcs));
+#if defined HAVE_ORC && !defined DISABLE_ORC && defined CHECK_X86
+  audio_resampler_check_x86 ("sse");
+  audio_resampler_check_x86 ("sse2");
+  audio_resampler_check_x86 ("sse41");
+#endif
+  memcpy (ref_funcs, resample_funcs, sizeof (ref_funcs));
+
+#if defined (CHECK_X86) && defined (__GNUC__)
+  __builtin_cpu_init ();
+  return __builtin_cpu_supports ("avx2") && __builtin_cpu_supports ("fma");
+#else
+  return FALSE;
+#endif
+}
+
+static void
+fill_input (GstAudioFormat format, gpointer data, gint block)
+{
+  gint i;
+
+  for (i = 0; i < IN_FRAMES * N_CHANNELS; i++) {
+    gdouble val = 0.7 * sin ((block * IN_FRAMES * N_CHANNELS + i) * 0.0123)
+        + 0.2 * sin ((block * IN_FRAMES * N_CHANNELS + i) * 0.731);
+
+    switch (format) {
+      case GST_AUDIO_FORMAT_S16:
+        ((gint16 *) data)[i] = (gint16) (val * G_MAXINT16);
+        break;
+      case GST_AUDIO_FORMAT_S32:
+        ((gint32 *) data)[i] = (gint32) (val * G_MAXINT32);
+        break;
+      case GST_AUDIO_FORMAT_F32:
+        ((gfloat *) data)[i] = val;
+        break;
+      case GST_AUDIO_FORMAT_F64:
+        ((gdouble *) data)[i] = val;
+        break;
+      default:
+        g_assert_not_reached ();
+    }
+  }
+}
+
+/* Runs all blocks through a resampler that uses the kernels of @funcs,
+ * returns the output of all blocks */
+static gpointer
+run_resampler (ResampleFunc * funcs, GstAudioFormat format,
+    GstAudioResamplerFilterMode mode,
+    GstAudioResamplerFilterInterpolation interpolation, gsize * out_len)
+{
+  GstAudioResampler *resampler;
+  GstStructure *options;
+  gint bpf = gst_audio_format_get_info (format)->width / 8 * N_CHANNELS;
+  gpointer in, out;
+  gsize out_frames, total = 0;
+  gint b;
+
+  /* the resampler takes its kernel when its filter is set up */
+  memcpy (resample_funcs, funcs, sizeof (resample_funcs));
+
+  options = gst_structure_new_empty ("options");
+  gst_audio_resampler_options_set_quality (GST_AUDIO_RESAMPLER_METHOD_KAISER,
+      GST_AUDIO_RESAMPLER_QUALITY_DEFAULT, 44100, 48000, options);
+  gst_structure_set (options,
+      GST_AUDIO_RESAMPLER_OPT_FILTER_MODE, GST_TYPE_AUDIO_RESAMPLER_FILTER_MODE,
+      mode, GST_AUDIO_RESAMPLER_OPT_FILTER_INTERPOLATION,
+      GST_TYPE_AUDIO_RESAMPLER_FILTER_INTERPOLATION, interpolation, NULL);
+
+  resampler = gst_audio_resampler_new (GST_AUDIO_RESAMPLER_METHOD_KAISER,
+      GST_AUDIO_RESAMPLER_FLAG_NONE, format, N_CHANNELS, 44100, 48000,
+      options);
+  gst_structure_free (options);
+  fail_unless (resampler != NULL);
+
+  in = g_malloc (IN_FRAMES * bpf);
+  out = g_malloc (N_BLOCKS * 2 * IN_FRAMES * bpf);
+
+  for (b = 0; b < N_BLOCKS; b++) {
+    gpointer in_p[1] = { in };
+    gpointer out_p[1];
+
+    fill_input (format, in, b);
+    out_frames = gst_audio_resampler_get_out_frames (resampler, IN_FRAMES);
+    out_p[0] = (guint8 *) out + total * bpf;
+    gst_audio_resampler_resample (resampler, in_p, IN_FRAMES, out_p,
+        out_frames);
+    total += out_frames;
+  }
+
+  gst_audio_resampler_free (resampler);
+  g_free (in);
+
+  *out_len = total * N_CHANNELS;
+  return out;
+}
+
+/* The integer kernels must match the SSE ones exactly, the float kernels
+ * use fused multiply-adds and only round differently */
+static void
+compare_output (GstAudioFormat format, gpointer ref, gpointer out, gsize len)
+{
+  gsize i;
+
+  for (i = 0; i < len; i++) {
+    switch (format) {
+      case GST_AUDIO_FORMAT_S16:
+        fail_unless_equals_int (((gint16 *) out)[i], ((gint16 *) ref)[i]);
+        break;
+      case GST_AUDIO_FORMAT_S32:
+        fail_unless_equals_int (((gint32 *) out)[i], ((gint32 *) ref)[i]);
+        break;
+      case GST_AUDIO_FORMAT_F32:
+        fail_unless (fabsf (((gfloat *) out)[i] - ((gfloat *) ref)[i]) < 1e-5,
+            "sample %" G_GSIZE_FORMAT ": %f != %f", i, ((gfloat *) out)[i],
+            ((gfloat *) ref)[i]);
+        break;
+      case GST_AUDIO_FORMAT_F64:
+        fail_unless (fabs (((gdouble *) out)[i] - ((gdouble *) ref)[i]) <
+            1e-10, "sample %" G_GSIZE_FORMAT ": %f != %f", i,
+            ((gdouble *) out)[i], ((gdouble *) ref)[i]);
+        break;
+      default:
+        g_assert_not_reached ();
+    }
+  }
+}
+
+GST_START_TEST (test_avx2_kernels)
+{
+  static const GstAudioFormat formats[] = {
+    GST_AUDIO_FORMAT_S16, GST_AUDIO_FORMAT_S32,
+    GST_AUDIO_FORMAT_F32, GST_AUDIO_FORMAT_F64
+  };
+  static const struct
+  {
+    GstAudioResamplerFilterMode mode;
+    GstAudioResamplerFilterInterpolation interpolation;
+  } filters[] = {
+    {
+    GST_AUDIO_RESAMPLER_FILTER_MODE_FULL,
+          GST_AUDIO_RESAMPLER_FILTER_INTERPOLATION_NONE}, {
+    GST_AUDIO_RESAMPLER_FILTER_MODE_INTERPOLATED,
+          GST_AUDIO_RESAMPLER_FILTER_INTERPOLATION_LINEAR}, {
+    GST_AUDIO_RESAMPLER_FILTER_MODE_INTERPOLATED,
+          GST_AUDIO_RESAMPLER_FILTER_INTERPOLATION_CUBIC}
+  };
+  guint f, m;
+
+  if (!setup_funcs ()) {
+    GST_INFO ("CPU does not support AVX2 and FMA, skipping");
+    return;
+  }
+
+  for (f = 0; f < G_N_ELEMENTS (formats); f++) {
+    for (m = 0; m < G_N_ELEMENTS (filters); m++) {
+      gpointer ref, out;
+      gsize ref_len, out_len;
+
+      GST_INFO ("format %s, filter mode %d, interpolation %d",
+          gst_audio_format_to_string (formats[f]), filters[m].mode,
+          filters[m].interpolation);
+
+      ref = run_resampler (ref_funcs, formats[f], filters[m].mode,
+          filters[m].interpolation, &ref_len);
+      out = run_resampler (avx2_funcs, formats[f], filters[m].mode,
+          filters[m].interpolation, &out_len);
+
+      fail_unless_equals_int (out_len, ref_len);
+      compare_output (formats[f], ref, out, ref_len);
+
+      g_free (ref);
+      g_free (out);
+    }
+  }
+}
+
+GST_END_TEST;
+
+static Suite *
+audioresampler_avx2_suite (void)
+{
+  Suite *s = suite_create ("audio resampler AVX2");
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_avx2_kernels);
+
+  return s;
+}
+
+GST_CHECK_MAIN (audioresampler_avx2);
@@ -0,0 +1,134 @@
+/* GStreamer
+ *
+ * unit test for the filter tables shared between audio resamplers
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <gst/check/gstcheck.h>
+
+/* The filter tables are private to the resampler, build it in so that the
+ * test can look at them */
+#undef GST_CAT_DEFAULT
+#include <gst/audio/audio-resampler.c>
+
+#define RESAMPLE_SAMPLES 480
+
+static void
+resample_sine (GstAudioResampler * resampler, gfloat * out, gsize out_len)
+{
+  gfloat in[RESAMPLE_SAMPLES];
+  gpointer in_p[1] = { in }, out_p[1] = { out };
+  gsize out_frames;
+  gint n;
+
+  for (n = 0; n < RESAMPLE_SAMPLES; n++)
+    in[n] = sin (n * 0.03);
+
+  out_frames = gst_audio_resampler_get_out_frames (resampler, RESAMPLE_SAMPLES);
+  fail_unless (out_frames <= out_len);
+  memset (out, 0, out_len * sizeof (gfloat));
+  gst_audio_resampler_resample (resampler, in_p, RESAMPLE_SAMPLES, out_p,
+      out_frames);
+}
+
+static gboolean
+taps_table_is_unused (TapsTable * table)
+{
+  gboolean unused;
+
+  g_mutex_lock (&taps_cache_lock);
+  unused = g_queue_find (&taps_cache_unused, table) != NULL;
+  g_mutex_unlock (&taps_cache_lock);
+
+  return unused;
+}
+
+GST_START_TEST (test_resampler_shared_filter)
+{
+  GstStructure *options;
+  GstAudioResampler *resampler, *other;
+  TapsTable *table;
+  gfloat out1[2 * RESAMPLE_SAMPLES], out2[2 * RESAMPLE_SAMPLES];
+
+  options = gst_structure_new_empty ("options");
+  gst_audio_resampler_options_set_quality (GST_AUDIO_RESAMPLER_METHOD_KAISER,
+      GST_AUDIO_RESAMPLER_QUALITY_MAX, 44100, 48000, options);
+  gst_structure_set (options, GST_AUDIO_RESAMPLER_OPT_FILTER_MODE,
+      GST_TYPE_AUDIO_RESAMPLER_FILTER_MODE,
+      GST_AUDIO_RESAMPLER_FILTER_MODE_INTERPOLATED, NULL);
+
+  resampler = gst_audio_resampler_new (GST_AUDIO_RESAMPLER_METHOD_KAISER, 0,
+      GST_AUDIO_FORMAT_F32, 1, 44100, 48000, options);
+  other = gst_audio_resampler_new (GST_AUDIO_RESAMPLER_METHOD_KAISER, 0,
+      GST_AUDIO_FORMAT_F32, 1, 44100, 48000, options);
+
+  /* both resamplers use the same table */
+  table = resampler->taps_table;
+  fail_unless (table != NULL);
+  fail_unless (other->taps_table == table);
+  fail_unless_equals_int (table->ref_count, 2);
+
+  resample_sine (resampler, out1, G_N_ELEMENTS (out1));
+  gst_audio_resampler_free (resampler);
+  fail_unless_equals_int (table->ref_count, 1);
+
+  /* the table is reused after switching to another filter and back */
+  gst_audio_resampler_options_set_quality (GST_AUDIO_RESAMPLER_METHOD_KAISER,
+      GST_AUDIO_RESAMPLER_QUALITY_MIN, 44100, 48000, options);
+  gst_audio_resampler_update (other, 0, 0, options);
+  fail_unless (other->taps_table != table);
+  fail_unless_equals_int (table->ref_count, 0);
+  fail_unless (taps_table_is_unused (table));
+
+  gst_audio_resampler_options_set_quality (GST_AUDIO_RESAMPLER_METHOD_KAISER,
+      GST_AUDIO_RESAMPLER_QUALITY_MAX, 44100, 48000, options);
+  gst_audio_resampler_update (other, 0, 0, options);
+  fail_unless (other->taps_table == table);
+  fail_unless_equals_int (table->ref_count, 1);
+  fail_unless (!taps_table_is_unused (table));
+
+  gst_audio_resampler_reset (other);
+  resample_sine (other, out2, G_N_ELEMENTS (out2));
+  fail_unless (memcmp (out1, out2, sizeof (out1)) == 0);
+
+  /* the last user keeps it cached for the next resampler */
+  gst_audio_resampler_free (other);
+  fail_unless_equals_int (table->ref_count, 0);
+  fail_unless (taps_table_is_unused (table));
+
+  gst_structure_free (options);
+}
+
+GST_END_TEST;
+
+static Suite *
+audioresampler_suite (void)
+{
+  Suite *s = suite_create ("audio resampler");
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_resampler_shared_filter);
+
+  return s;
+}
+
+GST_CHECK_MAIN (audioresampler);
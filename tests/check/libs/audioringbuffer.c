@@ -0,0 +1,313 @@
+/* GStreamer
+ *
+ * unit test for the audio ringbuffer base class
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <gst/check/gstcheck.h>
+#include <gst/check/gstharness.h>
+#include <gst/audio/audio.h>
+#include <gst/audio/gstaudiosrc.h>
+#include <string.h>
+
+#define GST_TYPE_AUDIO_FOO_RING_BUFFER (gst_audio_foo_ring_buffer_get_type())
+typedef struct _GstAudioFooRingBuffer GstAudioFooRingBuffer;
+typedef struct _GstAudioFooRingBufferClass GstAudioFooRingBufferClass;
+
+/* A ringbuffer without a device thread, the test advances it */
+struct _GstAudioFooRingBuffer
+{
+  GstAudioRingBuffer parent;
+};
+
+struct _GstAudioFooRingBufferClass
+{
+  GstAudioRingBufferClass parent_class;
+};
+
+GType gst_audio_foo_ring_buffer_get_type (void);
+G_DEFINE_TYPE (GstAudioFooRingBuffer, gst_audio_foo_ring_buffer,
+    GST_TYPE_AUDIO_RING_BUFFER);
+
+static gboolean
+gst_audio_foo_ring_buffer_open_device (GstAudioRingBuffer * buf)
+{
+  return TRUE;
+}
+
+static gboolean
+gst_audio_foo_ring_buffer_close_device (GstAudioRingBuffer * buf)
+{
+  return TRUE;
+}
+
+static gboolean
+gst_audio_foo_ring_buffer_acquire (GstAudioRingBuffer * buf,
+    GstAudioRingBufferSpec * spec)
+{
+  buf->size = spec->segtotal * spec->segsize;
+  buf->memory = g_malloc0 (buf->size);
+
+  return TRUE;
+}
+
+static gboolean
+gst_audio_foo_ring_buffer_release (GstAudioRingBuffer * buf)
+{
+  g_free (buf->memory);
+  buf->memory = NULL;
+
+  return TRUE;
+}
+
+static gboolean
+gst_audio_foo_ring_buffer_state_changed (GstAudioRingBuffer * buf)
+{
+  return TRUE;
+}
+
+static void
+gst_audio_foo_ring_buffer_init (GstAudioFooRingBuffer * buf)
+{
+}
+
+static void
+gst_audio_foo_ring_buffer_class_init (GstAudioFooRingBufferClass * klass)
+{
+  GstAudioRingBufferClass *rclass = GST_AUDIO_RING_BUFFER_CLASS (klass);
+
+  rclass->open_device = gst_audio_foo_ring_buffer_open_device;
+  rclass->close_device = gst_audio_foo_ring_buffer_close_device;
+  rclass->acquire = gst_audio_foo_ring_buffer_acquire;
+  rclass->release = gst_audio_foo_ring_buffer_release;
+  rclass->start = gst_audio_foo_ring_buffer_state_changed;
+  rclass->pause = gst_audio_foo_ring_buffer_state_changed;
+  rclass->resume = gst_audio_foo_ring_buffer_state_changed;
+  rclass->stop = gst_audio_foo_ring_buffer_state_changed;
+}
+
+#define N_SEGMENTS 5000
+
+typedef struct
+{
+  GstAudioRingBuffer *buf;
+  gint committed;
+} WriterData;
+
+static gpointer
+writer_thread (WriterData * data)
+{
+  GstAudioRingBuffer *buf = data->buf;
+  gint sps = buf->samples_per_seg;
+  guint8 *samples = g_malloc0 (buf->spec.segsize);
+  guint64 sample = 0;
+  gint accum = 0;
+  gint i;
+
+  for (i = 0; i < N_SEGMENTS; i++) {
+    /* blocks while the ringbuffer is full */
+    fail_unless_equals_int (gst_audio_ring_buffer_commit (buf, &sample,
+            samples, sps, sps, &accum), sps);
+    g_atomic_int_inc (&data->committed);
+  }
+
+  g_free (samples);
+
+  return NULL;
+}
+
+/* The device advances as soon as the writer filled the ringbuffer, racing
+ * with the writer going to sleep on the next segment. A lost wakeup leaves
+ * the writer sleeping forever and the test times out. */
+GST_START_TEST (test_advance_wakes_waiting_writer)
+{
+  GstAudioRingBuffer *buf;
+  GstCaps *caps;
+  WriterData data;
+  GThread *thread;
+  gint segtotal, i;
+
+  buf = g_object_new (GST_TYPE_AUDIO_FOO_RING_BUFFER, NULL);
+  gst_object_ref_sink (buf);
+
+  caps = gst_caps_new_simple ("audio/x-raw", "format", G_TYPE_STRING,
+      GST_AUDIO_NE (S16), "layout", G_TYPE_STRING, "interleaved",
+      "rate", G_TYPE_INT, 48000, "channels", G_TYPE_INT, 1, NULL);
+  buf->spec.latency_time = 2000;
+  buf->spec.buffer_time = 4000;
+  fail_unless (gst_audio_ring_buffer_parse_caps (&buf->spec, caps));
+  gst_caps_unref (caps);
+
+  fail_unless (gst_audio_ring_buffer_open_device (buf));
+  fail_unless (gst_audio_ring_buffer_acquire (buf, &buf->spec));
+  segtotal = buf->spec.segtotal;
+  fail_unless_equals_int (segtotal, 2);
+
+  gst_audio_ring_buffer_set_flushing (buf, FALSE);
+  gst_audio_ring_buffer_may_start (buf, TRUE);
+  fail_unless (gst_audio_ring_buffer_start (buf));
+
+  data.buf = buf;
+  data.committed = 0;
+  thread = g_thread_new ("writer", (GThreadFunc) writer_thread, &data);
+
+  for (i = 0; i < N_SEGMENTS - segtotal; i++) {
+    /* wait until the writer blocks, or is about to block, on a full
+     * ringbuffer */
+    while (g_atomic_int_get (&data.committed) < i + segtotal)
+      g_thread_yield ();
+
+    gst_audio_ring_buffer_advance (buf, 1);
+  }
+
+  g_thread_join (thread);
+  fail_unless_equals_int (data.committed, N_SEGMENTS);
+
+  fail_unless (gst_audio_ring_buffer_stop (buf));
+  fail_unless (gst_audio_ring_buffer_release (buf));
+  fail_unless (gst_audio_ring_buffer_close_device (buf));
+  gst_object_unref (buf);
+}
+
+GST_END_TEST;
+
+#define GST_TYPE_AUDIO_FOO_SRC (gst_audio_foo_src_get_type())
+typedef struct _GstAudioFooSrc GstAudioFooSrc;
+typedef struct _GstAudioFooSrcClass GstAudioFooSrcClass;
+
+#define FOO_SRC_CAPS "audio/x-raw, format=(string)S16LE, " \
+    "layout=(string)interleaved, rate=(int)48000, channels=(int)1"
+
+static GstStaticPadTemplate src_template = GST_STATIC_PAD_TEMPLATE ("src",
+    GST_PAD_SRC,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS (FOO_SRC_CAPS));
+
+struct _GstAudioFooSrc
+{
+  GstAudioSrc parent;
+
+  GstClockTime position;
+};
+
+struct _GstAudioFooSrcClass
+{
+  GstAudioSrcClass parent_class;
+};
+
+GType gst_audio_foo_src_get_type (void);
+G_DEFINE_TYPE (GstAudioFooSrc, gst_audio_foo_src, GST_TYPE_AUDIO_SRC);
+
+static gboolean
+gst_audio_foo_src_prepare (GstAudioSrc * src, GstAudioRingBufferSpec * spec)
+{
+  return TRUE;
+}
+
+static gboolean
+gst_audio_foo_src_unprepare (GstAudioSrc * src)
+{
+  return TRUE;
+}
+
+/* Captures a few samples at a time and reports a timestamp for them, so
+ * that the device thread stores timestamps for every segment */
+static guint
+gst_audio_foo_src_read (GstAudioSrc * src, gpointer data, guint length,
+    GstClockTime * timestamp)
+{
+  GstAudioFooSrc *self = (GstAudioFooSrc *) src;
+
+  length = MIN (length, 16 * 2);
+  memset (data, 0, length);
+  g_usleep (50);
+
+  *timestamp = self->position;
+  self->position += gst_util_uint64_scale_int (length / 2, GST_SECOND, 48000);
+
+  return length;
+}
+
+static void
+gst_audio_foo_src_init (GstAudioFooSrc * src)
+{
+}
+
+static void
+gst_audio_foo_src_class_init (GstAudioFooSrcClass * klass)
+{
+  GstElementClass *element_class = GST_ELEMENT_CLASS (klass);
+  GstAudioSrcClass *audiosrc_class = GST_AUDIO_SRC_CLASS (klass);
+
+  gst_element_class_add_static_pad_template (element_class, &src_template);
+  gst_element_class_set_metadata (element_class,
+      "AudioFooSrc", "Source/Audio",
+      "Audio Source Unit Test element", "Foo Bar <foo@bar.com>");
+
+  audiosrc_class->prepare = gst_audio_foo_src_prepare;
+  audiosrc_class->unprepare = gst_audio_foo_src_unprepare;
+  audiosrc_class->read = gst_audio_foo_src_read;
+}
+
+/* Stopping a source does not wait for its device thread, which keeps
+ * capturing and storing timestamps until release joins it. That must not
+ * write into the timestamps that release already freed. Best run under
+ * valgrind. */
+GST_START_TEST (test_release_while_capturing)
+{
+  gint i;
+
+  for (i = 0; i < 20; i++) {
+    GstElement *foosrc;
+    GstHarness *h;
+    GstBuffer *buffer;
+
+    foosrc = g_object_new (GST_TYPE_AUDIO_FOO_SRC, "latency-time",
+        (gint64) 1000, "buffer-time", (gint64) 4000, NULL);
+    h = gst_harness_new_with_element (foosrc, NULL, "src");
+    gst_harness_set_sink_caps_str (h, FOO_SRC_CAPS);
+    gst_harness_play (h);
+
+    buffer = gst_harness_pull (h);
+    fail_unless (buffer != NULL);
+    gst_buffer_unref (buffer);
+
+    /* releases the ringbuffer while the device thread is reading */
+    gst_harness_teardown (h);
+  }
+}
+
+GST_END_TEST;
+
+static Suite *
+audioringbuffer_suite (void)
+{
+  Suite *s = suite_create ("audioringbuffer");
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_advance_wakes_waiting_writer);
+  tcase_add_test (tc_chain, test_release_while_capturing);
+
+  return s;
+}
+
+GST_CHECK_MAIN (audioringbuffer);
@@ -25,6 +25,7 @@
 #endif
 
 #include <gst/check/gstcheck.h>
+#include <gst/check/gstharness.h>
 #include <gst/audio/gstaudiosink.h>
 
 #define GST_TYPE_AUDIO_FOO_SINK           (gst_audio_foo_sink_get_type())
@@ -43,6 +44,15 @@ struct _GstAudioFooSink
   GstAudioSink parent;
 
   guint num_clear_all_call;
+
+  /* when gated, the device only processes as many segments as allowed */
+  GMutex lock;
+  GCond cond;
+  gboolean gated;
+  gboolean flushing;
+  guint allowed_writes;
+
+  guint delay;
 };
 
 struct _GstAudioFooSinkClass
@@ -61,22 +71,80 @@ gst_audio_foo_sink_clear_all (GstAudioSink * sink)
   self->num_clear_all_call++;
 }
 
+static gboolean
+gst_audio_foo_sink_prepare (GstAudioSink * sink, GstAudioRingBufferSpec * spec)
+{
+  return TRUE;
+}
+
+static gint
+gst_audio_foo_sink_write (GstAudioSink * sink, gpointer data, guint length)
+{
+  GstAudioFooSink *self = GST_AUDIO_FOO_SINK (sink);
+
+  g_mutex_lock (&self->lock);
+  while (self->gated && !self->flushing && self->allowed_writes == 0)
+    g_cond_wait (&self->cond, &self->lock);
+  if (self->allowed_writes > 0)
+    self->allowed_writes--;
+  g_mutex_unlock (&self->lock);
+
+  return length;
+}
+
+static guint
+gst_audio_foo_sink_delay (GstAudioSink * sink)
+{
+  return GST_AUDIO_FOO_SINK (sink)->delay;
+}
+
+static void
+gst_audio_foo_sink_reset (GstAudioSink * sink)
+{
+  GstAudioFooSink *self = GST_AUDIO_FOO_SINK (sink);
+
+  g_mutex_lock (&self->lock);
+  self->flushing = TRUE;
+  g_cond_broadcast (&self->cond);
+  g_mutex_unlock (&self->lock);
+}
+
 static void
 gst_audio_foo_sink_init (GstAudioFooSink * src)
 {
+  g_mutex_init (&src->lock);
+  g_cond_init (&src->cond);
+}
+
+static void
+gst_audio_foo_sink_finalize (GObject * object)
+{
+  GstAudioFooSink *self = GST_AUDIO_FOO_SINK (object);
+
+  g_mutex_clear (&self->lock);
+  g_cond_clear (&self->cond);
+
+  G_OBJECT_CLASS (gst_audio_foo_sink_parent_class)->finalize (object);
 }
 
 static void
 gst_audio_foo_sink_class_init (GstAudioFooSinkClass * klass)
 {
+  GObjectClass *gobject_class = G_OBJECT_CLASS (klass);
   GstElementClass *element_class = GST_ELEMENT_CLASS (klass);
   GstAudioSinkClass *audiosink_class = GST_AUDIO_SINK_CLASS (klass);
 
+  gobject_class->finalize = gst_audio_foo_sink_finalize;
+
   gst_element_class_add_static_pad_template (element_class, &sink_template);
   gst_element_class_set_metadata (element_class,
       "AudioFooSink", "Sink/Audio",
       "Audio Sink Unit Test element", "Foo Bar <foo@bar.com>");
 
+  audiosink_class->prepare = gst_audio_foo_sink_prepare;
+  audiosink_class->write = gst_audio_foo_sink_write;
+  audiosink_class->delay = gst_audio_foo_sink_delay;
+  audiosink_class->reset = gst_audio_foo_sink_reset;
   audiosink_class->extension->clear_all = gst_audio_foo_sink_clear_all;
 }
 
@@ -107,6 +175,256 @@ GST_START_TEST (test_class_extension)
 
 GST_END_TEST;
 
+static GstHarness *
+setup_foo_sink_harness (gboolean low_latency)
+{
+  GstElement *foosink;
+  GstHarness *h;
+
+  /* 666us is a little less than 32 frames at 48kHz */
+  foosink = g_object_new (GST_TYPE_AUDIO_FOO_SINK, "low-latency", low_latency,
+      "latency-time", (gint64) 666, "buffer-time", (gint64) 2668, NULL);
+  h = gst_harness_new_with_element (foosink, "sink", NULL);
+  gst_harness_play (h);
+  gst_harness_set_src_caps_str (h, "audio/x-raw, format=(string)S16LE, "
+      "layout=(string)interleaved, rate=(int)48000, channels=(int)2");
+
+  return h;
+}
+
+GST_START_TEST (test_low_latency_segsize)
+{
+  GstHarness *h;
+  GstAudioRingBufferSpec *spec;
+
+  /* by default the segment size is truncated to whole frames */
+  h = setup_foo_sink_harness (FALSE);
+  spec = &GST_AUDIO_BASE_SINK (h->element)->ringbuffer->spec;
+  fail_unless_equals_int (spec->segsize, 31 * 4);
+  gst_harness_teardown (h);
+
+  /* in low-latency mode it is rounded */
+  h = setup_foo_sink_harness (TRUE);
+  spec = &GST_AUDIO_BASE_SINK (h->element)->ringbuffer->spec;
+  fail_unless_equals_int (spec->segsize, 32 * 4);
+  fail_unless_equals_int (spec->segtotal, 4);
+  gst_harness_teardown (h);
+}
+
+GST_END_TEST;
+
+/* Lets the device process @n_segments more segments and waits until it did */
+static void
+foo_sink_process_segments (GstHarness * h, guint n_segments)
+{
+  GstAudioFooSink *foosink = GST_AUDIO_FOO_SINK (h->element);
+  GstAudioRingBuffer *ringbuf = GST_AUDIO_BASE_SINK (h->element)->ringbuffer;
+  gint segdone = g_atomic_int_get (&ringbuf->segdone) - ringbuf->segbase;
+
+  g_mutex_lock (&foosink->lock);
+  foosink->allowed_writes += n_segments;
+  g_cond_broadcast (&foosink->cond);
+  g_mutex_unlock (&foosink->lock);
+
+  while (g_atomic_int_get (&ringbuf->segdone) - ringbuf->segbase <
+      segdone + n_segments)
+    g_usleep (1000);
+}
+
+static GstBuffer *
+create_foo_buffer (guint n_frames, guint8 val, GstClockTime pts)
+{
+  GstBuffer *buffer = gst_buffer_new_allocate (NULL, n_frames * 4, NULL);
+
+  gst_buffer_memset (buffer, 0, val, n_frames * 4);
+  GST_BUFFER_PTS (buffer) = pts;
+  GST_BUFFER_DURATION (buffer) =
+      gst_util_uint64_scale_int (n_frames, GST_SECOND, 48000);
+
+  return buffer;
+}
+
+/* Checks that segment @seg of the ringbuffer is filled with @val */
+static void
+check_foo_segment (GstHarness * h, gint seg, guint8 val)
+{
+  GstAudioRingBuffer *ringbuf = GST_AUDIO_BASE_SINK (h->element)->ringbuffer;
+  gint segsize = ringbuf->spec.segsize;
+  guint8 *data = ringbuf->memory + (seg % ringbuf->spec.segtotal) * segsize;
+  gint i;
+
+  for (i = 0; i < segsize; i++)
+    fail_unless_equals_int (data[i], val);
+}
+
+static guint64
+get_foo_stat (GstHarness * h, const gchar * field)
+{
+  GstStructure *stats;
+  guint64 val;
+
+  g_object_get (h->element, "audio-stats", &stats, NULL);
+  fail_unless (gst_structure_get_uint64 (stats, field, &val));
+  gst_structure_free (stats);
+
+  return val;
+}
+
+GST_START_TEST (test_low_latency_render)
+{
+  GstHarness *h;
+  GstAudioFooSink *foosink;
+  GstAudioBaseSink *bsink;
+  GstQuery *query;
+  GstClockTime min_latency, max_latency;
+  gboolean live;
+
+  /* 32 frame segments, 4 of them */
+  h = setup_foo_sink_harness (TRUE);
+  gst_harness_set_upstream_latency (h, 0);
+  bsink = GST_AUDIO_BASE_SINK (h->element);
+  foosink = GST_AUDIO_FOO_SINK (h->element);
+  g_mutex_lock (&foosink->lock);
+  foosink->gated = TRUE;
+  foosink->flushing = FALSE;
+  foosink->delay = 10;
+  g_mutex_unlock (&foosink->lock);
+
+  /* the first buffer starts the device at segment 0 */
+  fail_unless_equals_int (gst_harness_push (h, create_foo_buffer (32, 0x11,
+              0)), GST_FLOW_OK);
+  fail_unless_equals_uint64 (bsink->next_sample, 32);
+
+  /* the device played past what we wrote, the next buffer goes right
+   * behind the segment it is playing instead of where it would follow */
+  foo_sink_process_segments (h, 3);
+  fail_unless_equals_int (gst_harness_push (h, create_foo_buffer (32, 0x22,
+              32 * GST_SECOND / 48000)), GST_FLOW_OK);
+  fail_unless_equals_uint64 (bsink->next_sample, 5 * 32);
+  check_foo_segment (h, 4, 0x22);
+  fail_unless_equals_uint64 (get_foo_stat (h, "underruns"), 1);
+
+  /* two more segments fill the ringbuffer up to the device */
+  fail_unless_equals_int (gst_harness_push (h, create_foo_buffer (32, 0x33,
+              GST_CLOCK_TIME_NONE)), GST_FLOW_OK);
+  fail_unless_equals_int (gst_harness_push (h, create_foo_buffer (32, 0x44,
+              GST_CLOCK_TIME_NONE)), GST_FLOW_OK);
+  fail_unless_equals_uint64 (bsink->next_sample, 7 * 32);
+  fail_unless_equals_uint64 (get_foo_stat (h, "overruns"), 0);
+
+  /* one more would have to wait for the device, the queued samples are
+   * dropped and silenced instead and it is written behind the device */
+  fail_unless_equals_int (gst_harness_push (h, create_foo_buffer (32, 0x55,
+              GST_CLOCK_TIME_NONE)), GST_FLOW_OK);
+  fail_unless_equals_uint64 (bsink->next_sample, 5 * 32);
+  fail_unless_equals_uint64 (get_foo_stat (h, "overruns"), 1);
+  fail_unless_equals_uint64 (get_foo_stat (h, "dropped-samples"), 3 * 32);
+  check_foo_segment (h, 4, 0x55);
+  check_foo_segment (h, 5, 0x00);
+  check_foo_segment (h, 6, 0x00);
+
+  /* the latency is what is queued behind the device plus its delay: the
+   * segment it is playing, the one we wrote and 10 frames */
+  query = gst_query_new_latency ();
+  fail_unless (gst_element_query (h->element, query));
+  gst_query_parse_latency (query, &live, &min_latency, &max_latency);
+  fail_unless (live);
+  fail_unless_equals_uint64 (min_latency,
+      gst_util_uint64_scale_int (2 * 32 + 10, GST_SECOND, 48000));
+  gst_query_unref (query);
+
+  gst_harness_teardown (h);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_audio_stats)
+{
+  GstElement *foosink;
+  GstAudioRingBuffer *ringbuf;
+  GstHarness *h;
+  GstClock *clock;
+  GstBus *bus;
+  GstMessage *msg;
+  GstStructure *stats;
+  const GValue *histogram;
+  guint64 val, sum = 0;
+  guint i;
+
+  /* 10ms segments, resync right away on anything over 1ms off */
+  foosink = g_object_new (GST_TYPE_AUDIO_FOO_SINK, "latency-time",
+      (gint64) 10000, "buffer-time", (gint64) 200000, "alignment-threshold",
+      (guint64) GST_MSECOND, "discont-wait", (guint64) 0,
+      "audio-stats-interval", (guint64) 1, NULL);
+  GST_AUDIO_FOO_SINK (foosink)->gated = TRUE;
+  h = gst_harness_new_with_element (foosink, "sink", NULL);
+
+  /* sync against our own clock, so that samples end up at their
+   * timestamps */
+  clock = gst_element_provide_clock (h->element);
+  gst_element_set_clock (h->element, clock);
+  gst_object_unref (clock);
+  bus = gst_bus_new ();
+  gst_element_set_bus (h->element, bus);
+
+  gst_harness_play (h);
+  gst_harness_set_src_caps_str (h, "audio/x-raw, format=(string)S16LE, "
+      "layout=(string)interleaved, rate=(int)48000, channels=(int)2");
+  ringbuf = GST_AUDIO_BASE_SINK (h->element)->ringbuffer;
+
+  fail_unless_equals_int (gst_harness_push (h, create_foo_buffer (480, 0x11,
+              0)), GST_FLOW_OK);
+  /* a 10ms gap is filled with silence */
+  fail_unless_equals_int (gst_harness_push (h, create_foo_buffer (480, 0x11,
+              20 * GST_MSECOND)), GST_FLOW_OK);
+  fail_unless_equals_uint64 (get_foo_stat (h, "inserted-samples"), 480);
+  /* 5ms overlapping the previous buffer are dropped */
+  fail_unless_equals_int (gst_harness_push (h, create_foo_buffer (480, 0x11,
+              25 * GST_MSECOND)), GST_FLOW_OK);
+  fail_unless_equals_uint64 (get_foo_stat (h, "dropped-samples"), 240);
+  fail_unless_equals_uint64 (get_foo_stat (h, "underruns"), 0);
+
+  /* the device plays up to 50ms, so the next buffer is late */
+  fail_unless (gst_audio_ring_buffer_start (ringbuf));
+  foo_sink_process_segments (h, 5);
+  fail_unless_equals_int (gst_harness_push (h, create_foo_buffer (480, 0x11,
+              35 * GST_MSECOND)), GST_FLOW_OK);
+
+  g_object_get (h->element, "audio-stats", &stats, NULL);
+  fail_unless (gst_structure_has_name (stats,
+          "application/x-gst-audio-base-sink-stats"));
+  fail_unless (gst_structure_get_uint64 (stats, "underruns", &val));
+  fail_unless_equals_uint64 (val, 1);
+  fail_unless (gst_structure_get_uint64 (stats, "dropped-samples", &val));
+  fail_unless_equals_uint64 (val, 240 + 480);
+  fail_unless (gst_structure_get_uint64 (stats, "inserted-samples", &val));
+  fail_unless_equals_uint64 (val, 480);
+  fail_unless (gst_structure_get_uint64 (stats, "processed", &val));
+  fail_unless_equals_uint64 (val, 4);
+
+  /* every processed buffer is in one bucket of the histogram */
+  histogram = gst_structure_get_value (stats, "process-time-histogram");
+  fail_unless (histogram != NULL);
+  fail_unless (GST_VALUE_HOLDS_ARRAY (histogram));
+  fail_unless_equals_int (gst_value_array_get_size (histogram), 8);
+  for (i = 0; i < gst_value_array_get_size (histogram); i++)
+    sum += g_value_get_uint64 (gst_value_array_get_value (histogram, i));
+  fail_unless_equals_uint64 (sum, 4);
+  gst_structure_free (stats);
+
+  /* the stats are posted while rendering */
+  msg = gst_bus_pop_filtered (bus, GST_MESSAGE_ELEMENT);
+  fail_unless (msg != NULL);
+  fail_unless (gst_structure_has_name (gst_message_get_structure (msg),
+          "application/x-gst-audio-base-sink-stats"));
+  gst_message_unref (msg);
+
+  gst_element_set_bus (h->element, NULL);
+  gst_object_unref (bus);
+  gst_harness_teardown (h);
+}
+
+GST_END_TEST;
 
 static Suite *
 audiosink_suite (void)
@@ -116,6 +434,9 @@ audiosink_suite (void)
 
   suite_add_tcase (s, tc_chain);
   tcase_add_test (tc_chain, test_class_extension);
+  tcase_add_test (tc_chain, test_low_latency_segsize);
+  tcase_add_test (tc_chain, test_low_latency_render);
+  tcase_add_test (tc_chain, test_audio_stats);
 
   return s;
 }
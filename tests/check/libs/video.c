@@ -36,6 +36,12 @@
 #include <gst/video/video-overlay-composition.h>
 #include <string.h>
 
+#if defined (HAVE_AVX2) && defined (HAVE_IMMINTRIN_H) && defined (__GNUC__) \
+    && (defined (__i386__) || defined (__x86_64__))
+#define CHECK_SCALER_AVX2
+#include <gst/video/video-scaler-x86-avx2.h>
+#endif
+
 /* These are from the current/old videotestsrc; we check our new public API
  * in libgstvideo against the old one to make sure the sizes and offsets
  * end up the same */
@@ -2488,6 +2494,172 @@ GST_START_TEST (test_video_scaler)
 
 GST_END_TEST;
 
+#ifdef CHECK_SCALER_AVX2
+/* What the ORC multaps, muladdtaps and scaletaps sequences compute. 8 bit
+ * pixels are accumulated in wrapping 16 bit integers */
+static void
+scaler_h_taps_u8_lq_ref (guint8 * d, const guint8 * pixels,
+    const gint16 * taps, guint n_taps, guint count)
+{
+  guint i, j;
+
+  for (i = 0; i < count; i++) {
+    gint16 acc = 0, v;
+
+    for (j = 0; j < n_taps; j++)
+      acc += (gint16) (pixels[j * count + i] * taps[j * count + i]);
+    v = (gint16) (acc + 32) >> 6;
+    d[i] = CLAMP (v, 0, 255);
+  }
+}
+
+static void
+scaler_v_taps_u8_lq_ref (guint8 * d, gpointer srcs[], guint src_inc,
+    const gint16 * taps, guint n_taps, guint count)
+{
+  guint i, j;
+
+  for (i = 0; i < count; i++) {
+    gint16 acc = 0, v;
+
+    for (j = 0; j < n_taps; j++)
+      acc += (gint16) (((guint8 *) srcs[j * src_inc])[i] * taps[j]);
+    v = (gint16) (acc + 32) >> 6;
+    d[i] = CLAMP (v, 0, 255);
+  }
+}
+
+static void
+scaler_h_taps_u16_ref (guint16 * d, const guint16 * pixels,
+    const gint16 * taps, guint n_taps, guint count)
+{
+  guint i, j;
+
+  for (i = 0; i < count; i++) {
+    gint32 acc = 0, v;
+
+    for (j = 0; j < n_taps; j++)
+      acc += pixels[j * count + i] * taps[j * count + i];
+    v = (acc + 4095) >> 12;
+    d[i] = CLAMP (v, 0, 65535);
+  }
+}
+
+static void
+scaler_v_taps_u16_ref (guint16 * d, gpointer srcs[], guint src_inc,
+    const gint16 * taps, guint n_taps, guint count)
+{
+  guint i, j;
+
+  for (i = 0; i < count; i++) {
+    gint32 acc = 0, v;
+
+    for (j = 0; j < n_taps; j++)
+      acc += ((guint16 *) srcs[j * src_inc])[i] * taps[j];
+    v = (acc + 4095) >> 12;
+    d[i] = CLAMP (v, 0, 65535);
+  }
+}
+#endif
+
+GST_START_TEST (test_video_scaler_avx2)
+{
+#ifdef CHECK_SCALER_AVX2
+  /* the kernels handle 32 (8 bit) or 16 (16 bit) samples at a time and
+   * finish the rest one by one */
+  static const guint n_taps[] = { 3, 4, 5, 8 };
+  static const guint counts[] = { 1, 15, 16, 17, 31, 32, 33, 47, 100 };
+  /* interlaced vertical scaling takes every other line */
+  static const guint src_incs[] = { 1, 2 };
+  GRand *rand;
+  guint t, c, k, i;
+
+  __builtin_cpu_init ();
+  if (!__builtin_cpu_supports ("avx2")) {
+    GST_INFO ("CPU does not support AVX2, skipping");
+    return;
+  }
+
+  rand = g_rand_new_with_seed (0x5ca1e);
+
+  for (t = 0; t < G_N_ELEMENTS (n_taps); t++) {
+    for (c = 0; c < G_N_ELEMENTS (counts); c++) {
+      guint taps = n_taps[t], count = counts[c];
+      guint8 *pixels8 = g_new (guint8, taps * count);
+      guint16 *pixels16 = g_new (guint16, taps * count);
+      gint16 *htaps8 = g_new (gint16, taps * count);
+      gint16 *htaps16 = g_new (gint16, taps * count);
+      gint16 *vtaps8 = g_new (gint16, taps);
+      gint16 *vtaps16 = g_new (gint16, taps);
+      guint8 *ref8 = g_new (guint8, count), *out8 = g_new (guint8, count);
+      guint16 *ref16 = g_new (guint16, count), *out16 =
+          g_new (guint16, count);
+      gpointer srcs8[16], srcs16[16];
+
+      GST_INFO ("%u taps, %u samples", taps, count);
+
+      /* taps of a few times the unity gain, so that the sums go out of
+       * range and get clamped, and wrap around for 8 bit pixels */
+      for (i = 0; i < taps * count; i++) {
+        pixels8[i] = g_rand_int_range (rand, 0, 256);
+        pixels16[i] = g_rand_int_range (rand, 0, 65536);
+        htaps8[i] = g_rand_int_range (rand, -64, 128);
+        htaps16[i] = g_rand_int_range (rand, -1024, 2048);
+      }
+      for (i = 0; i < taps; i++) {
+        vtaps8[i] = htaps8[i];
+        vtaps16[i] = htaps16[i];
+      }
+
+      scaler_h_taps_u8_lq_ref (ref8, pixels8, htaps8, taps, count);
+      video_scaler_h_taps_u8_lq_avx2 (out8, pixels8, htaps8, taps, count);
+      fail_unless (memcmp (out8, ref8, count) == 0);
+
+      scaler_h_taps_u16_ref (ref16, pixels16, htaps16, taps, count);
+      video_scaler_h_taps_u16_avx2 (out16, pixels16, htaps16, taps, count);
+      fail_unless (memcmp (out16, ref16, count * 2) == 0);
+
+      for (k = 0; k < G_N_ELEMENTS (src_incs); k++) {
+        guint src_inc = src_incs[k];
+
+        /* the lines in between belong to the other field */
+        for (i = 0; i < taps * src_inc; i++) {
+          srcs8[i] = i % src_inc ? NULL : pixels8 + i / src_inc * count;
+          srcs16[i] = i % src_inc ? NULL : pixels16 + i / src_inc * count;
+        }
+
+        scaler_v_taps_u8_lq_ref (ref8, srcs8, src_inc, vtaps8, taps, count);
+        video_scaler_v_taps_u8_lq_avx2 (out8, srcs8, src_inc, vtaps8, taps,
+            count);
+        fail_unless (memcmp (out8, ref8, count) == 0);
+
+        scaler_v_taps_u16_ref (ref16, srcs16, src_inc, vtaps16, taps, count);
+        video_scaler_v_taps_u16_avx2 (out16, srcs16, src_inc, vtaps16, taps,
+            count);
+        fail_unless (memcmp (out16, ref16, count * 2) == 0);
+      }
+
+      g_free (pixels8);
+      g_free (pixels16);
+      g_free (htaps8);
+      g_free (htaps16);
+      g_free (vtaps8);
+      g_free (vtaps16);
+      g_free (ref8);
+      g_free (out8);
+      g_free (ref16);
+      g_free (out16);
+    }
+  }
+
+  g_rand_free (rand);
+#else
+  GST_INFO ("AVX2 scaler kernels not built, skipping");
+#endif
+}
+
+GST_END_TEST;
+
 typedef enum
 {
   RGB,
@@ -2862,6 +3034,32 @@ GST_START_TEST (test_video_convert_multithreading)
   fail_unless (gst_buffer_memcmp (refbuffer, 0, info.data, info.size) == 0);
   gst_buffer_unmap (outbuffer, &info);
 
+  gst_video_frame_map (&outframe, &outinfo, outbuffer, GST_MAP_WRITE);
+  gst_video_frame_map (&refframe, &outinfo, refbuffer, GST_MAP_WRITE);
+
+  /* Multi-threaded conversion, process-wide shared pool */
+  pool = gst_video_converter_get_shared_task_pool ();
+  {
+    GstTaskPool *pool2 = gst_video_converter_get_shared_task_pool ();
+    fail_unless (pool == pool2);
+    gst_object_unref (pool2);
+  }
+  convert = gst_video_converter_new_with_pool (&ininfo, &outinfo,
+      gst_structure_new ("options",
+          GST_VIDEO_CONVERTER_OPT_THREADS, G_TYPE_UINT, 4, NULL), pool);
+  gst_video_converter_frame (convert, &inframe, &outframe);
+  gst_video_converter_free (convert);
+  /* the shared pool and its threads go away with the last user */
+  g_object_add_weak_pointer (G_OBJECT (pool), (gpointer *) & pool);
+  gst_object_unref (pool);
+  fail_unless (pool == NULL);
+
+  gst_video_frame_unmap (&outframe);
+  gst_video_frame_unmap (&refframe);
+
+  gst_buffer_map (outbuffer, &info, GST_MAP_READ);
+  fail_unless (gst_buffer_memcmp (refbuffer, 0, info.data, info.size) == 0);
+  gst_buffer_unmap (outbuffer, &info);
 
   gst_buffer_unref (refbuffer);
   gst_buffer_unref (outbuffer);
@@ -2872,6 +3070,174 @@ GST_START_TEST (test_video_convert_multithreading)
 
 GST_END_TEST;
 
+/* A smooth gradient with a steep ripple on top, so that any misplaced line or
+ * column of the scaled output changes its value */
+static void
+fill_video_frame_pattern (GstVideoFrame * frame)
+{
+  gint c, i, j, w, h;
+
+  for (c = 0; c < GST_VIDEO_FRAME_N_COMPONENTS (frame); c++) {
+    w = GST_VIDEO_FRAME_COMP_WIDTH (frame, c);
+    h = GST_VIDEO_FRAME_COMP_HEIGHT (frame, c);
+
+    for (i = 0; i < h; i++) {
+      guint8 *d = (guint8 *) GST_VIDEO_FRAME_COMP_DATA (frame, c) +
+          i * GST_VIDEO_FRAME_COMP_STRIDE (frame, c);
+      gint x, y;
+
+      for (j = 0; j < w; j++) {
+        x = c == 1 ? w - 1 - j : j;
+        y = c == 2 ? h - 1 - i : i;
+        d[j * GST_VIDEO_FRAME_COMP_PSTRIDE (frame, c)] =
+            32 + x * 64 / w + y * 64 / h + 4 * ABS ((i + j + 4 * c) % 16 - 8);
+      }
+    }
+  }
+}
+
+/* Compares the components of two frames of the same size, the formats can
+ * differ as long as they have the same components */
+static void
+compare_video_frames (GstVideoFrame * frame, GstVideoFrame * ref, gint max_diff)
+{
+  gint c, i, j, w, h;
+
+  for (c = 0; c < GST_VIDEO_FRAME_N_COMPONENTS (frame); c++) {
+    w = GST_VIDEO_FRAME_COMP_WIDTH (frame, c);
+    h = GST_VIDEO_FRAME_COMP_HEIGHT (frame, c);
+    fail_unless_equals_int (GST_VIDEO_FRAME_COMP_WIDTH (ref, c), w);
+    fail_unless_equals_int (GST_VIDEO_FRAME_COMP_HEIGHT (ref, c), h);
+
+    for (i = 0; i < h; i++) {
+      guint8 *d = (guint8 *) GST_VIDEO_FRAME_COMP_DATA (frame, c) +
+          i * GST_VIDEO_FRAME_COMP_STRIDE (frame, c);
+      guint8 *r = (guint8 *) GST_VIDEO_FRAME_COMP_DATA (ref, c) +
+          i * GST_VIDEO_FRAME_COMP_STRIDE (ref, c);
+
+      for (j = 0; j < w; j++) {
+        gint dv = d[j * GST_VIDEO_FRAME_COMP_PSTRIDE (frame, c)];
+        gint rv = r[j * GST_VIDEO_FRAME_COMP_PSTRIDE (ref, c)];
+
+        fail_unless (ABS (dv - rv) <= max_diff,
+            "component %d at %d,%d: %d != %d", c, j, i, dv, rv);
+      }
+    }
+  }
+}
+
+static GstBuffer *
+convert_video_buffer (GstBuffer * inbuffer, GstVideoInfo * ininfo,
+    GstVideoFormat format, gint width, gint height, GstVideoInfo * outinfo,
+    gboolean scale_options)
+{
+  GstVideoFrame inframe, outframe;
+  GstBuffer *outbuffer;
+  GstVideoConverter *convert;
+  GstStructure *options = NULL;
+
+  fail_unless (gst_video_info_set_format (outinfo, format, width, height));
+  outbuffer = gst_buffer_new_and_alloc (outinfo->size);
+
+  if (scale_options)
+    options = gst_structure_new ("options",
+        GST_VIDEO_CONVERTER_OPT_RESAMPLER_METHOD,
+        GST_TYPE_VIDEO_RESAMPLER_METHOD, GST_VIDEO_RESAMPLER_METHOD_LANCZOS,
+        GST_VIDEO_CONVERTER_OPT_THREADS, G_TYPE_UINT, 3, NULL);
+
+  gst_video_frame_map (&inframe, ininfo, inbuffer, GST_MAP_READ);
+  gst_video_frame_map (&outframe, outinfo, outbuffer, GST_MAP_WRITE);
+  convert = gst_video_converter_new (ininfo, outinfo, options);
+  gst_video_converter_frame (convert, &inframe, &outframe);
+  gst_video_converter_free (convert);
+  gst_video_frame_unmap (&outframe);
+  gst_video_frame_unmap (&inframe);
+
+  return outbuffer;
+}
+
+typedef struct
+{
+  GstVideoFormat in_format;
+  GstVideoFormat out_format;
+  /* format the unfused path scales in */
+  GstVideoFormat scale_format;
+  gint in_width, in_height;
+  gint out_width, out_height;
+} FusedScaleTest;
+
+/* The fused paths scale and convert each line in one go, compare them with
+ * scaling in the input format and converting the result without scaling.
+ * The fused paths always scale horizontally first, the reference scales in
+ * two passes in the same order so that the 8 bit intermediates match. */
+GST_START_TEST (test_video_convert_fused_scale)
+{
+  static const FusedScaleTest tests[] = {
+    {GST_VIDEO_FORMAT_I420, GST_VIDEO_FORMAT_BGRx, GST_VIDEO_FORMAT_I420,
+        320, 240, 480, 360},
+    {GST_VIDEO_FORMAT_I420, GST_VIDEO_FORMAT_BGRx, GST_VIDEO_FORMAT_I420,
+        320, 240, 213, 119},
+    {GST_VIDEO_FORMAT_YV12, GST_VIDEO_FORMAT_BGRA, GST_VIDEO_FORMAT_YV12,
+        320, 240, 211, 301},
+    {GST_VIDEO_FORMAT_NV12, GST_VIDEO_FORMAT_I420, GST_VIDEO_FORMAT_NV12,
+        320, 240, 640, 360},
+    {GST_VIDEO_FORMAT_NV12, GST_VIDEO_FORMAT_I420, GST_VIDEO_FORMAT_NV12,
+        320, 240, 211, 157},
+    {GST_VIDEO_FORMAT_NV21, GST_VIDEO_FORMAT_YV12, GST_VIDEO_FORMAT_NV21,
+        320, 240, 400, 97},
+  };
+  guint n;
+
+  for (n = 0; n < G_N_ELEMENTS (tests); n++) {
+    const FusedScaleTest *t = &tests[n];
+    GstVideoInfo ininfo, outinfo, hinfo, vinfo, refinfo;
+    GstVideoFrame inframe, outframe, refframe;
+    GstBuffer *inbuffer, *outbuffer, *hbuffer, *vbuffer, *refbuffer;
+
+    GST_DEBUG ("%s %dx%d -> %s %dx%d",
+        gst_video_format_to_string (t->in_format), t->in_width, t->in_height,
+        gst_video_format_to_string (t->out_format), t->out_width,
+        t->out_height);
+
+    fail_unless (gst_video_info_set_format (&ininfo, t->in_format,
+            t->in_width, t->in_height));
+    inbuffer = gst_buffer_new_and_alloc (ininfo.size);
+    gst_video_frame_map (&inframe, &ininfo, inbuffer, GST_MAP_WRITE);
+    fill_video_frame_pattern (&inframe);
+    gst_video_frame_unmap (&inframe);
+
+    outbuffer = convert_video_buffer (inbuffer, &ininfo, t->out_format,
+        t->out_width, t->out_height, &outinfo, TRUE);
+
+    hbuffer = convert_video_buffer (inbuffer, &ininfo, t->scale_format,
+        t->out_width, t->in_height, &hinfo, TRUE);
+    vbuffer = convert_video_buffer (hbuffer, &hinfo, t->scale_format,
+        t->out_width, t->out_height, &vinfo, TRUE);
+    if (GST_VIDEO_INFO_IS_RGB (&outinfo)) {
+      refbuffer = convert_video_buffer (vbuffer, &vinfo, t->out_format,
+          t->out_width, t->out_height, &refinfo, FALSE);
+    } else {
+      /* the planar formats have the same components, compare them directly */
+      refbuffer = gst_buffer_ref (vbuffer);
+      refinfo = vinfo;
+    }
+
+    gst_video_frame_map (&outframe, &outinfo, outbuffer, GST_MAP_READ);
+    gst_video_frame_map (&refframe, &refinfo, refbuffer, GST_MAP_READ);
+    compare_video_frames (&outframe, &refframe, 1);
+    gst_video_frame_unmap (&refframe);
+    gst_video_frame_unmap (&outframe);
+
+    gst_buffer_unref (refbuffer);
+    gst_buffer_unref (vbuffer);
+    gst_buffer_unref (hbuffer);
+    gst_buffer_unref (outbuffer);
+    gst_buffer_unref (inbuffer);
+  }
+}
+
+GST_END_TEST;
+
 GST_START_TEST (test_video_transfer)
 {
   gint i, j;
@@ -4036,6 +4402,7 @@ video_suite (void)
   tcase_add_test (tc_chain, test_video_chroma);
   tcase_add_test (tc_chain, test_video_chroma_site);
   tcase_add_test (tc_chain, test_video_scaler);
+  tcase_add_test (tc_chain, test_video_scaler_avx2);
   tcase_add_test (tc_chain, test_video_color_convert_rgb_rgb);
   tcase_add_test (tc_chain, test_video_color_convert_rgb_yuv);
   tcase_add_test (tc_chain, test_video_color_convert_yuv_yuv);
@@ -4044,6 +4411,7 @@ video_suite (void)
   tcase_add_test (tc_chain, test_video_size_convert);
   tcase_add_test (tc_chain, test_video_convert);
   tcase_add_test (tc_chain, test_video_convert_multithreading);
+  tcase_add_test (tc_chain, test_video_convert_fused_scale);
   tcase_add_test (tc_chain, test_video_transfer);
   tcase_add_test (tc_chain, test_overlay_blend);
   tcase_add_test (tc_chain, test_video_center_rect);
@@ -234,6 +234,87 @@ GST_START_TEST (test_that_tcpserversink_and_tcpclientsrc_are_symmetrical)
 
 GST_END_TEST;
 
+static GstPadProbeReturn
+count_buffer_lists_cb (GstPad * pad, GstPadProbeInfo * info,
+    gpointer user_data)
+{
+  gint *n_lists = user_data;
+
+  g_atomic_int_inc (n_lists);
+
+  return GST_PAD_PROBE_OK;
+}
+
+GST_START_TEST (test_tcpclientsrc_buffer_list)
+{
+  SymmetryTest st = { 0 };
+  GstElement *serversink = gst_check_setup_element ("tcpserversink");
+  GstElement *clientsrc = gst_check_setup_element ("tcpclientsrc");
+  guint timeout = 100;
+  guint8 *data;
+  gsize size = 256 * 1024, received = 0, i;
+  gint n_lists = 0;
+  GstStructure *stats;
+  guint64 bytes_received;
+  GstPad *pad;
+
+  /* the reads grow beyond the default while data is queued on the socket
+   * and come out as buffer lists */
+  g_object_set (clientsrc, "buffer-list", TRUE, "max-read-size", 64 * 1024,
+      NULL);
+  /* appsink unpacks the lists, so look for them before they get there */
+  pad = gst_element_get_static_pad (clientsrc, "src");
+  gst_pad_add_probe (pad, GST_PAD_PROBE_TYPE_BUFFER_LIST,
+      count_buffer_lists_cb, &n_lists, NULL);
+  gst_object_unref (pad);
+
+  symmetry_test_setup (&st, serversink, clientsrc);
+
+  while (timeout) {
+    guint handles;
+    g_object_get (serversink, "num-handles", &handles, NULL);
+    if (handles > 0)
+      break;
+    g_usleep (G_USEC_PER_SEC / 100);
+    timeout--;
+  }
+
+  data = g_malloc (size);
+  for (i = 0; i < size; i++)
+    data[i] = i % 251;
+  fail_unless (gst_app_src_push_buffer (st.sink_src,
+          gst_buffer_new_wrapped (g_memdup (data, size), size)) == GST_FLOW_OK);
+
+  while (received < size) {
+    GstSample *out = gst_app_sink_pull_sample (st.src_sink);
+    GstBuffer *buf;
+    gsize buf_size;
+
+    fail_unless (out != NULL);
+    buf = gst_sample_get_buffer (out);
+    buf_size = gst_buffer_get_size (buf);
+    fail_unless (received + buf_size <= size);
+    fail_unless (gst_buffer_memcmp (buf, 0, data + received, buf_size) == 0);
+    received += buf_size;
+    gst_sample_unref (out);
+  }
+
+  /* every read is pushed as a list, even if nothing more was queued */
+  fail_unless (g_atomic_int_get (&n_lists) > 0);
+
+  /* the reads ask for more than was sent, only the received bytes count */
+  g_object_get (clientsrc, "stats", &stats, NULL);
+  fail_unless (gst_structure_get_uint64 (stats, "bytes-received",
+          &bytes_received));
+  fail_unless_equals_uint64 (bytes_received, size);
+  gst_structure_free (stats);
+
+  g_free (data);
+  symmetry_test_teardown (&st);
+}
+
+GST_END_TEST;
+
 static void
 on_connection_closed (GstElement * socketsrc, gpointer user_data)
 {
@@ -381,6 +462,7 @@ socketintegrationtest_suite (void)
       test_that_tcpclientsink_and_tcpserversrc_are_symmetrical);
   tcase_add_test (tc_chain,
       test_that_tcpserversink_and_tcpclientsrc_are_symmetrical);
+  tcase_add_test (tc_chain, test_tcpclientsrc_buffer_list);
   tcase_add_test (tc_chain,
       test_that_we_can_provide_new_socketsrc_sockets_during_signal);
 #ifdef HAVE_GIO_UNIX_2_0